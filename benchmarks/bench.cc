@@ -0,0 +1,200 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "../rtengine/simdkernels.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace bench {
+
+namespace {
+
+std::string json_escape(const std::string &s)
+{
+    std::string ret;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+        }
+        ret += c;
+    }
+    return ret;
+}
+
+
+std::string key(const std::string &group, const std::string &name)
+{
+    return group + "/" + name;
+}
+
+
+// extracts the value of "field" from a line of the results file; the
+// format is the one written by saveResults(), one result per line
+bool get_field(const std::string &line, const char *field, std::string &out)
+{
+    const std::string f = std::string("\"") + field + "\": ";
+    auto pos = line.find(f);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos += f.size();
+    if (pos < line.size() && line[pos] == '"') {
+        auto end = line.find('"', pos + 1);
+        if (end == std::string::npos) {
+            return false;
+        }
+        out = line.substr(pos + 1, end - pos - 1);
+    } else {
+        auto end = line.find_first_of(",}", pos);
+        out = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+} // namespace
+
+
+void Registry::add(const std::string &group, const std::string &name, int repeat, std::function<void()> run, std::function<void()> setup, std::function<void()> teardown)
+{
+    benchmarks_.push_back({group, name, repeat, setup, run, teardown});
+}
+
+
+Result run(const Benchmark &b, int repeat)
+{
+    Result res;
+    res.group = b.group;
+    res.name = b.name;
+
+    if (b.setup) {
+        b.setup();
+    }
+
+    // warm-up run, not measured
+    b.run();
+
+    std::vector<double> times;
+    for (int i = 0; i < std::max(repeat, 1); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        b.run();
+        auto stop = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+
+    if (b.teardown) {
+        b.teardown();
+    }
+
+    std::sort(times.begin(), times.end());
+    res.runs = times.size();
+    res.min_ms = times.front();
+    res.median_ms = times[times.size() / 2];
+    res.mean_ms = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+    return res;
+}
+
+
+bool saveResults(const std::string &fname, const std::vector<Result> &results)
+{
+    std::ofstream out(fname);
+    if (!out) {
+        return false;
+    }
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    out << "{\n\"format\": 1,\n"
+        << "\"threads\": " << threads << ",\n"
+        << "\"simd\": \"" << rtengine::simd::levelName(rtengine::simd::level()) << "\",\n"
+        << "\"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &r = results[i];
+        char buf[256];
+        snprintf(buf, sizeof(buf), "\"runs\": %d, \"min_ms\": %.3f, \"median_ms\": %.3f, \"mean_ms\": %.3f", r.runs, r.min_ms, r.median_ms, r.mean_ms);
+        out << "{\"group\": \"" << json_escape(r.group) << "\", \"name\": \"" << json_escape(r.name) << "\", " << buf << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+
+    return bool(out);
+}
+
+
+bool loadBaseline(const std::string &fname, std::map<std::string, double> &out)
+{
+    std::ifstream in(fname);
+    if (!in) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string group, name, median;
+        if (get_field(line, "group", group) && get_field(line, "name", name) && get_field(line, "median_ms", median)) {
+            out[key(group, name)] = atof(median.c_str());
+        }
+    }
+    return true;
+}
+
+
+int compare(const std::vector<Result> &results, const std::map<std::string, double> &baseline, double threshold)
+{
+    int regressions = 0;
+
+    printf("\n%-48s %12s %12s %8s\n", "benchmark", "baseline ms", "current ms", "change");
+    for (auto &r : results) {
+        auto it = baseline.find(key(r.group, r.name));
+        if (it == baseline.end() || it->second <= 0) {
+            printf("%-48s %12s %12.2f %8s\n", key(r.group, r.name).c_str(), "-", r.median_ms, "new");
+            continue;
+        }
+        const double change = r.median_ms / it->second - 1.0;
+        const bool slower = change > threshold;
+        if (slower) {
+            ++regressions;
+        }
+        printf("%-48s %12.2f %12.2f %+7.1f%%%s\n", key(r.group, r.name).c_str(), it->second, r.median_ms, change * 100.0, slower ? "  <-- REGRESSION" : "");
+    }
+
+    return regressions;
+}
+
+
+void doNotOptimize(const void *p)
+{
+    static volatile const void *sink;
+    sink = p;
+}
+
+} // namespace bench
@@ -0,0 +1,90 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct Config {
+    std::string datadir;   // ART data dir (for the colour profiles)
+    std::string tmpdir;    // where the synthetic raw files are written
+    std::string profiles;  // dir with the processing profiles of the macro benchmarks
+    int width = 3000;      // size of the synthetic images
+    int height = 2000;
+    int repeat = 0;        // 0 means use the default of each benchmark
+};
+
+
+// A benchmark runs the code to measure once per call of run(); setup and
+// teardown are called once, outside of the timed region
+struct Benchmark {
+    std::string group; // "micro" or "macro"
+    std::string name;
+    int repeat;
+    std::function<void()> setup;
+    std::function<void()> run;
+    std::function<void()> teardown;
+};
+
+
+struct Result {
+    std::string group;
+    std::string name;
+    int runs = 0;
+    double min_ms = 0;
+    double median_ms = 0;
+    double mean_ms = 0;
+};
+
+
+class Registry {
+public:
+    void add(const std::string &group, const std::string &name, int repeat, std::function<void()> run, std::function<void()> setup=nullptr, std::function<void()> teardown=nullptr);
+
+    const std::vector<Benchmark> &benchmarks() const { return benchmarks_; }
+
+private:
+    std::vector<Benchmark> benchmarks_;
+};
+
+
+void registerMicro(Registry &reg, const Config &cfg);
+void registerMacro(Registry &reg, const Config &cfg);
+
+Result run(const Benchmark &b, int repeat);
+
+bool saveResults(const std::string &fname, const std::vector<Result> &results);
+
+// reads the median timings of a results file written by saveResults()
+bool loadBaseline(const std::string &fname, std::map<std::string, double> &out);
+
+// prints a comparison table, and returns the number of benchmarks slower
+// than the baseline by more than threshold (a fraction, e.g. 0.1 = 10%)
+int compare(const std::vector<Result> &results, const std::map<std::string, double> &baseline, double threshold);
+
+// prevents the compiler from optimising away the computation of a value
+void doNotOptimize(const void *p);
+
+} // namespace bench
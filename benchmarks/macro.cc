@@ -0,0 +1,119 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "synthetic.h"
+#include "../rtengine/rtengine.h"
+#include "../rtengine/procparams.h"
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+#include <algorithm>
+#include <memory>
+#include <stdio.h>
+
+using namespace rtengine;
+using namespace rtengine::procparams;
+
+/*
+ * Macro benchmarks: the full processing pipeline (as used by the batch
+ * queue and ART-cli) on synthetic raw files, with each of the processing
+ * profiles found in Config::profiles
+ */
+
+namespace bench {
+
+namespace {
+
+std::vector<std::string> list_profiles(const std::string &dir)
+{
+    std::vector<std::string> ret;
+    try {
+        Glib::Dir d(dir);
+        for (auto name : d) {
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".arp") {
+                ret.push_back(name);
+            }
+        }
+    } catch (Glib::Exception &exc) {
+        fprintf(stderr, "ERROR: can't read the profiles in %s: %s\n", dir.c_str(), Glib::ustring(exc.what()).c_str());
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+
+struct Input {
+    const char *name;
+    CFA cfa;
+    bool compressed;
+};
+
+const Input inputs[] = {
+    { "bayer", CFA::BAYER, false },
+    { "bayer_ljpeg", CFA::BAYER, true },
+    { "xtrans_ljpeg", CFA::XTRANS, true }
+};
+
+} // namespace
+
+
+void registerMacro(Registry &reg, const Config &cfg)
+{
+    const auto profiles = list_profiles(cfg.profiles);
+
+    for (auto &input : inputs) {
+        const std::string fname = cfg.tmpdir + "/macro_" + input.name + ".dng";
+        auto written = std::make_shared<bool>(false);
+
+        for (auto &p : profiles) {
+            const std::string profile = Glib::build_filename(cfg.profiles, p);
+            auto params = std::make_shared<ProcParams>();
+
+            auto setup =
+                [=]() {
+                    if (!*written) {
+                        *written = writeDNG(fname, cfg.width, cfg.height, input.cfa, input.compressed, 4);
+                        if (!*written) {
+                            fprintf(stderr, "ERROR: can't write %s\n", fname.c_str());
+                        }
+                    }
+                    if (params->load(nullptr, profile) != 0) {
+                        fprintf(stderr, "ERROR: can't load %s\n", profile.c_str());
+                    }
+                };
+
+            auto run =
+                [=]() {
+                    int err = 0;
+                    ProcessingJob *job = ProcessingJob::create(fname, true, *params);
+                    IImagefloat *img = processImage(job, err, nullptr);
+                    if (img) {
+                        img->free();
+                    } else {
+                        fprintf(stderr, "ERROR: processing of %s failed (%d)\n", fname.c_str(), err);
+                    }
+                };
+
+            reg.add("macro", std::string("processImage/") + input.name + "/" + p.substr(0, p.size() - 4), 3, run, setup);
+        }
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,215 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "config.h"
+#include "options.h"
+#include "../rtengine/rtengine.h"
+#include "../rtengine/settings.h"
+#include <giomm.h>
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+#include <glib/gstdio.h>
+#include <iostream>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * art-bench: runs the micro and macro benchmarks, writes the timings to a
+ * JSON file and optionally compares them against a baseline written by a
+ * previous run. The exit status is 1 if any benchmark is slower than the
+ * baseline by more than the given threshold.
+ */
+
+extern Options options;
+
+// needed by the rtgui code we link with
+Glib::ustring creditsPath;
+Glib::ustring licensePath;
+Glib::ustring argv1;
+bool progress = false;
+
+namespace {
+
+void print_help(const char *prog)
+{
+    std::cout << "Usage: " << prog << " [options]\n"
+              << "  --list                only list the benchmarks\n"
+              << "  --filter=STR          only run the benchmarks whose name contains STR\n"
+              << "  --micro-only          only run the micro benchmarks\n"
+              << "  --macro-only          only run the macro benchmarks\n"
+              << "  --repeat=N            number of timed runs of each benchmark\n"
+              << "  --size=WxH            size of the synthetic images (default 3000x2000)\n"
+              << "  --output=FILE         write the results to FILE (JSON)\n"
+              << "  --baseline=FILE       compare the results with FILE\n"
+              << "  --threshold=PERCENT   regression threshold (default 10)\n"
+              << "  --datadir=DIR         ART data dir (default " << DATA_SEARCH_PATH << ")\n"
+              << "  --profiles=DIR        processing profiles of the macro benchmarks\n"
+              << "  --tmpdir=DIR          where the synthetic raw files are written\n";
+}
+
+
+bool get_arg(const char *arg, const char *name, std::string &out)
+{
+    const size_t n = strlen(name);
+    if (strncmp(arg, name, n) == 0 && arg[n] == '=') {
+        out = arg + n + 1;
+        return true;
+    }
+    return false;
+}
+
+
+void remove_dir(const std::string &dir)
+{
+    try {
+        Glib::Dir d(dir);
+        for (auto name : d) {
+            auto fname = Glib::build_filename(dir, name);
+            if (Glib::file_test(fname, Glib::FILE_TEST_IS_DIR)) {
+                remove_dir(fname);
+            } else {
+                g_remove(fname.c_str());
+            }
+        }
+    } catch (Glib::FileError &) {
+    }
+    g_rmdir(dir.c_str());
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    setlocale(LC_NUMERIC, "C");
+    Gio::init();
+
+    bench::Config cfg;
+    cfg.datadir = DATA_SEARCH_PATH;
+    cfg.profiles = Glib::build_filename(BENCHMARKS_SOURCE_DIR, "profiles");
+
+    std::string filter, output, baseline, val;
+    double threshold = 10;
+    bool list = false, micro = true, macro = true;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *a = argv[i];
+        if (strcmp(a, "--list") == 0) {
+            list = true;
+        } else if (strcmp(a, "--micro-only") == 0) {
+            macro = false;
+        } else if (strcmp(a, "--macro-only") == 0) {
+            micro = false;
+        } else if (get_arg(a, "--filter", filter) || get_arg(a, "--output", output) ||
+                   get_arg(a, "--baseline", baseline) || get_arg(a, "--datadir", cfg.datadir) ||
+                   get_arg(a, "--profiles", cfg.profiles) || get_arg(a, "--tmpdir", cfg.tmpdir)) {
+            continue;
+        } else if (get_arg(a, "--repeat", val)) {
+            cfg.repeat = atoi(val.c_str());
+        } else if (get_arg(a, "--threshold", val)) {
+            threshold = atof(val.c_str());
+        } else if (get_arg(a, "--size", val)) {
+            if (sscanf(val.c_str(), "%dx%d", &cfg.width, &cfg.height) != 2 || cfg.width < 64 || cfg.height < 64) {
+                std::cerr << "invalid size: " << val << std::endl;
+                return 2;
+            }
+        } else {
+            print_help(argv[0]);
+            return strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0 ? 0 : 2;
+        }
+    }
+
+    std::string userdir;
+    try {
+        userdir = Glib::dir_make_tmp("art-bench-XXXXXX");
+    } catch (Glib::FileError &exc) {
+        std::cerr << "can't create a temporary directory: " << exc.what() << std::endl;
+        return 2;
+    }
+    if (cfg.tmpdir.empty()) {
+        cfg.tmpdir = userdir;
+    }
+
+    bench::Registry reg;
+    if (micro) {
+        bench::registerMicro(reg, cfg);
+    }
+    if (macro) {
+        bench::registerMacro(reg, cfg);
+    }
+
+    std::vector<const bench::Benchmark *> todo;
+    for (auto &b : reg.benchmarks()) {
+        if (filter.empty() || (b.group + "/" + b.name).find(filter) != std::string::npos) {
+            todo.push_back(&b);
+        }
+    }
+
+    if (list) {
+        for (auto b : todo) {
+            std::cout << b->group << "/" << b->name << std::endl;
+        }
+        remove_dir(userdir);
+        return 0;
+    }
+
+    // use the default settings (and not the ones of the user), so that the
+    // results do not depend on the local configuration
+    options.ART_base_dir = cfg.datadir;
+    options.rtSettings.lensfunDbDirectory = LENSFUN_DB_PATH;
+    options.rtSettings.verbose = 0;
+    rtengine::init(&options.rtSettings, cfg.datadir, userdir, false);
+
+    std::vector<bench::Result> results;
+    for (auto b : todo) {
+        std::cout << b->group << "/" << b->name << "... " << std::flush;
+        results.push_back(bench::run(*b, cfg.repeat > 0 ? cfg.repeat : b->repeat));
+        auto &r = results.back();
+        printf("%.2f ms (min %.2f, %d runs)\n", r.median_ms, r.min_ms, r.runs);
+    }
+
+    int ret = 0;
+
+    if (!output.empty() && !bench::saveResults(output, results)) {
+        std::cerr << "can't write " << output << std::endl;
+        ret = 2;
+    }
+
+    if (!baseline.empty()) {
+        std::map<std::string, double> base;
+        if (!bench::loadBaseline(baseline, base)) {
+            std::cout << "\nno baseline found at " << baseline << ", skipping the comparison" << std::endl;
+        } else {
+            int n = bench::compare(results, base, threshold / 100.0);
+            if (n > 0) {
+                std::cout << "\n" << n << " benchmark(s) slower than the baseline by more than " << threshold << "%" << std::endl;
+                ret = ret ? ret : 1;
+            }
+        }
+    }
+
+    rtengine::cleanup();
+    remove_dir(userdir);
+
+    return ret;
+}
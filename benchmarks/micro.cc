@@ -0,0 +1,492 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "synthetic.h"
+#include "../rtengine/gauss.h"
+#include "../rtengine/boxblur.h"
+#include "../rtengine/guidedfilter.h"
+#include "../rtengine/improcfun.h"
+#include "../rtengine/imagefloat.h"
+#include "../rtengine/ipdenoise.h"
+#include "../rtengine/medianfilter.h"
+#include "../rtengine/LUT3D.h"
+#include "../rtengine/rawimage.h"
+#include "../rtengine/rawimagesource.h"
+#include "../rtengine/procparams.h"
+#include "../rtgui/thumbbrowserlayout.h"
+#include <algorithm>
+#include <memory>
+#include <cmath>
+#include <string>
+#include <stdio.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace rtengine;
+using namespace rtengine::procparams;
+
+namespace bench {
+
+namespace {
+
+int num_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+
+// lazily-built inputs shared by several benchmarks
+struct Inputs {
+    explicit Inputs(const Config &c): cfg(c) {}
+
+    const array2D<float> &plane()
+    {
+        if (!plane_) {
+            plane_.reset(new array2D<float>());
+            makePlane(cfg.width, cfg.height, 1, *plane_);
+        }
+        return *plane_;
+    }
+
+    Imagefloat *image()
+    {
+        if (!image_) {
+            array2D<float> rgb[3];
+            makeScene(cfg.width, cfg.height, 2, rgb[0], rgb[1], rgb[2]);
+            image_.reset(new Imagefloat(cfg.width, cfg.height));
+            for (int y = 0; y < cfg.height; ++y) {
+                for (int x = 0; x < cfg.width; ++x) {
+                    image_->r(y, x) = rgb[0][y][x] * 65535.f;
+                    image_->g(y, x) = rgb[1][y][x] * 65535.f;
+                    image_->b(y, x) = rgb[2][y][x] * 65535.f;
+                }
+            }
+        }
+        return image_.get();
+    }
+
+    const std::string &dng(CFA cfa, bool compressed)
+    {
+        std::string &fname = dngs_[int(cfa) * 2 + int(compressed)];
+        if (fname.empty()) {
+            fname = cfg.tmpdir + "/" + (cfa == CFA::BAYER ? "bayer" : "xtrans") + (compressed ? "_ljpeg" : "") + ".dng";
+            if (!writeDNG(fname, cfg.width, cfg.height, cfa, compressed, 3)) {
+                fprintf(stderr, "ERROR: can't write %s\n", fname.c_str());
+            }
+        }
+        return fname;
+    }
+
+    const Config &cfg;
+
+private:
+    std::unique_ptr<array2D<float>> plane_;
+    std::unique_ptr<Imagefloat> image_;
+    std::string dngs_[4];
+};
+
+
+void register_filters(Registry &reg, std::shared_ptr<Inputs> in)
+{
+    const int W = in->cfg.width;
+    const int H = in->cfg.height;
+    auto dst = std::make_shared<array2D<float>>();
+
+    auto alloc = [=]() { (*dst)(W, H); in->plane(); };
+    auto release = [=]() { (*dst)(0, 0); };
+
+    for (double sigma : { 2.0, 10.0, 40.0 }) {
+        reg.add("micro", "gaussianBlur/sigma" + std::to_string(int(sigma)), 5,
+                [=]() {
+                    array2D<float> &src = const_cast<array2D<float> &>(in->plane());
+#ifdef _OPENMP
+#                   pragma omp parallel
+#endif
+                    gaussianBlur(src, *dst, W, H, sigma);
+                }, alloc, release);
+    }
+
+    for (int radius : { 8, 64 }) {
+        reg.add("micro", "boxblur/r" + std::to_string(radius), 5,
+                [=]() {
+                    array2D<float> &src = const_cast<array2D<float> &>(in->plane());
+                    boxblur(src, *dst, radius, W, H, true);
+                }, alloc, release);
+    }
+
+    for (int radius : { 8, 32 }) {
+        reg.add("micro", "guidedFilter/r" + std::to_string(radius), 5,
+                [=]() {
+                    guidedFilter(in->plane(), in->plane(), *dst, radius, 0.01f, true);
+                }, alloc, release);
+    }
+
+    // the sorting networks of median.h against the histogram-based filter
+    const std::pair<denoise::Median, int> networks[] = {
+        { denoise::Median::TYPE_3X3_STRONG, 1 },
+        { denoise::Median::TYPE_5X5_STRONG, 2 },
+        { denoise::Median::TYPE_7X7, 3 },
+        { denoise::Median::TYPE_9X9, 4 }
+    };
+    for (auto &p : networks) {
+        const int d = 2 * p.second + 1;
+        const auto type = p.first;
+        reg.add("micro", "median/network_" + std::to_string(d) + "x" + std::to_string(d), 5,
+                [=]() {
+                    array2D<float> &src = const_cast<array2D<float> &>(in->plane());
+                    denoise::Median_Denoise(src, *dst, W, H, type, 1, num_threads());
+                }, alloc, release);
+    }
+    for (int radius : { 1, 2, 3, 4, 16, 64 }) {
+        reg.add("micro", "median/histogram_r" + std::to_string(radius), 5,
+                [=]() {
+                    medianFilter(in->plane(), *dst, radius, true);
+                }, alloc, release);
+    }
+}
+
+
+void register_image_ops(Registry &reg, std::shared_ptr<Inputs> in)
+{
+    const int W = in->cfg.width;
+    const int H = in->cfg.height;
+    auto params = std::make_shared<ProcParams>();
+    auto work = std::make_shared<std::unique_ptr<Imagefloat>>();
+
+    auto copy_input = [=]() {
+        work->reset(new Imagefloat(W, H));
+        in->image()->copyTo(work->get());
+    };
+    auto release = [=]() { work->reset(); };
+
+    for (float scale : { 0.5f, 0.25f }) {
+        auto dst = std::make_shared<std::unique_ptr<Imagefloat>>();
+        reg.add("micro", "Lanczos/x" + std::to_string(int(1.f / scale)), 5,
+                [=]() {
+                    ImProcFunctions ipf(params.get(), true);
+                    ipf.Lanczos(in->image(), dst->get(), scale);
+                },
+                [=]() { in->image(); dst->reset(new Imagefloat(W * scale + 0.5f, H * scale + 0.5f)); },
+                [=]() { dst->reset(); });
+    }
+
+    const std::pair<Imagefloat::Mode, const char *> modes[] = {
+        { Imagefloat::Mode::LAB, "lab" },
+        { Imagefloat::Mode::YUV, "yuv" },
+        { Imagefloat::Mode::XYZ, "xyz" }
+    };
+    for (auto &m : modes) {
+        const auto mode = m.first;
+        reg.add("micro", std::string("Imagefloat::setMode/rgb_") + m.second + "_rgb", 5,
+                [=]() {
+                    (*work)->setMode(mode, true);
+                    (*work)->setMode(Imagefloat::Mode::RGB, true);
+                }, copy_input, release);
+    }
+
+    class Init: public LUT3D::initializer {
+    public:
+        void operator()(float &r, float &g, float &b) override
+        {
+            // a smooth but non-separable transform
+            const float l = 0.3f * r + 0.6f * g + 0.1f * b;
+            r = std::pow(std::max(r * 0.9f + 0.1f * g, 0.f), 0.8f);
+            g = l + (g - l) * 1.2f;
+            b = std::sqrt(std::max(b * 0.8f + 0.2f * l, 0.f));
+        }
+    };
+    auto lut = std::make_shared<LUT3D>();
+    reg.add("micro", "LUT3D/apply", 5,
+            [=]() {
+                Imagefloat *img = work->get();
+#ifdef _OPENMP
+#               pragma omp parallel for
+#endif
+                for (int y = 0; y < H; ++y) {
+                    for (int x = 0; x < W; ++x) {
+                        float r = img->r(y, x) / 65535.f;
+                        float g = img->g(y, x) / 65535.f;
+                        float b = img->b(y, x) / 65535.f;
+                        (*lut)(r, g, b);
+                        img->r(y, x) = r * 65535.f;
+                        img->g(y, x) = g * 65535.f;
+                        img->b(y, x) = b * 65535.f;
+                    }
+                }
+            },
+            [=]() {
+                Init f;
+                lut->init(33, f);
+                copy_input();
+            }, release);
+}
+
+
+void register_raw(Registry &reg, std::shared_ptr<Inputs> in)
+{
+    const std::pair<CFA, bool> decoders[] = {
+        { CFA::BAYER, false },
+        { CFA::BAYER, true },
+        { CFA::XTRANS, true }
+    };
+    for (auto &d : decoders) {
+        const CFA cfa = d.first;
+        const bool compressed = d.second;
+        const std::string name = std::string("decode/") + (cfa == CFA::BAYER ? "bayer" : "xtrans") + (compressed ? "_ljpeg_tiled" : "_uncompressed");
+        reg.add("micro", name, 5,
+                [=]() {
+                    RawImage ri(in->dng(cfa, compressed));
+                    if (ri.loadRaw(true) != 0) {
+                        fprintf(stderr, "ERROR: can't decode %s\n", in->dng(cfa, compressed).c_str());
+                    }
+                },
+                [=]() { in->dng(cfa, compressed); });
+    }
+
+    auto src = std::make_shared<std::unique_ptr<RawImageSource>>();
+    auto load = [=](CFA cfa) {
+        return [=]() {
+            src->reset(new RawImageSource());
+            if ((*src)->load(in->dng(cfa, false)) != 0) {
+                fprintf(stderr, "ERROR: can't load %s\n", in->dng(cfa, false).c_str());
+                return;
+            }
+            RAWParams raw;
+            (*src)->preprocess(raw, LensProfParams(), CoarseTransformParams(), false);
+        };
+    };
+    auto release = [=]() { src->reset(); };
+
+    const auto &bayer = RAWParams::BayerSensor::getMethodStrings();
+    for (size_t i = 0; i < bayer.size(); ++i) {
+        const auto method = RAWParams::BayerSensor::Method(i);
+        if (method == RAWParams::BayerSensor::Method::PIXELSHIFT || method == RAWParams::BayerSensor::Method::NONE) {
+            continue;
+        }
+        reg.add("micro", std::string("demosaic/bayer_") + bayer[i], 3,
+                [=]() {
+                    RAWParams raw;
+                    raw.bayersensor.method = method;
+                    double contrast = 0;
+                    (*src)->demosaic(raw, false, contrast);
+                }, load(CFA::BAYER), release);
+    }
+
+    const auto &xtrans = RAWParams::XTransSensor::getMethodStrings();
+    for (size_t i = 0; i < xtrans.size(); ++i) {
+        const auto method = RAWParams::XTransSensor::Method(i);
+        if (method == RAWParams::XTransSensor::Method::NONE) {
+            continue;
+        }
+        reg.add("micro", std::string("demosaic/xtrans_") + xtrans[i], 3,
+                [=]() {
+                    RAWParams raw;
+                    raw.xtranssensor.method = method;
+                    double contrast = 0;
+                    (*src)->demosaic(raw, false, contrast);
+                }, load(CFA::XTRANS), release);
+    }
+}
+
+
+// The insertion of the thumbnails of a large directory in the file browser:
+// FileCatalog sorts the file names before loading them, so entries arrive
+// roughly in order, and each batch is sorted, merged into the entry vector
+// and laid out from its first position on, as FileBrowser::addEntries_ and
+// ThumbBrowserBase::arrangeNewFiles do. The cost of a batch should not
+// depend on the number of entries already there (compare batch_at_10k and
+// batch_at_100k). The legacy path (one ordered insertion and one full
+// relayout per file) is quadratic, so it is measured on fewer entries
+class Entry {
+public:
+    std::string filename;
+    bool filtered;
+    bool drawable;
+    int x, y, w, h;
+
+    int getMinimalWidth() const { return 180; }
+    int getMinimalHeight() const { return 160; }
+    int getStartX() const { return x; }
+    int getStartY() const { return y; }
+
+    void setPosition(int px, int py, int pw, int ph)
+    {
+        x = px;
+        y = py;
+        w = pw;
+        h = ph;
+    }
+};
+
+bool entry_less(const Entry *a, const Entry *b)
+{
+    return a->filename < b->filename;
+}
+
+std::vector<Entry> make_entries(int n)
+{
+    Rng rng(4);
+    std::vector<Entry> ret(n);
+    for (size_t i = 0; i < ret.size(); ++i) {
+        auto &e = ret[i];
+        char buf[64];
+        snprintf(buf, sizeof(buf), "/photos/%04u/IMG_%08u.CR2", rng.next() % 20, rng.next() % 100000000);
+        e.filename = buf;
+        e.filtered = (i % 10 == 0);
+        e.drawable = false;
+        e.x = e.y = e.w = e.h = 0;
+    }
+    std::sort(ret.begin(), ret.end(), [](const Entry &a, const Entry &b) { return a.filename < b.filename; });
+    return ret;
+}
+
+
+// the grid of ThumbBrowserBase
+class Layout {
+public:
+    static constexpr int avail_width = 1600;
+
+    void arrange(const std::vector<Entry *> &fd)
+    {
+        int num_cols = 0;
+        row_height_ = thumbbrowserlayout::rowHeight(fd);
+        size_ = thumbbrowserlayout::arrangeGrid(fd, row_height_, avail_width, num_cols, &col_widths_);
+        valid_ = size_.second > row_height_;
+    }
+
+    void arrangeNew(const std::vector<Entry *> &fd, size_t first)
+    {
+        if (!valid_ || first == 0 || !thumbbrowserlayout::updateGrid(fd, first, row_height_, col_widths_, size_)) {
+            arrange(fd);
+        }
+    }
+
+    const std::pair<int, int> &size() const { return size_; }
+
+private:
+    bool valid_ = false;
+    int row_height_ = 0;
+    std::vector<int> col_widths_;
+    std::pair<int, int> size_;
+};
+
+
+// adds entries[begin, end) to fd in sorted batches
+void add_batches(std::vector<Entry> &entries, size_t begin, size_t end, std::vector<Entry *> &fd, Layout &layout)
+{
+    constexpr size_t BATCH = 256;
+    std::vector<Entry *> batch;
+    for (size_t i = begin; i < end; i += BATCH) {
+        batch.clear();
+        for (size_t j = i; j < std::min(i + BATCH, end); ++j) {
+            batch.push_back(&entries[j]);
+        }
+        std::stable_sort(batch.begin(), batch.end(), entry_less);
+        const size_t first = thumbbrowserlayout::merge(fd, batch, entry_less);
+        layout.arrangeNew(fd, first);
+    }
+}
+
+
+struct BrowserState {
+    std::vector<Entry> entries;
+    std::vector<Entry *> fd;
+    Layout layout;
+};
+
+
+void register_filebrowser(Registry &reg)
+{
+    auto st = std::make_shared<BrowserState>();
+    const auto release =
+        [=]() {
+            st->fd.clear();
+            st->entries.clear();
+        };
+
+    reg.add("micro", "filebrowser/batch_insert_100k", 5,
+            [=]() {
+                std::vector<Entry *> fd;
+                Layout layout;
+                add_batches(st->entries, 0, st->entries.size(), fd, layout);
+                doNotOptimize(&layout.size());
+            },
+            [=]() { st->entries = make_entries(100000); },
+            release);
+
+    // 100 batches of 256 entries at the end of an already loaded directory
+    // (they are removed after each batch)
+    for (int n : { 10000, 100000 }) {
+        reg.add("micro", "filebrowser/batch_at_" + std::to_string(n / 1000) + "k", 5,
+                [=]() {
+                    const size_t sz = st->fd.size();
+                    for (int i = 0; i < 100; ++i) {
+                        add_batches(st->entries, sz, sz + 256, st->fd, st->layout);
+                        st->fd.resize(sz);
+                    }
+                    doNotOptimize(&st->layout.size());
+                },
+                [=]() {
+                    st->entries = make_entries(n + 256);
+                    st->fd.clear();
+                    for (int i = 0; i < n; ++i) {
+                        st->fd.push_back(&st->entries[i]);
+                    }
+                    st->layout = Layout();
+                    st->layout.arrange(st->fd);
+                },
+                release);
+    }
+
+    reg.add("micro", "filebrowser/ordered_insert_5k", 3,
+            [=]() {
+                std::vector<Entry *> fd;
+                Layout layout;
+                for (size_t i = 0; i < 5000; ++i) {
+                    // in directory order, which is not the sorted one
+                    Entry *e = &st->entries[(i * 7919) % 5000];
+                    fd.insert(std::lower_bound(fd.begin(), fd.end(), e, entry_less), e);
+                    layout.arrange(fd);
+                }
+                doNotOptimize(&layout.size());
+            },
+            [=]() { st->entries = make_entries(5000); },
+            release);
+}
+
+} // namespace
+
+
+void registerMicro(Registry &reg, const Config &cfg)
+{
+    auto in = std::make_shared<Inputs>(cfg);
+    register_filters(reg, in);
+    register_image_ops(reg, in);
+    register_raw(reg, in);
+    register_filebrowser(reg);
+}
+
+} // namespace bench
@@ -0,0 +1,464 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synthetic.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+constexpr int BLACK = 512;
+constexpr int WHITE = 16383;
+constexpr int TILE_SIZE = 256;
+
+// camera multipliers of the synthetic sensor
+constexpr float WB_MUL[3] = { 2.f, 1.f, 1.6f };
+
+const uint8_t BAYER_PATTERN[4] = { 0, 1, 1, 2 }; // RGGB
+
+const uint8_t XTRANS_PATTERN[36] = {
+    1, 1, 0, 1, 1, 2,
+    1, 1, 2, 1, 1, 0,
+    2, 0, 1, 0, 2, 1,
+    1, 1, 2, 1, 1, 0,
+    1, 1, 0, 1, 1, 2,
+    0, 2, 1, 2, 0, 1
+};
+
+
+struct Rect {
+    int x0, y0, x1, y1;
+    float c[3];
+};
+
+
+void scene(int W, int H, uint64_t seed, int nchan, array2D<float> *out[3])
+{
+    Rng rng(seed);
+
+    std::vector<Rect> rects(24);
+    for (auto &r : rects) {
+        r.x0 = rng.next() % W;
+        r.y0 = rng.next() % H;
+        r.x1 = std::min(W, r.x0 + int(rng.next() % (W / 4 + 1)));
+        r.y1 = std::min(H, r.y0 + int(rng.next() % (H / 4 + 1)));
+        for (int c = 0; c < 3; ++c) {
+            r.c[c] = rng.uniform() * 0.5f - 0.25f;
+        }
+    }
+
+    const float fx = 6.2831853f * (1.f + rng.uniform() * 3.f) / W;
+    const float fy = 6.2831853f * (1.f + rng.uniform() * 3.f) / H;
+
+    for (int c = 0; c < nchan; ++c) {
+        (*out[c])(W, H);
+    }
+
+    // the noise is generated per row from a row-specific seed, so that the
+    // result does not depend on the number of threads
+#ifdef _OPENMP
+#   pragma omp parallel for
+#endif
+    for (int y = 0; y < H; ++y) {
+        Rng noise(seed ^ (uint64_t(y + 1) << 20));
+        for (int x = 0; x < W; ++x) {
+            const float base = 0.45f + 0.3f * std::sin(x * fx) * std::cos(y * fy) + 0.15f * float(x) / W;
+            for (int c = 0; c < nchan; ++c) {
+                float v = base * (0.8f + 0.2f * c);
+                for (auto &r : rects) {
+                    if (x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1) {
+                        v += r.c[c];
+                    }
+                }
+                v += (noise.uniform() - 0.5f) * 0.04f;
+                (*out[c])[y][x] = std::max(0.f, std::min(v, 1.f));
+            }
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// minimal lossless JPEG (ITU T.81 process 14) encoder, predictor 1, with a
+// fixed Huffman table
+//-----------------------------------------------------------------------------
+
+// number of codes of each length (1..16), and the categories in code order
+const uint8_t HUFF_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 };
+const uint8_t HUFF_VALS[17] = { 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15, 0, 16 };
+
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t> &out): out_(out), acc_(0), n_(0) {}
+
+    void put(uint32_t bits, int len)
+    {
+        for (int i = len - 1; i >= 0; --i) {
+            acc_ = (acc_ << 1) | ((bits >> i) & 1);
+            if (++n_ == 8) {
+                emit();
+            }
+        }
+    }
+
+    void flush()
+    {
+        while (n_ != 0) {
+            acc_ = (acc_ << 1) | 1;
+            if (++n_ == 8) {
+                emit();
+            }
+        }
+    }
+
+private:
+    void emit()
+    {
+        out_.push_back(acc_);
+        if (acc_ == 0xff) {
+            out_.push_back(0);
+        }
+        acc_ = 0;
+        n_ = 0;
+    }
+
+    std::vector<uint8_t> &out_;
+    uint32_t acc_;
+    int n_;
+};
+
+
+void put16(std::vector<uint8_t> &out, int v)
+{
+    out.push_back(v >> 8);
+    out.push_back(v & 0xff);
+}
+
+
+void ljpeg_encode(const uint16_t *data, int width, int height, int bits, std::vector<uint8_t> &out)
+{
+    uint16_t code[17];
+    uint8_t codelen[17];
+    {
+        int c = 0, k = 0;
+        for (int len = 1; len <= 16; ++len) {
+            for (int i = 0; i < HUFF_BITS[len - 1]; ++i, ++k) {
+                code[HUFF_VALS[k]] = c++;
+                codelen[HUFF_VALS[k]] = len;
+            }
+            c <<= 1;
+        }
+    }
+
+    put16(out, 0xffd8);
+
+    put16(out, 0xffc4);
+    put16(out, 2 + 1 + 16 + 17);
+    out.push_back(0);
+    out.insert(out.end(), HUFF_BITS, HUFF_BITS + 16);
+    out.insert(out.end(), HUFF_VALS, HUFF_VALS + 17);
+
+    put16(out, 0xffc3);
+    put16(out, 2 + 6 + 3);
+    out.push_back(bits);
+    put16(out, height);
+    put16(out, width);
+    out.push_back(1);
+    out.push_back(0);
+    out.push_back(0x11);
+    out.push_back(0);
+
+    put16(out, 0xffda);
+    put16(out, 2 + 1 + 2 + 3);
+    out.push_back(1);
+    out.push_back(0);
+    out.push_back(0);
+    out.push_back(1); // predictor
+    out.push_back(0);
+    out.push_back(0);
+
+    BitWriter bw(out);
+    int first = 1 << (bits - 1);
+    for (int y = 0; y < height; ++y) {
+        const uint16_t *row = data + size_t(y) * width;
+        for (int x = 0; x < width; ++x) {
+            const int pred = x ? row[x - 1] : first;
+            int diff = (row[x] - pred) & 0xffff;
+            if (diff >= 0x8000) {
+                diff -= 0x10000;
+            }
+            if (diff == -0x8000) {
+                bw.put(code[16], codelen[16]);
+                continue;
+            }
+            int cat = 0;
+            for (int a = std::abs(diff); a; a >>= 1) {
+                ++cat;
+            }
+            bw.put(code[cat], codelen[cat]);
+            if (cat) {
+                bw.put(diff < 0 ? diff + (1 << cat) - 1 : diff, cat);
+            }
+        }
+        first = row[0];
+    }
+    bw.flush();
+
+    put16(out, 0xffd9);
+}
+
+
+//-----------------------------------------------------------------------------
+// minimal little-endian TIFF/DNG writer
+//-----------------------------------------------------------------------------
+
+enum TiffType {
+    BYTE = 1,
+    ASCII = 2,
+    SHORT = 3,
+    LONG = 4,
+    RATIONAL = 5,
+    SRATIONAL = 10
+};
+
+
+struct TiffEntry {
+    uint16_t tag;
+    uint16_t type;
+    uint32_t count;
+    std::vector<uint8_t> data;
+};
+
+
+class TiffWriter {
+public:
+    void add(uint16_t tag, TiffType type, const std::vector<uint32_t> &values)
+    {
+        TiffEntry e{tag, uint16_t(type), uint32_t(values.size()), {}};
+        for (auto v : values) {
+            if (type == BYTE) {
+                e.data.push_back(v);
+            } else if (type == SHORT) {
+                put(e.data, v, 2);
+            } else {
+                put(e.data, v, 4);
+            }
+        }
+        entries_.push_back(e);
+    }
+
+    void add(uint16_t tag, const std::string &s)
+    {
+        TiffEntry e{tag, ASCII, uint32_t(s.size() + 1), std::vector<uint8_t>(s.begin(), s.end())};
+        e.data.push_back(0);
+        entries_.push_back(e);
+    }
+
+    // (s)rationals are given as numerator/denominator pairs
+    void addRational(uint16_t tag, TiffType type, const std::vector<int32_t> &values)
+    {
+        TiffEntry e{tag, uint16_t(type), uint32_t(values.size() / 2), {}};
+        for (auto v : values) {
+            put(e.data, uint32_t(v), 4);
+        }
+        entries_.push_back(e);
+    }
+
+    // image data is written right after the header, starting at offset 8
+    bool write(const std::string &fname, const std::vector<uint8_t> &image)
+    {
+        std::sort(entries_.begin(), entries_.end(), [](const TiffEntry &a, const TiffEntry &b) { return a.tag < b.tag; });
+
+        std::vector<uint8_t> extra;
+        size_t extra_start = 8 + image.size();
+        extra_start += extra_start & 1;
+        std::vector<uint8_t> ifd;
+        put(ifd, entries_.size(), 2);
+        for (auto &e : entries_) {
+            put(ifd, e.tag, 2);
+            put(ifd, e.type, 2);
+            put(ifd, e.count, 4);
+            if (e.data.size() <= 4) {
+                std::vector<uint8_t> v = e.data;
+                v.resize(4, 0);
+                ifd.insert(ifd.end(), v.begin(), v.end());
+            } else {
+                put(ifd, extra_start + extra.size(), 4);
+                extra.insert(extra.end(), e.data.begin(), e.data.end());
+                if (extra.size() & 1) {
+                    extra.push_back(0);
+                }
+            }
+        }
+        put(ifd, 0, 4);
+
+        std::vector<uint8_t> header = { 'I', 'I', 42, 0 };
+        put(header, extra_start + extra.size(), 4);
+
+        FILE *f = fopen(fname.c_str(), "wb");
+        if (!f) {
+            return false;
+        }
+        bool ok = fwrite(header.data(), 1, header.size(), f) == header.size();
+        ok = ok && fwrite(image.data(), 1, image.size(), f) == image.size();
+        if (image.size() & 1) {
+            ok = ok && fputc(0, f) != EOF;
+        }
+        ok = ok && fwrite(extra.data(), 1, extra.size(), f) == extra.size();
+        ok = ok && fwrite(ifd.data(), 1, ifd.size(), f) == ifd.size();
+        return fclose(f) == 0 && ok;
+    }
+
+private:
+    static void put(std::vector<uint8_t> &out, uint32_t v, int n)
+    {
+        for (int i = 0; i < n; ++i) {
+            out.push_back((v >> (8 * i)) & 0xff);
+        }
+    }
+
+    std::vector<TiffEntry> entries_;
+};
+
+} // namespace
+
+
+void makeScene(int W, int H, uint64_t seed, array2D<float> &r, array2D<float> &g, array2D<float> &b)
+{
+    array2D<float> *out[3] = { &r, &g, &b };
+    scene(W, H, seed, 3, out);
+}
+
+
+void makePlane(int W, int H, uint64_t seed, array2D<float> &out)
+{
+    array2D<float> *o[3] = { &out, nullptr, nullptr };
+    scene(W, H, seed, 1, o);
+}
+
+
+bool writeDNG(const std::string &fname, int W, int H, CFA cfa, bool compressed, uint64_t seed)
+{
+    array2D<float> rgb[3];
+    makeScene(W, H, seed, rgb[0], rgb[1], rgb[2]);
+
+    const int pw = cfa == CFA::BAYER ? 2 : 6;
+    const uint8_t *pattern = cfa == CFA::BAYER ? BAYER_PATTERN : XTRANS_PATTERN;
+
+    std::vector<uint16_t> raw(size_t(W) * H);
+#ifdef _OPENMP
+#   pragma omp parallel for
+#endif
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            const int c = pattern[(y % pw) * pw + x % pw];
+            const float v = rgb[c][y][x] / WB_MUL[c];
+            raw[size_t(y) * W + x] = BLACK + std::round(v * (WHITE - BLACK));
+        }
+    }
+
+    TiffWriter tw;
+    std::vector<uint8_t> image;
+
+    tw.add(254, LONG, {0});
+    tw.add(256, LONG, {uint32_t(W)});
+    tw.add(257, LONG, {uint32_t(H)});
+    tw.add(258, SHORT, {16});
+    tw.add(259, SHORT, {uint32_t(compressed ? 7 : 1)});
+    tw.add(262, SHORT, {32803});
+    tw.add(271, "ART");
+    tw.add(272, cfa == CFA::BAYER ? "Synthetic Bayer" : "Synthetic X-Trans");
+    tw.add(274, SHORT, {1});
+    tw.add(277, SHORT, {1});
+    tw.add(284, SHORT, {1});
+
+    if (compressed) {
+        const int tw_n = (W + TILE_SIZE - 1) / TILE_SIZE;
+        const int th_n = (H + TILE_SIZE - 1) / TILE_SIZE;
+        std::vector<std::vector<uint8_t>> tiles(tw_n * th_n);
+
+#ifdef _OPENMP
+#       pragma omp parallel for schedule(dynamic)
+#endif
+        for (int t = 0; t < tw_n * th_n; ++t) {
+            const int x0 = (t % tw_n) * TILE_SIZE;
+            const int y0 = (t / tw_n) * TILE_SIZE;
+            // tiles are padded by replicating the last row/column
+            std::vector<uint16_t> buf(TILE_SIZE * TILE_SIZE);
+            for (int y = 0; y < TILE_SIZE; ++y) {
+                for (int x = 0; x < TILE_SIZE; ++x) {
+                    buf[y * TILE_SIZE + x] = raw[size_t(std::min(y0 + y, H - 1)) * W + std::min(x0 + x, W - 1)];
+                }
+            }
+            ljpeg_encode(buf.data(), TILE_SIZE, TILE_SIZE, 16, tiles[t]);
+        }
+
+        std::vector<uint32_t> offsets, sizes;
+        for (auto &t : tiles) {
+            offsets.push_back(8 + image.size());
+            sizes.push_back(t.size());
+            image.insert(image.end(), t.begin(), t.end());
+            if (image.size() & 1) {
+                image.push_back(0);
+            }
+        }
+        tw.add(322, LONG, {uint32_t(TILE_SIZE)});
+        tw.add(323, LONG, {uint32_t(TILE_SIZE)});
+        tw.add(324, LONG, offsets);
+        tw.add(325, LONG, sizes);
+    } else {
+        image.resize(raw.size() * 2);
+        for (size_t i = 0; i < raw.size(); ++i) {
+            image[2 * i] = raw[i] & 0xff;
+            image[2 * i + 1] = raw[i] >> 8;
+        }
+        tw.add(273, LONG, {8});
+        tw.add(278, LONG, {uint32_t(H)});
+        tw.add(279, LONG, {uint32_t(image.size())});
+    }
+
+    tw.add(33421, SHORT, {uint32_t(pw), uint32_t(pw)});
+    tw.add(33422, BYTE, std::vector<uint32_t>(pattern, pattern + pw * pw));
+    tw.add(50706, BYTE, {1, 4, 0, 0});
+    tw.add(50708, cfa == CFA::BAYER ? "ART Synthetic Bayer" : "ART Synthetic X-Trans");
+    tw.add(50714, LONG, {uint32_t(BLACK)});
+    tw.add(50717, LONG, {uint32_t(WHITE)});
+    // XYZ -> camera: the synthetic sensor has sRGB primaries
+    tw.addRational(50721, SRATIONAL, {
+            32406, 10000, -15372, 10000, -4986, 10000,
+            -9689, 10000, 18758, 10000, 415, 10000,
+            557, 10000, -2040, 10000, 10570, 10000
+        });
+    tw.addRational(50728, RATIONAL, {
+            10000, int32_t(WB_MUL[0] * 10000),
+            10000, int32_t(WB_MUL[1] * 10000),
+            10000, int32_t(WB_MUL[2] * 10000)
+        });
+    tw.add(50778, SHORT, {21}); // D65
+
+    return tw.write(fname, image);
+}
+
+} // namespace bench
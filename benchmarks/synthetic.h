@@ -0,0 +1,75 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../rtengine/array2D.h"
+#include <cstdint>
+#include <string>
+
+/*
+ * Deterministic synthetic inputs for the benchmarks: the same seed always
+ * gives the same data, so that timings are comparable across runs and
+ * commits without shipping any image files.
+ */
+
+namespace bench {
+
+using rtengine::array2D;
+
+// xorshift64*
+class Rng {
+public:
+    explicit Rng(uint64_t seed): state_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    uint32_t next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return (state_ * 0x2545F4914F6CDD1DULL) >> 32;
+    }
+
+    // uniform in [0, 1)
+    float uniform() { return (next() >> 8) * (1.f / 16777216.f); }
+
+private:
+    uint64_t state_;
+};
+
+
+// A scene with smooth gradients, hard edges and fine texture, with values
+// in [0, 1]
+void makeScene(int W, int H, uint64_t seed, array2D<float> &r, array2D<float> &g, array2D<float> &b);
+
+// a single-channel version of the above
+void makePlane(int W, int H, uint64_t seed, array2D<float> &out);
+
+
+enum class CFA {
+    BAYER,
+    XTRANS
+};
+
+// Writes the scene mosaiced with the given CFA as a 14-bit DNG, either
+// uncompressed or as 256x256 tiles of lossless JPEG
+bool writeDNG(const std::string &fname, int W, int H, CFA cfa, bool compressed, uint64_t seed);
+
+} // namespace bench
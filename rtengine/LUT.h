@@ -647,6 +647,29 @@ public:
 #endif
     }
 
+    // use a buffer of s + 3 elements owned by someone else (e.g. a read-only
+    // memory mapped file), which must outlive the LUT
+    void wrap(T *buffer, unsigned int s, int flags = LUT_CLIP_BELOW | LUT_CLIP_ABOVE)
+    {
+        if (owner && data) {
+            delete[] data;
+        }
+
+        dirty = false;
+        clip = flags;
+        data = buffer;
+        owner = 0;
+        size = s;
+        upperBound = size - 1;
+        maxs = size - 2;
+        maxsf = (float)maxs;
+#ifdef __SSE2__
+        maxsv =  F2V( size - 2);
+        sizeiv =  _mm_set1_epi32( (int)(size - 1) );
+        sizev = F2V( size - 1 );
+#endif
+    }
+
 
 };
 
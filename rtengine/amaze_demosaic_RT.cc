@@ -34,6 +34,7 @@
 #include "opthelper.h"
 #include "median.h"
 #include "StopWatch.h"
+#include "trace.h"
 
 namespace rtengine
 {
@@ -41,6 +42,7 @@ namespace rtengine
 void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw, int winh, const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
 {
     BENCHFUN
+    TRACE_FUN("demosaic");
 
     volatile double progress = 0.0;
 
@@ -69,110 +69,102 @@ int RawImageSource::interpolateBadPixelsBayer(const PixelsMap &bitmapBads, array
     constexpr float eps = 1.f;
     int counter = 0;
 
+    const std::vector<badPix> bad = bitmapBads.pixels(2);
+
 #ifdef _OPENMP
-    #pragma omp parallel for reduction(+:counter) schedule(dynamic,16)
+    #pragma omp parallel for reduction(+:counter) schedule(dynamic,64)
 #endif
 
-    for (int row = 2; row < H - 2; ++row) {
-        for (int col = 2; col < W - 2; ++col) {
-            const int sk = bitmapBads.skipIfZero(col, row); //optimization for a stripe all zero
-
-            if (sk) {
-                col += sk - 1; //-1 is because of col++ in cycle
-                continue;
-            }
+    for (size_t k = 0; k < bad.size(); ++k) {
+        const int row = bad[k].y;
+        const int col = bad[k].x;
 
-            if (!bitmapBads.get(col, row)) {
-                continue;
-            }
+        float wtdsum = 0.f, norm = 0.f;
 
-            float wtdsum = 0.f, norm = 0.f;
-
-            // diagonal interpolation
-            if (fc(cfarray, row, col) == 1) {
-                // green channel. We can use closer pixels than for red or blue channel. Distance to center pixel is sqrt(2) => weighting is 0.70710678
-                // For green channel following pixels will be used for interpolation. Pixel to be interpolated is in center.
-                // 1 means that pixel is used in this step, if itself and his counterpart are not marked bad
-                // 0 0 0 0 0
-                // 0 1 0 1 0
-                // 0 0 0 0 0
-                // 0 1 0 1 0
-                // 0 0 0 0 0
-                for (int dx = -1; dx <= 1; dx += 2) {
-                    if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
-                        continue;
-                    }
-
-                    const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][col + dx] - rawData[row + 1][col - dx]) + eps);
-                    wtdsum += dirwt * (rawData[row - 1][col + dx] + rawData[row + 1][col - dx]);
-                    norm += dirwt;
+        // diagonal interpolation
+        if (fc(cfarray, row, col) == 1) {
+            // green channel. We can use closer pixels than for red or blue channel. Distance to center pixel is sqrt(2) => weighting is 0.70710678
+            // For green channel following pixels will be used for interpolation. Pixel to be interpolated is in center.
+            // 1 means that pixel is used in this step, if itself and his counterpart are not marked bad
+            // 0 0 0 0 0
+            // 0 1 0 1 0
+            // 0 0 0 0 0
+            // 0 1 0 1 0
+            // 0 0 0 0 0
+            for (int dx = -1; dx <= 1; dx += 2) {
+                if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
+                    continue;
                 }
-            } else {
-                // red and blue channel. Distance to center pixel is sqrt(8) => weighting is 0.35355339
-                // For red and blue channel following pixels will be used for interpolation. Pixel to be interpolated is in center.
-                // 1 means that pixel is used in this step, if itself and his counterpart are not marked bad
-                // 1 0 0 0 1
-                // 0 0 0 0 0
-                // 0 0 0 0 0
-                // 0 0 0 0 0
-                // 1 0 0 0 1
-                for (int dx = -2; dx <= 2; dx += 4) {
-                    if (bitmapBads.get(col + dx, row - 2) || bitmapBads.get(col - dx, row + 2)) {
-                        continue;
-                    }
 
-                    const float dirwt = 0.35355339f / (fabsf(rawData[row - 2][col + dx] - rawData[row + 2][col - dx]) + eps);
-                    wtdsum += dirwt * (rawData[row - 2][col + dx] + rawData[row + 2][col - dx]);
-                    norm += dirwt;
-                }
+                const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][col + dx] - rawData[row + 1][col - dx]) + eps);
+                wtdsum += dirwt * (rawData[row - 1][col + dx] + rawData[row + 1][col - dx]);
+                norm += dirwt;
             }
-
-            // channel independent. Distance to center pixel is 2 => weighting is 0.5
-            // Additionally for all channel following pixels will be used for interpolation. Pixel to be interpolated is in center.
+        } else {
+            // red and blue channel. Distance to center pixel is sqrt(8) => weighting is 0.35355339
+            // For red and blue channel following pixels will be used for interpolation. Pixel to be interpolated is in center.
             // 1 means that pixel is used in this step, if itself and his counterpart are not marked bad
-            // 0 0 1 0 0
-            // 0 0 0 0 0
             // 1 0 0 0 1
             // 0 0 0 0 0
-            // 0 0 1 0 0
+            // 0 0 0 0 0
+            // 0 0 0 0 0
+            // 1 0 0 0 1
+            for (int dx = -2; dx <= 2; dx += 4) {
+                if (bitmapBads.get(col + dx, row - 2) || bitmapBads.get(col - dx, row + 2)) {
+                    continue;
+                }
 
-            // horizontal interpolation
-            if (!(bitmapBads.get(col - 2, row) || bitmapBads.get(col + 2, row))) {
-                const float dirwt = 0.5f / (fabsf(rawData[row][col - 2] - rawData[row][col + 2]) + eps);
-                wtdsum += dirwt * (rawData[row][col - 2] + rawData[row][col + 2]);
+                const float dirwt = 0.35355339f / (fabsf(rawData[row - 2][col + dx] - rawData[row + 2][col - dx]) + eps);
+                wtdsum += dirwt * (rawData[row - 2][col + dx] + rawData[row + 2][col - dx]);
                 norm += dirwt;
             }
+        }
 
-            // vertical interpolation
-            if (!(bitmapBads.get(col, row - 2) || bitmapBads.get(col, row + 2))) {
-                const float dirwt = 0.5f / (fabsf(rawData[row - 2][col] - rawData[row + 2][col]) + eps);
-                wtdsum += dirwt * (rawData[row - 2][col] + rawData[row + 2][col]);
-                norm += dirwt;
-            }
+        // channel independent. Distance to center pixel is 2 => weighting is 0.5
+        // Additionally for all channel following pixels will be used for interpolation. Pixel to be interpolated is in center.
+        // 1 means that pixel is used in this step, if itself and his counterpart are not marked bad
+        // 0 0 1 0 0
+        // 0 0 0 0 0
+        // 1 0 0 0 1
+        // 0 0 0 0 0
+        // 0 0 1 0 0
+
+        // horizontal interpolation
+        if (!(bitmapBads.get(col - 2, row) || bitmapBads.get(col + 2, row))) {
+            const float dirwt = 0.5f / (fabsf(rawData[row][col - 2] - rawData[row][col + 2]) + eps);
+            wtdsum += dirwt * (rawData[row][col - 2] + rawData[row][col + 2]);
+            norm += dirwt;
+        }
 
-            if (LIKELY(norm > 0.f)) { // This means, we found at least one pair of valid pixels in the steps above, likelihood of this case is about 99.999%
-                rawData[row][col] = wtdsum / (2.f * norm); //gradient weighted average, Factor of 2.f is an optimization to avoid multiplications in former steps
-                counter++;
-            } else { //backup plan -- simple average. Same method for all channels. We could improve this, but it's really unlikely that this case happens
-                int tot = 0;
-                float sum = 0.f;
-
-                for (int dy = -2; dy <= 2; dy += 2) {
-                    for (int dx = -2; dx <= 2; dx += 2) {
-                        if (bitmapBads.get(col + dx, row + dy)) {
-                            continue;
-                        }
+        // vertical interpolation
+        if (!(bitmapBads.get(col, row - 2) || bitmapBads.get(col, row + 2))) {
+            const float dirwt = 0.5f / (fabsf(rawData[row - 2][col] - rawData[row + 2][col]) + eps);
+            wtdsum += dirwt * (rawData[row - 2][col] + rawData[row + 2][col]);
+            norm += dirwt;
+        }
+
+        if (LIKELY(norm > 0.f)) { // This means, we found at least one pair of valid pixels in the steps above, likelihood of this case is about 99.999%
+            rawData[row][col] = wtdsum / (2.f * norm); //gradient weighted average, Factor of 2.f is an optimization to avoid multiplications in former steps
+            counter++;
+        } else { //backup plan -- simple average. Same method for all channels. We could improve this, but it's really unlikely that this case happens
+            int tot = 0;
+            float sum = 0.f;
 
-                        sum += rawData[row + dy][col + dx];
-                        tot++;
+            for (int dy = -2; dy <= 2; dy += 2) {
+                for (int dx = -2; dx <= 2; dx += 2) {
+                    if (bitmapBads.get(col + dx, row + dy)) {
+                        continue;
                     }
-                }
 
-                if (tot > 0) {
-                    rawData[row][col] = sum / tot;
-                    counter ++;
+                    sum += rawData[row + dy][col + dx];
+                    tot++;
                 }
             }
+
+            if (tot > 0) {
+                rawData[row][col] = sum / tot;
+                counter ++;
+            }
         }
     }
 
@@ -187,95 +179,87 @@ int RawImageSource::interpolateBadPixelsNColours(const PixelsMap &bitmapBads, co
     constexpr float eps = 1.f;
     int counter = 0;
 
+    const std::vector<badPix> bad = bitmapBads.pixels(2);
+
 #ifdef _OPENMP
-    #pragma omp parallel for reduction(+:counter) schedule(dynamic,16)
+    #pragma omp parallel for reduction(+:counter) schedule(dynamic,64)
 #endif
 
-    for (int row = 2; row < H - 2; ++row) {
-        for (int col = 2; col < W - 2; ++col) {
-            const int sk = bitmapBads.skipIfZero(col, row); //optimization for a stripe all zero
+    for (size_t k = 0; k < bad.size(); ++k) {
+        const int row = bad[k].y;
+        const int col = bad[k].x;
 
-            if (sk) {
-                col += sk - 1; //-1 is because of col++ in cycle
-                continue;
+        float wtdsum[colors];
+        float norm[colors];
+            for (int c = 0; c < colors; ++c) {
+                wtdsum[c] = norm[c] = 0.f;
             }
 
-            if (!bitmapBads.get(col, row)) {
+        // diagonal interpolation
+        for (int dx = -1; dx <= 1; dx += 2) {
+            if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
                 continue;
             }
 
-            float wtdsum[colors];
-            float norm[colors];
-                for (int c = 0; c < colors; ++c) {
-                    wtdsum[c] = norm[c] = 0.f;
-                }
-
-            // diagonal interpolation
-            for (int dx = -1; dx <= 1; dx += 2) {
-                if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
-                    continue;
-                }
-
-                for (int c = 0; c < colors; ++c) {
-                    const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][(col + dx) * colors + c] - rawData[row + 1][(col - dx) * colors + c]) + eps);
-                    wtdsum[c] += dirwt * (rawData[row - 1][(col + dx) * colors + c] + rawData[row + 1][(col - dx) * colors + c]);
-                    norm[c] += dirwt;
-                }
+            for (int c = 0; c < colors; ++c) {
+                const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][(col + dx) * colors + c] - rawData[row + 1][(col - dx) * colors + c]) + eps);
+                wtdsum[c] += dirwt * (rawData[row - 1][(col + dx) * colors + c] + rawData[row + 1][(col - dx) * colors + c]);
+                norm[c] += dirwt;
             }
+        }
 
-            // horizontal interpolation
-            if (!(bitmapBads.get(col - 1, row) || bitmapBads.get(col + 1, row))) {
-                for (int c = 0; c < colors; ++c) {
-                    const float dirwt = 1.f / (fabsf(rawData[row][(col - 1) * colors + c] - rawData[row][(col + 1) * colors + c]) + eps);
-                    wtdsum[c] += dirwt * (rawData[row][(col - 1) * colors + c] + rawData[row][(col + 1) * colors + c]);
-                    norm[c] += dirwt;
-                }
+        // horizontal interpolation
+        if (!(bitmapBads.get(col - 1, row) || bitmapBads.get(col + 1, row))) {
+            for (int c = 0; c < colors; ++c) {
+                const float dirwt = 1.f / (fabsf(rawData[row][(col - 1) * colors + c] - rawData[row][(col + 1) * colors + c]) + eps);
+                wtdsum[c] += dirwt * (rawData[row][(col - 1) * colors + c] + rawData[row][(col + 1) * colors + c]);
+                norm[c] += dirwt;
             }
+        }
 
-            // vertical interpolation
-            if (!(bitmapBads.get(col, row - 1) || bitmapBads.get(col, row + 1))) {
-                for (int c = 0; c < colors; ++c) {
-                    const float dirwt = 1.f / (fabsf(rawData[row - 1][col * colors + c] - rawData[row + 1][col * colors + c]) + eps);
-                    wtdsum[c] += dirwt * (rawData[row - 1][col * colors + c] + rawData[row + 1][col * colors + c]);
-                    norm[c] += dirwt;
-                }
+        // vertical interpolation
+        if (!(bitmapBads.get(col, row - 1) || bitmapBads.get(col, row + 1))) {
+            for (int c = 0; c < colors; ++c) {
+                const float dirwt = 1.f / (fabsf(rawData[row - 1][col * colors + c] - rawData[row + 1][col * colors + c]) + eps);
+                wtdsum[c] += dirwt * (rawData[row - 1][col * colors + c] + rawData[row + 1][col * colors + c]);
+                norm[c] += dirwt;
             }
+        }
 
-            if (LIKELY(norm[0] > 0.f)) { // This means, we found at least one pair of valid pixels in the steps above, likelihood of this case is about 99.999%
-                for (int c = 0; c < colors; ++c) {
-                    rawData[row][col * colors + c] = wtdsum[c] / (2.f * norm[c]); //gradient weighted average, Factor of 2.f is an optimization to avoid multiplications in former steps
-                }
-
-                counter++;
-            } else { //backup plan -- simple average. Same method for all channels. We could improve this, but it's really unlikely that this case happens
-                int tot = 0;
-                float sum[colors];
-                for (int c = 0; c < colors; ++c) {
-                    sum[c] = 0.f;
-                }
-
-                for (int dy = -2; dy <= 2; dy += 2) {
-                    for (int dx = -2; dx <= 2; dx += 2) {
-                        if (bitmapBads.get(col + dx, row + dy)) {
-                            continue;
-                        }
+        if (LIKELY(norm[0] > 0.f)) { // This means, we found at least one pair of valid pixels in the steps above, likelihood of this case is about 99.999%
+            for (int c = 0; c < colors; ++c) {
+                rawData[row][col * colors + c] = wtdsum[c] / (2.f * norm[c]); //gradient weighted average, Factor of 2.f is an optimization to avoid multiplications in former steps
+            }
 
-                        for (int c = 0; c < colors; ++c) {
-                            sum[c] += rawData[row + dy][(col + dx) * colors + c];
-                        }
+            counter++;
+        } else { //backup plan -- simple average. Same method for all channels. We could improve this, but it's really unlikely that this case happens
+            int tot = 0;
+            float sum[colors];
+            for (int c = 0; c < colors; ++c) {
+                sum[c] = 0.f;
+            }
 
-                        tot++;
+            for (int dy = -2; dy <= 2; dy += 2) {
+                for (int dx = -2; dx <= 2; dx += 2) {
+                    if (bitmapBads.get(col + dx, row + dy)) {
+                        continue;
                     }
-                }
 
-                if (tot > 0) {
                     for (int c = 0; c < colors; ++c) {
-                        rawData[row][col * colors + c] = sum[c] / tot;
+                        sum[c] += rawData[row + dy][(col + dx) * colors + c];
                     }
 
-                    counter ++;
+                    tot++;
                 }
             }
+
+            if (tot > 0) {
+                for (int c = 0; c < colors; ++c) {
+                    rawData[row][col * colors + c] = sum[c] / tot;
+                }
+
+                counter ++;
+            }
         }
     }
 
@@ -290,179 +274,171 @@ int RawImageSource::interpolateBadPixelsXtrans(const PixelsMap &bitmapBads)
     constexpr float eps = 1.f;
     int counter = 0;
 
+    const std::vector<badPix> bad = bitmapBads.pixels(2);
+
 #ifdef _OPENMP
-    #pragma omp parallel for reduction(+:counter) schedule(dynamic,16)
+    #pragma omp parallel for reduction(+:counter) schedule(dynamic,64)
 #endif
 
-    for (int row = 2; row < H - 2; ++row) {
-        for (int col = 2; col < W - 2; ++col) {
-            const int skip = bitmapBads.skipIfZero(col, row); //optimization for a stripe all zero
-
-            if (skip) {
-                col += skip - 1; //-1 is because of col++ in cycle
-                continue;
-            }
-
-            if (!bitmapBads.get(col, row)) {
-                continue;
-            }
-
-            float wtdsum = 0.f, norm = 0.f;
-            const unsigned int pixelColor = ri->XTRANSFC(row, col);
-
-            if (pixelColor == 1) {
-                // green channel. A green pixel can either be a solitary green pixel or a member of a 2x2 square of green pixels
-                if (ri->XTRANSFC(row, col - 1) == ri->XTRANSFC(row, col + 1)) {
-                    // If left and right neighbor have same color, then this is a solitary green pixel
-                    // For these the following pixels will be used for interpolation. Pixel to be interpolated is in center and marked with a P.
-                    // Pairs of pixels used in this step are numbered. A pair will be used if none of the pixels of the pair is marked bad
-                    // 0 means, the pixel has a different color and will not be used
-                    // 0 1 0 2 0
-                    // 3 5 0 6 4
-                    // 0 0 P 0 0
-                    // 4 6 0 5 3
-                    // 0 2 0 1 0
-                    for (int dx = -1; dx <= 1; dx += 2) { // pixels marked 5 or 6 in above example. Distance to P is sqrt(2) => weighting is 0.70710678f
-                        if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
-                            continue;
-                        }
-
-                        const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][col + dx] - rawData[row + 1][col - dx]) + eps);
-                        wtdsum += dirwt * (rawData[row - 1][col + dx] + rawData[row + 1][col - dx]);
-                        norm += dirwt;
-                    }
-
-                    for (int dx = -1; dx <= 1; dx += 2) { // pixels marked 1 or 2 on above example. Distance to P is sqrt(5) => weighting is 0.44721359f
-                        if (bitmapBads.get(col + dx, row - 2) || bitmapBads.get(col - dx, row + 2)) {
-                            continue;
-                        }
-
-                        const float dirwt = 0.44721359f / (fabsf(rawData[row - 2][col + dx] - rawData[row + 2][col - dx]) + eps);
-                        wtdsum += dirwt * (rawData[row - 2][col + dx] + rawData[row + 2][col - dx]);
-                        norm += dirwt;
+    for (size_t k = 0; k < bad.size(); ++k) {
+        const int row = bad[k].y;
+        const int col = bad[k].x;
+
+        float wtdsum = 0.f, norm = 0.f;
+        const unsigned int pixelColor = ri->XTRANSFC(row, col);
+
+        if (pixelColor == 1) {
+            // green channel. A green pixel can either be a solitary green pixel or a member of a 2x2 square of green pixels
+            if (ri->XTRANSFC(row, col - 1) == ri->XTRANSFC(row, col + 1)) {
+                // If left and right neighbor have same color, then this is a solitary green pixel
+                // For these the following pixels will be used for interpolation. Pixel to be interpolated is in center and marked with a P.
+                // Pairs of pixels used in this step are numbered. A pair will be used if none of the pixels of the pair is marked bad
+                // 0 means, the pixel has a different color and will not be used
+                // 0 1 0 2 0
+                // 3 5 0 6 4
+                // 0 0 P 0 0
+                // 4 6 0 5 3
+                // 0 2 0 1 0
+                for (int dx = -1; dx <= 1; dx += 2) { // pixels marked 5 or 6 in above example. Distance to P is sqrt(2) => weighting is 0.70710678f
+                    if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
+                        continue;
                     }
 
-                    for (int dx = -2; dx <= 2; dx += 4) { // pixels marked 3 or 4 on above example. Distance to P is sqrt(5) => weighting is 0.44721359f
-                        if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
-                            continue;
-                        }
+                    const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][col + dx] - rawData[row + 1][col - dx]) + eps);
+                    wtdsum += dirwt * (rawData[row - 1][col + dx] + rawData[row + 1][col - dx]);
+                    norm += dirwt;
+                }
 
-                        const float dirwt = 0.44721359f / (fabsf(rawData[row - 1][col + dx] - rawData[row + 1][col - dx]) + eps);
-                        wtdsum += dirwt * (rawData[row - 1][col + dx] + rawData[row + 1][col - dx]);
-                        norm += dirwt;
-                    }
-                } else {
-                    // this is a member of a 2x2 square of green pixels
-                    // For these the following pixels will be used for interpolation. Pixel to be interpolated is at position P in the example.
-                    // Pairs of pixels used in this step are numbered. A pair will be used if none of the pixels of the pair is marked bad
-                    // 0 means, the pixel has a different color and will not be used
-                    // 1 0 0 3
-                    // 0 P 2 0
-                    // 0 2 1 0
-                    // 3 0 0 0
-
-                    // pixels marked 1 in above example. Distance to P is sqrt(2) => weighting is 0.70710678f
-                    const int offset1 = ri->XTRANSFC(row - 1, col - 1) == ri->XTRANSFC(row + 1, col + 1) ? 1 : -1;
-
-                    if (!(bitmapBads.get(col - offset1, row - 1) || bitmapBads.get(col + offset1, row + 1))) {
-                        const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][col - offset1] - rawData[row + 1][col + offset1]) + eps);
-                        wtdsum += dirwt * (rawData[row - 1][col - offset1] + rawData[row + 1][col + offset1]);
-                        norm += dirwt;
+                for (int dx = -1; dx <= 1; dx += 2) { // pixels marked 1 or 2 on above example. Distance to P is sqrt(5) => weighting is 0.44721359f
+                    if (bitmapBads.get(col + dx, row - 2) || bitmapBads.get(col - dx, row + 2)) {
+                        continue;
                     }
 
-                    // pixels marked 2 in above example. Distance to P is 1 => weighting is 1.f
-                    int offsety = ri->XTRANSFC(row - 1, col) != 1 ? 1 : -1;
-                    int offsetx = offset1 * offsety;
+                    const float dirwt = 0.44721359f / (fabsf(rawData[row - 2][col + dx] - rawData[row + 2][col - dx]) + eps);
+                    wtdsum += dirwt * (rawData[row - 2][col + dx] + rawData[row + 2][col - dx]);
+                    norm += dirwt;
+                }
 
-                    if (!(bitmapBads.get(col + offsetx, row) || bitmapBads.get(col, row + offsety))) {
-                        const float dirwt = 1.f / (fabsf(rawData[row][col + offsetx] - rawData[row + offsety][col]) + eps);
-                        wtdsum += dirwt * (rawData[row][col + offsetx] + rawData[row + offsety][col]);
-                        norm += dirwt;
+                for (int dx = -2; dx <= 2; dx += 4) { // pixels marked 3 or 4 on above example. Distance to P is sqrt(5) => weighting is 0.44721359f
+                    if (bitmapBads.get(col + dx, row - 1) || bitmapBads.get(col - dx, row + 1)) {
+                        continue;
                     }
 
-                    const int offsety2 = -offsety;
-                    const int offsetx2 = -offsetx;
-                    offsetx *= 2;
-                    offsety *= 2;
-
-                    // pixels marked 3 in above example. Distance to P is sqrt(5) => weighting is 0.44721359f
-                    if (!(bitmapBads.get(col + offsetx, row + offsety2) || bitmapBads.get(col + offsetx2, row + offsety))) {
-                        const float dirwt = 0.44721359f / (fabsf(rawData[row + offsety2][col + offsetx] - rawData[row + offsety][col + offsetx2]) + eps);
-                        wtdsum += dirwt * (rawData[row + offsety2][col + offsetx] + rawData[row + offsety][col + offsetx2]);
-                        norm += dirwt;
-                    }
+                    const float dirwt = 0.44721359f / (fabsf(rawData[row - 1][col + dx] - rawData[row + 1][col - dx]) + eps);
+                    wtdsum += dirwt * (rawData[row - 1][col + dx] + rawData[row + 1][col - dx]);
+                    norm += dirwt;
                 }
             } else {
-                // red and blue channel.
-                // Each red or blue pixel has exactly one neighbor of same color in distance 2 and four neighbors of same color which can be reached by a move of a knight in chess.
-                // For the distance 2 pixel (marked with an X) we generate a virtual counterpart (marked with a V)
-                // For red and blue channel following pixels will be used for interpolation. Pixel to be interpolated is in center and marked with a P.
-                // Pairs of pixels used in this step are numbered except for distance 2 pixels which are marked X and V. A pair will be used if none of the pixels of the pair is marked bad
-                // 0 1 0 0 0    0 0 X 0 0   remaining cases are symmetric
-                // 0 0 0 0 2    1 0 0 0 2
-                // X 0 P 0 V    0 0 P 0 0
-                // 0 0 0 0 1    0 0 0 0 0
-                // 0 2 0 0 0    0 2 V 1 0
-
-                // Find two knight moves landing on a pixel of same color as the pixel to be interpolated.
-                // If we look at first and last row of 5x5 square, we will find exactly two knight pixels.
-                // Additionally we know that the column of this pixel has 1 or -1 horizontal distance to the center pixel
-                // When we find a knight pixel, we get its counterpart, which has distance (+-3,+-3), where the signs of distance depend on the corner of the found knight pixel.
-                // These pixels are marked 1 or 2 in above examples. Distance to P is sqrt(5) => weighting is 0.44721359f
-                // The following loop simply scans the four possible places. To keep things simple, it does not stop after finding two knight pixels, because it will not find more than two
-                for (int d1 = -2, offsety = 3; d1 <= 2; d1 += 4, offsety -= 6) {
-                    for (int d2 = -1, offsetx = 3; d2 < 1; d2 += 2, offsetx -= 6) {
-                        if (ri->XTRANSFC(row + d1, col + d2) == pixelColor) {
-                            if (!(bitmapBads.get(col + d2, row + d1) || bitmapBads.get(col + d2 + offsetx, row + d1 + offsety))) {
-                                const float dirwt = 0.44721359f / (fabsf(rawData[row + d1][col + d2] - rawData[row + d1 + offsety][col + d2 + offsetx]) + eps);
-                                wtdsum += dirwt * (rawData[row + d1][col + d2] + rawData[row + d1 + offsety][col + d2 + offsetx]);
-                                norm += dirwt;
-                            }
-                        }
-                    }
+                // this is a member of a 2x2 square of green pixels
+                // For these the following pixels will be used for interpolation. Pixel to be interpolated is at position P in the example.
+                // Pairs of pixels used in this step are numbered. A pair will be used if none of the pixels of the pair is marked bad
+                // 0 means, the pixel has a different color and will not be used
+                // 1 0 0 3
+                // 0 P 2 0
+                // 0 2 1 0
+                // 3 0 0 0
+
+                // pixels marked 1 in above example. Distance to P is sqrt(2) => weighting is 0.70710678f
+                const int offset1 = ri->XTRANSFC(row - 1, col - 1) == ri->XTRANSFC(row + 1, col + 1) ? 1 : -1;
+
+                if (!(bitmapBads.get(col - offset1, row - 1) || bitmapBads.get(col + offset1, row + 1))) {
+                    const float dirwt = 0.70710678f / (fabsf(rawData[row - 1][col - offset1] - rawData[row + 1][col + offset1]) + eps);
+                    wtdsum += dirwt * (rawData[row - 1][col - offset1] + rawData[row + 1][col + offset1]);
+                    norm += dirwt;
                 }
 
-                // now scan for the pixel of same color in distance 2 in each direction (marked with an X in above examples).
-                bool distance2PixelFound = false;
-                int dx, dy;
+                // pixels marked 2 in above example. Distance to P is 1 => weighting is 1.f
+                int offsety = ri->XTRANSFC(row - 1, col) != 1 ? 1 : -1;
+                int offsetx = offset1 * offsety;
 
-                // check horizontal
-                for (dx = -2, dy = 0; dx <= 2; dx += 4) {
-                    if (ri->XTRANSFC(row, col + dx) == pixelColor) {
-                        distance2PixelFound = true;
-                        break;
-                    }
+                if (!(bitmapBads.get(col + offsetx, row) || bitmapBads.get(col, row + offsety))) {
+                    const float dirwt = 1.f / (fabsf(rawData[row][col + offsetx] - rawData[row + offsety][col]) + eps);
+                    wtdsum += dirwt * (rawData[row][col + offsetx] + rawData[row + offsety][col]);
+                    norm += dirwt;
                 }
 
-                if (!distance2PixelFound) {
-                    // no distance 2 pixel on horizontal, check vertical
-                    for (dx = 0, dy = -2; dy <= 2; dy += 4) {
-                        if (ri->XTRANSFC(row + dy, col) == pixelColor) {
-                            distance2PixelFound = true;
-                            break;
+                const int offsety2 = -offsety;
+                const int offsetx2 = -offsetx;
+                offsetx *= 2;
+                offsety *= 2;
+
+                // pixels marked 3 in above example. Distance to P is sqrt(5) => weighting is 0.44721359f
+                if (!(bitmapBads.get(col + offsetx, row + offsety2) || bitmapBads.get(col + offsetx2, row + offsety))) {
+                    const float dirwt = 0.44721359f / (fabsf(rawData[row + offsety2][col + offsetx] - rawData[row + offsety][col + offsetx2]) + eps);
+                    wtdsum += dirwt * (rawData[row + offsety2][col + offsetx] + rawData[row + offsety][col + offsetx2]);
+                    norm += dirwt;
+                }
+            }
+        } else {
+            // red and blue channel.
+            // Each red or blue pixel has exactly one neighbor of same color in distance 2 and four neighbors of same color which can be reached by a move of a knight in chess.
+            // For the distance 2 pixel (marked with an X) we generate a virtual counterpart (marked with a V)
+            // For red and blue channel following pixels will be used for interpolation. Pixel to be interpolated is in center and marked with a P.
+            // Pairs of pixels used in this step are numbered except for distance 2 pixels which are marked X and V. A pair will be used if none of the pixels of the pair is marked bad
+            // 0 1 0 0 0    0 0 X 0 0   remaining cases are symmetric
+            // 0 0 0 0 2    1 0 0 0 2
+            // X 0 P 0 V    0 0 P 0 0
+            // 0 0 0 0 1    0 0 0 0 0
+            // 0 2 0 0 0    0 2 V 1 0
+
+            // Find two knight moves landing on a pixel of same color as the pixel to be interpolated.
+            // If we look at first and last row of 5x5 square, we will find exactly two knight pixels.
+            // Additionally we know that the column of this pixel has 1 or -1 horizontal distance to the center pixel
+            // When we find a knight pixel, we get its counterpart, which has distance (+-3,+-3), where the signs of distance depend on the corner of the found knight pixel.
+            // These pixels are marked 1 or 2 in above examples. Distance to P is sqrt(5) => weighting is 0.44721359f
+            // The following loop simply scans the four possible places. To keep things simple, it does not stop after finding two knight pixels, because it will not find more than two
+            for (int d1 = -2, offsety = 3; d1 <= 2; d1 += 4, offsety -= 6) {
+                for (int d2 = -1, offsetx = 3; d2 < 1; d2 += 2, offsetx -= 6) {
+                    if (ri->XTRANSFC(row + d1, col + d2) == pixelColor) {
+                        if (!(bitmapBads.get(col + d2, row + d1) || bitmapBads.get(col + d2 + offsetx, row + d1 + offsety))) {
+                            const float dirwt = 0.44721359f / (fabsf(rawData[row + d1][col + d2] - rawData[row + d1 + offsety][col + d2 + offsetx]) + eps);
+                            wtdsum += dirwt * (rawData[row + d1][col + d2] + rawData[row + d1 + offsety][col + d2 + offsetx]);
+                            norm += dirwt;
                         }
                     }
                 }
+            }
 
-                // calculate the value of its virtual counterpart (marked with a V in above examples)
-                float virtualPixel;
+            // now scan for the pixel of same color in distance 2 in each direction (marked with an X in above examples).
+            bool distance2PixelFound = false;
+            int dx, dy;
 
-                if (dy == 0) {
-                    virtualPixel = 0.5f * (rawData[row - 1][col - dx] + rawData[row + 1][col - dx]);
-                } else {
-                    virtualPixel = 0.5f * (rawData[row - dy][col - 1] + rawData[row - dy][col + 1]);
+            // check horizontal
+            for (dx = -2, dy = 0; dx <= 2; dx += 4) {
+                if (ri->XTRANSFC(row, col + dx) == pixelColor) {
+                    distance2PixelFound = true;
+                    break;
                 }
+            }
 
-                // and weight as usual. Distance to P is 2 => weighting is 0.5f
-                const float dirwt = 0.5f / (fabsf(virtualPixel - rawData[row + dy][col + dx]) + eps);
-                wtdsum += dirwt * (virtualPixel + rawData[row + dy][col + dx]);
-                norm += dirwt;
+            if (!distance2PixelFound) {
+                // no distance 2 pixel on horizontal, check vertical
+                for (dx = 0, dy = -2; dy <= 2; dy += 4) {
+                    if (ri->XTRANSFC(row + dy, col) == pixelColor) {
+                        distance2PixelFound = true;
+                        break;
+                    }
+                }
             }
 
-            if (LIKELY(norm > 0.f)) { // This means, we found at least one pair of valid pixels in the steps above, likelihood of this case is about 99.999%
-                rawData[row][col] = wtdsum / (2.f * norm); //gradient weighted average, Factor of 2.f is an optimization to avoid multiplications in former steps
-                counter++;
+            // calculate the value of its virtual counterpart (marked with a V in above examples)
+            float virtualPixel;
+
+            if (dy == 0) {
+                virtualPixel = 0.5f * (rawData[row - 1][col - dx] + rawData[row + 1][col - dx]);
+            } else {
+                virtualPixel = 0.5f * (rawData[row - dy][col - 1] + rawData[row - dy][col + 1]);
             }
+
+            // and weight as usual. Distance to P is 2 => weighting is 0.5f
+            const float dirwt = 0.5f / (fabsf(virtualPixel - rawData[row + dy][col + dx]) + eps);
+            wtdsum += dirwt * (virtualPixel + rawData[row + dy][col + dx]);
+            norm += dirwt;
+        }
+
+        if (LIKELY(norm > 0.f)) { // This means, we found at least one pair of valid pixels in the steps above, likelihood of this case is about 99.999%
+            rawData[row][col] = wtdsum / (2.f * norm); //gradient weighted average, Factor of 2.f is an optimization to avoid multiplications in former steps
+            counter++;
         }
     }
 
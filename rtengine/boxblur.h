@@ -28,6 +28,7 @@
 #include "alignedbuffer.h"
 #include "rt_math.h"
 #include "opthelper.h"
+#include "simdkernels.h"
 #include "StopWatch.h"
 
 
@@ -388,11 +389,14 @@ inline void boxblur (float** src, float** dst, int radius, int W, int H, bool mu
         const vfloat onev = F2V(1.f);
         vfloat tempv, temp1v, lenv, lenp1v, lenm1v, rlenv;
 
+        // columns processed with wider vectors, if available
+        const int start = simd::boxblurVertical(dst, W, H, radius);
+
 #ifdef _OPENMP
         #pragma omp for nowait
 #endif
 
-        for (int col = 0; col < W - 7; col += 8) {
+        for (int col = start; col < W - 7; col += 8) {
             lenv = leninitv;
             tempv = LVFU(dst[0][col]);
             temp1v = LVFU(dst[0][col + 4]);
@@ -25,6 +25,10 @@
 #include "opthelper.h"
 #include "iccstore.h"
 #include "linalgebra.h"
+#include "simdkernels.h"
+#include "../rtgui/version.h"
+#include <glib/gstdio.h>
+#include <functional>
 
 using namespace std;
 
@@ -85,6 +89,183 @@ float PQ_inv(float X)
         6.277394636015326f);
 }
 
+
+/*
+ * The 65536-entry tables of Color::init are saved to a file in the cache
+ * dir the first time they are computed. Later runs map that file
+ * read-only instead of computing the tables again, so all the running
+ * processes share one copy of them. The file is only used if its header
+ * matches this version of ART and the layout of the tables, if the
+ * checksum of its data is correct, and if a sample of its entries is
+ * equal to a fresh computation of the same entries.
+ */
+template <class T>
+struct ColorTable {
+    LUT<T> *lut;
+    int flags;
+    std::function<T(int)> value;
+};
+
+constexpr uint32_t COLOR_TABLES_FORMAT = 1; // increase when the tables change
+constexpr size_t COLOR_TABLES_ALIGN = 64;
+constexpr int COLOR_TABLES_CHECK_STEP = 251;
+
+struct ColorTablesHeader {
+    char magic[8];
+    char version[56];
+    uint32_t format;
+    uint32_t byte_order;
+    uint32_t count;
+    uint32_t size;
+    uint64_t checksum; // of everything after the header
+};
+
+GMappedFile *color_tables_file = nullptr;
+
+
+size_t color_tables_align(size_t n)
+{
+    return (n + COLOR_TABLES_ALIGN - 1) & ~(COLOR_TABLES_ALIGN - 1);
+}
+
+
+ColorTablesHeader color_tables_header(size_t count, int size)
+{
+    ColorTablesHeader ret;
+    memset(&ret, 0, sizeof(ret));
+    memcpy(ret.magic, "ARTCLUT", 8);
+    strncpy(ret.version, RTVERSION, sizeof(ret.version) - 1);
+    ret.format = COLOR_TABLES_FORMAT;
+    ret.byte_order = 0x01020304;
+    ret.count = count;
+    ret.size = size;
+    return ret;
+}
+
+
+// each table is stored with the 3 extra elements allocated by LUT
+template <class T>
+size_t color_table_bytes(int size)
+{
+    return color_tables_align((size + 3) * sizeof(T));
+}
+
+
+uint64_t color_tables_checksum(const char *data, size_t len)
+{
+    // FNV-1a on 64-bit words (len is a multiple of COLOR_TABLES_ALIGN)
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+template <class T>
+void fill_color_table(ColorTable<T> &t, int size)
+{
+    LUT<T> &lut = *t.lut;
+    for (int i = 0; i < size; ++i) {
+        lut[i] = t.value(i);
+    }
+}
+
+
+template <class T>
+bool check_color_table(const ColorTable<T> &t, const char *data, int size)
+{
+    const auto check =
+        [&](int i) -> bool
+        {
+            const T v = t.value(i);
+            return memcmp(&v, data + i * sizeof(T), sizeof(T)) == 0;
+        };
+
+    for (int i = 0; i < size; i += COLOR_TABLES_CHECK_STEP) {
+        if (!check(i)) {
+            return false;
+        }
+    }
+    return check(size - 1);
+}
+
+
+bool map_color_tables(const Glib::ustring &fname, std::vector<ColorTable<float>> &tables, ColorTable<uint8_t> &thumb, int size)
+{
+    GMappedFile *f = g_mapped_file_new(fname.c_str(), FALSE, nullptr);
+    if (!f) {
+        return false;
+    }
+
+    char *data = g_mapped_file_get_contents(f);
+    const size_t start = color_tables_align(sizeof(ColorTablesHeader));
+    const size_t len = start + tables.size() * color_table_bytes<float>(size) + color_table_bytes<uint8_t>(size);
+    ColorTablesHeader hdr = color_tables_header(tables.size(), size);
+    bool ok = g_mapped_file_get_length(f) == len;
+    if (ok) {
+        hdr.checksum = color_tables_checksum(data + start, len - start);
+        ok = memcmp(data, &hdr, sizeof(hdr)) == 0;
+    }
+
+    for (size_t k = 0, pos = start; ok && k < tables.size(); ++k, pos += color_table_bytes<float>(size)) {
+        ok = check_color_table(tables[k], data + pos, size);
+    }
+    ok = ok && check_color_table(thumb, data + len - color_table_bytes<uint8_t>(size), size);
+
+    if (!ok) {
+        g_mapped_file_unref(f);
+        return false;
+    }
+
+    size_t pos = start;
+    for (auto &t : tables) {
+        t.lut->wrap(reinterpret_cast<float *>(data + pos), size, t.flags);
+        pos += color_table_bytes<float>(size);
+    }
+    thumb.lut->wrap(reinterpret_cast<uint8_t *>(data + pos), size, thumb.flags);
+
+    if (color_tables_file) {
+        g_mapped_file_unref(color_tables_file);
+    }
+    color_tables_file = f;
+    return true;
+}
+
+
+bool save_color_tables(const Glib::ustring &fname, const std::vector<ColorTable<float>> &tables, const ColorTable<uint8_t> &thumb, int size)
+{
+    const size_t start = color_tables_align(sizeof(ColorTablesHeader));
+    std::string buf(start + tables.size() * color_table_bytes<float>(size) + color_table_bytes<uint8_t>(size), 0);
+
+    size_t pos = start;
+    for (const auto &t : tables) {
+        memcpy(&buf[pos], &(*t.lut)[0], size * sizeof(float));
+        pos += color_table_bytes<float>(size);
+    }
+    memcpy(&buf[pos], &(*thumb.lut)[0], size);
+
+    ColorTablesHeader hdr = color_tables_header(tables.size(), size);
+    hdr.checksum = color_tables_checksum(buf.data() + start, buf.size() - start);
+    memcpy(&buf[0], &hdr, sizeof(hdr));
+
+    // g_file_set_contents writes to a temporary file and renames it, so
+    // concurrent processes never see a partially written file
+    g_mkdir_with_parents(Glib::path_get_dirname(fname).c_str(), 0755);
+    return g_file_set_contents(fname.c_str(), buf.data(), buf.size(), nullptr);
+}
+
+
+void unmap_color_tables()
+{
+    if (color_tables_file) {
+        g_mapped_file_unref(color_tables_file);
+        color_tables_file = nullptr;
+    }
+}
+
 } // namespace
 
 
@@ -176,157 +357,82 @@ void Color::init ()
     /*******************************************/
 
     constexpr auto maxindex = 65536;
+    const int epsmaxint = eps_max;
+    const double rsRGBGamma = 1.0 / sRGBGamma;
 
-    cachef(maxindex, LUT_CLIP_BELOW);
-    cachefy(maxindex, LUT_CLIP_BELOW);
-    gammatab(maxindex, 0);
-    gammatabThumb(maxindex, 0);
-
-    igammatab_srgb(maxindex, 0);
-    igammatab_srgb1(maxindex, 0);
-    gammatab_srgb(maxindex, 0);
-    gammatab_srgb1(maxindex, 0);
-
-    denoiseGammaTab(maxindex, 0);
-    denoiseIGammaTab(maxindex, 0);
-
-    igammatab_24_17(maxindex, 0);
-    gammatab_24_17a(maxindex, LUT_CLIP_ABOVE | LUT_CLIP_BELOW);
-
-    jzazbz_pq_(maxindex, 0);
-    jzazbz_pq_inv_(maxindex, 0);
-
-#ifdef _OPENMP
-    #pragma omp parallel sections
-#endif
-    {
-#ifdef _OPENMP
-        #pragma omp section
-#endif
+    std::vector<ColorTable<float>> tables = {
         {
-            int i = 0;
-            int epsmaxint = eps_max;
-
-            for (; i <= epsmaxint; i++)
+            &cachef, LUT_CLIP_BELOW,
+            [=](int i) -> float
             {
-                cachef[i] = 327.68 * ((kappa * i / MAXVALF + 16.0) / 116.0);
-            }
-
-            for(; i < maxindex; i++)
-            {
-                cachef[i] = 327.68 * std::cbrt((double)i / MAXVALF);
-            }
-        }
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        {
-            int i = 0;
-            int epsmaxint = eps_max;
-
-            for (; i <= epsmaxint; i++)
-            {
-                cachefy[i] = 327.68 * (kappa * i / MAXVALF);
-            }
-
-            for(; i < maxindex; i++)
-            {
-                cachefy[i] = 327.68 * (116.0 * std::cbrt((double)i / MAXVALF) - 16.0);
-            }
-        }
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        {
-            for (int i = 0; i < maxindex; i++)
-            {
-                gammatab_srgb[i] = gammatab_srgb1[i] = gamma2(i / 65535.0);
-            }
-            gammatab_srgb *= 65535.f;
-            gamma2curve.share(gammatab_srgb, LUT_CLIP_BELOW | LUT_CLIP_ABOVE); // shares the buffer with gammatab_srgb but has different clip flags
-        }
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        {
-            for (int i = 0; i < maxindex; i++)
-            {
-                igammatab_srgb[i] = igammatab_srgb1[i] = igamma2 (i / 65535.0);
+                if (i <= epsmaxint) {
+                    return 327.68 * ((kappa * i / MAXVALF + 16.0) / 116.0);
+                } else {
+                    return 327.68 * std::cbrt((double)i / MAXVALF);
+                }
             }
-
-            igammatab_srgb *= 65535.f;
-        }
-#ifdef _OPENMP
-        #pragma omp section
-#endif
+        },
         {
-            double rsRGBGamma = 1.0 / sRGBGamma;
-
-            for (int i = 0; i < maxindex; i++)
+            &cachefy, LUT_CLIP_BELOW,
+            [=](int i) -> float
             {
-                double val = pow (i / 65535.0, rsRGBGamma);
-                gammatab[i] = 65535.0 * val;
-                gammatabThumb[i] = (unsigned char)(255.0 * val);
+                if (i <= epsmaxint) {
+                    return 327.68 * (kappa * i / MAXVALF);
+                } else {
+                    return 327.68 * (116.0 * std::cbrt((double)i / MAXVALF) - 16.0);
+                }
             }
-        }
-
-#ifdef _OPENMP
-        #pragma omp section
-#endif
+        },
+        { &gammatab_srgb, 0, [](int i) -> float { return float(gamma2(i / 65535.0)) * 65535.f; } },
+        { &gammatab_srgb1, 0, [](int i) -> float { return gamma2(i / 65535.0); } },
+        { &igammatab_srgb, 0, [](int i) -> float { return float(igamma2(i / 65535.0)) * 65535.f; } },
+        { &igammatab_srgb1, 0, [](int i) -> float { return igamma2(i / 65535.0); } },
+        { &gammatab, 0, [=](int i) -> float { return 65535.0 * pow(i / 65535.0, rsRGBGamma); } },
         // modify arbitrary data for Lab..I have test : nothing, gamma 2.6 11 - gamma 4 5 - gamma 5.5 10
         // we can put other as gamma g=2.6 slope=11, etc.
         // but noting to do with real gamma !!!: it's only for data Lab # data RGB
         // finally I opted for gamma55 and with options we can change
-        for (int i = 0; i < maxindex; i++) {
-            denoiseGammaTab[i] = 65535.0 * gamma55 (i / 65535.0);
-        }
+        { &denoiseGammaTab, 0, [](int i) -> float { return 65535.0 * gamma55(i / 65535.0); } },
+        { &denoiseIGammaTab, 0, [](int i) -> float { return 65535.0 * igamma55(i / 65535.0); } },
+        { &gammatab_24_17a, LUT_CLIP_ABOVE | LUT_CLIP_BELOW, [](int i) -> float { return gamma24_17(i / 65535.0); } },
+        { &igammatab_24_17, 0, [](int i) -> float { return 65535.0 * igamma24_17(i / 65535.0); } },
+        { &jzazbz_pq_, 0, [](int i) -> float { return PQ(float(i)/65535.f); } },
+        { &jzazbz_pq_inv_, 0, [](int i) -> float { return PQ_inv(float(i)/65535.f); } }
+    };
+    ColorTable<uint8_t> thumb = {
+        &gammatabThumb, 0, [=](int i) -> uint8_t { return (unsigned char)(255.0 * pow(i / 65535.0, rsRGBGamma)); }
+    };
 
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        // modify arbitrary data for Lab..I have test : nothing, gamma 2.6 11 - gamma 4 5 - gamma 5.5 10
-        // we can put other as gamma g=2.6 slope=11, etc.
-        // but noting to do with real gamma !!!: it's only for data Lab # data RGB
-        // finally I opted for gamma55 and with options we can change
+    const Glib::ustring tables_file = settings->cacheDirectory.empty() ? Glib::ustring() : Glib::build_filename(settings->cacheDirectory, "colortables.bin");
 
-        for (int i = 0; i < maxindex; i++) {
-            denoiseIGammaTab[i] = 65535.0 * igamma55 (i / 65535.0);
+    if (tables_file.empty() || !map_color_tables(tables_file, tables, thumb, maxindex)) {
+        for (auto &t : tables) {
+            (*t.lut)(maxindex, t.flags);
         }
+        (*thumb.lut)(maxindex, thumb.flags);
 
 #ifdef _OPENMP
-        #pragma omp section
+        #pragma omp parallel for schedule(dynamic)
 #endif
-
-        for (int i = 0; i < maxindex; i++) {
-            gammatab_24_17a[i] = gamma24_17(i / 65535.0);
+        for (size_t k = 0; k <= tables.size(); ++k) {
+            if (k < tables.size()) {
+                fill_color_table(tables[k], maxindex);
+            } else {
+                fill_color_table(thumb, maxindex);
+            }
         }
 
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-
-        for (int i = 0; i < maxindex; i++) {
-            igammatab_24_17[i] = 65535.0 * igamma24_17 (i / 65535.0);
+        if (!tables_file.empty() && !save_color_tables(tables_file, tables, thumb, maxindex) && settings->verbose) {
+            printf("Cannot save the colour tables to %s\n", tables_file.c_str());
         }
+    } else if (settings->verbose) {
+        printf("Mapped the colour tables from %s\n", tables_file.c_str());
+    }
 
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        initMunsell();
-
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        linearGammaTRC = cmsBuildGamma(nullptr, 1.0);
+    gamma2curve.share(gammatab_srgb, LUT_CLIP_BELOW | LUT_CLIP_ABOVE); // shares the buffer with gammatab_srgb but has different clip flags
 
-#ifdef _OPENMP
-        #pragma omp section
-#endif
-        for (int i = 0; i < maxindex; ++i) {
-            jzazbz_pq_[i] = PQ(float(i)/65535.f);
-            jzazbz_pq_inv_[i] = PQ_inv(float(i)/65535.f);
-        }
-    }
+    initMunsell();
+    linearGammaTRC = cmsBuildGamma(nullptr, 1.0);
 }
 
 void Color::cleanup ()
@@ -334,6 +440,8 @@ void Color::cleanup ()
     if (linearGammaTRC) {
         cmsFreeToneCurve(linearGammaTRC);
     }
+
+    unmap_color_tables();
 }
 
 void Color::rgb2lab01 (const Glib::ustring &profile, const Glib::ustring &profileW, float r, float g, float b, float &LAB_l, float &LAB_a, float &LAB_b, bool workingSpace)
@@ -1276,6 +1384,29 @@ inline float Color::computeXYZ2LabY(float f)
 }
 
 
+void Color::scaledXYZ2Lab(float x, float y, float z, float &L, float &a, float &b)
+{
+    const float fx = computeXYZ2Lab(x);
+    const float fy = computeXYZ2Lab(y);
+    const float fz = computeXYZ2Lab(z);
+
+    L = computeXYZ2LabY(y);
+    a = 500.f * (fx - fy);
+    b = 200.f * (fy - fz);
+}
+
+
+int Color::RGB2LabWide(const float *R, const float *G, const float *B, float *L, float *a, float *b, const float wp[3][3], int width, bool scaleD50)
+{
+    const auto view =
+        [](const LUTf &lut) -> simd::LUTView
+        {
+            return { &lut[0], float(lut.getSize() - 2), float(lut.getUpperBound()) };
+        };
+    return simd::rgb2lab(R, G, B, L, a, b, width, wp, scaleD50 ? float(D50x) : 1.f, scaleD50 ? float(D50z) : 1.f, view(cachef), view(cachefy), scaledXYZ2Lab);
+}
+
+
 void Color::RGB2Lab(float *R, float *G, float *B, float *L, float *a, float *b, const float wp[3][3], int width)
 {
 
@@ -1285,7 +1416,7 @@ void Color::RGB2Lab(float *R, float *G, float *B, float *L, float *a, float *b,
     vfloat c500v = F2V(500.f);
     vfloat c200v = F2V(200.f);
 #endif
-    int i = 0;
+    int i = RGB2LabWide(R, G, B, L, a, b, wp, width, false);
     
 #ifdef __SSE2__
     for(;i < width - 3; i+=4) {
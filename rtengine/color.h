@@ -100,6 +100,8 @@ private:
 
     static float computeXYZ2Lab(float f);
     static float computeXYZ2LabY(float f);
+    // XYZ2Lab() with x and z already divided by D50x and D50z
+    static void scaledXYZ2Lab(float x, float y, float z, float &L, float &a, float &b);
 
     static LUTf jzazbz_pq_;
     static LUTf jzazbz_pq_inv_;
@@ -626,6 +628,11 @@ public:
 #endif
     static void RGB2Lab(float *X, float *Y, float *Z, float *L, float *a, float *b, const float wp[3][3], int width);
     static void RGB2L(float *X, float *Y, float *Z, float *L, const float wp[3][3], int width);
+    // Converts the first pixels of a row with the AVX2/AVX-512 unit, if
+    // any, and returns how many (see simdkernels.h). Same results as
+    // RGB2Lab() or, if scaleD50 is true, as rgb2lab() with vfloat arguments.
+    // L, a and b may alias R, G and B
+    static int RGB2LabWide(const float *R, const float *G, const float *B, float *L, float *a, float *b, const float wp[3][3], int width, bool scaleD50);
 
     template <class T>
     static void rgb2lab(float R, float G, float B, float &l, float &a, float &b, const T ws[3][3])
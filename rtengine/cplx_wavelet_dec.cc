@@ -35,7 +35,45 @@ wavelet_decomposition::~wavelet_decomposition()
     delete[] wavfilt_synth;
 
     if(coeff0) {
-        delete [] coeff0;
+        release(coeff0);
+    }
+}
+
+
+wavelet_buffers::~wavelet_buffers()
+{
+    for (auto &b : blocks_) {
+        delete[] b.data;
+    }
+}
+
+
+float *wavelet_buffers::get(size_t n)
+{
+    Block *best = nullptr;
+    for (auto &b : blocks_) {
+        if (!b.used && b.size >= n && (!best || b.size < best->size)) {
+            best = &b;
+        }
+    }
+
+    if (!best) {
+        blocks_.push_back(Block{new float[n], n, false});
+        best = &blocks_.back();
+    }
+
+    best->used = true;
+    return best->data;
+}
+
+
+void wavelet_buffers::release(float *data)
+{
+    for (auto &b : blocks_) {
+        if (b.data == data) {
+            b.used = false;
+            return;
+        }
     }
 }
 
@@ -23,6 +23,7 @@
 
 #include <cstddef>
 #include <cmath>
+#include <utility>
 #include <vector>
 
 #include "cplx_wavelet_level.h"
@@ -43,7 +44,7 @@ private:
     static const int maxlevels = 10;//should be greater than any conceivable order of decimation
 
     int lvltot, subsamp;
-    //int numThreads;
+    int numThreads;
     int m_w, m_h;//dimensions
 
     int wavfilt_len, wavfilt_offset;
@@ -54,10 +55,27 @@ private:
     //wavelet_level<internal_type> * wavelet_decomp[maxlevels];
     std::vector<wavelet_level<internal_type> *> wavelet_decomp;
 
+    wavelet_buffers *pool;
+
+    float *alloc(size_t n)
+    {
+        return pool ? pool->get(n) : new float[n];
+    }
+
+    void release(float *data)
+    {
+        if (pool) {
+            pool->release(data);
+        } else {
+            delete[] data;
+        }
+    }
+
 public:
 
+    // if pool is not null, all the buffers are taken from it
     template<typename E>
-    wavelet_decomposition(E * src, int width, int height, int maxlvl, int subsampling, int skipcrop = 1, int numThreads = 1, int Daub4Len = 6);
+    wavelet_decomposition(E * src, int width, int height, int maxlvl, int subsampling, int skipcrop = 1, int numThreads = 1, int Daub4Len = 6, wavelet_buffers *pool = nullptr);
 
     ~wavelet_decomposition();
 
@@ -95,10 +113,10 @@ public:
 };
 
 template<typename E>
-wavelet_decomposition::wavelet_decomposition(E * src, int width, int height, int maxlvl, int subsampling, int skipcrop, int numThreads, int Daub4Len)
+wavelet_decomposition::wavelet_decomposition(E * src, int width, int height, int maxlvl, int subsampling, int skipcrop, int numThreads, int Daub4Len, wavelet_buffers *pool)
     : coeff0(nullptr),
       //memoryAllocationFailed(false),
-      lvltot(0), subsamp(subsampling), /*numThreads(numThreads),*/ m_w(width), m_h(height)
+      lvltot(0), subsamp(subsampling), numThreads(numThreads), m_w(width), m_h(height), pool(pool)
 {
 
     //initialize wavelet filters
@@ -154,14 +172,14 @@ wavelet_decomposition::wavelet_decomposition(E * src, int width, int height, int
 
     lvltot = 0;
     E *buffer[2];
-    buffer[0] = new /*(std::nothrow)*/ E[(m_w / 2 + 1) * (m_h / 2 + 1)];
+    buffer[0] = alloc((m_w / 2 + 1) * (m_h / 2 + 1));
 
     // if(buffer[0] == nullptr) {
     //     memoryAllocationFailed = true;
     //     return;
     // }
 
-    buffer[1] = new /*(std::nothrow)*/ E[(m_w / 2 + 1) * (m_h / 2 + 1)];
+    buffer[1] = alloc((m_w / 2 + 1) * (m_h / 2 + 1));
 
     // if(buffer[1] == nullptr) {
     //     memoryAllocationFailed = true;
@@ -175,7 +193,7 @@ wavelet_decomposition::wavelet_decomposition(E * src, int width, int height, int
 
     wavelet_decomp.push_back(new wavelet_level<internal_type>(
                                  src, buffer[bufferindex ^ 1], lvltot/*level*/, subsamp, m_w, m_h, 
-                                 wavfilt_anal, wavfilt_anal, wavfilt_len, wavfilt_offset, skipcrop, numThreads));
+                                 wavfilt_anal, wavfilt_anal, wavfilt_len, wavfilt_offset, skipcrop, numThreads, pool));
 
     // if(wavelet_decomp[lvltot]->memoryAllocationFailed) {
     //     memoryAllocationFailed = true;
@@ -186,7 +204,7 @@ wavelet_decomposition::wavelet_decomposition(E * src, int width, int height, int
         bufferindex ^= 1;
         wavelet_decomp.push_back(new wavelet_level<internal_type>(buffer[bufferindex], buffer[bufferindex ^ 1]/*lopass*/, lvltot/*level*/, subsamp, 
                 wavelet_decomp[lvltot - 1]->width(), wavelet_decomp[lvltot - 1]->height(), 
-                                                                  wavfilt_anal, wavfilt_anal, wavfilt_len, wavfilt_offset, skipcrop, numThreads));
+                                                                  wavfilt_anal, wavfilt_anal, wavfilt_len, wavfilt_offset, skipcrop, numThreads, pool));
 
         // if(wavelet_decomp[lvltot]->memoryAllocationFailed) {
         //     memoryAllocationFailed = true;
@@ -194,7 +212,7 @@ wavelet_decomposition::wavelet_decomposition(E * src, int width, int height, int
     }
 
     coeff0 = buffer[bufferindex ^ 1];
-    delete[] buffer[bufferindex];
+    release(buffer[bufferindex]);
 }
 
 template<typename E>
@@ -211,7 +229,10 @@ void wavelet_decomposition::reconstruct(E * dst, const float blend)
         int width = wavelet_decomp[1]->m_w;
         int height = wavelet_decomp[1]->m_h;
 
-        E *tmpHi = new /*(std::nothrow)*/ E[width * height];
+        // the levels which are not subsampled are reconstructed from coeff0
+        // into tmp, and then the two buffers are swapped
+        E *tmp = alloc((m_w / 2 + 1) * (m_h / 2 + 1));
+        E *tmpHi = nullptr;
 
         // if(tmpHi == nullptr) {
         //     memoryAllocationFailed = true;
@@ -219,13 +240,24 @@ void wavelet_decomposition::reconstruct(E * dst, const float blend)
         // }
 
         for (int lvl = lvltot; lvl > 0; lvl--) {
-            E *tmpLo = wavelet_decomp[lvl]->wavcoeffs[2]; // we can use this as buffer
-            wavelet_decomp[lvl]->reconstruct_level(tmpLo, tmpHi, coeff0, coeff0, wavfilt_synth, wavfilt_synth, wavfilt_len, wavfilt_offset);
+            if (wavelet_decomp[lvl]->subsampled()) {
+                if (!tmpHi) {
+                    tmpHi = alloc(width * height);
+                }
+                E *tmpLo = wavelet_decomp[lvl]->wavcoeffs[2]; // we can use this as buffer
+                wavelet_decomp[lvl]->reconstruct_level(tmpLo, tmpHi, coeff0, coeff0, wavfilt_synth, wavfilt_synth, wavfilt_len, wavfilt_offset);
+            } else {
+                wavelet_decomp[lvl]->reconstruct_level_haar(coeff0, tmp);
+                std::swap(coeff0, tmp);
+            }
             delete wavelet_decomp[lvl];
             wavelet_decomp[lvl] = nullptr;
         }
 
-        delete[] tmpHi;
+        if (tmpHi) {
+            release(tmpHi);
+        }
+        release(tmp);
     }
 
     int width = wavelet_decomp[0]->m_w;
@@ -243,7 +275,7 @@ void wavelet_decomposition::reconstruct(E * dst, const float blend)
     //     }
     // }
 
-    E *tmpHi = new /*(std::nothrow)*/ E[width * height];
+    E *tmpHi = alloc(width * height);
 
     // if(tmpHi == nullptr) {
     //     memoryAllocationFailed = true;
@@ -262,10 +294,10 @@ void wavelet_decomposition::reconstruct(E * dst, const float blend)
     //     delete[] tmpLo;
     // }
 
-    delete[] tmpHi;
+    release(tmpHi);
     delete wavelet_decomp[0];
     wavelet_decomp[0] = nullptr;
-    delete[] coeff0;
+    release(coeff0);
     coeff0 = nullptr;
 }
 
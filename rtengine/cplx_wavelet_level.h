@@ -26,10 +26,38 @@
 #include "rt_math.h"
 #include "opthelper.h"
 #include "stdio.h"
+#include "noncopyable.h"
 #include <memory>
+#include <vector>
 
 namespace rtengine {
 
+/*
+ * A pool of buffers for the subbands of wavelet decompositions.
+ * Decompositions of the same size made one after the other with the same
+ * pool (e.g. one per local contrast region) reuse the same blocks, instead
+ * of allocating and faulting in new memory each time. A pool must be used
+ * by one decomposition at a time.
+ */
+class wavelet_buffers: public NonCopyable {
+public:
+    wavelet_buffers() = default;
+    ~wavelet_buffers();
+
+    // returns a block of at least n floats
+    float *get(size_t n);
+    void release(float *data);
+
+private:
+    struct Block {
+        float *data;
+        size_t size;
+        bool used;
+    };
+    std::vector<Block> blocks_;
+};
+
+
 template<typename T>
 class wavelet_level {
 
@@ -44,6 +72,9 @@ class wavelet_level {
     // spacing of filter taps
     int skip;
 
+    // where the subbands are allocated from (if not null)
+    wavelet_buffers *pool;
+
     // bool bigBlockOfMemory;
     // allocation and destruction of data storage
     T ** create(int n);
@@ -83,8 +114,8 @@ public:
     int m_w2, m_h2;
 
     template<typename E>
-    wavelet_level(E * src, E * dst, int level, int subsamp, int w, int h, float *filterV, float *filterH, int len, int offset, int skipcrop, int numThreads)
-        : lvl(level), subsamp_out((subsamp >> level) & 1), numThreads(numThreads), skip(1 << level),
+    wavelet_level(E * src, E * dst, int level, int subsamp, int w, int h, float *filterV, float *filterH, int len, int offset, int skipcrop, int numThreads, wavelet_buffers *pool = nullptr)
+        : lvl(level), subsamp_out((subsamp >> level) & 1), numThreads(numThreads), skip(1 << level), pool(pool),
           //bigBlockOfMemory(true), memoryAllocationFailed(false),
           wavcoeffs(nullptr), m_w(w), m_h(h), m_w2(w), m_h2(h)
     {
@@ -144,6 +175,11 @@ public:
         return skip;
     }
 
+    bool subsampled() const
+    {
+        return subsamp_out;
+    }
+
     // bool bigBlockOfMemoryUsed() const
     // {
     //     return bigBlockOfMemory;
@@ -154,12 +190,18 @@ public:
 
     template<typename E>
     void reconstruct_level(E* tmpLo, E* tmpHi, E *src, E *dst, float *filterV, float *filterH, int taps, int offset, const float blend = 1.f);
+
+    // reconstruction of a level which is not subsampled, with the
+    // horizontal and vertical Haar synthesis fused in a single pass and no
+    // temporary buffers. src and dst must not overlap
+    template<typename E>
+    void reconstruct_level_haar(const E *src, E *dst);
 };
 
 template<typename T>
 T ** wavelet_level<T>::create(int n)
 {
-    T * data = new /*(std::nothrow)*/ T[3 * n];
+    T * data = pool ? pool->get(3 * n) : new /*(std::nothrow)*/ T[3 * n];
 
     // if(data == nullptr) {
     //     bigBlockOfMemory = false;
@@ -189,7 +231,11 @@ void wavelet_level<T>::destroy(T ** subbands)
 {
     if(subbands) {
         // if(bigBlockOfMemory) {
-            delete[] subbands[1];
+            if (pool) {
+                pool->release(subbands[1]);
+            } else {
+                delete[] subbands[1];
+            }
         // } else {
         //     for(int j = 1; j < 4; j++) {
         //         if(subbands[j] != nullptr) {
@@ -297,6 +343,72 @@ template<typename T> void wavelet_level<T>::SynthesisFilterHaarVertical (const T
     }
 }
 
+template<typename T> template<typename E> void wavelet_level<T>::reconstruct_level_haar(const E * RESTRICT src, E * RESTRICT dst)
+{
+    /* Same computation as SynthesisFilterHaarHorizontal on (src, wavcoeffs[1])
+     * and (wavcoeffs[2], wavcoeffs[3]), followed by SynthesisFilterHaarVertical,
+     * but computing the horizontal results of rows i and i - skip when output
+     * row i needs them
+     */
+    const int width = m_w;
+    const int xs = min(skip, width);
+    const T * const c1 = wavcoeffs[1];
+    const T * const c2 = wavcoeffs[2];
+    const T * const c3 = wavcoeffs[3];
+
+    const auto lo0 = [&](int p) -> float { return src[p] + c1[p]; };
+    const auto hi0 = [&](int p) -> float { return c2[p] + c3[p]; };
+    const auto lo = [&](int p) -> float { return 0.5f * (src[p] + c1[p] + src[p - skip] - c1[p - skip]); };
+    const auto hi = [&](int p) -> float { return 0.5f * (c2[p] + c3[p] + c2[p - skip] - c3[p - skip]); };
+#ifdef __SSE2__
+    const vfloat halfv = F2V(0.5f);
+    const auto lov = [&](int p) -> vfloat { return halfv * (LVFU(src[p]) + LVFU(c1[p]) + LVFU(src[p - skip]) - LVFU(c1[p - skip])); };
+    const auto hiv = [&](int p) -> vfloat { return halfv * (LVFU(c2[p]) + LVFU(c3[p]) + LVFU(c2[p - skip]) - LVFU(c3[p - skip])); };
+#endif
+
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(numThreads) if(numThreads>1)
+#endif
+
+    for (int i = 0; i < m_h; i++) {
+        const int p = i * width;
+        E * const out = dst + p;
+        int j;
+
+        if (i < skip) {
+            for (j = 0; j < xs; j++) {
+                out[j] = lo0(p + j) + hi0(p + j);
+            }
+
+#ifdef __SSE2__
+            for (; j < width - 3; j += 4) {
+                STVFU(out[j], lov(p + j) + hiv(p + j));
+            }
+#endif
+
+            for (; j < width; j++) {
+                out[j] = lo(p + j) + hi(p + j);
+            }
+        } else {
+            const int q = p - skip * width;
+
+            for (j = 0; j < xs; j++) {
+                out[j] = 0.5f * (lo0(p + j) + hi0(p + j) + lo0(q + j) - hi0(q + j));
+            }
+
+#ifdef __SSE2__
+            for (; j < width - 3; j += 4) {
+                STVFU(out[j], halfv * (lov(p + j) + hiv(p + j) + lov(q + j) - hiv(q + j)));
+            }
+#endif
+
+            for (; j < width; j++) {
+                out[j] = 0.5f * (lo(p + j) + hi(p + j) + lo(q + j) - hi(q + j));
+            }
+        }
+    }
+}
+
 template<typename T>
 void wavelet_level<T>::AnalysisFilterSubsampHorizontal (T * RESTRICT srcbuffer, T * RESTRICT dstLo, T * RESTRICT dstHi, float * RESTRICT filterLo, float *RESTRICT filterHi,
         const int taps, const int offset, const int srcwidth, const int dstwidth, const int row)
@@ -26,6 +26,7 @@
 /*RT*/#include <omp.h>
 /*RT*/#endif
 
+#include <atomic>
 #include <utility>
 #include <vector>
 #include "opthelper.h"
@@ -275,6 +276,10 @@ void CLASS merror (void *ptr, const char *where)
 }
 
 void CLASS derror()
+{
+#ifdef _OPENMP
+#pragma omp critical(dcraw_derror)
+#endif
 {
   if (!data_error) {
     fprintf (stderr, "%s: ", ifname);
@@ -288,6 +293,7 @@ void CLASS derror()
 #endif
   }
   data_error++;
+}
 /*RT Issue 2467  longjmp (failure, 1);*/
 }
 
@@ -845,6 +851,11 @@ struct jhead {
 };
 
 int CLASS ljpeg_start (struct jhead *jh, int info_only)
+{
+  return ljpeg_start (jh, info_only, ifp, getbithuff, zero_after_ff);
+}
+
+int CLASS ljpeg_start (struct jhead *jh, int info_only, IMFILE *ifp, getbithuff_t &getbithuff, unsigned &zero_after_ff)
 {
   ushort c, tag, len;
   uchar data[0x10000];
@@ -909,6 +920,11 @@ void CLASS ljpeg_end (struct jhead *jh)
 }
 
 inline int CLASS ljpeg_diff (ushort *huff)
+{
+  return ljpeg_diff (huff, getbithuff);
+}
+
+inline int CLASS ljpeg_diff (ushort *huff, getbithuff_t &getbithuff)
 {
   int len, diff;
 
@@ -922,6 +938,11 @@ inline int CLASS ljpeg_diff (ushort *huff)
 }
 
 ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
+{
+  return ljpeg_row (jrow, jh, ifp, getbithuff);
+}
+
+ushort * CLASS ljpeg_row (int jrow, struct jhead *jh, IMFILE *ifp, getbithuff_t &getbithuff)
 {
   int col, c, diff, pred, spred=0;
   ushort mark=0, *row[3];
@@ -938,7 +959,7 @@ ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
   FORC3 row[c] = (jh->row + ((jrow & 1) + 1) * (jh->wide*jh->clrs*((jrow+c) & 1)));
   for (col=0; col < jh->wide; col++)
     FORC(jh->clrs) {
-      diff = ljpeg_diff (jh->huff[c]);
+      diff = ljpeg_diff (jh->huff[c], getbithuff);
       if (jh->sraw && c <= jh->sraw && (col | c))
 		    pred = spred;
       else if (col) pred = row[0][-jh->clrs];
@@ -1193,12 +1214,83 @@ void CLASS lossless_dnglj92_load_raw()
     }
 }
 
+/*RT: decode the tiles of a lossless (predictive) tiled DNG concurrently.
+  Tile offsets are read up front, and each tile is decoded from the memory
+  mapped file with its own file position and bit reader. Returns false
+  (without touching the raw data) if the image is not suitable */
+bool CLASS lossless_dng_load_raw_tiles()
+{
+  if (tile_length >= INT_MAX || tile_width >= INT_MAX) return false;
+  const size_t tiles_wide = (raw_width + tile_width - 1) / tile_width;
+  const size_t tiles_high = (raw_height + tile_length - 1) / tile_length;
+  const size_t tile_count = tiles_wide * tiles_high;
+  if (tile_count < 2) return false;
+
+  const ssize_t save = ftell(ifp);
+  std::vector<ssize_t> offsets(tile_count);
+  for (size_t t = 0; t < tile_count; ++t)
+    offsets[t] = get4();
+
+  // DCT-based (0xc1) tiles are left to the serial path
+  {
+    IMFILE f = *ifp;
+    f.plistener = nullptr;
+    IMFILE *fp = &f;
+    unsigned zaff = 0;
+    getbithuff_t bits(this, fp, zaff);
+    struct jhead jh;
+    fseek (fp, offsets[0], SEEK_SET);
+    if (!ljpeg_start (&jh, 1, fp, bits, zaff) || jh.algo != 0xc3) {
+      fseek (ifp, save, SEEK_SET);
+      return false;
+    }
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (size_t t = 0; t < tile_count; ++t) {
+    IMFILE f = *ifp;
+    f.plistener = nullptr;
+    f.eof = false;
+    IMFILE *fp = &f;
+    unsigned zaff = 0;
+    getbithuff_t bits(this, fp, zaff);
+    struct jhead jh;
+
+    fseek (fp, offsets[t], SEEK_SET);
+    if (!ljpeg_start (&jh, 0, fp, bits, zaff)) continue;
+    if (jh.algo == 0xc3) {
+      const unsigned trow = (t / tiles_wide) * tile_length;
+      const unsigned tcol = (t % tiles_wide) * tile_width;
+      unsigned jwide = jh.wide;
+      if (filters || (colors == 1 && jh.clrs > 1)) jwide *= jh.clrs;
+      jwide /= MIN (is_raw, tiff_samples);
+      unsigned row = 0, col = 0;
+      for (int jrow=0; jrow < jh.high; jrow++) {
+        ushort *rp = ljpeg_row (jrow, &jh, fp, bits);
+        for (unsigned jcol=0; jcol < jwide; jcol++) {
+          adobe_copy_pixel (trow+row, tcol+col, &rp);
+          if (++col >= tile_width || col >= raw_width)
+            row += 1 + (col = 0);
+        }
+      }
+    }
+    ljpeg_end (&jh);
+  }
+
+  fseek (ifp, save + 4 * tile_count, SEEK_SET);
+  return true;
+}
+
 void CLASS lossless_dng_load_raw()
 {
   unsigned save, trow=0, tcol=0, jwide, jrow, jcol, row, col, i, j;
   struct jhead jh;
   ushort *rp;
 
+  if (lossless_dng_load_raw_tiles()) return;
+
   while (trow < raw_height) {
     save = ftell(ifp);
     if (tile_length < INT_MAX)
@@ -3038,6 +3130,64 @@ void CLASS lossy_dng_load_raw()
     gamma_curve (1/2.4, 12.92310, 1, 255);
     FORC3 memcpy (cur[c], curve, sizeof cur[0]);
   }
+  if (tile_length < INT_MAX && tile_width < INT_MAX) {
+    // RT: tiles are independent JPEG streams, decode them concurrently
+    // straight from the memory mapped file
+    const size_t tiles_wide = (raw_width + tile_width - 1) / tile_width;
+    const size_t tiles_high = (raw_height + tile_length - 1) / tile_length;
+    const size_t tile_count = tiles_wide * tiles_high;
+    std::vector<ssize_t> offsets(tile_count);
+    fseek (ifp, data_offset, SEEK_SET);
+    for (size_t t = 0; t < tile_count; ++t)
+      offsets[t] = get4();
+    std::atomic<bool> failed(false);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      struct jpeg_decompress_struct tcinfo;
+      rt_jpeg_error_mgr tjerr;
+      tcinfo.err = rt_jpeg_std_error(&tjerr, ifname, nullptr);
+      jpeg_create_decompress (&tcinfo);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (size_t t = 0; t < tile_count; ++t) {
+        if (failed || offsets[t] < 0 || offsets[t] >= ifp->size) continue;
+        const unsigned trow = (t / tiles_wide) * tile_length;
+        const unsigned tcol = (t % tiles_wide) * tile_width;
+        unsigned c; // for FORC3
+        try {
+          jpeg_mem_src(&tcinfo, fdata(offsets[t], ifp), ifp->size - offsets[t]);
+          jpeg_read_header (&tcinfo, TRUE);
+          jpeg_start_decompress (&tcinfo);
+          JSAMPARRAY tbuf = (*tcinfo.mem->alloc_sarray)
+            ((j_common_ptr) &tcinfo, JPOOL_IMAGE, tcinfo.output_width*3, 1);
+          unsigned trow_cur;
+          while (tcinfo.output_scanline < tcinfo.output_height &&
+                 (trow_cur = trow + tcinfo.output_scanline) < height) {
+            jpeg_read_scanlines (&tcinfo, tbuf, 1);
+            JSAMPLE (*tpixel)[3] = (JSAMPLE (*)[3]) tbuf[0];
+            for (unsigned tc=0; tc < tcinfo.output_width && tcol+tc < width; tc++) {
+              FORC3 image[trow_cur*width+tcol+tc][c] = cur[c][tpixel[tc][c]];
+            }
+          }
+          jpeg_abort_decompress (&tcinfo);
+        } catch (rt_jpeg_error &) {
+          failed = true;
+        }
+      }
+      jpeg_destroy_decompress (&tcinfo);
+    }
+
+    if (failed) {
+      longjmp (failure, 1);
+    }
+    maximum = 0xffff;
+    return;
+  }
+
   //cinfo.err = jpeg_std_error (&jerr);
   cinfo.err = rt_jpeg_std_error(&jerr, ifname, nullptr);
   jpeg_create_decompress (&cinfo);
@@ -10921,16 +11071,13 @@ void CLASS deflate_dng_load_raw() {
       tileOffsets[t] = get4();
     }
     size_t tileBytes[tileCount];
-    uLongf maxCompressed = 0;
     if (tileCount == 1) {
-      tileBytes[0] = maxCompressed = ifd->bytes;
+      tileBytes[0] = ifd->bytes;
     } else {
       fseek(ifp, ifd->bytes, SEEK_SET);
       for (size_t t = 0; t < tileCount; ++t) {
         tileBytes[t] = get4();
         //fprintf(stderr, "Tile %d at %d, size %d\n", t, tileOffsets[t], tileBytes[t]);
-        if (maxCompressed < tileBytes[t])
-          maxCompressed = tileBytes[t];
       }
     }
     uLongf dstLen = tile_width * tile_length * 4;
@@ -10939,7 +11086,6 @@ void CLASS deflate_dng_load_raw() {
 #pragma omp parallel
 #endif
 {
-    Bytef * cBuffer = new Bytef[maxCompressed];
     Bytef * uBuffer = new Bytef[dstLen];
 
 #ifdef _OPENMP
@@ -10948,14 +11094,11 @@ void CLASS deflate_dng_load_raw() {
     for (size_t y = 0; y < raw_height; y += tile_length) {
         for (size_t x = 0; x < raw_width; x += tile_width) {
             size_t t = (y / tile_length) * tilesWide + (x / tile_width);
-#ifdef _OPENMP
-            #pragma omp critical
-#endif
-            {
-                fseek(ifp, tileOffsets[t], SEEK_SET);
-                fread(cBuffer, 1, tileBytes[t], ifp);
+            // decompress straight from the memory mapped file
+            int err = Z_DATA_ERROR;
+            if (tileOffsets[t] < size_t(ifp->size) && tileBytes[t] <= size_t(ifp->size) - tileOffsets[t]) {
+                err = decompress(tileBytes[t], dstLen, fdata(tileOffsets[t], ifp), uBuffer);
             }
-            int err = decompress(tileBytes[t], dstLen, cBuffer, uBuffer);
             if (err != Z_OK) {
                 fprintf(stderr, "DNG Deflate: Failed uncompressing tile %d, with error %d\n", (int)t, err);
             } else if (ifd->sample_format == 3) {  // Floating point data
@@ -10976,7 +11119,6 @@ void CLASS deflate_dng_load_raw() {
         }
     }
 
-    delete [] cBuffer;
     delete [] uBuffer;
 }
   }
@@ -359,6 +359,10 @@ int ljpeg_start (struct jhead *jh, int info_only);
 void ljpeg_end (struct jhead *jh);
 int ljpeg_diff (ushort *huff);
 ushort * ljpeg_row (int jrow, struct jhead *jh);
+// variants with explicit decoder state, for decoding tiles in parallel
+int ljpeg_start (struct jhead *jh, int info_only, IMFILE *ifp, getbithuff_t &getbithuff, unsigned &zero_after_ff);
+int ljpeg_diff (ushort *huff, getbithuff_t &getbithuff);
+ushort * ljpeg_row (int jrow, struct jhead *jh, IMFILE *ifp, getbithuff_t &getbithuff);
 void lossless_jpeg_load_raw();
 void ljpeg_idct (struct jhead *jh);
 
@@ -366,6 +370,7 @@ void ljpeg_idct (struct jhead *jh);
 void canon_sraw_load_raw();
 void adobe_copy_pixel (unsigned row, unsigned col, ushort **rp);
 void lossless_dng_load_raw();
+bool lossless_dng_load_raw_tiles();
 void lossless_dnglj92_load_raw();
 void packed_dng_load_raw();
 void deflate_dng_load_raw();
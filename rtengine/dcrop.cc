@@ -41,6 +41,7 @@ extern const Settings* settings;
 Crop::Crop(ImProcCoordinator* parent, EditDataProvider *editDataProvider, bool isDetailWindow)
     : PipetteBuffer(editDataProvider), origCrop(nullptr), spotCrop(nullptr),
       denoiseCrop(nullptr),
+      half_cache_(false),
       cropImg (nullptr), transCrop (nullptr), 
       updating(false), newUpdatePending(false), skip(10),
       cropx(0), cropy(0), cropw(-1), croph(-1),
@@ -377,10 +378,18 @@ void Crop::update(int todo)
         transCrop = nullptr;
     }
 
+    // with the half-float cache, the intermediate stages are computed in
+    // bufs_[2] and only their binary16 copies are kept
+    Imagefloat *buf0 = half_cache_ ? bufs_[2] : bufs_[0];
+    Imagefloat *buf1 = half_cache_ ? bufs_[2] : bufs_[1];
+
     if (todo & M_RGBCURVE) {
         Imagefloat *workingCrop = baseCrop;
-        workingCrop->copyTo(bufs_[0]);
-        pipeline_stop_[1] = stop || parent->ipf.process(ImProcFunctions::Pipeline::PREVIEW, ImProcFunctions::Stage::STAGE_1, bufs_[0]);
+        workingCrop->copyTo(buf0);
+        pipeline_stop_[1] = stop || parent->ipf.process(ImProcFunctions::Pipeline::PREVIEW, ImProcFunctions::Stage::STAGE_1, buf0, pcache_.get());
+        if (half_cache_) {
+            hbufs_[0].store(buf0, true);
+        }
         
         if (workingCrop != baseCrop) {
             delete workingCrop;
@@ -389,16 +398,27 @@ void Crop::update(int todo)
     stop = stop || pipeline_stop_[1];
 
     if (todo & M_LUMACURVE) {
-        bufs_[0]->copyTo(bufs_[1]);
+        if (half_cache_) {
+            hbufs_[0].restore(buf1, true);
+        } else {
+            bufs_[0]->copyTo(bufs_[1]);
+        }
         
-        pipeline_stop_[2] = stop || parent->ipf.process(ImProcFunctions::Pipeline::PREVIEW, ImProcFunctions::Stage::STAGE_2, bufs_[1]);
+        pipeline_stop_[2] = stop || parent->ipf.process(ImProcFunctions::Pipeline::PREVIEW, ImProcFunctions::Stage::STAGE_2, buf1, pcache_.get());
+        if (half_cache_) {
+            hbufs_[1].store(buf1, true);
+        }
     }
     stop = stop || pipeline_stop_[2];
     
     if (todo & (M_LUMINANCE | M_COLOR)) {
-        bufs_[1]->copyTo(bufs_[2]);
+        if (half_cache_) {
+            hbufs_[1].restore(bufs_[2], true);
+        } else {
+            bufs_[1]->copyTo(bufs_[2]);
+        }
 
-        pipeline_stop_[3] = stop || parent->ipf.process(ImProcFunctions::Pipeline::PREVIEW, ImProcFunctions::Stage::STAGE_3, bufs_[2]);
+        pipeline_stop_[3] = stop || parent->ipf.process(ImProcFunctions::Pipeline::PREVIEW, ImProcFunctions::Stage::STAGE_3, bufs_[2], pcache_.get());
     }
     stop = stop || pipeline_stop_[3];
 
@@ -471,6 +491,10 @@ void Crop::freeAll()
                 bufs_[i-1] = nullptr;
             }
         }
+        for (auto &h : hbufs_) {
+            h.clear();
+        }
+        pcache_.reset();
 
         if (cropImg) {
             delete    cropImg;
@@ -633,12 +657,22 @@ bool Crop::setCropSizes(int rcx, int rcy, int rcw, int rch, int skip, bool inter
             denoiseCrop->allocate(cropw, croph);
         }
 
+        half_cache_ = settings->preview_half_float_cache;
         for (int i = 0; i < 3; ++i) {
+            if (half_cache_ && i < 2) {
+                delete bufs_[i];
+                bufs_[i] = nullptr;
+                continue;
+            }
             if (!bufs_[i]) {
                 bufs_[i] = new Imagefloat();
             }
             bufs_[i]->allocate(cropw, croph);
         }
+        for (auto &h : hbufs_) {
+            h.clear();
+        }
+        pcache_.reset(new PipelineCache(half_cache_));
 
         if (!cropImg) {
             cropImg = new Image8();
@@ -664,7 +698,9 @@ bool Crop::setCropSizes(int rcx, int rcy, int rcw, int rch, int skip, bool inter
         denoiseCrop->assignColorSpace(parent->params.icm.workingProfile);
     }
     for (int i = 0; i < 3; ++i) {
-        bufs_[i]->assignColorSpace(parent->params.icm.workingProfile);
+        if (bufs_[i]) {
+            bufs_[i]->assignColorSpace(parent->params.icm.workingProfile);
+        }
     }
     
     cropx = bx1;
@@ -27,6 +27,8 @@
 #include "imagesource.h"
 #include "procevents.h"
 #include "pipettebuffer.h"
+#include "halfimagefloat.h"
+#include "pipelinecache.h"
 #include "../rtgui/threadutils.h"
 
 namespace rtengine {
@@ -43,6 +45,9 @@ protected:
     Imagefloat*  spotCrop;   // "one chunk" allocation
     Imagefloat *denoiseCrop;
     Imagefloat *bufs_[3];
+    HalfImagefloat hbufs_[2]; // binary16 copies of bufs_[0,1] if half_cache_ is set
+    bool half_cache_;
+    std::unique_ptr<PipelineCache> pcache_;
     std::array<bool, 4> pipeline_stop_;
     Image8*      cropImg;    // "one chunk" allocation ; displayed image in monitor color space, showing the output profile as well (soft-proofing enabled, which then correspond to workimg) or not
 
@@ -0,0 +1,207 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "defectmaps.h"
+#include "settings.h"
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace rtengine {
+
+extern const Settings *settings;
+
+DefectMapStore *DefectMapStore::getInstance()
+{
+    static DefectMapStore instance;
+    return &instance;
+}
+
+
+void DefectMapStore::init(const Glib::ustring &userSettingsDir)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    dir_ = Glib::build_filename(userSettingsDir, "defectmaps");
+    maps_.clear();
+}
+
+
+bool DefectMapStore::get(const Key &key, std::vector<badPix> &out)
+{
+    if (settings->defect_map_images <= 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dir_.empty()) {
+        return false;
+    }
+
+    const Map &map = lookup(key);
+    if (!map.complete) {
+        return false;
+    }
+
+    out.clear();
+    out.reserve(map.hits.size());
+    for (const auto &p : map.hits) {
+        out.emplace_back(p.first.second, p.first.first);
+    }
+    return true;
+}
+
+
+void DefectMapStore::learn(const Key &key, const Glib::ustring &fname, const std::vector<badPix> &detected)
+{
+    const int needed = settings->defect_map_images;
+    if (needed <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dir_.empty()) {
+        return;
+    }
+
+    Map &map = lookup(key);
+    if (map.complete || std::find(map.images.begin(), map.images.end(), fname) != map.images.end()) {
+        return;
+    }
+
+    map.images.push_back(fname);
+    for (const auto &p : detected) {
+        ++map.hits[std::make_pair(int(p.y), int(p.x))];
+    }
+
+    if (int(map.images.size()) >= needed) {
+        // keep only the pixels found in at least 3/4 of the images: the
+        // others are more likely details of the scenes (stars, specular
+        // highlights) than defects of the sensor
+        const int n = map.images.size();
+        for (auto it = map.hits.begin(); it != map.hits.end(); ) {
+            if (it->second * 4 < n * 3) {
+                it = map.hits.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        map.complete = true;
+        map.images.clear();
+
+        if (settings->verbose) {
+            printf("Defect map of %s %s %s complete: %d pixels\n", key.make.c_str(), key.model.c_str(), key.serial.c_str(), int(map.hits.size()));
+        }
+    }
+
+    save(fileName(key), map);
+}
+
+
+Glib::ustring DefectMapStore::fileName(const Key &key) const
+{
+    std::ostringstream buf;
+    buf << key.make << " " << key.model << " " << key.serial
+        << " " << key.width << "x" << key.height
+        << " t" << key.threshold << (key.hot ? "h" : "") << (key.dead ? "d" : "");
+    std::string name = buf.str();
+    for (auto &c : name) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.')) {
+            c = '_';
+        }
+    }
+    return Glib::build_filename(dir_, name + ".txt");
+}
+
+
+DefectMapStore::Map &DefectMapStore::lookup(const Key &key)
+{
+    const Glib::ustring fname = fileName(key);
+    auto it = maps_.find(fname);
+    if (it == maps_.end()) {
+        Map &map = maps_[fname];
+        map.complete = false;
+        if (load(fname, map) && settings->verbose) {
+            printf("Loaded defect map %s: %d pixels%s\n", fname.c_str(), int(map.hits.size()), map.complete ? "" : " (incomplete)");
+        }
+        return map;
+    }
+    return it->second;
+}
+
+
+bool DefectMapStore::load(const Glib::ustring &fname, Map &map) const
+{
+    FILE *f = g_fopen(fname.c_str(), "r");
+    if (!f) {
+        return false;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        int x, y, n;
+        if (strncmp(line, "image ", 6) == 0) {
+            map.images.emplace_back(line + 6);
+        } else if (sscanf(line, "complete %d", &n) == 1) {
+            map.complete = (n != 0);
+        } else if (sscanf(line, "%d %d %d", &x, &y, &n) == 3) {
+            map.hits[std::make_pair(y, x)] = n;
+        }
+    }
+
+    fclose(f);
+    return true;
+}
+
+
+bool DefectMapStore::save(const Glib::ustring &fname, const Map &map) const
+{
+    g_mkdir_with_parents(dir_.c_str(), 0755);
+
+    const Glib::ustring tmp_name = fname + ".tmp";
+    FILE *f = g_fopen(tmp_name.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+
+    fprintf(f, "# ART defect map: x y hits\n");
+    fprintf(f, "complete %d\n", int(map.complete));
+    for (const auto &name : map.images) {
+        fprintf(f, "image %s\n", name.c_str());
+    }
+    for (const auto &p : map.hits) {
+        fprintf(f, "%d %d %d\n", p.first.second, p.first.first, p.second);
+    }
+
+    bool ok = (fclose(f) == 0);
+    if (ok) {
+        ::g_remove(fname.c_str());
+        ok = ::g_rename(tmp_name.c_str(), fname.c_str()) == 0;
+    }
+    if (!ok) {
+        ::g_remove(tmp_name.c_str());
+    }
+    return ok;
+}
+
+} // namespace rtengine
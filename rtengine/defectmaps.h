@@ -0,0 +1,92 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glibmm/ustring.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pixelsmap.h"
+
+namespace rtengine {
+
+/*
+ * Defect maps learned by the hot/dead pixel filter.
+ *
+ * The stable defects of a sensor are found again in every image it takes,
+ * so there is no need to look for them in every file. For each camera
+ * (make, model and serial number) and set of filter parameters, the store
+ * counts in how many distinct images each pixel was detected. After the
+ * filter has run on settings->defect_map_images images, the pixels found
+ * in at least 3/4 of them become the defect map of the camera, which is
+ * then corrected like a .badpixels file, without running the filter.
+ *
+ * The maps are saved in the "defectmaps" subdirectory of the config dir,
+ * one file per camera and set of parameters, with one "x y hits" line
+ * per pixel.
+ */
+class DefectMapStore {
+public:
+    struct Key {
+        std::string make;
+        std::string model;
+        std::string serial;
+        int width;
+        int height;
+        int threshold;
+        bool hot;
+        bool dead;
+    };
+
+    static DefectMapStore *getInstance();
+
+    void init(const Glib::ustring &userSettingsDir);
+
+    // if the map of key is complete, stores its pixels (in row-major
+    // order) into out and returns true
+    bool get(const Key &key, std::vector<badPix> &out);
+
+    // records the pixels detected in the image fname. Images already seen
+    // for key are ignored, so that reprocessing the same file in the
+    // editor does not count as new evidence
+    void learn(const Key &key, const Glib::ustring &fname, const std::vector<badPix> &detected);
+
+private:
+    struct Map {
+        bool complete;
+        std::vector<Glib::ustring> images;
+        std::map<std::pair<int, int>, int> hits; // (y, x) -> number of images
+    };
+
+    DefectMapStore() = default;
+
+    Glib::ustring fileName(const Key &key) const;
+    Map &lookup(const Key &key);
+    bool load(const Glib::ustring &fname, Map &map) const;
+    bool save(const Glib::ustring &fname, const Map &map) const;
+
+    Glib::ustring dir_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Map> maps_;
+};
+
+} // namespace rtengine
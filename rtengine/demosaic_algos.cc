@@ -29,6 +29,7 @@
 #include "sleef.h"
 #include "opthelper.h"
 #include "median.h"
+#include "trace.h"
 //#define BENCHMARK
 #include "StopWatch.h"
 #ifdef _OPENMP
@@ -1688,6 +1689,7 @@ void RawImageSource::dcb_color_full(float (*image)[3], int x0, int y0, float (*c
 void RawImageSource::dcb_demosaic(int iterations, bool dcb_enhance)
 {
 BENCHFUN
+    TRACE_FUN("demosaic");
     double currentProgress = 0.0;
 
     if(plistener) {
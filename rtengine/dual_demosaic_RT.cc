@@ -33,6 +33,7 @@
 
 #define BENCHMARK
 #include "StopWatch.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -41,6 +42,7 @@ namespace rtengine {
 void RawImageSource::dual_demosaic_RT(bool isBayer, const procparams::RAWParams &raw, int winw, int winh, const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue, double &contrast, bool autoContrast)
 {
     BENCHFUN
+    TRACE_FUN("demosaic");
 
     if (contrast == 0.0 && !autoContrast) {
         // contrast == 0.0 means only first demosaicer will be used
@@ -72,8 +74,6 @@ void RawImageSource::dual_demosaic_RT(bool isBayer, const procparams::RAWParams
         return;
     }
 
-    array2D<float> L(winw, winh);
-
     if (isBayer) {
         switch (raw.bayersensor.method) {
         case procparams::RAWParams::BayerSensor::Method::AMAZEBILINEAR:
@@ -100,24 +100,30 @@ void RawImageSource::dual_demosaic_RT(bool isBayer, const procparams::RAWParams
         }
     }
 
-    const float xyz_rgb[3][3] = {          // XYZ from RGB
-                                { 0.412453, 0.357580, 0.180423 },
-                                { 0.212671, 0.715160, 0.072169 },
-                                { 0.019334, 0.119193, 0.950227 }
-                                };
-
-#ifdef _OPENMP
-    #pragma omp parallel for schedule(dynamic,16)
-#endif
-    for(int i = 0; i < winh; ++i) {
-        Color::RGB2L(red[i], green[i], blue[i], L[i], xyz_rgb, winw);
-    }
-
     // calculate contrast based blend factors to use flat demosaicer in regions with low contrast
     JaggedArray<float> blend(winw, winh);
     float contrastf = contrast / 100.0;
 
-    buildBlendMask(L, blend, winw, winh, contrastf, 1.f, autoContrast);
+    {
+        // the mask is smoothed with a gaussian blur of unbounded support,
+        // so it can't be built tile by tile. L is released right after it
+        array2D<float> L(winw, winh);
+
+        const float xyz_rgb[3][3] = {          // XYZ from RGB
+                                    { 0.412453, 0.357580, 0.180423 },
+                                    { 0.212671, 0.715160, 0.072169 },
+                                    { 0.019334, 0.119193, 0.950227 }
+                                    };
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(dynamic,16)
+#endif
+        for(int i = 0; i < winh; ++i) {
+            Color::RGB2L(red[i], green[i], blue[i], L[i], xyz_rgb, winw);
+        }
+
+        buildBlendMask(L, blend, winw, winh, contrastf, 1.f, autoContrast);
+    }
     contrast = contrastf * 100.f;
 
     if (isBayer) {
@@ -127,27 +133,10 @@ void RawImageSource::dual_demosaic_RT(bool isBayer, const procparams::RAWParams
         case procparams::RAWParams::BayerSensor::Method::DCBBILINEAR:
             bayer_bilinear_demosaic(blend, rawData, red, green, blue);
             break;
-        default: {
-            array2D<float>& redTmp = L; // L is not needed anymore => reuse it
-            array2D<float> greenTmp(winw, winh);
-            array2D<float> blueTmp(winw, winh);
-            vng4_demosaic(rawData, redTmp, greenTmp, blueTmp);
-#ifdef _OPENMP
-            #pragma omp parallel for schedule(dynamic,16)
-#endif
-            for(int i = 0; i < winh; ++i) {
-                // the following is split into 3 loops intentionally to avoid cache conflicts on CPUs with only 4-way cache
-                for(int j = 0; j < winw; ++j) {
-                    red[i][j] = intp(blend[i][j], red[i][j], redTmp[i][j]);
-                }
-                for(int j = 0; j < winw; ++j) {
-                    green[i][j] = intp(blend[i][j], green[i][j], greenTmp[i][j]);
-                }
-                for(int j = 0; j < winw; ++j) {
-                    blue[i][j] = intp(blend[i][j], blue[i][j], blueTmp[i][j]);
-                }
-            }
-        } break;
+        default:
+            // tiled, blends each tile in place as soon as it is interpolated
+            vng4_demosaic_blend(blend, rawData, red, green, blue);
+            break;
         }
     } else {
         fast_xtrans_interpolate_blend(blend, rawData, red, green, blue);
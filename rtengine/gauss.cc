@@ -23,6 +23,7 @@
 #include "opthelper.h"
 #include "boxblur.h"
 #include "alignedbuffer.h"
+#include "simdkernels.h"
 
 namespace {
 
@@ -125,6 +126,23 @@ template<class T> void calculateYvVFactors( const T sigma, T &b1, T &b2, T &b3,
 
 }
 
+#ifdef __SSE2__
+rtengine::simd::YvVCoeffs yvv_coeffs(double B, double b1, double b2, double b3, const double M[3][3])
+{
+    rtengine::simd::YvVCoeffs ret;
+    ret.B = B;
+    ret.b1 = b1;
+    ret.b2 = b2;
+    ret.b3 = b3;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            ret.M[i][j] = M[i][j];
+        }
+    }
+    return ret;
+}
+#endif
+
 // classical filtering if the support window is small and src != dst
 template<class T> void gauss3x3 (T** RESTRICT src, T** RESTRICT dst, const int W, const int H, const T c0, const T c1, const T c2, const T b0, const T b1)
 {
@@ -562,6 +580,9 @@ template<class T> void gaussHorizontalSse (T** src, T** dst, const int W, const
             M[i][j] /= (1.0 + b1 - b2 + b3) * (1.0 - b1 - b2 - b3);
         }
 
+    // rows processed with wider vectors, if available
+    const int start = rtengine::simd::gaussHorizontal(src, dst, W, H, yvv_coeffs(B, b1, b2, b3, M));
+
     vfloat Rv;
     vfloat Tv, Tm2v, Tm3v;
     vfloat Bv, b1v, b2v, b3v;
@@ -577,7 +598,7 @@ template<class T> void gaussHorizontalSse (T** src, T** dst, const int W, const
     #pragma omp for nowait
 #endif
 
-    for (int i = 0; i < H - 3; i += 4) {
+    for (int i = start; i < H - 3; i += 4) {
         Tv = _mm_set_ps(src[i][0], src[i + 1][0], src[i + 2][0], src[i + 3][0]);
         Tm3v = Tv * (Bv + b1v + b2v + b3v);
         STVF( tmp[0][0], Tm3v );
@@ -724,6 +745,9 @@ template<class T> void gaussVerticalSse (T** src, T** dst, const int W, const in
             M[i][j] /= (1.0 + b1 - b2 + b3) * (1.0 - b1 - b2 - b3);
         }
 
+    // columns processed with wider vectors, if available
+    const int start = rtengine::simd::gaussVertical(src, dst, nullptr, W, H, yvv_coeffs(B, b1, b2, b3, M), rtengine::simd::GaussMode::STANDARD);
+
     //float tmp[H][8] ALIGNED16;
     AlignedMatrix<float> tmp(H, 8);
     vfloat Rv;
@@ -743,7 +767,7 @@ template<class T> void gaussVerticalSse (T** src, T** dst, const int W, const in
 #endif
 
     // process 8 columns per iteration for better usage of cpu cache
-    for (int i = 0; i < W - 7; i += 8) {
+    for (int i = start; i < W - 7; i += 8) {
         Tv = LVFU( src[0][i]);
         Tv1 = LVFU( src[0][i + 4]);
         Rv = Tv * (Bv + b1v + b2v + b3v);
@@ -868,6 +892,9 @@ template<class T> void gaussVerticalSsemult (T** RESTRICT src, T** RESTRICT dst,
             M[i][j] /= (1.0 + b1 - b2 + b3) * (1.0 - b1 - b2 - b3);
         }
 
+    // columns processed with wider vectors, if available
+    const int start = rtengine::simd::gaussVertical(src, dst, nullptr, W, H, yvv_coeffs(B, b1, b2, b3, M), rtengine::simd::GaussMode::MULT);
+
     //float tmp[H][8] ALIGNED16;
     AlignedMatrix<float> tmp(H, 8);
     vfloat Rv;
@@ -887,7 +914,7 @@ template<class T> void gaussVerticalSsemult (T** RESTRICT src, T** RESTRICT dst,
 #endif
 
     // process 8 columns per iteration for better usage of cpu cache
-    for (int i = 0; i < W - 7; i += 8) {
+    for (int i = start; i < W - 7; i += 8) {
         Tv = LVFU( src[0][i]);
         Tv1 = LVFU( src[0][i + 4]);
         Rv = Tv * (Bv + b1v + b2v + b3v);
@@ -1010,6 +1037,9 @@ template<class T> void gaussVerticalSsediv (T** src, T** dst, T** divBuffer, con
             M[i][j] /= (1.0 + b1 - b2 + b3) * (1.0 - b1 - b2 - b3);
         }
 
+    // columns processed with wider vectors, if available
+    const int start = rtengine::simd::gaussVertical(src, dst, divBuffer, W, H, yvv_coeffs(B, b1, b2, b3, M), rtengine::simd::GaussMode::DIV);
+
     //float tmp[H][8] ALIGNED16;
     AlignedMatrix<float> tmp(H, 8);
     vfloat Rv;
@@ -1030,7 +1060,7 @@ template<class T> void gaussVerticalSsediv (T** src, T** dst, T** divBuffer, con
 #endif
 
     // process 8 columns per iteration for better usage of cpu cache
-    for (int i = 0; i < W - 7; i += 8) {
+    for (int i = start; i < W - 7; i += 8) {
         Tv = LVFU( src[0][i]);
         Tv1 = LVFU( src[0][i + 4]);
         Rv = Tv * (Bv + b1v + b2v + b3v);
@@ -33,6 +33,12 @@
 #include "sleef.h"
 #include "rescale.h"
 #include "imagefloat.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace rtengine {
 
@@ -53,9 +59,7 @@ namespace rtengine {
 #endif
 
 
-namespace {
-
-int calculate_subsampling(int w, int h, int r)
+int guidedFilterSubsampling(int w, int h, int r)
 {
     if (r == 1) {
         return 1;
@@ -74,158 +78,364 @@ int calculate_subsampling(int w, int h, int r)
     return LIM(r / 2, 2, 4);
 }
 
-} // namespace
+namespace {
 
+/*
+ * Computes the (box) means of the linear coefficients a and b of the guided
+ * filter for the rows [y0, y1) of the output, i.e.
+ *
+ *   a = cov(I, p) / (var(I) + epsilon)
+ *   b = mean(p) - a * mean(I)
+ *   meana = mean(a), meanb = mean(b)
+ *
+ * in a single sweep over the rows of I and p. Instead of blurring full-size
+ * images for each of the intermediate results, we keep running column sums
+ * of I, p, I*I and I*p over the window of the current row of a and b, and
+ * of a and b over the window of the current output row. Only the last
+ * 2*rad+2 rows of a and b are kept, so the scratch space is O(rad * W).
+ *
+ * Several images p can be filtered in the same sweep. The sums of I and I*I
+ * are kept once per distinct guide, and those of p and I*p are not kept at
+ * all for an image which is its own guide, as they are the same.
+ *
+ * The box means are the same as those of boxblur(), i.e. the windows shrink
+ * at the borders of the image. The column sums are in double precision, to
+ * avoid the accumulation of rounding errors in the running sums (which
+ * would otherwise show up in var(I) = mean(I*I) - mean(I)^2).
+ */
+class GuidedFilterBand {
+public:
+    // p[k] is filtered with the guide I[g[k]], or with itself if it is null
+    GuidedFilterBand(const std::vector<const array2D<float> *> &I, const std::vector<const array2D<float> *> &p, const std::vector<int> &g, int rad, float epsilon):
+        W_(I[0]->width()), H_(I[0]->height()),
+        rad_(rad), epsilon_(epsilon),
+        guides_(I.size()), chans_(p.size()),
+        rcx_(W_),
+        ring_size_(2 * rad + 2)
+    {
+        for (size_t i = 0; i < guides_.size(); ++i) {
+            auto &gd = guides_[i];
+            gd.I = I[i];
+            gd.sI.resize(W_);
+            gd.sII.resize(W_);
+            gd.mI.resize(W_);
+            gd.mII.resize(W_);
+            stats_in_.push_back(&gd.sI);
+            stats_in_.push_back(&gd.sII);
+            stats_out_.push_back(gd.mI.data());
+            stats_out_.push_back(gd.mII.data());
+        }
+        for (size_t k = 0; k < chans_.size(); ++k) {
+            auto &c = chans_[k];
+            c.g = g[k];
+            c.p = p[k];
+            if (c.p) {
+                c.sp.resize(W_);
+                c.sIp.resize(W_);
+                c.mp.resize(W_);
+                c.mIp.resize(W_);
+                stats_in_.push_back(&c.sp);
+                stats_in_.push_back(&c.sIp);
+                stats_out_.push_back(c.mp.data());
+                stats_out_.push_back(c.mIp.data());
+            }
+            c.sa.resize(W_);
+            c.sb.resize(W_);
+            c.ring_a.resize(W_ * ring_size_);
+            c.ring_b.resize(W_ * ring_size_);
+            ab_in_.push_back(&c.sa);
+            ab_in_.push_back(&c.sb);
+        }
+        ab_out_.resize(ab_in_.size());
+        prefix_.resize((W_ + 1) * std::max(stats_in_.size(), ab_in_.size()));
 
-void guidedFilter(const array2D<float> &guide, const array2D<float> &src, array2D<float> &dst, int r, float epsilon, bool multithread, int subsampling)
-{
+        for (int x = 0; x < W_; ++x) {
+            rcx_[x] = 1.0 / (min(W_ - 1, x + rad_) - max(0, x - rad_) + 1);
+        }
+    }
 
-    const int W = src.width();
-    const int H = src.height();
+    void operator()(const std::vector<array2D<float> *> &meana, const std::vector<array2D<float> *> &meanb, int y0, int y1)
+    {
+        // rows of a and b needed for the output rows [y0, y1)
+        const int j0 = max(0, y0 - rad_);
+        const int j1 = min(H_, y1 + rad_);
 
-    if (subsampling <= 0) {
-        subsampling = calculate_subsampling(W, H, r);
-    }
+        for (auto s : stats_in_) {
+            std::fill(s->begin(), s->end(), 0.0);
+        }
+        for (auto s : ab_in_) {
+            std::fill(s->begin(), s->end(), 0.0);
+        }
 
-    enum Op { MUL, DIVEPSILON, ADD, SUB, ADDMUL, SUBMUL };
+        for (int row = max(0, j0 - rad_), end = min(H_ - 1, j0 + rad_); row <= end; ++row) {
+            add_input_row(row);
+        }
 
-    const auto apply =
-        [=](Op op, array2D<float> &res, const array2D<float> &a, const array2D<float> &b, const array2D<float> &c=array2D<float>()) -> void
-        {
-            const int w = res.width();
-            const int h = res.height();
-            
-#ifdef _OPENMP
-            #pragma omp parallel for if (multithread)
-#endif
-            for (int y = 0; y < h; ++y) {
-                for (int x = 0; x < w; ++x) {
-                    float r;
-                    float aa = a[y][x];
-                    float bb = b[y][x];
-                    switch (op) {
-                    case MUL:
-                        r = aa * bb;
-                        break;
-                    case DIVEPSILON:
-                        r = aa / (bb + epsilon);
-                        break;
-                    case ADD:
-                        r = aa + bb;
-                        break;
-                    case SUB:
-                        r = aa - bb;
-                        break;
-                    case ADDMUL:
-                        r = aa * bb + c[y][x];
-                        break;
-                    case SUBMUL:
-                        r = c[y][x] - (aa * bb);
-                        break;
-                    default:
-                        assert(false);
-                        r = 0;
-                        break;
-                    }
-                    res[y][x] = r;
+        int next_out = y0;
+        int ab_first = j0; // first row of a and b still in the sa and sb sums
+
+        for (int j = j0; j < j1; ++j) {
+            if (j > j0) {
+                if (j + rad_ < H_) {
+                    add_input_row(j + rad_);
+                }
+                if (j - rad_ - 1 >= 0) {
+                    sub_input_row(j - rad_ - 1);
                 }
             }
-        };
 
-    // use the terminology of the paper (Algorithm 2)
-    const array2D<float> &I = guide;
-    const array2D<float> &p = src;
-    array2D<float> &q = dst;
+            compute_ab_row(j);
 
-    const auto f_subsample =
-        [=](array2D<float> &d, const array2D<float> &s) -> void
-        {
-            if (d.width() == s.width() && d.height() == s.height()) {
-#ifdef _OPENMP
-#               pragma omp parallel for if (multithread)
-#endif
-                for (int y = 0; y < s.height(); ++y) {
-                    for (int x = 0; x < s.width(); ++x) {
-                        d[y][x] = s[y][x];
-                    }
+            // emit all the output rows whose window is now complete
+            while (next_out < y1 && (next_out + rad_ <= j || j == H_ - 1)) {
+                for (; ab_first < next_out - rad_; ++ab_first) {
+                    sub_ab_row(ab_first);
                 }
-            } else {
-                rescaleBilinear(s, d, multithread);
+                const double rcy = 1.0 / (min(H_ - 1, next_out + rad_) - max(0, next_out - rad_) + 1);
+                for (size_t k = 0; k < chans_.size(); ++k) {
+                    ab_out_[2 * k] = (*meana[k])[next_out];
+                    ab_out_[2 * k + 1] = (*meanb[k])[next_out];
+                }
+                hmean(ab_in_, ab_out_, rcy);
+                ++next_out;
             }
-        };
+        }
+    }
 
-    // const auto f_upsample = f_subsample;
-    
-    const size_t w = W / subsampling;
-    const size_t h = H / subsampling;
+private:
+    struct Guide {
+        const array2D<float> *I;
+        std::vector<double> sI, sII;
+        std::vector<float> mI, mII;
+    };
+
+    struct Channel {
+        int g;
+        const array2D<float> *p;
+        std::vector<double> sp, sIp, sa, sb;
+        std::vector<float> mp, mIp;
+        std::vector<float> ring_a, ring_b;
+    };
+
+    void add_input_row(int row)
+    {
+        for (auto &gd : guides_) {
+            const float *I = (*gd.I)[row];
+            for (int x = 0; x < W_; ++x) {
+                const double i = I[x];
+                gd.sI[x] += i;
+                gd.sII[x] += i * i;
+            }
+        }
+        for (auto &c : chans_) {
+            if (c.p) {
+                const float *I = (*guides_[c.g].I)[row];
+                const float *p = (*c.p)[row];
+                for (int x = 0; x < W_; ++x) {
+                    const double i = I[x];
+                    c.sp[x] += p[x];
+                    c.sIp[x] += i * p[x];
+                }
+            }
+        }
+    }
 
-    const auto f_mean =
-        [multithread](array2D<float> &d, array2D<float> &s, int rad) -> void
-        {
-            rad = LIM(rad, 0, (min(s.width(), s.height()) - 1) / 2 - 1);
-            boxblur(s, d, rad, s.width(), s.height(), multithread);
-        };
+    void sub_input_row(int row)
+    {
+        for (auto &gd : guides_) {
+            const float *I = (*gd.I)[row];
+            for (int x = 0; x < W_; ++x) {
+                const double i = I[x];
+                gd.sI[x] -= i;
+                gd.sII[x] -= i * i;
+            }
+        }
+        for (auto &c : chans_) {
+            if (c.p) {
+                const float *I = (*guides_[c.g].I)[row];
+                const float *p = (*c.p)[row];
+                for (int x = 0; x < W_; ++x) {
+                    const double i = I[x];
+                    c.sp[x] -= p[x];
+                    c.sIp[x] -= i * p[x];
+                }
+            }
+        }
+    }
 
-    array2D<float> I1(w, h, ARRAY2D_ALIGNED);
-    array2D<float> p1(w, h, ARRAY2D_ALIGNED);
+    void sub_ab_row(int row)
+    {
+        const int off = (row % ring_size_) * W_;
+        for (auto &c : chans_) {
+            const float *a = &c.ring_a[off];
+            const float *b = &c.ring_b[off];
+            for (int x = 0; x < W_; ++x) {
+                c.sa[x] -= a[x];
+                c.sb[x] -= b[x];
+            }
+        }
+    }
 
-    f_subsample(I1, I);
-    f_subsample(p1, p);
+    // horizontal box means of N rows of column sums, with 1/rows scaling
+    // factor rcy. The prefix sums of the N rows are interleaved, so that
+    // they can be computed in parallel
+    void hmean(const std::vector<std::vector<double> *> &s, const std::vector<float *> &out, double rcy)
+    {
+        const size_t N = s.size();
+        double *P = prefix_.data();
+        for (size_t k = 0; k < N; ++k) {
+            P[k] = 0.0;
+        }
+        for (int x = 0; x < W_; ++x) {
+            for (size_t k = 0; k < N; ++k) {
+                P[(x + 1) * N + k] = P[x * N + k] + (*s[k])[x];
+            }
+        }
+        for (int x = 0; x < W_; ++x) {
+            const int x0 = max(0, x - rad_);
+            const int x1 = min(W_, x + rad_ + 1);
+            const double f = rcx_[x] * rcy;
+            for (size_t k = 0; k < N; ++k) {
+                out[k][x] = (P[x1 * N + k] - P[x0 * N + k]) * f;
+            }
+        }
+    }
 
-    DEBUG_DUMP(I);
-    DEBUG_DUMP(p);
-    DEBUG_DUMP(I1);
-    DEBUG_DUMP(p1);
+    void compute_ab_row(int j)
+    {
+        const double rcy = 1.0 / (min(H_ - 1, j + rad_) - max(0, j - rad_) + 1);
+        hmean(stats_in_, stats_out_, rcy);
+
+        const int off = (j % ring_size_) * W_;
+        for (auto &c : chans_) {
+            const float *mI = guides_[c.g].mI.data();
+            const float *mII = guides_[c.g].mII.data();
+            const float *mp = c.p ? c.mp.data() : mI;
+            const float *mIp = c.p ? c.mIp.data() : mII;
+            float *a = &c.ring_a[off];
+            float *b = &c.ring_b[off];
+            for (int x = 0; x < W_; ++x) {
+                const float varI = mII[x] - mI[x] * mI[x];
+                const float covIp = mIp[x] - mI[x] * mp[x];
+                a[x] = covIp / (varI + epsilon_);
+                b[x] = mp[x] - a[x] * mI[x];
+                c.sa[x] += a[x];
+                c.sb[x] += b[x];
+            }
+        }
+    }
 
-    float r1 = float(r) / subsampling;
+    const int W_;
+    const int H_;
+    const int rad_;
+    const float epsilon_;
 
-    array2D<float> meanI(w, h, ARRAY2D_ALIGNED);
-    f_mean(meanI, I1, r1);
-    DEBUG_DUMP(meanI);
+    std::vector<Guide> guides_;
+    std::vector<Channel> chans_;
+    std::vector<std::vector<double> *> stats_in_, ab_in_;
+    std::vector<float *> stats_out_, ab_out_;
+    std::vector<double> prefix_;
+    std::vector<double> rcx_;
+    const int ring_size_;
+};
 
-    array2D<float> meanp(w, h, ARRAY2D_ALIGNED);
-    f_mean(meanp, p1, r1);
-    DEBUG_DUMP(meanp);
+} // namespace
 
-    array2D<float> &corrIp = p1;
-    apply(MUL, corrIp, I1, p1);
-    f_mean(corrIp, corrIp, r1);
-    DEBUG_DUMP(corrIp);
 
-    array2D<float> &corrI = I1;
-    apply(MUL, corrI, I1, I1);
-    f_mean(corrI, corrI, r1);
-    DEBUG_DUMP(corrI);
+void guidedFilter(const std::vector<const array2D<float> *> &guide, const std::vector<const array2D<float> *> &src, const std::vector<array2D<float> *> &dst, int r, float epsilon, bool multithread, int subsampling)
+{
+    assert(guide.size() == src.size() && src.size() == dst.size());
 
-    array2D<float> &varI = corrI;
-    apply(SUBMUL, varI, meanI, meanI, corrI);
-    DEBUG_DUMP(varI);
+    const int n = src.size();
+    if (!n) {
+        return;
+    }
 
-    array2D<float> &covIp = corrIp;
-    apply(SUBMUL, covIp, meanI, meanp, corrIp);
-    DEBUG_DUMP(covIp);
+    const int W = src[0]->width();
+    const int H = src[0]->height();
 
-    array2D<float> &a = varI;
-    apply(DIVEPSILON, a, covIp, varI);
-    DEBUG_DUMP(a);
+    if (subsampling <= 0) {
+        subsampling = guidedFilterSubsampling(W, H, r);
+    }
 
-    array2D<float> &b = covIp;
-    apply(SUBMUL, b, a, meanI, meanp);
-    DEBUG_DUMP(b);
+    const int w = W / subsampling;
+    const int h = H / subsampling;
+    const bool rescale = (w != W || h != H);
+
+    // use the terminology of the paper (Algorithm 2): the distinct guides
+    // I, and for each image p the index of its guide. Images which are
+    // their own guide have no p1
+    std::vector<const array2D<float> *> I;
+    std::vector<int> gidx(n);
+    for (int k = 0; k < n; ++k) {
+        auto it = std::find(I.begin(), I.end(), guide[k]);
+        gidx[k] = it - I.begin();
+        if (it == I.end()) {
+            I.push_back(guide[k]);
+        }
+    }
 
-    array2D<float> &meana = a;
-    f_mean(meana, a, r1);
-    DEBUG_DUMP(meana);
+    // no copies are needed without subsampling
+    std::vector<array2D<float>> I1buf(rescale ? I.size() : 0);
+    std::vector<array2D<float>> p1buf(rescale ? n : 0);
+    std::vector<const array2D<float> *> I1(I);
+    std::vector<const array2D<float> *> p1(n);
+    for (size_t i = 0; i < I1buf.size(); ++i) {
+        I1buf[i](w, h, ARRAY2D_ALIGNED);
+        rescaleBilinear(*I[i], I1buf[i], multithread);
+        I1[i] = &I1buf[i];
+    }
+    for (int k = 0; k < n; ++k) {
+        if (src[k] != guide[k]) {
+            if (rescale) {
+                p1buf[k](w, h, ARRAY2D_ALIGNED);
+                rescaleBilinear(*src[k], p1buf[k], multithread);
+                p1[k] = &p1buf[k];
+            } else {
+                p1[k] = src[k];
+            }
+        }
+    }
+
+    const float r1 = float(r) / subsampling;
+    const int rad = LIM(int(r1), 0, (min(w, h) - 1) / 2 - 1);
+
+    std::vector<array2D<float>> meanabuf(n), meanbbuf(n);
+    std::vector<array2D<float> *> meana(n), meanb(n);
+    for (int k = 0; k < n; ++k) {
+        meanabuf[k](w, h, ARRAY2D_ALIGNED);
+        meanbbuf[k](w, h, ARRAY2D_ALIGNED);
+        meana[k] = &meanabuf[k];
+        meanb[k] = &meanbbuf[k];
+    }
+
+    // each band of rows is processed independently, at the cost of
+    // recomputing a and b for the 2*rad rows shared with the neighbours
+    int num_bands = 1;
+#ifdef _OPENMP
+    if (multithread) {
+        num_bands = LIM(h / 4, 1, omp_get_max_threads());
+    }
+#endif
+
+#ifdef _OPENMP
+#   pragma omp parallel for schedule(static, 1) if (multithread)
+#endif
+    for (int band = 0; band < num_bands; ++band) {
+        const int y0 = int64_t(h) * band / num_bands;
+        const int y1 = int64_t(h) * (band + 1) / num_bands;
+        GuidedFilterBand gf(I1, p1, gidx, rad, epsilon);
+        gf(meana, meanb, y0, y1);
+    }
 
-    array2D<float> &meanb = b;
-    f_mean(meanb, b, r1);
-    DEBUG_DUMP(meanb);
+    DEBUG_DUMP(meanabuf[0]);
+    DEBUG_DUMP(meanbbuf[0]);
 
     // speedup by heckflosse67
-    const int Ws = meana.width();
-    const int Hs = meana.height();
-    const int Wd = q.width();
-    const int Hd = q.height();
+    const int Ws = w;
+    const int Hs = h;
+    const int Wd = dst[0]->width();
+    const int Hd = dst[0]->height();
     const float col_scale = float(Ws) / float(Wd);
     const float row_scale = float(Hs) / float(Hd);
 
@@ -234,40 +444,76 @@ void guidedFilter(const array2D<float> &guide, const array2D<float> &src, array2
 #endif
     for (int y = 0; y < Hd; ++y) {
         float ymrs = y * row_scale; 
-        for (int x = 0; x < Wd; ++x) {
-            q[y][x] = getBilinearValue(meana, x * col_scale, ymrs) * I[y][x] + getBilinearValue(meanb, x * col_scale, ymrs);
+        for (int k = 0; k < n; ++k) {
+            const array2D<float> &Ik = *guide[k];
+            array2D<float> &q = *dst[k];
+            for (int x = 0; x < Wd; ++x) {
+                q[y][x] = getBilinearValue(*meana[k], x * col_scale, ymrs) * Ik[y][x] + getBilinearValue(*meanb[k], x * col_scale, ymrs);
+            }
         }
     }
 }
 
 
-void guidedFilterLog(const array2D<float> &guide, float base, array2D<float> &chan, int r, float eps, bool multithread, int subsampling)
+void guidedFilter(const array2D<float> &guide, const array2D<float> &src, array2D<float> &dst, int r, float epsilon, bool multithread, int subsampling)
+{
+    guidedFilter({&guide}, {&src}, {&dst}, r, epsilon, multithread, subsampling);
+}
+
+
+namespace {
+
+void guidedFilterLog(const std::vector<const array2D<float> *> &guide, float base, const std::vector<array2D<float> *> &chan, int r, float eps, bool multithread, int subsampling)
 {
 #ifdef _OPENMP
 #    pragma omp parallel for if (multithread)
 #endif
-    for (int y = 0; y < chan.height(); ++y) {
-        for (int x = 0; x < chan.width(); ++x) {
-            chan[y][x] = xlin2log(max(chan[y][x], 0.f), base);
+    for (int y = 0; y < chan[0]->height(); ++y) {
+        for (auto c : chan) {
+            for (int x = 0; x < c->width(); ++x) {
+                (*c)[y][x] = xlin2log(max((*c)[y][x], 0.f), base);
+            }
         }
     }
 
-    guidedFilter(guide, chan, chan, r, eps, multithread, subsampling);
+    guidedFilter(guide, std::vector<const array2D<float> *>(chan.begin(), chan.end()), chan, r, eps, multithread, subsampling);
 
 #ifdef _OPENMP
 #    pragma omp parallel for if (multithread)
 #endif
-    for (int y = 0; y < chan.height(); ++y) {
-        for (int x = 0; x < chan.width(); ++x) {
-            chan[y][x] = xlog2lin(max(chan[y][x], 0.f), base);
+    for (int y = 0; y < chan[0]->height(); ++y) {
+        for (auto c : chan) {
+            for (int x = 0; x < c->width(); ++x) {
+                (*c)[y][x] = xlog2lin(max((*c)[y][x], 0.f), base);
+            }
         }
     }
 }
 
+} // namespace
+
+
+void guidedFilterLog(const array2D<float> &guide, float base, const std::vector<array2D<float> *> &chan, int r, float eps, bool multithread, int subsampling)
+{
+    guidedFilterLog(std::vector<const array2D<float> *>(chan.size(), &guide), base, chan, r, eps, multithread, subsampling);
+}
+
+
+void guidedFilterLog(float base, const std::vector<array2D<float> *> &chan, int r, float eps, bool multithread, int subsampling)
+{
+    guidedFilterLog(std::vector<const array2D<float> *>(chan.begin(), chan.end()), base, chan, r, eps, multithread, subsampling);
+}
+
+
+void guidedFilterLog(const array2D<float> &guide, float base, array2D<float> &chan, int r, float eps, bool multithread, int subsampling)
+{
+    guidedFilterLog(guide, base, std::vector<array2D<float> *>{&chan}, r, eps, multithread, subsampling);
+}
+
 
 void guidedFilterLog(float base, array2D<float> &chan, int r, float eps, bool multithread, int subsampling)
 {
-    guidedFilterLog(chan, base, chan, r, eps, multithread, subsampling);
+    guidedFilterLog(base, std::vector<array2D<float> *>{&chan}, r, eps, multithread, subsampling);
 }
 
 } // namespace rtengine
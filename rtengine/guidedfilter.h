@@ -21,13 +21,30 @@
 #pragma once
 
 #include "array2D.h"
+#include <vector>
 
 namespace rtengine {
 
 void guidedFilter(const array2D<float> &guide, const array2D<float> &src, array2D<float> &dst, int r, float epsilon, bool multithread, int subsampling=0);
 
+// filters each src[i] with guide[i] into dst[i], all in a single pass over
+// the images. The guide statistics are computed once per distinct guide, so
+// filtering N images with the same guide (or each image with itself) is
+// cheaper than N separate calls. All the images must have the same size.
+// dst[i] can be the same as src[i] and guide[i], but not as any other guide
+void guidedFilter(const std::vector<const array2D<float> *> &guide, const std::vector<const array2D<float> *> &src, const std::vector<array2D<float> *> &dst, int r, float epsilon, bool multithread, int subsampling=0);
+
+// the subsampling used by guidedFilter when none is given, for an image of
+// size w x h
+int guidedFilterSubsampling(int w, int h, int r);
+
 void guidedFilterLog(float base, array2D<float> &chan, int r, float eps, bool multithread, int subsampling=0);
 
 void guidedFilterLog(const array2D<float> &guide, float base, array2D<float> &chan, int r, float eps, bool multithread, int subsampling=0);
 
+// batched versions of the above, see guidedFilter
+void guidedFilterLog(float base, const std::vector<array2D<float> *> &chan, int r, float eps, bool multithread, int subsampling=0);
+
+void guidedFilterLog(const array2D<float> &guide, float base, const std::vector<array2D<float> *> &chan, int r, float eps, bool multithread, int subsampling=0);
+
 } // namespace rtengine
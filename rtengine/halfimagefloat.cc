@@ -0,0 +1,139 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "halfimagefloat.h"
+#include "halffloat.h"
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace rtengine {
+
+namespace {
+
+constexpr float SCALE = 65535.f;
+constexpr float ISCALE = 1.f / 65535.f;
+
+void to_half(const float *src, uint16_t *dst, int W)
+{
+    int x = 0;
+#ifdef __F16C__
+    const __m128 s = _mm_set1_ps(ISCALE);
+    for (; x < W - 3; x += 4) {
+        __m128i h = _mm_cvtps_ph(_mm_mul_ps(_mm_loadu_ps(src + x), s), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), h);
+    }
+#endif
+    for (; x < W; ++x) {
+        dst[x] = DNG_FloatToHalf(src[x] * ISCALE);
+    }
+}
+
+
+void from_half(const uint16_t *src, float *dst, int W)
+{
+    int x = 0;
+#ifdef __F16C__
+    const __m128 s = _mm_set1_ps(SCALE);
+    for (; x < W - 3; x += 4) {
+        __m128 f = _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x)));
+        _mm_storeu_ps(dst + x, _mm_mul_ps(f, s));
+    }
+#endif
+    for (; x < W; ++x) {
+        dst[x] = DNG_HalfToFloat(src[x]) * SCALE;
+    }
+}
+
+} // namespace
+
+
+HalfImagefloat::HalfImagefloat():
+    width_(0),
+    height_(0)
+{
+}
+
+
+void HalfImagefloat::allocate(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    data_.resize(size_t(width) * size_t(height) * 3);
+}
+
+
+void HalfImagefloat::clear()
+{
+    width_ = height_ = 0;
+    std::vector<uint16_t>().swap(data_);
+}
+
+
+void HalfImagefloat::store(const Imagefloat *src, bool multithread)
+{
+    const int W = src->getWidth();
+    const int H = src->getHeight();
+    if (W != width_ || H != height_ || !isAllocated()) {
+        allocate(W, H);
+    }
+    src->copyState(&state_);
+
+    const size_t plane = size_t(W) * size_t(H);
+
+#ifdef _OPENMP
+#   pragma omp parallel for if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        uint16_t *row = &data_[size_t(y) * W];
+        to_half(src->r(y), row, W);
+        to_half(src->g(y), row + plane, W);
+        to_half(src->b(y), row + 2 * plane, W);
+    }
+}
+
+
+void HalfImagefloat::restore(Imagefloat *dst, bool multithread) const
+{
+    if (!isAllocated()) {
+        return;
+    }
+    
+    const int W = width_;
+    const int H = height_;
+    if (dst->getWidth() != W || dst->getHeight() != H) {
+        dst->allocate(W, H);
+    }
+    state_.copyState(dst);
+
+    const size_t plane = size_t(W) * size_t(H);
+
+#ifdef _OPENMP
+#   pragma omp parallel for if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        const uint16_t *row = &data_[size_t(y) * W];
+        from_half(row, dst->r(y), W);
+        from_half(row + plane, dst->g(y), W);
+        from_half(row + 2 * plane, dst->b(y), W);
+    }
+}
+
+} // namespace rtengine
@@ -0,0 +1,61 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "imagefloat.h"
+#include "noncopyable.h"
+#include <vector>
+#include <inttypes.h>
+
+namespace rtengine {
+
+/*
+ * Compact storage for an Imagefloat, using IEEE binary16 values. Used to keep
+ * intermediate results of the processing pipeline around at half the memory
+ * cost. Values are normalized to [0,1] before conversion, so that the whole
+ * Imagefloat range (including out-of-gamut and negative values) fits into
+ * the half-float range.
+ */
+class HalfImagefloat: public NonCopyable {
+public:
+    HalfImagefloat();
+
+    void allocate(int width, int height);
+    void clear();
+    bool isAllocated() const { return !data_.empty(); }
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    size_t getSize() const { return data_.size() * sizeof(uint16_t); }
+
+    // converts src to half floats; reallocates the buffer if needed
+    void store(const Imagefloat *src, bool multithread);
+    // converts back to float into dst (reallocated if needed); does nothing
+    // if no image has been stored yet
+    void restore(Imagefloat *dst, bool multithread) const;
+
+private:
+    int width_;
+    int height_;
+    std::vector<uint16_t> data_;
+    Imagefloat state_; // color space and mode of the stored image
+};
+
+} // namespace rtengine
@@ -846,7 +846,7 @@ void Imagefloat::rgb_to_lab(bool multithread)
 #   pragma omp parallel for if (multithread)
 #endif
     for (int y = 0; y < height; ++y) {
-        int x = 0;
+        int x = Color::RGB2LabWide(r(y), g(y), b(y), g(y), r(y), b(y), ws_, width, true);
 #ifdef __SSE2__
         vfloat Rv, Gv, Bv;
         vfloat Lv, av, bv;
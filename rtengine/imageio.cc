@@ -44,6 +44,7 @@
 #include "settings.h"
 
 #include "rtjpeg.h"
+#include "trace.h"
 
 using namespace std;
 using namespace rtengine;
@@ -904,6 +905,7 @@ int ImageIO::loadPPMFromMemory(const char* buffer, int width, int height, bool s
 
 int ImageIO::savePNG(const Glib::ustring &fname, int bps, bool uncompressed) const
 {
+    trace::Span span("ImageIO::savePNG", "encode");
     if (getWidth() < 1 || getHeight() < 1) {
         return IMIO_HEADERERROR;
     }
@@ -964,6 +966,7 @@ int ImageIO::savePNG(const Glib::ustring &fname, int bps, bool uncompressed) con
     if (bps > 16) {
         bps = 16;
     }
+    span.addBytes(size_t(width) * height * 3 * bps / 8);
 
     png_set_IHDR(png, info, width, height, bps, PNG_COLOR_TYPE_RGB,
                  PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_BASE);
@@ -1028,6 +1031,7 @@ int ImageIO::savePNG(const Glib::ustring &fname, int bps, bool uncompressed) con
 // Quality 0..100, subsampling: 1=low quality, 2=medium, 3=high
 int ImageIO::saveJPEG (const Glib::ustring &fname, int quality, int subSamp) const
 {
+    trace::Span span("ImageIO::saveJPEG", "encode");
     if (getWidth() < 1 || getHeight() < 1) {
         return IMIO_HEADERERROR;
     }
@@ -1082,6 +1086,7 @@ int ImageIO::saveJPEG (const Glib::ustring &fname, int quality, int subSamp) con
 
         cinfo.image_width  = width;
         cinfo.image_height = height;
+        span.addBytes(size_t(width) * height * 3);
         cinfo.in_color_space = JCS_RGB;
         cinfo.input_components = 3;
         jpeg_set_defaults (&cinfo);
@@ -1189,6 +1194,7 @@ int ImageIO::saveJPEG (const Glib::ustring &fname, int quality, int subSamp) con
 
 int ImageIO::saveTIFF (const Glib::ustring &fname, int bps, bool isFloat, bool uncompressed) const
 {
+    trace::Span span("ImageIO::saveTIFF", "encode");
     if (getWidth() < 1 || getHeight() < 1) {
         return IMIO_HEADERERROR;
     }
@@ -1203,6 +1209,7 @@ int ImageIO::saveTIFF (const Glib::ustring &fname, int bps, bool isFloat, bool u
 
     int lineWidth = width * 3 * bps / 8;
     unsigned char* linebuffer = new unsigned char[lineWidth];
+    span.addBytes(size_t(lineWidth) * height);
 
     // little hack to get libTiff to use proper byte order (see TIFFClienOpen()):
     const char *mode = "w";
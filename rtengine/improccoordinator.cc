@@ -54,6 +54,7 @@ ImProcCoordinator::ImProcCoordinator():
     orig_prev(nullptr),
     oprevi(nullptr),
     spotprev(nullptr),
+    half_cache_(false),
 
     drcomp_11_dcrop_cache(nullptr),
     previmg(nullptr),
@@ -498,13 +499,21 @@ void ImProcCoordinator::updatePreviewImage(int todo, bool panningRelatedChange)
         }
     
         progress("Exposure curve & CIELAB conversion...", 100 * readyphase / numofphases);
+
+        // with the half-float cache, the intermediate stages are computed
+        // in bufs_[2] and only their binary16 copies are kept
+        Imagefloat *buf0 = half_cache_ ? bufs_[2] : bufs_[0];
+        Imagefloat *buf1 = half_cache_ ? bufs_[2] : bufs_[1];
     
         if ((todo & M_RGBCURVE) || (todo & M_CROP)) {
             // if it's just crop we just need the histogram, no image updates
             if (todo & M_RGBCURVE) {
                 //initialize rrm bbm ggm different from zero to avoid black screen in some cases
-                oprevi->copyTo(bufs_[0]);
-                pipeline_stop_[1] = stop || ipf.process(ImProcFunctions::Pipeline::NAVIGATOR, ImProcFunctions::Stage::STAGE_1, bufs_[0]);
+                oprevi->copyTo(buf0);
+                pipeline_stop_[1] = stop || ipf.process(ImProcFunctions::Pipeline::NAVIGATOR, ImProcFunctions::Stage::STAGE_1, buf0, pcache_.get());
+                if (half_cache_) {
+                    hbufs_[0].store(buf0, true);
+                }
             }
     
             // compute L channel histogram
@@ -516,14 +525,25 @@ void ImProcCoordinator::updatePreviewImage(int todo, bool panningRelatedChange)
         readyphase++;
     
         if (todo & M_LUMACURVE) {
-            bufs_[0]->copyTo(bufs_[1]);
-            pipeline_stop_[2] = stop || ipf.process(ImProcFunctions::Pipeline::NAVIGATOR, ImProcFunctions::Stage::STAGE_2, bufs_[1]);
+            if (half_cache_) {
+                hbufs_[0].restore(buf1, true);
+            } else {
+                bufs_[0]->copyTo(bufs_[1]);
+            }
+            pipeline_stop_[2] = stop || ipf.process(ImProcFunctions::Pipeline::NAVIGATOR, ImProcFunctions::Stage::STAGE_2, buf1, pcache_.get());
+            if (half_cache_) {
+                hbufs_[1].store(buf1, true);
+            }
         }
         stop = stop || pipeline_stop_[2];
 
         if (todo & (M_LUMINANCE | M_COLOR)) {
-            bufs_[1]->copyTo(bufs_[2]);
-            pipeline_stop_[3] = stop || ipf.process(ImProcFunctions::Pipeline::NAVIGATOR, ImProcFunctions::Stage::STAGE_3, bufs_[2]);
+            if (half_cache_) {
+                hbufs_[1].restore(bufs_[2], true);
+            } else {
+                bufs_[1]->copyTo(bufs_[2]);
+            }
+            pipeline_stop_[3] = stop || ipf.process(ImProcFunctions::Pipeline::NAVIGATOR, ImProcFunctions::Stage::STAGE_3, bufs_[2], pcache_.get());
         }
         stop = stop || pipeline_stop_[3];
     
@@ -672,6 +692,10 @@ void ImProcCoordinator::freeAll()
                 bufs_[i-1] = nullptr;
             }
         }
+        for (auto &h : hbufs_) {
+            h.clear();
+        }
+        pcache_.reset();
 
         if (imageListener) {
             imageListener->delImage(previmg);
@@ -726,9 +750,11 @@ void ImProcCoordinator::setScale(int prevscale)
 
         orig_prev = new Imagefloat(pW, pH);
         oprevi = orig_prev;
-        for (int i = 0; i < 3; ++i) {
+        half_cache_ = settings->preview_half_float_cache;
+        for (int i = half_cache_ ? 2 : 0; i < 3; ++i) {
             bufs_[i] = new Imagefloat(pW, pH);
         }
+        pcache_.reset(new PipelineCache(half_cache_));
         previmg = new Image8(pW, pH);
         workimg = new Image8(pW, pH);
 
@@ -745,7 +771,9 @@ void ImProcCoordinator::setScale(int prevscale)
         oprevi->assignColorSpace(params.icm.workingProfile);
     }
     for (int i = 0; i < 3; ++i) {
-        bufs_[i]->assignColorSpace(params.icm.workingProfile);
+        if (bufs_[i]) {
+            bufs_[i]->assignColorSpace(params.icm.workingProfile);
+        }
     }
     
     if (!sizeListeners.empty())
@@ -26,6 +26,8 @@
 #include "imagesource.h"
 #include "procevents.h"
 #include "dcrop.h"
+#include "halfimagefloat.h"
+#include "pipelinecache.h"
 #include "LUT.h"
 #include "../rtgui/threadutils.h"
 
@@ -59,6 +61,9 @@ protected:
     Imagefloat *oprevi;
     Imagefloat *spotprev;
     Imagefloat *bufs_[3];
+    HalfImagefloat hbufs_[2]; // binary16 copies of bufs_[0,1] if half_cache_ is set
+    bool half_cache_;
+    std::unique_ptr<PipelineCache> pcache_;
     std::array<bool, 4> pipeline_stop_;
     
     Imagefloat *drcomp_11_dcrop_cache; // global cache for dynamicRangeCompression used in 1:1 detail windows (except when denoise is active)
@@ -42,6 +42,9 @@
 #include "../rtgui/ppversion.h"
 #include "../rtgui/guiutils.h"
 #include "refreshmap.h"
+#include "pipelinecache.h"
+#include "trace.h"
+#include <functional>
 
 namespace rtengine {
 
@@ -56,6 +59,7 @@ ImProcFunctions::ImProcFunctions(const ProcParams* iparams, bool imultiThread):
     scale(1),
     multiThread(imultiThread),
     cur_pipeline(Pipeline::OUTPUT),
+    cur_stage(Stage::STAGE_0),
     dcpProf(nullptr),
     dcpApplyState(nullptr),
     pipetteBuffer(nullptr),
@@ -70,7 +74,8 @@ ImProcFunctions::ImProcFunctions(const ProcParams* iparams, bool imultiThread):
     show_sharpening_mask(false),
     plistener(nullptr),
     progress_step(0),
-    progress_end(1)
+    progress_end(1),
+    mask_cache(nullptr)
 {
 }
 
@@ -539,6 +544,21 @@ namespace {
 
 constexpr int NUM_PIPELINE_STEPS = 23;
 
+
+inline size_t hash_combine(size_t seed, size_t v)
+{
+    return seed ^ (v + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+
+// hash of the parameters of the tools selected in pe
+size_t params_hash(const ProcParams &params, const ParamsEdited &pe)
+{
+    KeyFile kf;
+    params.save(nullptr, kf, &pe);
+    return std::hash<std::string>()(kf.to_data().raw());
+}
+
 } // namespace
 
 void ImProcFunctions::setProgressListener(ProgressListener *pl, int num_previews)
@@ -554,8 +574,9 @@ void ImProcFunctions::setProgressListener(ProgressListener *pl, int num_previews
 
 
 template <class Ret, class Method>
-Ret ImProcFunctions::apply(Method op, Imagefloat *img)
+Ret ImProcFunctions::apply(const char *name, Method op, Imagefloat *img)
 {
+    trace::Span span(name, "pipeline", int(cur_stage));
     if (plistener) {
         float percent = float(++progress_step) / float(progress_end);
         plistener->setProgress(percent);
@@ -564,13 +585,56 @@ Ret ImProcFunctions::apply(Method op, Imagefloat *img)
 }
 
 
-bool ImProcFunctions::process(Pipeline pipeline, Stage stage, Imagefloat *img)
+bool ImProcFunctions::process(Pipeline pipeline, Stage stage, Imagefloat *img, PipelineCache *cache)
 {
     bool stop = false;
     cur_pipeline = pipeline;
-
-#define STEP_(op) apply<void>(&ImProcFunctions::op, img)
-#define STEP_s_(op) apply<bool>(&ImProcFunctions::op, img)
+    cur_stage = stage;
+    mask_cache = cache ? &cache->masks() : nullptr;
+
+#define STEP_(op) apply<void>(#op, &ImProcFunctions::op, img)
+#define STEP_s_(op) apply<bool>(#op, &ImProcFunctions::op, img)
+
+    // checkpoint keys: the key of the stage input, combined with everything
+    // that the steps read besides their own parameters
+    size_t key = 0;
+    if (cache) {
+        ParamsEdited pe(false);
+        pe.icm = true;
+        key = hash_combine(cache->getInputKey(int(stage)), params_hash(*params, pe));
+        for (auto v : { int(pipeline), offset_x, offset_y, full_width, full_height, img->getWidth(), img->getHeight(), int(show_sharpening_mask) }) {
+            key = hash_combine(key, std::hash<int>()(v));
+        }
+        key = hash_combine(key, std::hash<double>()(scale));
+    }
+    // don't skip any step if some pipette or delta E picker needs its data
+    const bool can_restore = cache && deltaE.x < 0 && !(pipetteBuffer && pipetteBuffer->getEditID() != EUID_None);
+    const auto step_key =
+        [&](size_t k, const std::function<void(ParamsEdited &)> &sel) -> size_t
+        {
+            if (!cache) {
+                return 0;
+            }
+            ParamsEdited pe(false);
+            sel(pe);
+            return hash_combine(k, params_hash(*params, pe));
+        };
+    const auto restore =
+        [&](PipelineCache::Checkpoint cp, size_t k) -> bool
+        {
+            return can_restore && cache->restore(cp, k, img, multiThread);
+        };
+    const auto store =
+        [&](PipelineCache::Checkpoint cp, size_t k, bool needed) -> void
+        {
+            if (cache) {
+                if (needed && !stop) {
+                    cache->store(cp, k, img, multiThread);
+                } else {
+                    cache->drop(cp);
+                }
+            }
+        };
         
     switch (stage) {
     case Stage::STAGE_0:
@@ -585,22 +649,60 @@ bool ImProcFunctions::process(Pipeline pipeline, Stage stage, Imagefloat *img)
         if (params->icm.workingProfile == "ProPhoto") {
             proPhotoBlue(img, multiThread);
         }
+        if (cache) {
+            cache->invalidateOutput(int(stage));
+        }
         break;
-    case Stage::STAGE_2:
-        if (pipeline == Pipeline::OUTPUT ||
-            (pipeline == Pipeline::PREVIEW /*&& scale == 1*/)) {
-            stop = STEP_s_(sharpening);
-            if (!stop) {
-                STEP_(impulsedenoise);
-                STEP_(defringe);
+    case Stage::STAGE_2: {
+        const bool detail = pipeline == Pipeline::OUTPUT ||
+            (pipeline == Pipeline::PREVIEW /*&& scale == 1*/);
+        const size_t k_cc = step_key(key,
+            [detail](ParamsEdited &pe)
+            {
+                pe.sharpening = pe.impulseDenoise = pe.defringe = detail;
+                pe.colorcorrection = true;
+            });
+        const size_t k_end = step_key(k_cc, [](ParamsEdited &pe) { pe.smoothing = true; });
+        int resume = 0;
+        if (restore(PipelineCache::CP_STAGE_2_END, k_end)) {
+            resume = 2;
+        } else if (restore(PipelineCache::CP_COLORCORRECTION, k_cc)) {
+            resume = 1;
+        }
+        if (resume < 1) {
+            if (detail) {
+                stop = STEP_s_(sharpening);
+                if (!stop) {
+                    STEP_(impulsedenoise);
+                    STEP_(defringe);
+                }
             }
+            stop = stop || STEP_s_(colorCorrection);
+            store(PipelineCache::CP_COLORCORRECTION, k_cc, params->colorcorrection.enabled || (detail && params->sharpening.enabled));
+        }
+        if (resume < 2) {
+            stop = stop || STEP_s_(guidedSmoothing);
+            store(PipelineCache::CP_STAGE_2_END, k_end, params->smoothing.enabled);
+        }
+        if (cache) {
+            if (stop) {
+                cache->invalidateOutput(int(stage));
+            } else {
+                cache->setOutputKey(int(stage), k_end);
+            }
+        }
+    }   break;
+    case Stage::STAGE_3: {
+        const size_t k_tb = step_key(key,
+            [](ParamsEdited &pe)
+            {
+                pe.gradient = pe.pcvignette = pe.textureBoost = true;
+            });
+        if (!restore(PipelineCache::CP_TEXTUREBOOST, k_tb)) {
+            STEP_(creativeGradients);
+            stop = stop || STEP_s_(textureBoost);
+            store(PipelineCache::CP_TEXTUREBOOST, k_tb, params->textureBoost.enabled);
         }
-        stop = stop || STEP_s_(colorCorrection);
-        stop = stop || STEP_s_(guidedSmoothing);
-        break;
-    case Stage::STAGE_3:
-        STEP_(creativeGradients);
-        stop = stop || STEP_s_(textureBoost);
         if (!stop) { 
             STEP_(logEncoding);
             STEP_(saturationVibrance);
@@ -632,8 +734,9 @@ bool ImProcFunctions::process(Pipeline pipeline, Stage stage, Imagefloat *img)
             STEP_s_(prsharpening);
             scale = s;
         }
-        break;
+    }   break;
     }
+    mask_cache = nullptr;
     return stop;
 }
 
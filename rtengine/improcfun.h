@@ -39,6 +39,9 @@ namespace rtengine {
 
 using namespace procparams;
 
+class PipelineCache;
+class MaskCache;
+
 struct ImProcData {
     const ProcParams *params;
     double scale;
@@ -91,7 +94,7 @@ public:
         PREVIEW,
         OUTPUT
     };
-    bool process(Pipeline pipeline, Stage stage, Imagefloat *img);
+    bool process(Pipeline pipeline, Stage stage, Imagefloat *img, PipelineCache *cache=nullptr);
 
     void setViewport(int ox, int oy, int fw, int fh);
     void setOutputHistograms(LUTu *histToneCurve, LUTu *histCCurve, LUTu *histLCurve);
@@ -110,6 +113,12 @@ public:
     void transform(Imagefloat* original, Imagefloat* transformed, int cx, int cy, int sx, int sy, int oW, int oH, int fW, int fH, const FramesMetaData *metadata, int rawRotationDeg, bool highQuality);    
     void resize(Imagefloat* src, Imagefloat* dst, float dScale);
     void Lanczos(Imagefloat *src, Imagefloat *dst, float scale);
+
+    // resample src to the size of dst, in the current mode of src
+    void resample(Imagefloat *src, Imagefloat *dst, ResampleKernel kernel);
+    // resample src to all the sizes of dst at once (dst[i] with kernels[i]),
+    // cascading each output from a larger one when possible
+    void resampleLadder(Imagefloat *src, const std::vector<Imagefloat *> &dst, const std::vector<ResampleKernel> &kernels);
     void impulsedenoise(Imagefloat *rgb);   //Emil's impulse denoise
     bool textureBoost(Imagefloat *rgb);
 
@@ -215,6 +224,7 @@ private:
     double scale;
     bool multiThread;
     Pipeline cur_pipeline;
+    Stage cur_stage;
 
     DCPProfile *dcpProf;
     const DCPProfile::ApplyState *dcpApplyState;
@@ -238,6 +248,8 @@ private:
     int progress_step;
     int progress_end;
 
+    MaskCache *mask_cache; // of the pipeline being processed, if any
+
     
 private:
     void transformLuminanceOnly(Imagefloat* original, Imagefloat* transformed, int cx, int cy, int oW, int oH, int fW, int fH, bool creative);
@@ -256,7 +268,7 @@ private:
     bool needsLensfun();
 
     template <class Ret, class Method>
-    Ret apply(Method op, Imagefloat *img);
+    Ret apply(const char *name, Method op, Imagefloat *img);
 };
 
 
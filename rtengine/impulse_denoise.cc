@@ -25,6 +25,7 @@
 #include "opthelper.h"
 #include "gauss.h"
 #include "rt_algo.h"
+#include "medianfilter.h"
 
 using namespace std;
 
@@ -32,7 +33,7 @@ namespace rtengine {
 
 namespace {
 
-void impulse_nr(Imagefloat *lab, double thresh, bool multithread)
+void impulse_nr(Imagefloat *lab, double thresh, int median_radius, bool multithread)
 {
     // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
     // impulse noise removal
@@ -58,6 +59,31 @@ void impulse_nr(Imagefloat *lab, double thresh, bool multithread)
 
     markImpulse(width, height, lab_L, impish, thresh);
 
+    if (median_radius > 0) {
+        // replace the impulses with the median of their neighbourhood
+        array2D<float> med(width, height);
+        float **channels[3] = { lab_L, lab_a, lab_b };
+
+        for (auto c : channels) {
+            const array2D<float> src(width, height, c, ARRAY2D_BYREFERENCE);
+            medianFilter(src, med, median_radius, multithread);
+
+#ifdef _OPENMP
+#           pragma omp parallel for if (multithread)
+#endif
+            for (int i = 0; i < height; ++i) {
+                for (int j = 0; j < width; ++j) {
+                    if (impish[i][j]) {
+                        c[i][j] = med[i][j];
+                    }
+                }
+            }
+        }
+
+        delete [] impish[0];
+        return;
+    }
+
 //     //The cleaning algorithm starts here
 
 //     //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -186,7 +212,8 @@ void ImProcFunctions::impulsedenoise(Imagefloat *rgb)
     {
         float t = params->impulseDenoise.thresh / scale;
         rgb->setMode(Imagefloat::Mode::LAB, multiThread);
-        impulse_nr(rgb, t / 20.0, multiThread);
+        const int r = params->impulseDenoise.medianRadius;
+        impulse_nr(rgb, t / 20.0, r > 0 ? max(int(r / scale + 0.5), 1) : 0, multiThread);
     }
 }
 
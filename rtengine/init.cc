@@ -16,6 +16,7 @@
  *  You should have received a copy of the GNU General Public License
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cstdio>
 #include <fftw3.h>
 #include "../rtgui/profilestorecombobox.h"
 #include "rtengine.h"
@@ -27,6 +28,7 @@
 #include "improcfun.h"
 #include "improccoordinator.h"
 #include "dfmanager.h"
+#include "defectmaps.h"
 #include "ffmanager.h"
 #include "rtthumbnail.h"
 #include "profilestore.h"
@@ -35,6 +37,8 @@
 #include "metadata.h"
 #include "imgiomanager.h"
 #include "threadpool.h"
+#include "trace.h"
+#include "simdkernels.h"
 
 #ifdef _OPENMP
 # include <omp.h>
@@ -54,6 +58,7 @@ MyMutex *librawMutex = nullptr;
 int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDir, bool loadAll)
 {
     settings = s;
+    trace::start(s->trace_file, s->trace_buffer_size);
     ProcParams::init();
     PerceptualToneCurve::init();
     RawImageSource::init();
@@ -67,6 +72,10 @@ int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDi
     }
     ThreadPool::init(num_threads);
 
+    if (settings->verbose) {
+        printf("Using %s vector kernels\n", simd::levelName(simd::level()));
+    }
+
 #ifdef _OPENMP
 #pragma omp parallel sections if (!settings->verbose)
 #endif
@@ -121,6 +130,12 @@ int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDi
 {
     ffm.init(s->flatFieldsPath);
 }
+#ifdef _OPENMP
+#pragma omp section
+#endif
+{
+    DefectMapStore::getInstance()->init(userSettingsDir);
+}
 }
 
     Color::init ();
@@ -141,6 +156,8 @@ int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDi
 
 void cleanup ()
 {
+    trace::finish();
+    InitialImage::clearCache();
     Exiv2Metadata::cleanup();
     ProcParams::cleanup ();
     Color::cleanup ();
@@ -182,6 +199,10 @@ Settings::Settings():
     metadata_xmp_sync(MetadataXmpSync::NONE),
     thread_pool_size(0),
     ctl_scripts_fast_preview(false),
+    preview_half_float_cache(false),
+    trace_buffer_size(1 << 20),
+    decoded_raw_cache_size(0),
+    defect_map_images(0),
     os_monitor_profile(StdMonitorProfile::SRGB)
 {
 }
@@ -233,7 +233,7 @@ bool ImProcFunctions::colorCorrection(Imagefloat *rgb)
     std::vector<array2D<float>> abmask(n);
     std::vector<array2D<float>> Lmask(n);
 
-    if (!generateMasks(rgb, params->colorcorrection.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, &Lmask, &abmask, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr)) {
+    if (!generateMasks(rgb, params->colorcorrection.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, &Lmask, &abmask, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr, mask_cache)) {
         return true; // show mask is active, nothing more to do
     }
     
@@ -739,6 +739,32 @@ bool ImProcFunctions::colorCorrection(Imagefloat *rgb)
         };
 #endif // __SSE2__
 
+    // the pixels outside of the box of each mask are left untouched, so
+    // each region is processed only within it
+    int rx0[n];
+    int ry0[n];
+    int rx1[n];
+    int ry1[n];
+    for (int i = 0; i < n; ++i) {
+        int lx0, ly0, lx1, ly1;
+        const bool has_ab = getMaskRegion(abmask[i], rx0[i], ry0[i], rx1[i], ry1[i], multiThread);
+        if (getMaskRegion(Lmask[i], lx0, ly0, lx1, ly1, multiThread)) {
+            if (has_ab) {
+                rx0[i] = min(rx0[i], lx0);
+                ry0[i] = min(ry0[i], ly0);
+                rx1[i] = max(rx1[i], lx1);
+                ry1[i] = max(ry1[i], ly1);
+            } else {
+                rx0[i] = lx0;
+                ry0[i] = ly0;
+                rx1[i] = lx1;
+                ry1[i] = ly1;
+            }
+        }
+        // keep the vectorized loop below aligned
+        rx0[i] &= ~3;
+    }
+
     rgb->setMode(Imagefloat::Mode::YUV, multiThread);
 
 #ifdef _OPENMP
@@ -754,22 +780,24 @@ bool ImProcFunctions::colorCorrection(Imagefloat *rgb)
 #endif
         for (int y = 0; y < H; ++y) {
             for (int i = 0; i < n; ++i) {
-                if (!params->colorcorrection.labmasks[i].enabled) {
+                if (!params->colorcorrection.labmasks[i].enabled || y < ry0[i] || y >= ry1[i]) {
                     continue;
                 }
+                const int x0 = rx0[i];
+                const int x1 = rx1[i];
                 if (lut[i]) {
-                    for (int x = 0; x < W; ++x) {
-                        Color::yuv2rgb(rgb->g(y, x), rgb->b(y, x), rgb->r(y, x), rbuf.data[x], gbuf.data[x], bbuf.data[x], ws);
+                    for (int x = x0; x < x1; ++x) {
+                        Color::yuv2rgb(rgb->g(y, x), rgb->b(y, x), rgb->r(y, x), rbuf.data[x - x0], gbuf.data[x - x0], bbuf.data[x - x0], ws);
                     }
 #ifdef _OPENMP
                     int thread_id = omp_get_thread_num();
 #else
                     int thread_id = 0;
 #endif
-                    lut[i]->apply(thread_id, W, rbuf.data, gbuf.data, bbuf.data);
-                    for (int x = 0; x < W; ++x) {
+                    lut[i]->apply(thread_id, x1 - x0, rbuf.data, gbuf.data, bbuf.data);
+                    for (int x = x0; x < x1; ++x) {
                         float Y, u, v;
-                        Color::rgb2yuv(rbuf.data[x], gbuf.data[x], bbuf.data[x], Y, u, v, ws);
+                        Color::rgb2yuv(rbuf.data[x - x0], gbuf.data[x - x0], bbuf.data[x - x0], Y, u, v, ws);
                         float blend = abmask[i][y][x];
                         float lblend = Lmask[i][y][x];
                         rgb->g(y, x) = intp(lblend, Y, rgb->g(y, x));
@@ -777,9 +805,9 @@ bool ImProcFunctions::colorCorrection(Imagefloat *rgb)
                         rgb->r(y, x) = intp(blend, v, rgb->r(y, x));
                     }
                 } else {
-                    int x = 0;
+                    int x = x0;
 #ifdef __SSE2__
-                    for (; x < W - 3; x += 4) {
+                    for (; x < x1 - 3; x += 4) {
                         vfloat Yv = LVF(rgb->g(y, x));
                         vfloat uv = LVF(rgb->b(y, x));
                         vfloat vv = LVF(rgb->r(y, x));
@@ -805,7 +833,7 @@ bool ImProcFunctions::colorCorrection(Imagefloat *rgb)
                         STVF(rgb->r(y, x), vv);
                     }
 #endif // __SSE2__
-                    for (; x < W; ++x) {
+                    for (; x < x1; ++x) {
                         float Y = rgb->g(y, x);
                         float u = rgb->b(y, x);
                         float v = rgb->r(y, x);
@@ -236,13 +236,9 @@ void extract_channels(Imagefloat *img, array2D<float> &r, array2D<float> &g, arr
     const int H = img->getHeight();
 
     array2D<float> imgR(W, H, img->r.ptrs, ARRAY2D_BYREFERENCE);
-    rtengine::guidedFilter(imgR, imgR, r, radius, epsilon, multithread);
-
     array2D<float> imgG(W, H, img->g.ptrs, ARRAY2D_BYREFERENCE);
-    rtengine::guidedFilter(imgG, imgG, g, radius, epsilon, multithread);
-
     array2D<float> imgB(W, H, img->b.ptrs, ARRAY2D_BYREFERENCE);
-    rtengine::guidedFilter(imgB, imgB, b, radius, epsilon, multithread);
+    rtengine::guidedFilter({&imgR, &imgG, &imgB}, {&imgR, &imgG, &imgB}, {&r, &g, &b}, radius, epsilon, multithread);
 }
 
 
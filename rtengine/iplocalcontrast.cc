@@ -248,7 +248,7 @@ void evaluate_params(wavelet_decomposition &wd, float *mean, float *meanN, float
 }
 
 
-void local_contrast_wavelets(array2D<float> &Y, const LocalContrastParams::Region &params, double scale, bool multiThread)
+void local_contrast_wavelets(array2D<float> &Y, const LocalContrastParams::Region &params, double scale, wavelet_buffers &pool, bool multiThread)
 {
     const int W = Y.width();
     const int H = Y.height();
@@ -259,7 +259,12 @@ void local_contrast_wavelets(array2D<float> &Y, const LocalContrastParams::Regio
         --wavelet_level;
     }
     int skip = scale;
-    wavelet_decomposition wd(static_cast<float *>(Y), W, H, wavelet_level, 1, skip);
+#ifdef _OPENMP
+    const int num_threads = multiThread ? omp_get_max_threads() : 1;
+#else
+    const int num_threads = 1;
+#endif
+    wavelet_decomposition wd(static_cast<float *>(Y), W, H, wavelet_level, 1, skip, num_threads, 6, &pool);
 
     // if (wd.memoryAllocationFailed) {
     //     return;
@@ -451,7 +456,7 @@ bool ImProcFunctions::localContrast(Imagefloat *rgb)
             show_mask_idx = -1;
         }
         std::vector<array2D<float>> mask(n);
-        if (!generateMasks(rgb, params->localContrast.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, &mask, nullptr, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr)) {
+        if (!generateMasks(rgb, params->localContrast.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, &mask, nullptr, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr, mask_cache)) {
             return true; // show mask is active, nothing more to do
         }
 
@@ -459,15 +464,24 @@ bool ImProcFunctions::localContrast(Imagefloat *rgb)
         const int H = rgb->getHeight();
         
         array2D<float> L(W, H, rgb->g.ptrs);
+        wavelet_buffers pool; // shared by the decompositions of all the regions
 
         for (int i = 0; i < n; ++i) {
             if (!params->localContrast.labmasks[i].enabled) {
                 continue;
             }
             
-            auto &r = params->localContrast.regions[i];
-            local_contrast_wavelets(L, r, scale, multiThread);
+            // the wavelet decomposition needs the whole frame (restricting
+            // it to the mask's box would change the result inside), but a
+            // region whose mask is empty can be skipped entirely
             const auto &blend = mask[i];
+            int min_x, min_y, max_x, max_y;
+            if (!getMaskRegion(blend, min_x, min_y, max_x, max_y, multiThread)) {
+                continue;
+            }
+            
+            auto &r = params->localContrast.regions[i];
+            local_contrast_wavelets(L, r, scale, pool, multiThread);
 #ifdef _OPENMP
 #           pragma omp parallel for if (multiThread)
 #endif
@@ -23,6 +23,10 @@
 #include "opthelper.h"
 #include "rt_math.h"
 #include "sleef.h"
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
 
 //#define PROFILE
 
@@ -47,179 +51,260 @@ inline float Lanc(float x, float a)
     }
 }
 
-} // namespace
+
+// Mitchell-Netravali cubic with B = C = 1/3
+inline float Mitchell(float x)
+{
+    constexpr float B = 1.f / 3.f;
+    constexpr float C = 1.f / 3.f;
+    x = std::abs(x);
+    if (x < 1.f) {
+        return ((12.f - 9.f * B - 6.f * C) * x * x * x + (-18.f + 12.f * B + 6.f * C) * x * x + (6.f - 2.f * B)) / 6.f;
+    } else if (x < 2.f) {
+        return ((-B - 6.f * C) * x * x * x + (6.f * B + 30.f * C) * x * x + (-12.f * B - 48.f * C) * x + (8.f * B + 24.f * C)) / 6.f;
+    } else {
+        return 0.f;
+    }
+}
 
 
-void ImProcFunctions::Lanczos(Imagefloat *src, Imagefloat *dst, float scale)
+inline float kernel_radius(ResampleKernel kernel)
 {
-    auto mode = src->mode();
-    src->setMode(Imagefloat::Mode::LAB, multiThread);
-    dst->assignMode(Imagefloat::Mode::LAB);
+    switch (kernel) {
+    case ResampleKernel::MITCHELL:
+        return 2.f;
+    case ResampleKernel::BOX:
+        return 0.5f;
+    default:
+        return 3.f;
+    }
+}
+
+
+inline float kernel_eval(ResampleKernel kernel, float x)
+{
+    switch (kernel) {
+    case ResampleKernel::MITCHELL:
+        return Mitchell(x);
+    case ResampleKernel::BOX:
+        return (x >= -0.5f && x < 0.5f) ? 1.f : 0.f;
+    default:
+        return Lanc(x, 3.f);
+    }
+}
+
+
+/*
+ * Precomputed weights for resampling along one direction. Every destination
+ * sample uses exactly "support" consecutive source samples starting at
+ * start[j], so that the inner loops have a fixed trip count; taps outside of
+ * the kernel footprint have a zero weight. Weights are stored transposed
+ * (w[k * stride + j]), so that the k-th tap of 4 consecutive destination
+ * samples can be loaded with a single vector load.
+ */
+class ResampleWeights {
+public:
+    ResampleWeights(ResampleKernel kernel, int src_size, int dst_size, float scale)
+    {
+        const float delta = 1.f / scale;
+        const float sc = min(scale, 1.f);
+        const float a = kernel_radius(kernel) / sc;
+
+        support = min(static_cast<int>(2.f * a) + 1, src_size);
+        stride = (dst_size + 3) & ~3;
+        start.resize(stride);
+        w.resize(size_t(support) * stride);
+
+        for (int j = 0; j < dst_size; ++j) {
+            // coord of the center of the pixel on the src image
+            const float x0 = (static_cast<float>(j) + 0.5f) * delta - 0.5f;
+            const int j0 = max(0, static_cast<int>(floorf(x0 - a)) + 1);
+            const int j1 = min(src_size, static_cast<int>(floorf(x0 + a)) + 1);
+            const int s = max(min(j0, src_size - support), 0);
+            start[j] = s;
+
+            float ws = 0.f;
+            for (int jj = j0; jj < j1 && jj - s < support; ++jj) {
+                const float v = kernel_eval(kernel, sc * (x0 - static_cast<float>(jj)));
+                w[size_t(jj - s) * stride + j] = v;
+                ws += v;
+            }
+            if (ws == 0.f) {
+                // degenerate footprint (box kernel falling between samples)
+                const int jj = LIM(static_cast<int>(x0 + 0.5f), s, s + support - 1);
+                w[size_t(jj - s) * stride + j] = 1.f;
+            } else {
+                for (int k = 0; k < support; ++k) {
+                    w[size_t(k) * stride + j] /= ws;
+                }
+            }
+        }
 
+        // pad the tail so that vector loads never read garbage
+        for (int j = dst_size; j < stride; ++j) {
+            start[j] = dst_size > 0 ? start[dst_size - 1] : 0;
+        }
+    }
+
+    int support;
+    int stride;
+    std::vector<int> start;
+    std::vector<float> w;
+};
+
+
+void resample_impl(Imagefloat *src, Imagefloat *dst, ResampleKernel kernel, float xscale, float yscale, bool multithread)
+{
     const int sW = src->getWidth();
     const int sH = src->getHeight();
     const int dW = dst->getWidth();
     const int dH = dst->getHeight();
-    
-    const float delta = 1.0f / scale;
-    const float a = 3.0f;
-    const float sc = min (scale, 1.0f);
-    const int support = static_cast<int> (2.0f * a / sc) + 1;
-
-    // storage for precomputed parameters for horizontal interpolation
-    float* const wwh = new float[support * dW];
-    int* const jj0 = new int[dW];
-    int* const jj1 = new int[dW];
-
-    const auto sL = src->g.ptrs;
-    const auto sa = src->r.ptrs;
-    const auto sb = src->b.ptrs;
-
-    auto dL = dst->g.ptrs;
-    auto da = dst->r.ptrs;
-    auto db = dst->b.ptrs;
-
-    // Phase 1: precompute coefficients for horizontal interpolation
-    for (int j = 0; j < dW; j++) {
-
-        // x coord of the center of pixel on src image
-        float x0 = (static_cast<float> (j) + 0.5f) * delta - 0.5f;
-
-        // weights for interpolation in horizontal direction
-        float * w = wwh + j * support;
-
-        // sum of weights used for normalization
-        float ws = 0.0f;
-
-        jj0[j] = max (0, static_cast<int> (floorf (x0 - a / sc)) + 1);
-        jj1[j] = min (sW, static_cast<int> (floorf (x0 + a / sc)) + 1);
-
-        // calculate weights
-        for (int jj = jj0[j]; jj < jj1[j]; jj++) {
-            int k = jj - jj0[j];
-            float z = sc * (x0 - static_cast<float> (jj));
-            w[k] = Lanc (z, a);
-            ws += w[k];
-        }
 
-        // normalize weights
-        for (int k = 0; k < support; k++) {
-            w[k] /= ws;
-        }
-    }
+    const ResampleWeights hw(kernel, sW, dW, xscale);
+    const ResampleWeights vw(kernel, sH, dH, yscale);
+
+    float **const sch[3] = { src->r.ptrs, src->g.ptrs, src->b.ptrs };
+    float **const dch[3] = { dst->r.ptrs, dst->g.ptrs, dst->b.ptrs };
 
 #ifdef _OPENMP
-    #pragma omp parallel
+#   pragma omp parallel if (multithread)
 #endif
     {
-        // temporal storage for vertically-interpolated row of pixels
-        AlignedBuffer<float> aligned_buffer_ll(sW);
-        AlignedBuffer<float> aligned_buffer_la(sW);
-        AlignedBuffer<float> aligned_buffer_lb(sW);
-        float* const lL = aligned_buffer_ll.data;
-        float* const la = aligned_buffer_la.data;
-        float* const lb = aligned_buffer_lb.data;
-        // weights for interpolation in y direction
-        float w[support] ALIGNED64;
-        memset(w, 0, sizeof(w));
-
-        // Phase 2: do actual interpolation
+        // temporary storage for the vertically-interpolated row of pixels
+        AlignedBuffer<float> buf(sW);
+        float *const line = buf.data;
+
 #ifdef _OPENMP
-        #pragma omp for
+#       pragma omp for
 #endif
+        for (int i = 0; i < dH; ++i) {
+            const int i0 = vw.start[i];
 
-        for (int i = 0; i < dH; i++) {
-            // y coord of the center of pixel on src image
-            float y0 = (static_cast<float> (i) + 0.5f) * delta - 0.5f;
+            for (int c = 0; c < 3; ++c) {
+                float **const s = sch[c];
+                float *const d = dch[c][i];
 
-            // sum of weights used for normalization
-            float ws = 0.0f;
-
-            int ii0 = max (0, static_cast<int> (floorf (y0 - a / sc)) + 1);
-            int ii1 = min (sH, static_cast<int> (floorf (y0 + a / sc)) + 1);
-
-            // calculate weights for vertical interpolation
-            for (int ii = ii0; ii < ii1; ii++) {
-                int k = ii - ii0;
-                float z = sc * (y0 - static_cast<float> (ii));
-                w[k] = Lanc (z, a);
-                ws += w[k];
-            }
-
-            // normalize weights
-            for (int k = 0; k < support; k++) {
-                w[k] /= ws;
-            }
-
-            // Do vertical interpolation. Store results.
+                // vertical pass, over the whole source row
+                int j = 0;
 #ifdef __SSE2__
-            int j;
-            __m128 Lv, av, bv, wkv;
-
-            for (j = 0; j < sW - 3; j += 4) {
-                Lv = _mm_setzero_ps();
-                av = _mm_setzero_ps();
-                bv = _mm_setzero_ps();
-
-                for (int ii = ii0; ii < ii1; ii++) {
-                    int k = ii - ii0;
-                    wkv = _mm_set1_ps (w[k]);
-                    Lv += wkv * LVFU (sL[ii][j]);
-                    av += wkv * LVFU (sa[ii][j]);
-                    bv += wkv * LVFU (sb[ii][j]);
+                for (; j < sW - 3; j += 4) {
+                    vfloat v = ZEROV;
+                    for (int k = 0; k < vw.support; ++k) {
+                        v += F2V(vw.w[size_t(k) * vw.stride + i]) * LVFU(s[i0 + k][j]);
+                    }
+                    STVF(line[j], v);
+                }
+#endif
+                for (; j < sW; ++j) {
+                    float v = 0.f;
+                    for (int k = 0; k < vw.support; ++k) {
+                        v += vw.w[size_t(k) * vw.stride + i] * s[i0 + k][j];
+                    }
+                    line[j] = v;
                 }
 
-                STVF (lL[j], Lv);
-                STVF (la[j], av);
-                STVF (lb[j], bv);
-            }
-
-#else
-            int j = 0;
+                // horizontal pass, 4 destination pixels at a time
+                j = 0;
+#ifdef __SSE2__
+                for (; j < dW - 3; j += 4) {
+                    const float *l0 = line + hw.start[j];
+                    const float *l1 = line + hw.start[j+1];
+                    const float *l2 = line + hw.start[j+2];
+                    const float *l3 = line + hw.start[j+3];
+                    vfloat v = ZEROV;
+                    for (int k = 0; k < hw.support; ++k) {
+                        v += LVFU(hw.w[size_t(k) * hw.stride + j]) * _mm_setr_ps(l0[k], l1[k], l2[k], l3[k]);
+                    }
+                    STVFU(d[j], v);
+                }
 #endif
+                for (; j < dW; ++j) {
+                    const float *l = line + hw.start[j];
+                    float v = 0.f;
+                    for (int k = 0; k < hw.support; ++k) {
+                        v += hw.w[size_t(k) * hw.stride + j] * l[k];
+                    }
+                    d[j] = v;
+                }
+            }
+        }
+    }
+}
 
-            for (; j < sW; j++) {
-                float L = 0.0f, a = 0.0f, b = 0.0f;
+} // namespace
 
-                for (int ii = ii0; ii < ii1; ii++) {
-                    int k = ii - ii0;
 
-                    L += w[k] * sL[ii][j];
-                    a += w[k] * sa[ii][j];
-                    b += w[k] * sb[ii][j];
-                }
+void ImProcFunctions::Lanczos(Imagefloat *src, Imagefloat *dst, float scale)
+{
+    auto mode = src->mode();
+    src->setMode(Imagefloat::Mode::LAB, multiThread);
+    dst->assignMode(Imagefloat::Mode::LAB);
 
-                lL[j] = L;
-                la[j] = a;
-                lb[j] = b;
-            }
+    resample_impl(src, dst, ResampleKernel::LANCZOS3, scale, scale, multiThread);
 
-            // Do horizontal interpolation
-            for (int j = 0; j < dW; j++) {
+    dst->setMode(mode, multiThread);
+}
 
-                float * wh = wwh + support * j;
 
-                float L = 0.0f, a = 0.0f, b = 0.0f;
+void ImProcFunctions::resample(Imagefloat *src, Imagefloat *dst, ResampleKernel kernel)
+{
+    src->copyState(dst);
+    if (src->getWidth() == dst->getWidth() && src->getHeight() == dst->getHeight()) {
+        src->copyTo(dst);
+        return;
+    }
 
-                for (int jj = jj0[j]; jj < jj1[j]; jj++) {
-                    int k = jj - jj0[j];
+    const float xscale = float(dst->getWidth()) / float(src->getWidth());
+    const float yscale = float(dst->getHeight()) / float(src->getHeight());
+    resample_impl(src, dst, kernel, xscale, yscale, multiThread);
+}
 
-                    L += wh[k] * lL[jj];
-                    a += wh[k] * la[jj];
-                    b += wh[k] * lb[jj];
-                }
 
-                dL[i][j] = L;
-                da[i][j] = a;
-                db[i][j] = b;
+void ImProcFunctions::resampleLadder(Imagefloat *src, const std::vector<Imagefloat *> &dst, const std::vector<ResampleKernel> &kernels)
+{
+    const auto area =
+        [](const Imagefloat *img) -> size_t
+        {
+            return size_t(img->getWidth()) * size_t(img->getHeight());
+        };
+
+    std::vector<size_t> todo(dst.size());
+    std::iota(todo.begin(), todo.end(), 0);
+    std::stable_sort(todo.begin(), todo.end(),
+                     [&](size_t a, size_t b) -> bool
+                     {
+                         return area(dst[a]) > area(dst[b]);
+                     });
+
+    // each output is computed from the smallest already computed one that
+    // is at least twice as big in both directions (or from src), so that the
+    // kernel always sees enough samples and the cost of the smaller sizes
+    // becomes negligible
+    std::vector<Imagefloat *> done;
+    std::vector<std::unique_ptr<Imagefloat>> reduced;
+    for (auto i : todo) {
+        Imagefloat *d = dst[i];
+        Imagefloat *from = src;
+        for (auto p : done) {
+            if (p->getWidth() >= 2 * d->getWidth() && p->getHeight() >= 2 * d->getHeight() && area(p) < area(from)) {
+                from = p;
             }
         }
-    }
-    delete[] jj0;
-    delete[] jj1;
-    delete[] wwh;
 
-    dst->setMode(mode, multiThread);
+        // for large downscales, first average blocks of n x n pixels (i.e.
+        // use the box kernel) down to a size still at least 3 times the
+        // output, and apply the (much wider) kernel only from there
+        const int n = min(from->getWidth() / d->getWidth(), from->getHeight() / d->getHeight()) / 3;
+        if (n >= 2 && kernels[i] != ResampleKernel::BOX) {
+            reduced.emplace_back(new Imagefloat(from->getWidth() / n, from->getHeight() / n, from));
+            resample(from, reduced.back().get(), ResampleKernel::BOX);
+            from = reduced.back().get();
+            done.push_back(from);
+        }
+
+        resample(from, d, kernels[i]);
+        done.push_back(d);
+    }
 }
 
 
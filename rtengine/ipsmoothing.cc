@@ -345,9 +345,7 @@ void guided_smoothing(array2D<float> &R, array2D<float> &G, array2D<float> &B, c
         const bool luminance = (chan == Channel::L);
 
         if (rgb) {
-            rtengine::guidedFilterLog(10.f, R, r, epsilon, multithread);
-            rtengine::guidedFilterLog(10.f, G, r, epsilon, multithread);
-            rtengine::guidedFilterLog(10.f, B, r, epsilon, multithread);
+            rtengine::guidedFilterLog(10.f, {&R, &G, &B}, r, epsilon, multithread);
         } else {
             array2D<float> guide(W, H, ARRAY2D_ALIGNED);
 #ifdef _OPENMP
@@ -359,9 +357,7 @@ void guided_smoothing(array2D<float> &R, array2D<float> &G, array2D<float> &B, c
                     guide[y][x] = xlin2log(max(l, 0.f), 10.f);
                 }
             }
-            rtengine::guidedFilterLog(guide, 10.f, R, r, epsilon, multithread);
-            rtengine::guidedFilterLog(guide, 10.f, G, r, epsilon, multithread);
-            rtengine::guidedFilterLog(guide, 10.f, B, r, epsilon, multithread);
+            rtengine::guidedFilterLog(guide, 10.f, {&R, &G, &B}, r, epsilon, multithread);
 
 #ifdef _OPENMP
 #           pragma omp parallel for if (multithread)
@@ -395,32 +391,6 @@ void guided_smoothing(array2D<float> &R, array2D<float> &G, array2D<float> &B, c
     }
 }
 
-void find_region(const array2D<float> &mask, int &min_x, int &min_y, int &max_x, int &max_y)
-{
-    const int W = mask.width();
-    const int H = mask.height();
-    
-    min_x = W - 1;
-    min_y = H - 1;
-    max_x = 0;
-    max_y = 0;
-
-    for (int y = 0; y < H; ++y) {
-        for (int x = 0; x < W; ++x) {
-            if (mask[y][x] > 0.f) {
-                min_x = std::min(min_x, x);
-                max_x = std::max(max_x, x);
-                min_y = std::min(min_y, y);
-                max_y = std::max(max_y, y);
-            }
-        }
-    }
-
-    ++max_x;
-    ++max_y;
-}
-
-
 void gaussian_smoothing(array2D<float> &R, array2D<float> &G, array2D<float> &B, float *buf, const TMatrix &ws, Channel chan, double sigma, double scale, bool multithread)
 {
     //static constexpr double HIGH_PRECISION_THRESHOLD = 2.0;
@@ -858,7 +828,7 @@ bool ImProcFunctions::guidedSmoothing(Imagefloat *rgb)
             show_mask_idx = -1;
         }
         std::vector<array2D<float>> mask(n);
-        if (!generateMasks(rgb, params->smoothing.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, nullptr, &mask, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr)) {
+        if (!generateMasks(rgb, params->smoothing.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, nullptr, &mask, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr, mask_cache)) {
             return true; // show mask is active, nothing more to do
         }
 
@@ -880,7 +850,9 @@ bool ImProcFunctions::guidedSmoothing(Imagefloat *rgb)
             int min_x, min_y, max_x, max_y;
             const auto &blend = mask[i];
 
-            find_region(blend, min_x, min_y, max_x, max_y);
+            if (!getMaskRegion(blend, min_x, min_y, max_x, max_y, multiThread)) {
+                continue;
+            }
             int ww = max_x - min_x;
             int hh = max_y - min_y;
 
@@ -26,6 +26,8 @@
 #include "guidedfilter.h"
 #include <iostream>
 #include <set>
+#include <vector>
+#include <memory>
 
 #define BENCHMARK
 #include "StopWatch.h"
@@ -82,71 +84,175 @@ inline float feather_factor(float x, float radius, float sigma)
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-void heal_laplace_loop(Imagefloat *img, const array2D<int32_t> &mask)
-{
-    const int width = img->getWidth();
-    const int height = img->getHeight();
-    
-    const int MAX_ITER = std::min(std::max(width, height) * 2, 1000);
+// Multigrid solver for the Laplace equation on the pixels where mask is
+// nonzero, using all the other pixels as Dirichlet boundary conditions.
+// This converges to the same solution as the SOR iterations used by GIMP,
+// but in a number of operations proportional to the area of the spot.
+class LaplaceSolver {
+public:
+    explicit LaplaceSolver(const array2D<int32_t> &mask):
+        W_(mask.width()),
+        H_(mask.height())
+    {
+        int w = W_, h = H_;
+        masks_.emplace_back(new array2D<uint8_t>(w, h));
+        auto &m = *masks_.back();
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                m[y][x] = (y > 0 && y < h-1 && x > 0 && x < w-1 && mask[y][x]);
+            }
+        }
+        while (w > MIN_SIZE && h > MIN_SIZE) {
+            const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+            const auto &fm = *masks_.back();
+            masks_.emplace_back(new array2D<uint8_t>(cw, ch));
+            auto &cm = *masks_.back();
+            for (int y = 0; y < ch; ++y) {
+                for (int x = 0; x < cw; ++x) {
+                    bool in = (y > 0 && y < ch-1 && x > 0 && x < cw-1);
+                    for (int i = 2*y; in && i < std::min(2*y+2, h); ++i) {
+                        for (int j = 2*x; j < std::min(2*x+2, w); ++j) {
+                            in = in && fm[i][j];
+                        }
+                    }
+                    cm[y][x] = in;
+                }
+            }
+            w = cw;
+            h = ch;
+        }
+    }
 
-    constexpr float w = 1.4f;
-    constexpr float w1 = 1.f - w;
-    constexpr float w2 = w / 4.f;
+    // u contains the boundary values and the initial guess on entry, and
+    // the solution on exit
+    void operator()(float **u) const
+    {
+        constexpr int MAX_CYCLES = 50;
+        constexpr float TOLERANCE = 1e-2f;
 
-    const auto next =
-        [&](float **chan, int x, int y) -> void
-        {
-            float &cur = chan[y][x];
-            float left = chan[y][x-1];
-            float top = chan[y-1][x];
-            float right = chan[y][x+1];
-            float bottom = chan[y+1][x];
-            float upd = cur * w1 + (left + top + right + bottom) * w2;
-            cur = upd;
-        };
+        array2D<float> zero(W_, H_, ARRAY2D_CLEAR_DATA);
+        for (int i = 0; i < MAX_CYCLES; ++i) {
+            if (vcycle(0, u, zero) < TOLERANCE) {
+                break;
+            }
+        }
+    }
 
-#ifdef __SSE2__
-    const vfloat w1v = F2V(w1);
-    const vfloat w2v = F2V(w2);
-    const vint iZEROv = vcast_vi_i(0);
-    
-    const auto vnext =
-        [&](float **chan, int x, int y) -> void
-        {
-            vfloat cur = LVFU(chan[y][x]);
-            vfloat left = LVFU(chan[y][x-1]);
-            vfloat top = LVFU(chan[y-1][x]);
-            vfloat right = LVFU(chan[y][x+1]);
-            vfloat bottom = LVFU(chan[y+1][x]);
-            vfloat upd = cur * w1v + (left + top + right + bottom) * w2v;
-            STVFU(chan[y][x], upd);
-        };
-#endif
+private:
+    static constexpr int MIN_SIZE = 4;
+    static constexpr int PRE_SMOOTH = 2;
+    static constexpr int POST_SMOOTH = 2;
+    static constexpr int COARSE_ITER = 64;
 
-    for (int iter = 0; iter < MAX_ITER; ++iter) {
-#ifdef _OPENMP
-#       pragma omp parallel for schedule(dynamic,16)
-#endif
-        for (int y = 1; y < height-1; ++y) {
-            int x = 1;
-#ifdef __SSE2__
-            for (; x < width-1-3; x+=4) {
-                vint m = _mm_loadu_si128(reinterpret_cast<vint *>(&mask[y][x]));
-                if (vtest(vnotm(vmaski_eq(m, iZEROv)))) {
-                    vnext(img->r.ptrs, x, y);
-                    vnext(img->g.ptrs, x, y);
-                    vnext(img->b.ptrs, x, y);
+    // red-black Gauss-Seidel for 4u - (sum of the neighbours) = f
+    void smooth(int level, float **u, const array2D<float> &f, int iterations) const
+    {
+        const auto &m = *masks_[level];
+        const int W = m.width(), H = m.height();
+        for (int it = 0; it < iterations; ++it) {
+            for (int parity = 0; parity < 2; ++parity) {
+                for (int y = 1; y < H-1; ++y) {
+                    for (int x = 1 + ((y + parity) & 1); x < W-1; x += 2) {
+                        if (m[y][x]) {
+                            u[y][x] = 0.25f * (u[y][x-1] + u[y][x+1] + u[y-1][x] + u[y+1][x] + f[y][x]);
+                        }
+                    }
                 }
             }
-#endif
-            for (; x < width-1; ++x) {
-                if (mask[y][x]) {
-                    next(img->r.ptrs, x, y);
-                    next(img->g.ptrs, x, y);
-                    next(img->b.ptrs, x, y);
+        }
+    }
+
+    // returns the max absolute residual
+    float residual(int level, float **u, const array2D<float> &f, array2D<float> &r) const
+    {
+        const auto &m = *masks_[level];
+        const int W = m.width(), H = m.height();
+        float ret = 0.f;
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                if (m[y][x]) {
+                    r[y][x] = f[y][x] - (4.f * u[y][x] - u[y][x-1] - u[y][x+1] - u[y-1][x] - u[y+1][x]);
+                    ret = std::max(ret, std::abs(r[y][x]));
+                } else {
+                    r[y][x] = 0.f;
                 }
             }
         }
+        return ret;
+    }
+
+    float vcycle(int level, float **u, const array2D<float> &f) const
+    {
+        const auto &m = *masks_[level];
+        const int W = m.width(), H = m.height();
+
+        if (level + 1 == int(masks_.size())) {
+            smooth(level, u, f, COARSE_ITER);
+            array2D<float> r(W, H);
+            return residual(level, u, f, r);
+        }
+
+        smooth(level, u, f, PRE_SMOOTH);
+
+        array2D<float> r(W, H);
+        const float res = residual(level, u, f, r);
+        if (res == 0.f) {
+            return res;
+        }
+
+        const auto &cm = *masks_[level+1];
+        const int cw = cm.width(), ch = cm.height();
+        array2D<float> cf(cw, ch, ARRAY2D_CLEAR_DATA);
+        array2D<float> e(cw, ch, ARRAY2D_CLEAR_DATA);
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                cf[y/2][x/2] += r[y][x];
+            }
+        }
+        for (int y = 0; y < ch; ++y) {
+            for (int x = 0; x < cw; ++x) {
+                if (!cm[y][x]) {
+                    cf[y][x] = 0.f;
+                }
+            }
+        }
+
+        vcycle(level + 1, e, cf);
+
+        // bilinear interpolation of the coarse correction
+        for (int y = 1; y < H-1; ++y) {
+            const int y0 = y / 2;
+            const int y1 = LIM((y & 1) ? y0 + 1 : y0 - 1, 0, ch-1);
+            for (int x = 1; x < W-1; ++x) {
+                if (m[y][x]) {
+                    const int x0 = x / 2;
+                    const int x1 = LIM((x & 1) ? x0 + 1 : x0 - 1, 0, cw-1);
+                    u[y][x] += 0.5625f * e[y0][x0] + 0.1875f * (e[y0][x1] + e[y1][x0]) + 0.0625f * e[y1][x1];
+                }
+            }
+        }
+
+        smooth(level, u, f, POST_SMOOTH);
+
+        return residual(level, u, f, r);
+    }
+
+    const int W_;
+    const int H_;
+    std::vector<std::unique_ptr<array2D<uint8_t>>> masks_;
+};
+
+
+void heal_laplace_loop(Imagefloat *img, const array2D<int32_t> &mask)
+{
+    const LaplaceSolver solve(mask);
+    float **chan[3] = { img->r.ptrs, img->g.ptrs, img->b.ptrs };
+
+#ifdef _OPENMP
+#   pragma omp parallel for
+#endif
+    for (int c = 0; c < 3; ++c) {
+        solve(chan[c]);
     }
 }
 
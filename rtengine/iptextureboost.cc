@@ -207,7 +207,7 @@ bool ImProcFunctions::textureBoost(Imagefloat *rgb)
             show_mask_idx = -1;
         }
         std::vector<array2D<float>> mask(n);
-        if (!generateMasks(rgb, params->textureBoost.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, &mask, nullptr, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr)) {
+        if (!generateMasks(rgb, params->textureBoost.labmasks, offset_x, offset_y, full_width, full_height, scale, multiThread, show_mask_idx, &mask, nullptr, cur_pipeline == Pipeline::NAVIGATOR ? plistener : nullptr, mask_cache)) {
             return true; // show mask is active, nothing more to do
         }
 
@@ -224,9 +224,12 @@ bool ImProcFunctions::textureBoost(Imagefloat *rgb)
             }
             
             auto &r = params->textureBoost.regions[i];
-            if (r.strength != 0) {
+            const auto &blend = mask[i];
+            int min_x, min_y, max_x, max_y;
+            // as in local contrast, the decomposition needs the whole
+            // frame, so only the regions with an empty mask are skipped
+            if (r.strength != 0 && getMaskRegion(blend, min_x, min_y, max_x, max_y, multiThread)) {
                 texture_boost(Y, r, scale, multiThread, scale == 1 || cur_pipeline == Pipeline::OUTPUT);
-                const auto &blend = mask[i];
 
 #ifdef _OPENMP
 #               pragma omp parallel for if (multiThread)
@@ -25,6 +25,7 @@
 #include "sleef.h"
 #include "opthelper.h"
 #include "median.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -41,6 +42,7 @@ namespace rtengine
 // TODO Tiles to reduce memory consumption
 void RawImageSource::lmmse_interpolate_omp(int winw, int winh, const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue, int iterations)
 {
+    TRACE_FUN("demosaic");
     const int width = winw, height = winh;
     const int ba = 10;
     const int rr1 = height + 2 * ba;
@@ -16,20 +16,288 @@
  *  You should have received a copy of the GNU General Public License
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <glib/gstdio.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <vector>
 #include "rtengine.h"
 #include "stdimagesource.h"
 #include "rawimagesource.h"
+#include "rawimage.h"
+#include "metadata.h"
+#include "settings.h"
 
-namespace rtengine
+namespace rtengine {
+
+extern const Settings *settings;
+
+namespace {
+
+/*
+ * Decoding a raw file is expensive, and the same file is often loaded
+ * several times in a row: when opening it again in the editor, when
+ * queueing several snapshots of it, or when switching back and forth in
+ * the filmstrip. So, instead of being deleted when their last reference
+ * goes away, the raw sources created by InitialImage::load are handed to
+ * a cache, which keeps the most recently used ones (up to
+ * settings->decoded_raw_cache_size MB) and gives them back to later loads
+ * of the same (unmodified) file.
+ *
+ * A source is never shared: it is either in the cache or owned by a
+ * single user, which processes it like the editor does when the raw
+ * parameters change (preprocess, demosaic, ...). All the frames of a
+ * file are decoded, so a cached source serves any of them.
+ */
+class CachedRawImageSource: public RawImageSource {
+public:
+    struct Key {
+        Glib::ustring fname;
+        int64_t size;
+        int64_t mtime;
+        // the metadata of the source might include the XMP sidecar
+        int64_t xmp_size;
+        int64_t xmp_mtime;
+
+        bool operator==(const Key &other) const
+        {
+            return fname == other.fname && size == other.size && mtime == other.mtime && xmp_size == other.xmp_size && xmp_mtime == other.xmp_mtime;
+        }
+    };
+
+    explicit CachedRawImageSource(const Key &key): key_(key), refs_(1) {}
+
+    void increaseRef() override { ++refs_; }
+    void decreaseRef() override;
+
+    const Key &key() const { return key_; }
+
+    // memory held by the decoded frames
+    size_t memoryUsage() const;
+
+    // drops everything that depends on the job that used the source,
+    // keeping only the decoded data
+    void recycle();
+
+    // makes a recycled source ready for a new owner
+    void reuse();
+
+private:
+    Key key_;
+    std::atomic<int> refs_;
+};
+
+
+class DecodedRawCache {
+public:
+    static DecodedRawCache &getInstance()
+    {
+        static DecodedRawCache instance;
+        return instance;
+    }
+
+    // takes the source for key out of the cache, or returns nullptr
+    CachedRawImageSource *get(const CachedRawImageSource::Key &key);
+    void put(CachedRawImageSource *src);
+    void clear();
+
+private:
+    DecodedRawCache(): size_(0), hits_(0), misses_(0) {}
+
+    std::mutex mutex_;
+    std::list<std::pair<CachedRawImageSource *, size_t>> lru_; // most recent first
+    size_t size_;
+    size_t hits_;
+    size_t misses_;
+};
+
+
+bool get_key(const Glib::ustring &fname, CachedRawImageSource::Key &key)
 {
+    GStatBuf st;
+    if (g_stat(fname.c_str(), &st) != 0) {
+        return false;
+    }
+
+    key.fname = fname;
+    key.size = st.st_size;
+    key.mtime = st.st_mtime;
+    key.xmp_size = -1;
+    key.xmp_mtime = -1;
+
+    if (settings->metadata_xmp_sync != Settings::MetadataXmpSync::NONE && g_stat(Exiv2Metadata::xmpSidecarPath(fname).c_str(), &st) == 0) {
+        key.xmp_size = st.st_size;
+        key.xmp_mtime = st.st_mtime;
+    }
+
+    return true;
+}
+
+
+void CachedRawImageSource::decreaseRef()
+{
+    if (--refs_ == 0) {
+        DecodedRawCache::getInstance().put(this);
+    }
+}
+
+
+size_t CachedRawImageSource::memoryUsage() const
+{
+    size_t n = 0;
+    size_t decoded = 0;
+
+    for (unsigned int i = 0; i < numFrames; ++i) {
+        const RawImage *r = riFrames[i];
+        const bool mosaic = r->getSensorType() == ST_BAYER || r->getSensorType() == ST_FUJI_XTRANS || r->get_colors() == 1;
+        n += size_t(mosaic ? 1 : 3) * r->get_width() * r->get_height();
+        // e.g. the buffers that libraw keeps alive
+        decoded += r->get_decoded_size();
+
+        if (i + 1 < numFrames && rawDataBuffer[i]) {
+            n += size_t(W) * H;
+        }
+    }
+
+    return n * sizeof(float) + decoded;
+}
+
+
+void CachedRawImageSource::recycle()
+{
+    flushRawData();
+    flushRGB();
+    redAWBMul = greenAWBMul = blueAWBMul = -1.;
+    plistener = nullptr;
+}
+
+
+void CachedRawImageSource::reuse()
+{
+    // these are allocated by load()
+    green(W, H);
+    red(W, H);
+    blue(W, H);
+    refs_ = 1;
+}
+
+
+CachedRawImageSource *DecodedRawCache::get(const CachedRawImageSource::Key &key)
+{
+    CachedRawImageSource *ret = nullptr;
+    std::vector<CachedRawImageSource *> stale;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto it = lru_.begin(); it != lru_.end(); ) {
+            if (it->first->key().fname != key.fname || (ret && it->first->key() == key)) {
+                ++it;
+            } else {
+                if (it->first->key() == key) {
+                    ret = it->first;
+                } else {
+                    stale.push_back(it->first);
+                }
+                size_ -= it->second;
+                it = lru_.erase(it);
+            }
+        }
+
+        if (ret) {
+            ++hits_;
+        } else {
+            ++misses_;
+        }
+
+        if (settings->verbose) {
+            std::cout << "decoded raw cache " << (ret ? "hit" : "miss") << " for " << key.fname
+                      << " (hit rate: " << hits_ << "/" << (hits_ + misses_)
+                      << ", " << (size_ >> 20) << " MB in " << lru_.size() << " entries)" << std::endl;
+        }
+    }
+
+    for (auto s : stale) {
+        delete s;
+    }
+
+    if (ret) {
+        ret->reuse();
+    }
+
+    return ret;
+}
+
+
+void DecodedRawCache::put(CachedRawImageSource *src)
+{
+    src->recycle();
+
+    const size_t limit = size_t(std::max(settings->decoded_raw_cache_size, 0)) << 20;
+    const size_t sz = src->memoryUsage();
+    std::vector<CachedRawImageSource *> evicted;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (sz > limit) {
+            evicted.push_back(src);
+        } else {
+            lru_.emplace_front(src, sz);
+            size_ += sz;
+
+            while (size_ > limit) {
+                evicted.push_back(lru_.back().first);
+                size_ -= lru_.back().second;
+                lru_.pop_back();
+            }
+        }
+    }
+
+    for (auto s : evicted) {
+        delete s;
+    }
+}
+
+
+void DecodedRawCache::clear()
+{
+    std::list<std::pair<CachedRawImageSource *, size_t>> entries;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries.swap(lru_);
+        size_ = 0;
+    }
+
+    for (auto &e : entries) {
+        delete e.first;
+    }
+}
+
+} // namespace
+
 
 InitialImage* InitialImage::load (const Glib::ustring& fname, bool isRaw, int* errorCode, ProgressListener* pl)
 {
 
     ImageSource* isrc;
+    CachedRawImageSource::Key key;
 
     if (!isRaw) {
         isrc = new StdImageSource ();
+    } else if (settings->decoded_raw_cache_size > 0 && get_key(fname, key)) {
+        auto cached = DecodedRawCache::getInstance().get(key);
+
+        if (cached) {
+            *errorCode = 0;
+            return cached;
+        }
+
+        isrc = new CachedRawImageSource (key);
     } else {
         isrc = new RawImageSource ();
     }
@@ -45,5 +313,11 @@ InitialImage* InitialImage::load (const Glib::ustring& fname, bool isRaw, int* e
 
     return isrc;
 }
+
+
+void InitialImage::clearCache()
+{
+    DecodedRawCache::getInstance().clear();
 }
 
+} // namespace rtengine
@@ -35,6 +35,9 @@
 #include "opthelper.h"
 #include "rescale.h"
 #include "../rtgui/multilangmgr.h"
+#include <algorithm>
+#include <functional>
+#include <string.h>
 
 namespace rtengine {
 
@@ -44,6 +47,108 @@ using procparams::DrawnMask;
 
 namespace {
 
+// A rectangular region of a mask, [x0, x1) x [y0, y1). Area shapes
+// often cover only a small part of the image, so they are rendered and
+// feathered only within their bounding box, grown by the reach of the
+// filters: outside of it, the result is known in advance
+struct MaskBox {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+    MaskBox(int x0=0, int y0=0, int x1=0, int y1=0):
+        x0(x0), y0(y0), x1(x1), y1(y1) {}
+
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+
+    bool contains(const MaskBox &other) const
+    {
+        return other.empty() || (x0 <= other.x0 && y0 <= other.y0 && x1 >= other.x1 && y1 >= other.y1);
+    }
+
+    MaskBox grow(int amount) const
+    {
+        return empty() ? *this : MaskBox(x0 - amount, y0 - amount, x1 + amount, y1 + amount);
+    }
+
+    // union (bounding box of both)
+    MaskBox operator|(const MaskBox &other) const
+    {
+        if (empty()) {
+            return other;
+        } else if (other.empty()) {
+            return *this;
+        }
+        return MaskBox(min(x0, other.x0), min(y0, other.y0), max(x1, other.x1), max(y1, other.y1));
+    }
+
+    // intersection
+    MaskBox operator&(const MaskBox &other) const
+    {
+        MaskBox ret(max(x0, other.x0), max(y0, other.y0), min(x1, other.x1), min(y1, other.y1));
+        return ret.empty() ? MaskBox() : ret;
+    }
+};
+
+
+// row pointers of arr, for creating views of a region of it with
+// ARRAY2D_BYREFERENCE
+inline float **rows(const array2D<float> &arr)
+{
+    return const_cast<array2D<float> &>(arr);
+}
+
+
+// sets all the pixels of mask outside of box to val
+void fill_outside(array2D<float> &mask, const MaskBox &box, float val, bool multithread)
+{
+    const int W = mask.width();
+    const int H = mask.height();
+
+#ifdef _OPENMP
+#   pragma omp parallel for if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        float *row = mask[y];
+        if (y < box.y0 || y >= box.y1 || box.empty()) {
+            std::fill(row, row + W, val);
+        } else {
+            std::fill(row, row + box.x0, val);
+            std::fill(row + box.x1, row + W, val);
+        }
+    }
+}
+
+
+// the region of a W x H mask affected by the content of box once it is
+// feathered (with a guided filter of the given radius) and blurred. It is
+// aligned to the grid used by the subsampling of the guided filter, so that
+// the result does not depend on where the region starts
+MaskBox filter_region(const MaskBox &box, int W, int H, bool feather, int radius, double blur)
+{
+    const MaskBox full(0, 0, W, H);
+    if (blur > 0) {
+        // the (recursive) gaussian blur has infinite support: any bounded
+        // region would leave a visible step at its edges
+        return (box & full).empty() ? MaskBox() : full;
+    }
+    int reach = 2;
+    if (feather) {
+        // two box filters, plus some slack for the subsampling
+        reach += 2 * radius + 16;
+    }
+    MaskBox ret = box.grow(reach) & full;
+    if (feather && !ret.empty()) {
+        const int s = guidedFilterSubsampling(W, H, radius);
+        ret = MaskBox(ret.x0 / s * s, ret.y0 / s * s, (ret.x1 + s - 1) / s * s, (ret.y1 + s - 1) / s * s) & full;
+    }
+    return ret;
+}
+
+
 bool generate_area_mask(int ox, int oy, int width, int height, const array2D<float> &guide, const AreaMask &areaMask, float scale, bool multithread, array2D<float> &global_mask, ProgressListener *plistener)
 {
     if (!areaMask.enabled || areaMask.shapes.empty() || (areaMask.isTrivial() && areaMask.blur <= 0.f)) {
@@ -55,42 +160,32 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
 
     Coord origin(ox, oy);
 
-    const auto inside =
-        [&](int x, int y) -> bool
-        {
-            return (x >= 0 && x < global_mask.width() &&
-                    y >= 0 && y < global_mask.height());
-        };
-
     const int dir[] = { 1, 1, 1, -1, -1, 1, -1, -1 };
 
     constexpr float bgcolor = 0.f;           // background layer, no effect applied
     constexpr float fgcolor = 1.f - bgcolor; // foreground layer, full effect applied
 
+    const int W = guide.width();
+    const int H = guide.height();
+    const MaskBox full(0, 0, W, H);
+
     // first fill with background
-    global_mask(guide.width(), guide.height());
+    global_mask(W, H);
     global_mask.fill(bgcolor);
 
+    // the part of the global mask that can differ from the background
+    MaskBox support;
+
     float min_feather = RT_INFINITY;
     float global_min_feather = RT_INFINITY;
 
     int radius = 0;
 
-    // will either hold a pointer to the global mask
-    // or allocate data for rendering each shape
-    // or used for intersecting shapes in single value mode
+    // holds the rendering of each shape, limited to the region it affects
     array2D<float> shape_mask;
     DiagonalCurve contrast_curve(areaMask.contrast);
 
     for (const auto &area_ : areaMask.shapes) {
-        if (!shape_mask.width()) {
-            // allocated once, when needed
-            shape_mask(global_mask.width(), global_mask.height());
-        }
-        if (area_->getType() != AreaMask::Shape::GRADIENT) {
-            // GRADIENT will update the whole image, no need to initialize it here
-            shape_mask.fill(area_->mode == AreaMask::Shape::SUBTRACT ? fgcolor : bgcolor);
-        }
         float color;
 
         switch (area_->mode) {
@@ -104,6 +199,23 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
             break;
         }
 
+        // the region of the global mask affected by the shape
+        MaskBox region;
+
+        const auto init_shape_mask =
+            [&]() -> void
+            {
+                shape_mask(region.width(), region.height());
+                shape_mask.fill(area_->mode == AreaMask::Shape::SUBTRACT ? fgcolor : bgcolor);
+            };
+
+        const auto inside =
+            [&](int x, int y) -> bool
+            {
+                return (x >= 0 && x < shape_mask.width() &&
+                        y >= 0 && y < shape_mask.height());
+            };
+
         switch (area_->getType()) {
         case AreaMask::Shape::RECTANGLE:
         {
@@ -122,6 +234,19 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
             min_feather = std::min(a_min, b_min);
             global_min_feather = rtengine::min<double>(global_min_feather, min_feather);
 
+            radius = std::max(int(area->feather / 100.0 * min_feather), 1);
+
+            // the shape is contained in the circle around the center
+            // passing through the corners of the rectangle
+            const int cx = center.x - origin.x;
+            const int cy = center.y - origin.y;
+            const int ext = int(std::sqrt(SQR(a_min) + SQR(b_min))) + 2;
+            region = filter_region(MaskBox(cx - ext, cy - ext, cx + ext + 1, cy + ext + 1), W, H, area_->feather != 0., radius, area_->blur / scale);
+            if (region.empty()) {
+                break;
+            }
+            init_shape_mask();
+
             const auto get =
                 [&](int x, int y) -> Coord
                 {
@@ -135,7 +260,7 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
                     //return ret;
                     double rx, ry;
                     ret.get(rx, ry);
-                    return Coord(int(rx + 0.5), int(ry + 0.5));
+                    return Coord(int(rx + 0.5) - region.x0, int(ry + 0.5) - region.y0);
                 };
 
             // draw the (bounded) ellipse
@@ -156,8 +281,6 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
                 }
             }
 
-            radius = std::max(int(area->feather / 100.0 * min_feather), 1);
-
             break;
         }
         case AreaMask::Shape::POLYGON:
@@ -174,17 +297,43 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
                 imgSpacePoly.at(i).roundness = area->knots.at(i).roundness;
             }
             auto v = area->get_tessellation(imgSpacePoly);
-            min_feather = polyFill(shape_mask, global_mask.width(), global_mask.height(), v, color);
+
+            // same bounds as computed by polyFill
+            int xs = int(v[0].x + 0.5), xe = xs;
+            int ys = int(v[0].y + 0.5), ye = ys;
+            for (auto &p : v) {
+                xs = std::min(xs, int(p.x));
+                xe = std::max(xe, int(p.x));
+                ys = std::min(ys, int(p.y));
+                ye = std::max(ye, int(p.y));
+            }
+            min_feather = std::min(xe - xs, ye - ys);
             global_min_feather = rtengine::min<double>(global_min_feather, min_feather);
 
             radius = std::max(int(area->feather / 100.0 * min_feather), 1);
 
+            region = filter_region(MaskBox(xs - 1, ys - 1, xe + 2, ye + 2), W, H, area_->feather != 0., radius, area_->blur / scale);
+            if (region.empty()) {
+                break;
+            }
+            init_shape_mask();
+
+            for (auto &p : v) {
+                p.x -= region.x0;
+                p.y -= region.y0;
+            }
+            polyFill(shape_mask, region.width(), region.height(), v, color);
+
             break;
         }
         case AreaMask::Shape::GRADIENT:
         {
             auto area = static_cast<AreaMask::Gradient*>(area_.get());
 
+            // GRADIENT will update the whole image, no need to initialize it
+            region = full;
+            shape_mask(W, H);
+
             Coord center(w2 + area->x / 100.0 * w2, h2 + area->y / 100.0 * h2);
             float color_start = fgcolor * (area_->mode == AreaMask::Shape::SUBTRACT ?
                                           (100. - area->strengthStart) :
@@ -195,8 +344,8 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
             float color_diff = color_end - color_start;
             float half_feather = area->feather * rtengine::norm2<double> (width, height) / 200.0;
             float feather = 2 * half_feather;
-            int w = global_mask.width();
-            int h = global_mask.height();
+            int w = W;
+            int h = H;
 
 #ifdef _OPENMP
 #       pragma omp parallel if (multithread)
@@ -232,9 +381,20 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
             break;
         }
 
+        if (region.empty()) {
+            // the shape does not affect the visible part of the image: adding
+            // or subtracting it is a no-op, intersecting clears everything
+            if (area_->mode == AreaMask::Shape::INTERSECT) {
+                global_mask.fill(bgcolor);
+                support = MaskBox();
+            }
+            continue;
+        }
+
         // feather the shape's mask
         if (area_->getType() != AreaMask::Shape::GRADIENT && area_->feather != 0.) {
-            guidedFilter(guide, shape_mask, shape_mask, radius, 1e-7, multithread);
+            array2D<float> region_guide(region.width(), region.height(), region.x0, region.y0, rows(guide), ARRAY2D_BYREFERENCE);
+            guidedFilter(region_guide, shape_mask, shape_mask, radius, 1e-7, multithread, guidedFilterSubsampling(W, H, radius));
         }
 
         // No contrast applied per shape
@@ -244,7 +404,7 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
 #ifdef _OPENMP
 #       pragma omp parallel if (multithread)
 #endif
-            gaussianBlur(shape_mask, shape_mask, global_mask.width(), global_mask.height(), area_->blur / scale);
+            gaussianBlur(shape_mask, shape_mask, region.width(), region.height(), area_->blur / scale);
         }
 
         // merge the shape's mask into the global mask
@@ -253,10 +413,10 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
 #ifdef _OPENMP
 #           pragma omp parallel for if (multithread)
 #endif
-            for (int y = 0; y < global_mask.height(); ++y) {
-                float *s = shape_mask[y];
-                float *g = global_mask[y];
-                for (int x = 0; x < global_mask.width(); ++x) {
+            for (int y = region.y0; y < region.y1; ++y) {
+                float *s = shape_mask[y - region.y0];
+                float *g = global_mask[y] + region.x0;
+                for (int x = region.x0; x < region.x1; ++x) {
                     if (*s == bgcolor || *g == fgcolor) {
                         ++s;
                         ++g;
@@ -272,28 +432,33 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
                     }
                 }
             }
+            support = support | region;
             break;
         case AreaMask::Shape::INTERSECT:
 #ifdef _OPENMP
 #           pragma omp parallel for if (multithread)
 #endif
-            for (int y = 0; y < global_mask.height(); ++y) {
-                float *s = shape_mask[y];
-                float *g = global_mask[y];
-                for (int x = 0; x < global_mask.width(); ++x) {
+            for (int y = region.y0; y < region.y1; ++y) {
+                float *s = shape_mask[y - region.y0];
+                float *g = global_mask[y] + region.x0;
+                for (int x = region.x0; x < region.x1; ++x) {
                     *(g++) *= *(s++);
                 }
             }
+            if (!region.contains(support)) {
+                fill_outside(global_mask, region, bgcolor, multithread);
+            }
+            support = support & region;
             break;
         case AreaMask::Shape::SUBTRACT:
         default:
 #ifdef _OPENMP
 #           pragma omp parallel for if (multithread)
 #endif
-            for (int y = 0; y < global_mask.height(); ++y) {
-                float *s = shape_mask[y];
-                float *g = global_mask[y];
-                for (int x = 0; x < global_mask.width(); ++x) {
+            for (int y = region.y0; y < region.y1; ++y) {
+                float *s = shape_mask[y - region.y0];
+                float *g = global_mask[y] + region.x0;
+                for (int x = region.x0; x < region.x1; ++x) {
                     if (*s == fgcolor || *g == bgcolor) {
                         ++s;
                         ++g;
@@ -312,57 +477,63 @@ bool generate_area_mask(int ox, int oy, int width, int height, const array2D<flo
             break;
         }
     }
+    shape_mask.free();
 
-    // feather the shape's mask
     if (areaMask.feather != 0.) {
         radius = std::max(int(areaMask.feather / 100.0 * global_min_feather), 1);
-        guidedFilter(guide, global_mask, global_mask, radius, 1e-7, multithread);
     }
 
-    // blur the shape's mask
-    if (areaMask.blur > 0.) {
-#ifdef _OPENMP
-#       pragma omp parallel if (multithread)
-#endif
-        gaussianBlur(global_mask, global_mask, global_mask.width(), global_mask.height(), areaMask.blur / scale);
-    }
+    // the global feathering and blurring are limited to the neighbourhood
+    // of the shapes as well
+    const MaskBox active = support.contains(full) ? full : filter_region(support, W, H, areaMask.feather != 0., radius, areaMask.blur / scale);
 
-    bool is_empty = plistener ? true : false;
+    if (!active.empty()) {
+        array2D<float> active_mask(active.width(), active.height(), active.x0, active.y0, rows(global_mask), ARRAY2D_BYREFERENCE);
 
-    // Apply contrast
-    if (!contrast_curve.isIdentity()) {
-        const auto contrast =
-            [&contrast_curve](float x) -> float
-            {
-                return contrast_curve.getVal(x);
-            };
+        // feather the shape's mask
+        if (areaMask.feather != 0.) {
+            array2D<float> active_guide(active.width(), active.height(), active.x0, active.y0, rows(guide), ARRAY2D_BYREFERENCE);
+            guidedFilter(active_guide, active_mask, active_mask, radius, 1e-7, multithread, guidedFilterSubsampling(W, H, radius));
+        }
+
+        // blur the shape's mask
+        if (areaMask.blur > 0.) {
 #ifdef _OPENMP
-#       pragma omp parallel for if (multithread)
+#           pragma omp parallel if (multithread)
 #endif
-        for (int y = 0; y < global_mask.height(); ++y) {
-            for (int x = 0; x < global_mask.width(); ++x) {
-                float v = LIM01(global_mask[y][x]);
-                // if (!areaMask.inverted) {
-                //     v = 1.f - v;
-                // }
-                global_mask[y][x] = contrast(v);
-                assert(global_mask[y][x] == global_mask[y][x]);
-                if (is_empty && global_mask[y][x]) {
-                    is_empty = false;
-                }
-            }
+            gaussianBlur(active_mask, active_mask, active.width(), active.height(), areaMask.blur / scale);
         }
-    } else {
+    }
+
+    // Apply contrast
+    const bool has_contrast = !contrast_curve.isIdentity();
+    const auto contrast =
+        [&](float x) -> float
+        {
+            return has_contrast ? contrast_curve.getVal(x) : x;
+        };
+
+    // the value of the mask away from all the shapes
+    const float outside = contrast(LIM01(bgcolor));
+    if (outside != bgcolor) {
+        fill_outside(global_mask, active, outside, multithread);
+    }
+
+    bool is_empty = plistener && outside == bgcolor;
+
 #ifdef _OPENMP
-#       pragma omp parallel for if (multithread)
+#   pragma omp parallel for if (multithread)
 #endif
-        for (int y = 0; y < global_mask.height(); ++y) {
-            for (int x = 0; x < global_mask.width(); ++x) {
-                global_mask[y][x] = LIM01(global_mask[y][x]);
-                assert(global_mask[y][x] == global_mask[y][x]);
-                if (is_empty && global_mask[y][x]) {
-                    is_empty = false;
-                }
+    for (int y = active.y0; y < active.y1; ++y) {
+        for (int x = active.x0; x < active.x1; ++x) {
+            float v = LIM01(global_mask[y][x]);
+            // if (!areaMask.inverted) {
+            //     v = 1.f - v;
+            // }
+            global_mask[y][x] = contrast(v);
+            assert(global_mask[y][x] == global_mask[y][x]);
+            if (is_empty && global_mask[y][x]) {
+                is_empty = false;
             }
         }
     }
@@ -800,10 +971,153 @@ bool mask_postprocess(int width, int height, float scale, const array2D<float> &
 }
 
 
+inline size_t hash_combine(size_t seed, size_t v)
+{
+    return seed ^ (v + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+
+// identity of the input of generateMasks(), computed from its contents
+size_t image_key(Imagefloat *rgb, bool multithread)
+{
+    const int W = rgb->getWidth();
+    const int H = rgb->getHeight();
+    std::vector<uint64_t> rows(H);
+
+#ifdef _OPENMP
+#   pragma omp parallel for if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        // FNV-1a, one independent lane per channel
+        uint64_t h[3] = { 0xcbf29ce484222325ULL, 0xcbf29ce484222325ULL ^ 1, 0xcbf29ce484222325ULL ^ 2 };
+        const float *row[3] = { rgb->r(y), rgb->g(y), rgb->b(y) };
+        for (int x = 0; x < W; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                uint32_t v;
+                memcpy(&v, row[c] + x, sizeof(v));
+                h[c] = (h[c] ^ v) * 0x100000001b3ULL;
+            }
+        }
+        rows[y] = h[0] ^ (h[1] * 0x9e3779b97f4a7c15ULL) ^ (h[2] * 0xc2b2ae3d27d4eb4fULL);
+    }
+
+    size_t ret = std::hash<std::string>()(rgb->colorSpace().raw());
+    ret = hash_combine(ret, int(rgb->mode()));
+    for (auto v : rows) {
+        ret = hash_combine(ret, v);
+    }
+    return ret;
+}
+
+
+// hash of the mask definition, excluding its name
+size_t mask_hash(const Mask &mask)
+{
+    Mask m(mask);
+    m.name = "";
+    procparams::KeyFile kf;
+    m.save(kf, "Mask", "", "");
+    return std::hash<std::string>()(kf.to_data().raw());
+}
+
+
+void copy_plane(const array2D<float> &src, array2D<float> &dst, bool multithread)
+{
+    const int W = src.width();
+    const int H = src.height();
+    dst(W, H);
+#ifdef _OPENMP
+#   pragma omp parallel for if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        std::copy(src[y], src[y] + W, dst[y]);
+    }
+}
+
+
+// looks up a single plane in the cache, or computes and stores it with
+// gen(), which returns false if the plane is not needed
+template <class Gen>
+bool cached_plane(MaskCache *cache, size_t key, bool multithread, array2D<float> &out, const Gen &gen)
+{
+    if (cache) {
+        if (auto p = cache->find(key)) {
+            if (p->empty()) {
+                return false;
+            }
+            copy_plane((*p)[0], out, multithread);
+            return true;
+        }
+    }
+    const bool ret = gen();
+    if (cache) {
+        std::vector<array2D<float>> planes(ret ? 1 : 0);
+        if (ret) {
+            copy_plane(out, planes[0], multithread);
+        }
+        cache->insert(key, std::move(planes));
+    }
+    return ret;
+}
+
 } // namespace
 
 
-bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x, int offset_y, int full_width, int full_height, double scale, bool multithread, int show_mask_idx, std::vector<array2D<float>> *Lmask, std::vector<array2D<float>> *abmask, ProgressListener *plistener)
+MaskCache::MaskCache(size_t max_entries):
+    max_entries_(max_entries),
+    clock_(0)
+{
+}
+
+
+void MaskCache::clear()
+{
+    entries_.clear();
+}
+
+
+size_t MaskCache::getSize() const
+{
+    size_t ret = 0;
+    for (auto &e : entries_) {
+        for (auto &p : e.planes) {
+            ret += size_t(p.width()) * size_t(p.height()) * sizeof(float);
+        }
+    }
+    return ret;
+}
+
+
+const std::vector<array2D<float>> *MaskCache::find(size_t key)
+{
+    for (auto &e : entries_) {
+        if (e.key == key) {
+            e.stamp = ++clock_;
+            return &e.planes;
+        }
+    }
+    return nullptr;
+}
+
+
+void MaskCache::insert(size_t key, std::vector<array2D<float>> &&planes)
+{
+    auto it = std::find_if(entries_.begin(), entries_.end(), [key](const Entry &e) { return e.key == key; });
+    if (it == entries_.end()) {
+        if (entries_.size() >= max_entries_) {
+            it = std::min_element(entries_.begin(), entries_.end(), [](const Entry &a, const Entry &b) { return a.stamp < b.stamp; });
+        } else {
+            entries_.emplace_back();
+            it = entries_.end() - 1;
+        }
+    }
+    it->key = key;
+    it->stamp = ++clock_;
+    it->planes = std::move(planes);
+}
+
+
+bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x, int offset_y, int full_width, int full_height, double scale, bool multithread, int show_mask_idx, std::vector<array2D<float>> *Lmask, std::vector<array2D<float>> *abmask, ProgressListener *plistener, MaskCache *cache)
 {
     int n = masks.size();
     if (show_mask_idx < 0 || show_mask_idx >= n || !masks[show_mask_idx].enabled) {
@@ -859,6 +1173,43 @@ bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x
     assert(!abmask || abmask->size() == size_t(n));
     assert(!Lmask || Lmask->size() == size_t(n));
 
+    // everything depends on the input pixels and on the geometry; the
+    // result also depends on the definitions of the masks (and on which
+    // planes are requested), while the building blocks only on their own
+    // parameters
+    enum { KEY_RESULT, KEY_LIGHTNESS, KEY_CONTRAST_THRESHOLD, KEY_DRAWN, KEY_AREA };
+    size_t base_key = 0;
+    size_t result_key = 0;
+    if (cache) {
+        base_key = image_key(rgb, multithread);
+        for (auto v : { offset_x, offset_y, full_width, full_height, W, H }) {
+            base_key = hash_combine(base_key, v);
+        }
+        base_key = hash_combine(base_key, std::hash<double>()(scale));
+
+        result_key = hash_combine(base_key, KEY_RESULT);
+        for (auto v : { n, begin_idx, end_idx, int(Lmask != nullptr), int(abmask != nullptr) }) {
+            result_key = hash_combine(result_key, v);
+        }
+        for (int i = begin_idx; i < end_idx; ++i) {
+            result_key = hash_combine(result_key, mask_hash(masks[i]));
+        }
+
+        auto res = show_mask_idx < 0 ? cache->find(result_key) : nullptr;
+        if (res) {
+            size_t k = 0;
+            for (int i = begin_idx; i < end_idx; ++i) {
+                if (Lmask) {
+                    copy_plane((*res)[k++], (*Lmask)[i], multithread);
+                }
+                if (abmask) {
+                    copy_plane((*res)[k++], (*abmask)[i], multithread);
+                }
+            }
+            return true;
+        }
+    }
+
     bool has_lmask = false;
     for (int i = begin_idx; i < end_idx; ++i) {
         if (abmask) {
@@ -881,30 +1232,36 @@ bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x
 
     array2D<float> LL;
     if (has_lmask) {
-        LL(W, H);
+        const auto compute_LL =
+            [&]() -> bool
+            {
+                LL(W, H);
 
-        constexpr float base_posterization = 40.f;
+                constexpr float base_posterization = 40.f;
 #ifdef _OPENMP
-#       pragma omp parallel for if (multithread)
+#               pragma omp parallel for if (multithread)
 #endif
-        for (int y = 0; y < H; ++y) {
-            for (int x = 0; x < W; ++x) {
-                float a, b;
-                rgb2lab(mode, rgb->r(y, x), rgb->g(y, x), rgb->b(y, x), guide[y][x], a, b, wp);
-                guide[y][x] /= 32768.f;
-                float l = guide[y][x];
-                float ll = round(l * base_posterization) / base_posterization;
-                LL[y][x] = ll;
-                assert(std::isfinite(LL[y][x]));
-            }
-        }
-        const float radius = max(max(full_width, W), max(full_height, H)) / 30.f;
-        const float epsilon = 0.001f;
-        int r2 = 10.f / scale;
-        if (r2 > 0) {
-            rtengine::guidedFilter(guide, guide, guide, r2, 0.01f, multithread);
-        }
-        rtengine::guidedFilter(guide, LL, LL, radius, epsilon, multithread);
+                for (int y = 0; y < H; ++y) {
+                    for (int x = 0; x < W; ++x) {
+                        float a, b;
+                        rgb2lab(mode, rgb->r(y, x), rgb->g(y, x), rgb->b(y, x), guide[y][x], a, b, wp);
+                        guide[y][x] /= 32768.f;
+                        float l = guide[y][x];
+                        float ll = round(l * base_posterization) / base_posterization;
+                        LL[y][x] = ll;
+                        assert(std::isfinite(LL[y][x]));
+                    }
+                }
+                const float radius = max(max(full_width, W), max(full_height, H)) / 30.f;
+                const float epsilon = 0.001f;
+                int r2 = 10.f / scale;
+                if (r2 > 0) {
+                    rtengine::guidedFilter(guide, guide, guide, r2, 0.01f, multithread);
+                }
+                rtengine::guidedFilter(guide, LL, LL, radius, epsilon, multithread);
+                return true;
+            };
+        cached_plane(cache, hash_combine(base_key, KEY_LIGHTNESS), multithread, LL, compute_LL);
 
 #if 0
         if (W > 300) {
@@ -1081,7 +1438,19 @@ bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x
                 if ((masks[i].drawnMask.mode == DrawnMask::ADD_BOUNDED) != add_bounded) {
                     continue;
                 }
-                if (generate_drawn_mask(offset_x, offset_y, full_width, full_height, masks[i].drawnMask, guide, multithread, amask)) {
+                const auto &drawn = masks[i].drawnMask;
+                const auto gen =
+                    [&]() -> bool
+                    {
+                        return generate_drawn_mask(offset_x, offset_y, full_width, full_height, drawn, guide, multithread, amask);
+                    };
+                size_t key = 0;
+                if (cache) {
+                    Mask m;
+                    m.drawnMask = drawn;
+                    key = hash_combine(hash_combine(base_key, KEY_DRAWN), mask_hash(m));
+                }
+                if (cached_plane(cache, key, multithread, amask, gen)) {
                     const bool add = masks[i].drawnMask.mode != DrawnMask::INTERSECT;
                     const float alpha = LIM01(masks[i].drawnMask.opacity);
 #ifdef _OPENMP
@@ -1113,8 +1482,14 @@ bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x
     
 
     for (int i = begin_idx; i < end_idx; ++i) {
-        if (masks[i].parametricMask.enabled && 
-            contrast_threshold_mask(full_width, full_height, scale, guide, masks[i].parametricMask.contrastThreshold, masks[i].parametricMask.blur, multithread, amask)) {
+        const auto &pm = masks[i].parametricMask;
+        const auto gen =
+            [&]() -> bool
+            {
+                return contrast_threshold_mask(full_width, full_height, scale, guide, pm.contrastThreshold, pm.blur, multithread, amask);
+            };
+        const size_t key = hash_combine(hash_combine(hash_combine(base_key, KEY_CONTRAST_THRESHOLD), pm.contrastThreshold), std::hash<double>()(pm.blur));
+        if (pm.enabled && cached_plane(cache, key, multithread, amask, gen)) {
             bool neg = masks[i].parametricMask.contrastThreshold < 0;
 #ifdef _OPENMP
 #           pragma omp parallel for if (multithread)
@@ -1136,7 +1511,18 @@ bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x
     apply_brush(true);
     
     for (int i = begin_idx; i < end_idx; ++i) {
-        if (generate_area_mask(offset_x, offset_y, full_width, full_height, guide, masks[i].areaMask, scale, multithread, amask, plistener)) {
+        const auto gen =
+            [&]() -> bool
+            {
+                return generate_area_mask(offset_x, offset_y, full_width, full_height, guide, masks[i].areaMask, scale, multithread, amask, plistener);
+            };
+        size_t key = 0;
+        if (cache) {
+            Mask m;
+            m.areaMask = masks[i].areaMask;
+            key = hash_combine(hash_combine(base_key, KEY_AREA), mask_hash(m));
+        }
+        if (cached_plane(cache, key, multithread, amask, gen)) {
 #ifdef _OPENMP
 #           pragma omp parallel for if (multithread)
 #endif
@@ -1231,6 +1617,20 @@ bool generateMasks(Imagefloat *rgb, const std::vector<Mask> &masks, int offset_x
         return false;
     }
 
+    if (cache) {
+        std::vector<array2D<float>> planes((end_idx - begin_idx) * (int(Lmask != nullptr) + int(abmask != nullptr)));
+        size_t k = 0;
+        for (int i = begin_idx; i < end_idx; ++i) {
+            if (Lmask) {
+                copy_plane((*Lmask)[i], planes[k++], multithread);
+            }
+            if (abmask) {
+                copy_plane((*abmask)[i], planes[k++], multithread);
+            }
+        }
+        cache->insert(result_key, std::move(planes));
+    }
+
     return true;
 }
 
@@ -1273,6 +1673,50 @@ void fillPipetteMasks(Imagefloat *rgb, PlanarWhateverData<float> *editWhatever,
 }
 
 
+bool getMaskRegion(const array2D<float> &mask, int &min_x, int &min_y, int &max_x, int &max_y, bool multithread)
+{
+    const int W = mask.width();
+    const int H = mask.height();
+
+    int x0 = W;
+    int y0 = H;
+    int x1 = 0;
+    int y1 = 0;
+
+#ifdef _OPENMP
+#   pragma omp parallel for reduction(min:x0,y0) reduction(max:x1,y1) if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        const float *row = mask[y];
+        int x = 0;
+        while (x < W && !(row[x] > 0.f)) {
+            ++x;
+        }
+        if (x == W) {
+            continue;
+        }
+        int xe = W;
+        while (!(row[xe - 1] > 0.f)) {
+            --xe;
+        }
+        x0 = std::min(x0, x);
+        x1 = std::max(x1, xe);
+        y0 = std::min(y0, y);
+        y1 = std::max(y1, y + 1);
+    }
+
+    if (x1 <= x0) {
+        min_x = min_y = max_x = max_y = 0;
+        return false;
+    }
+    min_x = x0;
+    min_y = y0;
+    max_x = x1;
+    max_y = y1;
+    return true;
+}
+
+
 bool getDeltaEColor(Imagefloat *rgb, int x, int y, int offset_x, int offset_y, int full_width, int full_height, double scale, float &L, float &C, float &H)
 {
     std::vector<float> med_L, med_a, med_b;
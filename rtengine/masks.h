@@ -24,11 +24,54 @@
 #include "array2D.h"
 #include "labimage.h"
 #include "imagefloat.h"
+#include "noncopyable.h"
 
 
 namespace rtengine {
 
-bool generateMasks(Imagefloat *rgb, const std::vector<procparams::Mask> &masks, int offset_x, int offset_y, int full_width, int full_height, double scale, bool multithread, int show_mask_idx, std::vector<array2D<float>> *Lmask, std::vector<array2D<float>> *abmask, ProgressListener *pl);
+/*
+ * Cache of the planes computed by generateMasks(), shared by all the tools
+ * of an interactive pipeline (it is owned by its PipelineCache).
+ *
+ * The keys are built from the contents of the input image, the geometry
+ * (viewport and scale) and the mask definitions, so that identical masks
+ * used by different tools, or by subsequent updates of the same tool that
+ * don't change the mask or the pixels upstream, are computed only once.
+ * Besides the final masks, the cache also holds their building blocks
+ * (the smoothed lightness guide and the area, drawn and contrast threshold
+ * masks), which can be reused when only a part of a mask changes.
+ * The least recently used planes are evicted first.
+ */
+class MaskCache: public NonCopyable {
+public:
+    explicit MaskCache(size_t max_entries=16);
+
+    void clear();
+    size_t getSize() const;
+
+    const std::vector<array2D<float>> *find(size_t key);
+    void insert(size_t key, std::vector<array2D<float>> &&planes);
+
+private:
+    struct Entry {
+        size_t key;
+        size_t stamp;
+        std::vector<array2D<float>> planes;
+    };
+
+    const size_t max_entries_;
+    std::vector<Entry> entries_;
+    size_t clock_;
+};
+
+
+bool generateMasks(Imagefloat *rgb, const std::vector<procparams::Mask> &masks, int offset_x, int offset_y, int full_width, int full_height, double scale, bool multithread, int show_mask_idx, std::vector<array2D<float>> *Lmask, std::vector<array2D<float>> *abmask, ProgressListener *pl, MaskCache *cache=nullptr);
+
+// bounding box [min_x, max_x) x [min_y, max_y) of the pixels of a mask
+// generated by generateMasks() that are not zero. Outside of it, the tool
+// using the mask leaves the image untouched, so it can limit its work to the
+// box. Returns false (and an empty box) if the mask is zero everywhere
+bool getMaskRegion(const array2D<float> &mask, int &min_x, int &min_y, int &max_x, int &max_y, bool multithread);
 
 enum class MasksEditID { H = 0, C, L };
 void fillPipetteMasks(Imagefloat *rgb, PlanarWhateverData<float> *editWhatever, MasksEditID id, bool multithread);
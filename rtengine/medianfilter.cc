@@ -0,0 +1,269 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "medianfilter.h"
+#include "rt_math.h"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace rtengine {
+
+namespace {
+
+typedef uint16_t hist_t;
+
+constexpr int TIER_BITS = 7;
+constexpr int BINS = 1 << TIER_BITS; // bins of each tier
+constexpr int LEVELS = BINS * BINS;  // quantisation levels
+
+// size of the blocks processed by each thread: the column histograms are
+// shared by all the rows of a block, and cost LEVELS * sizeof(hist_t) bytes
+// each, so the blocks are narrow and tall
+constexpr int TILE_W = 64;
+constexpr int TILE_H = 512;
+
+
+// dst += add (- sub), for a BINS-sized histogram
+inline void hist_add(hist_t *dst, const hist_t *add)
+{
+#ifdef __SSE2__
+    for (int i = 0; i < BINS; i += 8) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        d = _mm_add_epi16(d, _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), d);
+    }
+#else
+    for (int i = 0; i < BINS; ++i) {
+        dst[i] += add[i];
+    }
+#endif
+}
+
+
+inline void hist_add_sub(hist_t *dst, const hist_t *add, const hist_t *sub)
+{
+#ifdef __SSE2__
+    for (int i = 0; i < BINS; i += 8) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        d = _mm_add_epi16(d, _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i)));
+        d = _mm_sub_epi16(d, _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), d);
+    }
+#else
+    for (int i = 0; i < BINS; ++i) {
+        dst[i] += add[i] - sub[i];
+    }
+#endif
+}
+
+
+class MedianTile {
+public:
+    explicit MedianTile(int radius):
+        r_(radius),
+        coarse_((TILE_W + 2 * radius) * BINS),
+        fine_(size_t(TILE_W + 2 * radius) * LEVELS),
+        kcoarse_(BINS),
+        kfine_(LEVELS),
+        synced_(BINS),
+        xs_(TILE_W + 2 * radius)
+    {
+    }
+
+    void operator()(const array2D<hist_t> &q, array2D<float> &dst, int x0, int x1, int y0, int y1, float lo, float step)
+    {
+        const int W = q.width();
+        const int H = q.height();
+        const int d = 2 * r_ + 1;
+        const int nc = x1 - x0 + 2 * r_;
+        const int half = d * d / 2;
+
+        for (int c = 0; c < nc; ++c) {
+            xs_[c] = LIM(x0 - r_ + c, 0, W - 1);
+        }
+
+        std::fill(coarse_.begin(), coarse_.begin() + nc * BINS, 0);
+        std::fill(fine_.begin(), fine_.begin() + size_t(nc) * LEVELS, 0);
+
+        for (int y = y0 - r_; y <= y0 + r_; ++y) {
+            const hist_t *row = q[LIM(y, 0, H - 1)];
+            for (int c = 0; c < nc; ++c) {
+                const hist_t v = row[xs_[c]];
+                ++coarse_[c * BINS + (v >> TIER_BITS)];
+                ++fine_[size_t(c) * LEVELS + v];
+            }
+        }
+
+        for (int y = y0; y < y1; ++y) {
+            if (y > y0) {
+                // move the column histograms one row down
+                const int yout = LIM(y - r_ - 1, 0, H - 1);
+                const int yin = LIM(y + r_, 0, H - 1);
+                if (yout != yin) {
+                    const hist_t *rout = q[yout];
+                    const hist_t *rin = q[yin];
+                    for (int c = 0; c < nc; ++c) {
+                        const hist_t vo = rout[xs_[c]];
+                        const hist_t vi = rin[xs_[c]];
+                        --coarse_[c * BINS + (vo >> TIER_BITS)];
+                        --fine_[size_t(c) * LEVELS + vo];
+                        ++coarse_[c * BINS + (vi >> TIER_BITS)];
+                        ++fine_[size_t(c) * LEVELS + vi];
+                    }
+                }
+            }
+
+            std::fill(kcoarse_.begin(), kcoarse_.end(), 0);
+            for (int c = 0; c < d; ++c) {
+                hist_add(&kcoarse_[0], &coarse_[c * BINS]);
+            }
+            std::fill(synced_.begin(), synced_.end(), -1);
+
+            float *out = dst[y];
+
+            for (int k = 0, x = x0; x < x1; ++k, ++x) {
+                if (k > 0) {
+                    hist_add_sub(&kcoarse_[0], &coarse_[(k + d - 1) * BINS], &coarse_[(k - 1) * BINS]);
+                }
+
+                int rank = half;
+                int cb = 0;
+                while (rank >= kcoarse_[cb]) {
+                    rank -= kcoarse_[cb];
+                    ++cb;
+                }
+
+                // bring the fine histogram of the coarse bin up to date,
+                // either incrementally or from scratch, whatever is cheaper
+                hist_t *seg = &kfine_[cb * BINS];
+                const int last = synced_[cb];
+                if (last < 0 || 2 * (k - last) > d) {
+                    std::fill(seg, seg + BINS, 0);
+                    for (int c = k; c < k + d; ++c) {
+                        hist_add(seg, &fine_[size_t(c) * LEVELS + cb * BINS]);
+                    }
+                } else {
+                    for (int c = last + 1; c <= k; ++c) {
+                        hist_add_sub(seg, &fine_[size_t(c + d - 1) * LEVELS + cb * BINS], &fine_[size_t(c - 1) * LEVELS + cb * BINS]);
+                    }
+                }
+                synced_[cb] = k;
+
+                int fb = 0;
+                while (rank >= seg[fb]) {
+                    rank -= seg[fb];
+                    ++fb;
+                }
+
+                out[x] = lo + ((cb << TIER_BITS) + fb) * step;
+            }
+        }
+    }
+
+private:
+    const int r_;
+    std::vector<hist_t> coarse_; // per-column coarse histograms
+    std::vector<hist_t> fine_;   // per-column fine histograms
+    std::vector<hist_t> kcoarse_; // kernel histograms
+    std::vector<hist_t> kfine_;
+    std::vector<int> synced_; // column at which each fine kernel segment was last updated
+    std::vector<int> xs_;
+};
+
+} // namespace
+
+
+void medianFilter(const array2D<float> &src, array2D<float> &dst, int radius, bool multithread)
+{
+    const int W = src.width();
+    const int H = src.height();
+
+    if (&dst != &src && (dst.width() != W || dst.height() != H)) {
+        dst(W, H);
+    }
+
+    radius = LIM(radius, 0, MEDIAN_FILTER_MAX_RADIUS);
+
+    float lo = RT_INFINITY_F;
+    float hi = -RT_INFINITY_F;
+
+#ifdef _OPENMP
+#   pragma omp parallel for reduction(min:lo) reduction(max:hi) if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            lo = std::min(lo, src[y][x]);
+            hi = std::max(hi, src[y][x]);
+        }
+    }
+
+    if (radius == 0 || !(hi > lo)) {
+        if (&dst != &src) {
+#ifdef _OPENMP
+#           pragma omp parallel for if (multithread)
+#endif
+            for (int y = 0; y < H; ++y) {
+                std::copy(src[y], src[y] + W, dst[y]);
+            }
+        }
+        return;
+    }
+
+    array2D<hist_t> q(W, H);
+    const float qscale = (LEVELS - 1) / (hi - lo);
+
+#ifdef _OPENMP
+#   pragma omp parallel for if (multithread)
+#endif
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            q[y][x] = hist_t((src[y][x] - lo) * qscale + 0.5f);
+        }
+    }
+
+    const float step = (hi - lo) / (LEVELS - 1);
+    const int ntx = (W + TILE_W - 1) / TILE_W;
+    const int nty = (H + TILE_H - 1) / TILE_H;
+
+#ifdef _OPENMP
+#   pragma omp parallel if (multithread)
+#endif
+    {
+        MedianTile tile(radius);
+
+#ifdef _OPENMP
+#       pragma omp for collapse(2) schedule(dynamic)
+#endif
+        for (int ty = 0; ty < nty; ++ty) {
+            for (int tx = 0; tx < ntx; ++tx) {
+                const int x0 = tx * TILE_W;
+                const int y0 = ty * TILE_H;
+                tile(q, dst, x0, std::min(x0 + TILE_W, W), y0, std::min(y0 + TILE_H, H), lo, step);
+            }
+        }
+    }
+}
+
+} // namespace rtengine
@@ -0,0 +1,47 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "array2D.h"
+
+namespace rtengine {
+
+/*
+ * Median filter over a (2 * radius + 1)^2 square window, with a cost per
+ * pixel that is (mostly) independent of the radius.
+ *
+ * This is the algorithm of Perreault and Hebert, "Median Filtering in
+ * Constant Time" (IEEE TIP 2007): the values are quantised to 14 bits and
+ * kept in two-tier (coarse/fine) histograms with 16-bit counters, one per
+ * column plus one for the kernel; the coarse kernel histogram is updated
+ * with vector adds when moving right, and the fine ones are updated lazily,
+ * only for the coarse bin that contains the median. Borders are handled by
+ * replicating the edge pixels.
+ *
+ * The result is quantised to 1/16384 of the range of the input, so this is
+ * meant for the large radii for which the sorting networks of median.h are
+ * not usable. The radius is limited to 127. src and dst can be the same.
+ */
+void medianFilter(const array2D<float> &src, array2D<float> &dst, int radius, bool multithread);
+
+constexpr int MEDIAN_FILTER_MAX_RADIUS = 127;
+
+} // namespace rtengine
@@ -111,6 +111,21 @@ void clear_metadata_key(Data &data, const Key &key)
     }
 }
 
+// the XMP toolkit used by exiv2 is not thread-safe: images are saved (and
+// their metadata embedded) from several threads at once, so exiv2 has to
+// serialize its accesses to it
+std::recursive_mutex xmp_mutex;
+
+void xmp_lock(void *data, bool lock)
+{
+    auto m = static_cast<std::recursive_mutex *>(data);
+    if (lock) {
+        m->lock();
+    } else {
+        m->unlock();
+    }
+}
+
 Glib::ustring exiftool_base_dir;
 #ifdef WIN32
   const Glib::ustring exiftool_default = "exiftool.exe";
@@ -824,7 +839,7 @@ void Exiv2Metadata::init(const Glib::ustring &base_dir, const Glib::ustring &use
     exiftool_config_dir = user_dir;
     exiftool_.reset(new Exiftool());
     
-    Exiv2::XmpParser::initialize();
+    Exiv2::XmpParser::initialize(xmp_lock, &xmp_mutex);
     Exiv2::XmpProperties::registerNs("us/pixls/ART/", "ART");
 #ifdef EXV_ENABLE_BMFF
     Exiv2::enableBMFF(true);
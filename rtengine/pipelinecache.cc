@@ -0,0 +1,116 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipelinecache.h"
+
+namespace rtengine {
+
+PipelineCache::PipelineCache(bool half_float):
+    half_float_(half_float),
+    serial_(0)
+{
+    clear();
+}
+
+
+void PipelineCache::clear()
+{
+    for (int i = 0; i < CP_COUNT; ++i) {
+        drop(Checkpoint(i));
+    }
+    for (auto &k : keys_) {
+        k = ++serial_;
+    }
+    masks_.clear();
+}
+
+
+size_t PipelineCache::getSize() const
+{
+    size_t ret = 0;
+    for (auto &e : entries_) {
+        if (e.img) {
+            ret += size_t(e.img->getWidth()) * size_t(e.img->getHeight()) * 3 * sizeof(float);
+        }
+        ret += e.himg.getSize();
+    }
+    ret += masks_.getSize();
+    return ret;
+}
+
+
+size_t PipelineCache::getInputKey(int stage) const
+{
+    return keys_[stage];
+}
+
+
+void PipelineCache::setOutputKey(int stage, size_t key)
+{
+    keys_[stage+1] = key;
+}
+
+
+void PipelineCache::invalidateOutput(int stage)
+{
+    keys_[stage+1] = ++serial_;
+}
+
+
+bool PipelineCache::restore(Checkpoint cp, size_t key, Imagefloat *dst, bool multithread) const
+{
+    auto &e = entries_[cp];
+    if (!e.valid || e.key != key) {
+        return false;
+    }
+    if (half_float_) {
+        e.himg.restore(dst, multithread);
+    } else {
+        e.img->copyTo(dst);
+    }
+    return true;
+}
+
+
+void PipelineCache::store(Checkpoint cp, size_t key, const Imagefloat *src, bool multithread)
+{
+    auto &e = entries_[cp];
+    if (half_float_) {
+        e.himg.store(src, multithread);
+    } else {
+        if (!e.img) {
+            e.img.reset(new Imagefloat());
+        }
+        src->copyTo(e.img.get());
+    }
+    e.key = key;
+    e.valid = true;
+}
+
+
+void PipelineCache::drop(Checkpoint cp)
+{
+    auto &e = entries_[cp];
+    e.valid = false;
+    e.img.reset();
+    e.himg.clear();
+}
+
+} // namespace rtengine
@@ -0,0 +1,88 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "imagefloat.h"
+#include "halfimagefloat.h"
+#include "masks.h"
+#include "noncopyable.h"
+#include <array>
+#include <memory>
+
+namespace rtengine {
+
+/*
+ * Intermediate results of an interactive pipeline (ImProcCoordinator or
+ * Crop), saved by ImProcFunctions::process after the expensive steps.
+ *
+ * Each checkpoint is tagged with a key that combines the key of the stage
+ * input with the hashes of the parameters read by all the steps up to the
+ * checkpoint. When a stage is re-run, processing resumes from the last
+ * checkpoint whose key is still valid.
+ *
+ * It also owns the cache of the masks generated by the tools of the
+ * pipeline.
+ */
+class PipelineCache: public NonCopyable {
+public:
+    enum Checkpoint {
+        CP_COLORCORRECTION = 0, // stage 2, after colorCorrection
+        CP_STAGE_2_END,         // stage 2, after guidedSmoothing
+        CP_TEXTUREBOOST,        // stage 3, after textureBoost
+        CP_COUNT
+    };
+
+    explicit PipelineCache(bool half_float=false);
+
+    void clear();
+    size_t getSize() const;
+
+    // key of the input of the given stage
+    size_t getInputKey(int stage) const;
+    // key of the output of the given stage (i.e. the input of the next one)
+    void setOutputKey(int stage, size_t key);
+    // marks the output of the given stage as new and unknown
+    void invalidateOutput(int stage);
+
+    bool restore(Checkpoint cp, size_t key, Imagefloat *dst, bool multithread) const;
+    void store(Checkpoint cp, size_t key, const Imagefloat *src, bool multithread);
+    void drop(Checkpoint cp);
+
+    MaskCache &masks() { return masks_; }
+
+private:
+    struct Entry {
+        bool valid;
+        size_t key;
+        std::unique_ptr<Imagefloat> img;
+        HalfImagefloat himg;
+
+        Entry(): valid(false), key(0) {}
+    };
+
+    const bool half_float_;
+    std::array<Entry, CP_COUNT> entries_;
+    std::array<size_t, 5> keys_;
+    size_t serial_;
+    MaskCache masks_;
+};
+
+} // namespace rtengine
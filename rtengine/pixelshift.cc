@@ -21,6 +21,7 @@
 ////////////////////////////////////////////////////////////////
 
 #include <cmath>
+#include <vector>
 #include "rawimagesource.h"
 #include "../rtgui/multilangmgr.h"
 #include "procparams.h"
@@ -28,6 +29,7 @@
 #include "median.h"
 //#define BENCHMARK
 #include "StopWatch.h"
+#include "trace.h"
 
 using namespace std;
 using namespace rtengine;
@@ -76,196 +78,157 @@ void paintMotionMask(int index, bool showMotion, float *maskDest, float *nonMask
     }
 }
 
-void invertMask(int xStart, int xEnd, int yStart, int yEnd, const array2D<uint8_t> &maskIn, array2D<uint8_t> &maskOut)
+// Fills the holes of the motion mask, i.e. sets to 255 the pixels with a
+// value of 0 which are not 4-connected to the border of the area through
+// pixels with a value of 0. The runs of 0 values of each row are labelled
+// band by band in parallel with a union-find, then the bands are stitched
+// together, so that the work is spread over all threads and the memory
+// needed scales with the number of runs instead of the size of the mask.
+void fillHoles(int xStart, int xEnd, int yStart, int yEnd, array2D<uint8_t> &mask)
 {
-#ifdef _OPENMP
-    #pragma omp parallel for schedule(dynamic,16)
-#endif
+    if(xStart >= xEnd || yStart >= yEnd) {
+        return;
+    }
 
-    for(int i = yStart; i < yEnd; ++i) {
-#ifdef _OPENMP
-        #pragma omp simd
-#endif
+    struct Run {
+        int start;
+        int end;
+    };
 
-        for(int j = xStart; j < xEnd; ++j) {
-            maskOut[i][j] = ~maskIn[i][j];
-        }
-    }
-}
+    const int height = yEnd - yStart;
+    std::vector<std::vector<Run>> rowRuns(height);
 
-void xorMasks(int xStart, int xEnd, int yStart, int yEnd, const array2D<uint8_t> &maskIn, array2D<uint8_t> &maskOut)
-{
 #ifdef _OPENMP
     #pragma omp parallel for schedule(dynamic,16)
 #endif
 
-    for(int i = yStart; i < yEnd; ++i) {
-#ifdef _OPENMP
-        #pragma omp simd
-#endif
+    for(int i = 0; i < height; ++i) {
+        const uint8_t *row = mask[yStart + i];
 
-        for(int j = xStart; j < xEnd; ++j) {
-            maskOut[i][j] ^= maskIn[i][j];
+        for(int j = xStart; j < xEnd;) {
+            if(row[j]) {
+                ++j;
+            } else {
+                const int start = j;
+
+                while(j < xEnd && !row[j]) {
+                    ++j;
+                }
+
+                rowRuns[i].push_back({start, j});
+            }
         }
     }
-}
 
-void floodFill4Impl(int y, int x, int xStart, int xEnd, int yStart, int yEnd, array2D<uint8_t> &mask, std::stack<std::pair<uint16_t, uint16_t>, std::vector<std::pair<uint16_t, uint16_t>>> &coordStack)
-{
-    coordStack.emplace(x, y);
+    std::vector<size_t> rowOffset(height + 1);
+    rowOffset[0] = 0;
 
-    while(!coordStack.empty()) {
-        auto coord = coordStack.top();
-        coordStack.pop();
-        auto x = coord.first, y = coord.second;
+    for(int i = 0; i < height; ++i) {
+        rowOffset[i + 1] = rowOffset[i] + rowRuns[i].size();
+    }
 
-        if(mask[y][x] == 255) {
-            auto yUp = y - 1, yDown = y + 1;
-            bool lastXUp = false, lastXDown = false, firstXUp = false, firstXDown = false;
-            mask[y][x] = 0;
+    // a root is always the run with the lowest index of its component
+    std::vector<uint32_t> parent(rowOffset[height]);
 
-            if(yUp >= yStart && mask[yUp][x] == 255) {
-                coordStack.emplace(x, yUp);
-                firstXUp = lastXUp = true;
-            }
+    for(size_t k = 0; k < parent.size(); ++k) {
+        parent[k] = k;
+    }
 
-            if(yDown < yEnd && mask[yDown][x] == 255) {
-                coordStack.emplace(x, yDown);
-                firstXDown = lastXDown = true;
+    const auto find =
+        [&](uint32_t k) -> uint32_t
+        {
+            while(parent[k] != k) {
+                parent[k] = parent[parent[k]];
+                k = parent[k];
             }
 
-            auto xr = x + 1;
-
-            while(xr < xEnd && mask[y][xr] == 255) {
-                mask[y][xr] = 0;
+            return k;
+        };
 
-                if(yUp >= yStart && mask[yUp][xr] == 255) {
-                    if(!lastXUp) {
-                        coordStack.emplace(xr, yUp);
-                        lastXUp = true;
-                    }
-                } else {
-                    lastXUp = false;
-                }
+    // joins the overlapping runs of row i and of the row above
+    const auto joinRows =
+        [&](int i) -> void
+        {
+            const std::vector<Run> &above = rowRuns[i - 1];
+            const std::vector<Run> &cur = rowRuns[i];
+            size_t a = 0;
 
-                if(yDown < yEnd && mask[yDown][xr] == 255) {
-                    if(!lastXDown) {
-                        coordStack.emplace(xr, yDown);
-                        lastXDown = true;
-                    }
-                } else {
-                    lastXDown = false;
+            for(size_t c = 0; c < cur.size(); ++c) {
+                while(a < above.size() && above[a].end <= cur[c].start) {
+                    ++a;
                 }
 
-                xr++;
-            }
-
-            auto xl = x - 1;
-            lastXUp = firstXUp;
-            lastXDown = firstXDown;
-
-            while(xl >= xStart && mask[y][xl] == 255) {
-                mask[y][xl] = 0;
+                for(size_t b = a; b < above.size() && above[b].start < cur[c].end; ++b) {
+                    const uint32_t r1 = find(rowOffset[i - 1] + b);
+                    const uint32_t r2 = find(rowOffset[i] + c);
 
-                if(yUp >= yStart && mask[yUp][xl] == 255) {
-                    if(!lastXUp) {
-                        coordStack.emplace(xl, yUp);
-                        lastXUp = true;
+                    if(r1 < r2) {
+                        parent[r2] = r1;
+                    } else if(r2 < r1) {
+                        parent[r1] = r2;
                     }
-                } else {
-                    lastXUp = false;
                 }
+            }
+        };
 
-                if(yDown < yEnd && mask[yDown][xl] == 255) {
-                    if(!lastXDown) {
-                        coordStack.emplace(xl, yDown);
-                        lastXDown = true;
-                    }
-                } else {
-                    lastXDown = false;
-                }
+    constexpr int bandHeight = 64;
 
-                xl--;
-            }
+    // the unions inside a band touch only the runs of the band
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
 
-            mask[y][x] = 0;
+    for(int band = 0; band < height; band += bandHeight) {
+        for(int i = band + 1; i < std::min(band + bandHeight, height); ++i) {
+            joinRows(i);
         }
     }
-}
 
-void floodFill4(int xStart, int xEnd, int yStart, int yEnd, array2D<uint8_t> &mask)
-{
-#ifdef _OPENMP
-    #pragma omp parallel
-#endif
-    {
-        std::stack<std::pair<uint16_t, uint16_t>, std::vector<std::pair<uint16_t, uint16_t>>> coordStack;
+    for(int band = bandHeight; band < height; band += bandHeight) {
+        joinRows(band);
+    }
 
-#ifdef _OPENMP
-        #pragma omp for schedule(dynamic,128) nowait
-#endif
+    // as parents have lower indices than their children, a single pass
+    // in index order links every run to its root
+    for(size_t k = 0; k < parent.size(); ++k) {
+        parent[k] = parent[parent[k]];
+    }
 
-        for(uint16_t i = yStart; i < yEnd; i++)
-        {
-            floodFill4Impl(i, xStart, xStart, xEnd, yStart, yEnd, mask, coordStack);
-        }
+    std::vector<uint8_t> atBorder(parent.size(), 0);
 
-#ifdef _OPENMP
-        #pragma omp for schedule(dynamic,128) nowait
-#endif
+    for(int i = 0; i < height; ++i) {
+        const std::vector<Run> &runs = rowRuns[i];
 
-        for(int16_t i = yEnd - 1; i >= 0 ; i--)
-        {
-            floodFill4Impl(i, xEnd - 1, xStart, xEnd, yStart, yEnd, mask, coordStack);
+        if(runs.empty()) {
+            continue;
         }
 
-#ifdef _OPENMP
-        #pragma omp sections nowait
-#endif
-        {
-#ifdef _OPENMP
-            #pragma omp section
-#endif
-            {
-                uint16_t i = yStart;
-
-                for(uint16_t j = xStart; j < xEnd; j++)
-                {
-                    floodFill4Impl(i, j, xStart, xEnd, yStart, yEnd, mask, coordStack);
-                }
+        if(i == 0 || i == height - 1) {
+            for(size_t c = 0; c < runs.size(); ++c) {
+                atBorder[parent[rowOffset[i] + c]] = 1;
             }
-#ifdef _OPENMP
-            #pragma omp section
-#endif
-            {
-                uint16_t i = yStart;
-
-                for(uint16_t j = xEnd - 1; j >= xStart; j--)
-                {
-                    floodFill4Impl(i, j, xStart, xEnd, yStart, yEnd, mask, coordStack);
-                }
+        } else {
+            if(runs.front().start == xStart) {
+                atBorder[parent[rowOffset[i]]] = 1;
             }
-#ifdef _OPENMP
-            #pragma omp section
-#endif
-            {
-                uint16_t i = yEnd;
 
-                for(uint16_t j = xStart; j < xEnd; j++)
-                {
-                    floodFill4Impl(i, j, xStart, xEnd, yStart, yEnd, mask, coordStack);
-                }
+            if(runs.back().end == xEnd) {
+                atBorder[parent[rowOffset[i] + runs.size() - 1]] = 1;
             }
+        }
+    }
+
 #ifdef _OPENMP
-            #pragma omp section
+    #pragma omp parallel for schedule(dynamic,16)
 #endif
-            {
-                uint16_t i = yEnd;
 
-                for(uint16_t j = xEnd - 1; j >= xStart; j--)
-                {
-                    floodFill4Impl(i, j, xStart, xEnd, yStart, yEnd, mask, coordStack);
-                }
+    for(int i = 0; i < height; ++i) {
+        uint8_t *row = mask[yStart + i];
+        const std::vector<Run> &runs = rowRuns[i];
+
+        for(size_t c = 0; c < runs.size(); ++c) {
+            if(!atBorder[parent[rowOffset[i] + c]]) {
+                std::fill(row + runs[c].start, row + runs[c].end, 255);
             }
         }
     }
@@ -299,6 +262,7 @@ void calcFrameBrightnessFactor(unsigned int frame, uint32_t datalen, LUTu *histo
 void RawImageSource::pixelshift(int winx, int winy, int winw, int winh, const RAWParams &rawParamsIn, unsigned int frame, const std::string &make, const std::string &model, float rawWpCorrection)
 {
 BENCHFUN
+    TRACE_FUN("demosaic");
     if(numFrames != 4) { // fallback for non pixelshift files
         amaze_demosaic_RT(winx, winy, winw, winh, rawData, red, green, blue);
         return;
@@ -704,48 +668,6 @@ BENCHFUN
 
 
     if(motionDetection) {
-        // fill channels psRed and psBlue
-        array2D<float> psRed(winw + 32, winh); // increase width to avoid cache conflicts
-        array2D<float> psBlue(winw + 32, winh);
-
-#ifdef _OPENMP
-        #pragma omp parallel for schedule(dynamic,16)
-#endif
-
-        for(int i = winy + 1; i < winh - 1; ++i) {
-            float *nonGreenDest0 = psRed[i];
-            float *nonGreenDest1 = psBlue[i];
-            float ngbright[2][4] = {{redBrightness[0], redBrightness[1], redBrightness[2], redBrightness[3]},
-                                    {blueBrightness[0], blueBrightness[1], blueBrightness[2], blueBrightness[3]}
-                                   };
-            int ng = 0;
-            int j = winx + 1;
-            int c = FC(i, j);
-
-            if((c + FC(i, j + 1)) == 3) {
-                // row with blue pixels => swap destination pointers for non green pixels
-                std::swap(nonGreenDest0, nonGreenDest1);
-                ng ^= 1;
-            }
-
-            // offset to keep the code short. It changes its value between 0 and 1 for each iteration of the loop
-            unsigned int offset = c & 1;
-
-            for(; j < winw - 1; ++j) {
-                // store the non green values from the 4 frames into 2 temporary planes
-                nonGreenDest0[j] = (*rawDataFrames[(offset << 1) + offset])[i][j + offset] * ngbright[ng][(offset << 1) + offset];
-                nonGreenDest1[j] = (*rawDataFrames[2 - offset])[i + 1][j - offset + 1] * ngbright[ng ^ 1][2 - offset];
-                offset ^= 1; // 0 => 1 or 1 => 0
-            }
-        }
-
-        if(plistener) {
-            plistener->setProgress(0.3);
-        }
-
-        // now that the temporary planes are filled for easy access we do the motion detection
-        array2D<float> psMask(winw, winh);
-
         int offsX = 0, offsY = 0;
 
         if(!bayerParams.pixelShiftMedian) {
@@ -770,51 +692,192 @@ BENCHFUN
             }
         }
 
+        const int xStart = winx + border - offsX;
+        const int xEnd = winw - (border + offsX);
+        const int yStart = winy + border - offsY;
+        const int yEnd = winh - (border + offsY);
+
+        const float ngbright[2][4] = {{redBrightness[0], redBrightness[1], redBrightness[2], redBrightness[3]},
+                                      {blueBrightness[0], blueBrightness[1], blueBrightness[2], blueBrightness[3]}
+                                     };
+
+        // The frames are processed in bands of rows. The non green values
+        // of the 4 frames (psRed and psBlue) are computed per band in
+        // buffers of each thread, so that only the motion mask is kept for
+        // the whole frame (and the float mask only when it has to be
+        // blurred)
+        constexpr int bandHeight = 64;
+        constexpr int halo = 2;
+
+        // store the non green values of row i from the 4 frames into psRed and psBlue
+        const auto fillNonGreen =
+            [&](int i, float *nonGreenDest0, float *nonGreenDest1) -> void
+            {
+                int ng = 0;
+                int j = winx + 1;
+                int c = FC(i, j);
+
+                if((c + FC(i, j + 1)) == 3) {
+                    // row with blue pixels => swap destination pointers for non green pixels
+                    std::swap(nonGreenDest0, nonGreenDest1);
+                    ng ^= 1;
+                }
+
+                // offset to keep the code short. It changes its value between 0 and 1 for each iteration of the loop
+                unsigned int offset = c & 1;
+
+                for(; j < winw - 1; ++j) {
+                    nonGreenDest0[j] = (*rawDataFrames[(offset << 1) + offset])[i][j + offset] * ngbright[ng][(offset << 1) + offset];
+                    nonGreenDest1[j] = (*rawDataFrames[2 - offset])[i + 1][j - offset + 1] * ngbright[ng ^ 1][2 - offset];
+                    offset ^= 1; // 0 => 1 or 1 => 0
+                }
+            };
+
+        // fill the band buffers with the rows [rowStart - halo, rowEnd + halo)
+        const auto fillBand =
+            [&](int rowStart, int rowEnd, array2D<float> &psRed, array2D<float> &psBlue) -> void
+            {
+                for(int i = rowStart - halo; i < rowEnd + halo; ++i) {
+                    const int k = i - rowStart + halo;
+
+                    if(i >= winy + 1 && i < winh - 1) {
+                        fillNonGreen(i, psRed[k], psBlue[k]);
+                    } else {
+                        std::fill(psRed[k], psRed[k] + winw, 0.f);
+                        std::fill(psBlue[k], psBlue[k] + winw, 0.f);
+                    }
+                }
+            };
+
+        // motion detection for row i. psRed and psBlue point to the rows i
+        const auto detectMotion =
+            [&](int i, const float *const *psRed, const float *const *psBlue, float *psMask) -> void
+            {
+                // offset to keep the code short. It changes its value between 0 and 1 for each iteration of the loop
+                unsigned int offset = FC(i, xStart) & 1;
+
+                for(int j = xStart; j < xEnd; ++j, offset ^= 1) {
+                    psMask[j] = noMotion;
+
+                    if(checkGreen) {
+                        if(greenDiff((*rawDataFrames[1 - offset])[i - offset + 1][j] * greenBrightness[1 - offset], (*rawDataFrames[3 - offset])[i + offset][j + 1] * greenBrightness[3 - offset], stddevFactorGreen, eperIsoGreen, nRead, prnu) > 0.f) {
+                            psMask[j] = greenWeight;
+                            // do not set the motion pixel values. They have already been set by demosaicer
+                            continue;
+                        }
+                    }
+
+                    if(checkNonGreenCross) {
+                        // check red cross
+                        float redTop    = psRed[-1][j];
+                        float redLeft   = psRed[0][j - 1];
+                        float redCentre = psRed[0][j];
+                        float redRight  = psRed[0][j + 1];
+                        float redBottom = psRed[1][j];
+                        float redDiff   = nonGreenDiffCross(redRight, redLeft, redTop, redBottom, redCentre, clippedRed, stddevFactorRed, eperIsoRed, nRead, prnu);
+
+                        if(redDiff > 0.f) {
+                            psMask[j] = redBlueWeight;
+                            continue;
+                        }
+
+                        // check blue cross
+                        float blueTop    = psBlue[-1][j];
+                        float blueLeft   = psBlue[0][j - 1];
+                        float blueCentre = psBlue[0][j];
+                        float blueRight  = psBlue[0][j + 1];
+                        float blueBottom = psBlue[1][j];
+                        float blueDiff   = nonGreenDiffCross(blueRight, blueLeft, blueTop, blueBottom, blueCentre, clippedBlue, stddevFactorBlue, eperIsoBlue, nRead, prnu);
+
+                        if(blueDiff > 0.f) {
+                            psMask[j] = redBlueWeight;
+                            continue;
+                        }
+                    }
+                }
+            };
+
+        // mark row i as motion where the 3x3 sum of psMask reaches the
+        // threshold. psMask points to the row i
+        const auto thresholdMotion =
+            [&](const float *const *psMask, uint8_t *mask) -> void
+            {
+                int j = xStart;
+                float v3sum[3] = {0.f};
+
+                for(int v = -1; v <= 1; v++) {
+                    for(int h = -1; h < 1; h++) {
+                        v3sum[1 + h] += psMask[v][j + h];
+                    }
+                }
+
+                float blocksum = v3sum[0] + v3sum[1];
+
+                for(int voffset = 2; j < xEnd; ++j, ++voffset) {
+                    float colSum = psMask[-1][j + 1] + psMask[0][j + 1] + psMask[1][j + 1];
+                    voffset = voffset == 3 ? 0 : voffset;  // faster than voffset %= 3;
+                    blocksum -= v3sum[voffset];
+                    blocksum += colSum;
+                    v3sum[voffset] = colSum;
+
+                    if(blocksum >= threshold) {
+                        mask[j] = 255;
+                    }
+                }
+            };
+
+        // the blurred mask needs the whole frame. Outside of the area of
+        // the motion detection it must be 0
+        array2D<float> psMask;
+
+        if(blurMap) {
+            psMask(winw, winh, ARRAY2D_CLEAR_DATA);
+        }
+
+        array2D<uint8_t> mask(winw, winh, ARRAY2D_CLEAR_DATA);
 
 #ifdef _OPENMP
-        #pragma omp parallel for schedule(dynamic,16)
+        #pragma omp parallel
 #endif
+        {
+            array2D<float> psRed(winw, bandHeight + 2 * halo);
+            array2D<float> psBlue(winw, bandHeight + 2 * halo);
+            array2D<float> psMaskBand;
 
-        for(int i = winy + border - offsY; i < winh - (border + offsY); ++i) {
-            // offset to keep the code short. It changes its value between 0 and 1 for each iteration of the loop
-            unsigned int offset = FC(i, winx + border - offsX) & 1;
+            if(!blurMap) {
+                psMaskBand(winw, bandHeight + 2, ARRAY2D_CLEAR_DATA);
+            }
 
-            for(int j = winx + border - offsX; j < winw - (border + offsX); ++j, offset ^= 1) {
-                psMask[i][j] = noMotion;
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+
+            for(int y0 = yStart; y0 < yEnd; y0 += bandHeight) {
+                const int y1 = std::min(y0 + bandHeight, yEnd);
+                fillBand(y0, y1, psRed, psBlue);
+                float **psRedRows = psRed;
+                float **psBlueRows = psBlue;
 
-                if(checkGreen) {
-                    if(greenDiff((*rawDataFrames[1 - offset])[i - offset + 1][j] * greenBrightness[1 - offset], (*rawDataFrames[3 - offset])[i + offset][j + 1] * greenBrightness[3 - offset], stddevFactorGreen, eperIsoGreen, nRead, prnu) > 0.f) {
-                        psMask[i][j] = greenWeight;
-                        // do not set the motion pixel values. They have already been set by demosaicer
-                        continue;
+                if(blurMap) {
+                    for(int i = y0; i < y1; ++i) {
+                        detectMotion(i, psRedRows + i - y0 + halo, psBlueRows + i - y0 + halo, psMask[i]);
                     }
-                }
+                } else {
+                    // the 3x3 sum needs one more row of the mask on each side
+                    for(int i = y0 - 1; i < y1 + 1; ++i) {
+                        float *dest = psMaskBand[i - y0 + 1];
 
-                if(checkNonGreenCross) {
-                    // check red cross
-                    float redTop    = psRed[i - 1][j];
-                    float redLeft   = psRed[i][j - 1];
-                    float redCentre = psRed[i][j];
-                    float redRight  = psRed[i][j + 1];
-                    float redBottom = psRed[i + 1][j];
-                    float redDiff   = nonGreenDiffCross(redRight, redLeft, redTop, redBottom, redCentre, clippedRed, stddevFactorRed, eperIsoRed, nRead, prnu);
-
-                    if(redDiff > 0.f) {
-                        psMask[i][j] = redBlueWeight;
-                        continue;
+                        if(i >= yStart && i < yEnd) {
+                            detectMotion(i, psRedRows + i - y0 + halo, psBlueRows + i - y0 + halo, dest);
+                        } else {
+                            std::fill(dest, dest + winw, 0.f);
+                        }
                     }
 
-                    // check blue cross
-                    float blueTop    = psBlue[i - 1][j];
-                    float blueLeft   = psBlue[i][j - 1];
-                    float blueCentre = psBlue[i][j];
-                    float blueRight  = psBlue[i][j + 1];
-                    float blueBottom = psBlue[i + 1][j];
-                    float blueDiff   = nonGreenDiffCross(blueRight, blueLeft, blueTop, blueBottom, blueCentre, clippedBlue, stddevFactorBlue, eperIsoBlue, nRead, prnu);
-
-                    if(blueDiff > 0.f) {
-                        psMask[i][j] = redBlueWeight;
-                        continue;
+                    float **psMaskRows = psMaskBand;
+
+                    for(int i = y0; i < y1; ++i) {
+                        thresholdMotion(psMaskRows + i - y0 + 1, mask[i]);
                     }
                 }
             }
@@ -834,36 +897,15 @@ BENCHFUN
             if(plistener) {
                 plistener->setProgress(0.6);
             }
-        }
 
-        array2D<uint8_t> mask(winw, winh, ARRAY2D_CLEAR_DATA);
+            float **psMaskRows = psMask;
 
 #ifdef _OPENMP
-        #pragma omp parallel for schedule(dynamic,16)
+            #pragma omp parallel for schedule(dynamic,16)
 #endif
 
-        for(int i = winy + border - offsY; i < winh - (border + offsY); ++i) {
-            int j = winx + border - offsX;
-            float v3sum[3] = {0.f};
-
-            for(int v = -1; v <= 1; v++) {
-                for(int h = -1; h < 1; h++) {
-                    v3sum[1 + h] += psMask[i + v][j + h];
-                }
-            }
-
-            float blocksum = v3sum[0] + v3sum[1];
-
-            for(int voffset = 2; j < winw - (border + offsX); ++j, ++voffset) {
-                float colSum = psMask[i - 1][j + 1] + psMask[i][j + 1] + psMask[i + 1][j + 1];
-                voffset = voffset == 3 ? 0 : voffset;  // faster than voffset %= 3;
-                blocksum -= v3sum[voffset];
-                blocksum += colSum;
-                v3sum[voffset] = colSum;
-
-                if(blocksum >= threshold) {
-                    mask[i][j] = 255;
-                }
+            for(int i = yStart; i < yEnd; ++i) {
+                thresholdMotion(psMaskRows + i, mask[i]);
             }
         }
 
@@ -872,10 +914,7 @@ BENCHFUN
         }
 
         if(holeFill) {
-            array2D<uint8_t> maskInv(winw, winh);
-            invertMask(winx + border - offsX, winw - (border + offsX), winy + border - offsY, winh - (border + offsY), mask, maskInv);
-            floodFill4(winx + border - offsX, winw - (border + offsX), winy + border - offsY, winh - (border + offsY), maskInv);
-            xorMasks(winx + border - offsX, winw - (border + offsX), winy + border - offsY, winh - (border + offsY), maskInv, mask);
+            fillHoles(xStart, xEnd, yStart, yEnd, mask);
         }
 
         if(plistener) {
@@ -883,68 +922,84 @@ BENCHFUN
         }
 
 #ifdef _OPENMP
-        #pragma omp parallel for schedule(dynamic,16)
+        #pragma omp parallel
 #endif
+        {
+            array2D<float> psRed(winw, bandHeight + 2 * halo);
+            array2D<float> psBlue(winw, bandHeight + 2 * halo);
+
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+
+            for(int y0 = yStart; y0 < yEnd; y0 += bandHeight) {
+                const int y1 = std::min(y0 + bandHeight, yEnd);
+                fillBand(y0, y1, psRed, psBlue);
 
-        for(int i = winy + border - offsY; i < winh - (border + offsY); ++i) {
+                for(int i = y0; i < y1; ++i) {
+                    const float *psRedRow = psRed[i - y0 + halo];
+                    const float *psBlueRow = psBlue[i - y0 + halo];
+                    float *psMaskRow = smoothTransitions ? psMask[i] : nullptr;
 #ifdef __SSE2__
 
-            // pow() is expensive => pre calculate blend factor using SSE
-            if(smoothTransitions) { //
-                vfloat onev = F2V(1.f);
-                vfloat smoothv = F2V(smoothFactor);
-                int j = winx + border - offsX;
-
-                for(; j < winw - (border + offsX) - 3; j += 4) {
-                    vfloat blendv = vmaxf(LVFU(psMask[i][j]), onev) - onev;
-                    blendv = pow_F(blendv, smoothv);
-                    blendv = vself(vmaskf_eq(smoothv, ZEROV), onev, blendv);
-                    STVFU(psMask[i][j], blendv);
-                }
+                    // pow() is expensive => pre calculate blend factor using SSE
+                    if(smoothTransitions) { //
+                        vfloat onev = F2V(1.f);
+                        vfloat smoothv = F2V(smoothFactor);
+                        int j = xStart;
+
+                        for(; j < xEnd - 3; j += 4) {
+                            vfloat blendv = vmaxf(LVFU(psMaskRow[j]), onev) - onev;
+                            blendv = pow_F(blendv, smoothv);
+                            blendv = vself(vmaskf_eq(smoothv, ZEROV), onev, blendv);
+                            STVFU(psMaskRow[j], blendv);
+                        }
 
-                for(; j < winw - (border + offsX); ++j) {
-                    psMask[i][j] = smoothFactor == 0.f ? 1.f : pow_F(std::max(psMask[i][j] - 1.f, 0.f), smoothFactor);
-                }
-            }
+                        for(; j < xEnd; ++j) {
+                            psMaskRow[j] = smoothFactor == 0.f ? 1.f : pow_F(std::max(psMaskRow[j] - 1.f, 0.f), smoothFactor);
+                        }
+                    }
 
 #endif
-            float *greenDest = green[i + offsY];
-            float *redDest = red[i + offsY];
-            float *blueDest = blue[i + offsY];
+                    float *greenDest = green[i + offsY];
+                    float *redDest = red[i + offsY];
+                    float *blueDest = blue[i + offsY];
 
-            // offset to keep the code short. It changes its value between 0 and 1 for each iteration of the loop
-            unsigned int offset = FC(i, winx + border - offsX) & 1;
+                    // offset to keep the code short. It changes its value between 0 and 1 for each iteration of the loop
+                    unsigned int offset = FC(i, xStart) & 1;
 
-            for(int j = winx + border - offsX; j < winw - (border + offsX); ++j, offset ^= 1) {
-                if(showOnlyMask) {
-                    if(smoothTransitions) { // we want only motion mask => paint areas according to their motion (dark = no motion, bright = motion)
+                    for(int j = xStart; j < xEnd; ++j, offset ^= 1) {
+                        if(showOnlyMask) {
+                            if(smoothTransitions) { // we want only motion mask => paint areas according to their motion (dark = no motion, bright = motion)
 #ifdef __SSE2__
-                        // use pre calculated blend factor
-                        const float blend = psMask[i][j];
+                                // use pre calculated blend factor
+                                const float blend = psMaskRow[j];
 #else
-                        const float blend = smoothFactor == 0.f ? 1.f : pow_F(std::max(psMask[i][j] - 1.f, 0.f), smoothFactor);
+                                const float blend = smoothFactor == 0.f ? 1.f : pow_F(std::max(psMaskRow[j] - 1.f, 0.f), smoothFactor);
 #endif
-                        redDest[j + offsX] = greenDest[j + offsX] = blueDest[j + offsX] = blend * 32768.f;
-                    } else {
-                        redDest[j + offsX] = greenDest[j + offsX] = blueDest[j + offsX] = mask[i][j] == 255 ? 65535.f : 0.f;
-                    }
-                } else if(mask[i][j] == 255) {
-                    paintMotionMask(j + offsX, showMotion, greenDest, redDest, blueDest);
-                } else {
-                    if(smoothTransitions) {
+                                redDest[j + offsX] = greenDest[j + offsX] = blueDest[j + offsX] = blend * 32768.f;
+                            } else {
+                                redDest[j + offsX] = greenDest[j + offsX] = blueDest[j + offsX] = mask[i][j] == 255 ? 65535.f : 0.f;
+                            }
+                        } else if(mask[i][j] == 255) {
+                            paintMotionMask(j + offsX, showMotion, greenDest, redDest, blueDest);
+                        } else {
+                            if(smoothTransitions) {
 #ifdef __SSE2__
-                        // use pre calculated blend factor
-                        const float blend = psMask[i][j];
+                                // use pre calculated blend factor
+                                const float blend = psMaskRow[j];
 #else
-                        const float blend = smoothFactor == 0.f ? 1.f : pow_F(std::max(psMask[i][j] - 1.f, 0.f), smoothFactor);
+                                const float blend = smoothFactor == 0.f ? 1.f : pow_F(std::max(psMaskRow[j] - 1.f, 0.f), smoothFactor);
 #endif
-                        redDest[j + offsX] = intp(blend, showMotion ? 0.f : redDest[j + offsX], psRed[i][j] );
-                        greenDest[j + offsX] = intp(blend, showMotion ? 13500.f : greenDest[j + offsX], ((*rawDataFrames[1 - offset])[i - offset + 1][j] * greenBrightness[1 - offset] + (*rawDataFrames[3 - offset])[i + offset][j + 1] * greenBrightness[3 - offset]) * 0.5f);
-                        blueDest[j + offsX] = intp(blend, showMotion ? 0.f : blueDest[j + offsX], psBlue[i][j]);
-                    } else {
-                        redDest[j + offsX] = psRed[i][j];
-                        greenDest[j + offsX] = ((*rawDataFrames[1 - offset])[i - offset + 1][j] * greenBrightness[1 - offset] + (*rawDataFrames[3 - offset])[i + offset][j + 1] * greenBrightness[3 - offset]) * 0.5f;
-                        blueDest[j + offsX] = psBlue[i][j];
+                                redDest[j + offsX] = intp(blend, showMotion ? 0.f : redDest[j + offsX], psRedRow[j] );
+                                greenDest[j + offsX] = intp(blend, showMotion ? 13500.f : greenDest[j + offsX], ((*rawDataFrames[1 - offset])[i - offset + 1][j] * greenBrightness[1 - offset] + (*rawDataFrames[3 - offset])[i + offset][j + 1] * greenBrightness[3 - offset]) * 0.5f);
+                                blueDest[j + offsX] = intp(blend, showMotion ? 0.f : blueDest[j + offsX], psBlueRow[j]);
+                            } else {
+                                redDest[j + offsX] = psRedRow[j];
+                                greenDest[j + offsX] = ((*rawDataFrames[1 - offset])[i - offset + 1][j] * greenBrightness[1 - offset] + (*rawDataFrames[3 - offset])[i + offset][j + 1] * greenBrightness[3 - offset]) * 0.5f;
+                                blueDest[j + offsX] = psBlueRow[j];
+                            }
+                        }
                     }
                 }
             }
@@ -40,13 +40,14 @@ class PixelsMap :
 {
     int w; // line width in base_t units
     int h; // height
+    int pw; // line width in pixels
     typedef unsigned long base_t;
     static constexpr size_t base_t_size = sizeof(base_t);
     base_t *pm;
 
 public:
     PixelsMap(int width, int height)
-        : w((width / (base_t_size * 8)) + 1), h(height), pm(new base_t[h * w])
+        : w((width / (base_t_size * 8)) + 1), h(height), pw(width), pm(new base_t[h * w])
     {
         clear();
     }
@@ -90,10 +91,31 @@ public:
     {
         memset(pm, 0, h * w * base_t_size);
     }
-    // return 0 if at least one pixel in the word(base_t) is set, otherwise return the number of pixels to skip to the next word base_t
-    int skipIfZero(int x, int y) const
+
+    // returns the coordinates of the pixels set, in row-major order, leaving
+    // out the ones closer than border to the edges. The map is still scanned
+    // entirely, but a word at a time: only the pixels set in each word are
+    // visited, instead of testing every pixel of the map
+    std::vector<badPix> pixels(int border = 0) const
     {
-        return pm[y * w + x / (base_t_size * 8)] == 0 ? base_t_size * 8 - x % (base_t_size * 8) : 0;
+        constexpr int bits = base_t_size * 8;
+        std::vector<badPix> ret;
+
+        for (int y = border; y < h - border; ++y) {
+            const base_t *line = pm + y * w;
+
+            for (int i = 0; i < w; ++i) {
+                for (base_t word = line[i]; word; word &= word - 1) {
+                    const int x = i * bits + __builtin_ctzl(word);
+
+                    if (x >= border && x < pw - border) {
+                        ret.emplace_back(x, y);
+                    }
+                }
+            }
+        }
+
+        return ret;
     }
 };
 
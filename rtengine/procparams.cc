@@ -1793,7 +1793,8 @@ bool DefringeParams::operator !=(const DefringeParams& other) const
 
 ImpulseDenoiseParams::ImpulseDenoiseParams() :
     enabled(false),
-    thresh(50)
+    thresh(50),
+    medianRadius(0)
 {
 }
 
@@ -1801,7 +1802,8 @@ bool ImpulseDenoiseParams::operator ==(const ImpulseDenoiseParams& other) const
 {
     return
         enabled == other.enabled
-        && thresh == other.thresh;
+        && thresh == other.thresh
+        && medianRadius == other.medianRadius;
 }
 
 bool ImpulseDenoiseParams::operator !=(const ImpulseDenoiseParams& other) const
@@ -3636,6 +3638,7 @@ int ProcParams::save(ProgressListener *pl, bool save_general,
         if (RELEVANT_(impulseDenoise)) {
             saveToKeyfile("Impulse Denoising", "Enabled", impulseDenoise.enabled, keyFile);
             saveToKeyfile("Impulse Denoising", "Threshold", impulseDenoise.thresh, keyFile);
+            saveToKeyfile("Impulse Denoising", "MedianRadius", impulseDenoise.medianRadius, keyFile);
         }
 
 // Defringe
@@ -4667,6 +4670,7 @@ int ProcParams::load(ProgressListener *pl, bool load_general,
         if (keyFile.has_group("Impulse Denoising") && RELEVANT_(impulseDenoise)) {
             assignFromKeyfile(keyFile, "Impulse Denoising", "Enabled", impulseDenoise.enabled);
             assignFromKeyfile(keyFile, "Impulse Denoising", "Threshold", impulseDenoise.thresh);
+            assignFromKeyfile(keyFile, "Impulse Denoising", "MedianRadius", impulseDenoise.medianRadius);
         }
 
         if (ppVersion < 346) {
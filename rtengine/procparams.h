@@ -695,6 +695,7 @@ struct DefringeParams {
 struct ImpulseDenoiseParams {
     bool    enabled;
     int     thresh;
+    int     medianRadius; // 0 means weighted average of the neighbours
 
     ImpulseDenoiseParams();
 
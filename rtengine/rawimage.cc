@@ -17,6 +17,7 @@
 #include "utils.h"
 #include "metadata.h"
 #include "image8.h"
+#include "trace.h"
 
 #ifdef ART_USE_LIBRAW
 # include <libraw.h>
@@ -28,6 +29,31 @@ namespace rtengine {
 extern const Settings *settings;
 extern MyMutex *librawMutex;
 
+#if defined ART_USE_LIBRAW && defined LIBRAW_USE_OPENMP
+namespace {
+
+// LibRaw decoders that are parallelized internally with OpenMP
+bool libraw_decoder_uses_openmp(const char *name)
+{
+    static const char *names[] = {
+        "crxLoadRaw",
+        "fuji_compressed_load_raw",
+        "lossless_dng_load_raw",
+        "lossy_dng_load_raw",
+        "deflate_dng_load_raw",
+        "uncompressed_fp_dng_load_raw"
+    };
+    for (auto n : names) {
+        if (strncmp(name, n, strlen(n)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+#endif
+
 
 RawImage::RawImage(const Glib::ustring &name)
     : DCraw()
@@ -39,6 +65,11 @@ RawImage::RawImage(const Glib::ustring &name)
     , allocation(nullptr)
     , thumb_data(nullptr)
     , use_internal_decoder_(true)
+    , libraw_raw_image_(nullptr)
+    , libraw_raw_pitch_(0)
+    , libraw_top_margin_(0)
+    , libraw_left_margin_(0)
+    , float_raw_image_borrowed_(false)
 {
     profile_length = 0;
     memset(maximum_c4, 0, sizeof(maximum_c4));
@@ -68,7 +99,9 @@ RawImage::~RawImage()
     }
 
     if (float_raw_image) {
-        delete[] float_raw_image;
+        if (!float_raw_image_borrowed_) {
+            delete[] float_raw_image;
+        }
         float_raw_image = nullptr;
     }
 
@@ -501,8 +534,11 @@ skip_block:
 
 int RawImage::loadRaw (bool loadData, unsigned int imageNum, bool closeFile, ProgressListener *plistener, double progressRange, bool apply_corrections)
 {
+    trace::Span span(loadData ? "RawImage::loadRaw" : "RawImage::loadRaw (header)", "decode");
     ifname = filename.c_str();
     image = nullptr;
+    libraw_raw_image_ = nullptr;
+    float_raw_image_borrowed_ = false;
     verbose = settings->verbose;
     oprof = nullptr;
 
@@ -516,6 +552,10 @@ int RawImage::loadRaw (bool loadData, unsigned int imageNum, bool closeFile, Pro
         return 3;
     }
 
+    if (loadData) {
+        span.addBytes(ifp->size);
+    }
+
     imfile_set_plistener(ifp, plistener, 0.9 * progressRange);
 
     thumb_length = 0;
@@ -779,7 +819,12 @@ int RawImage::loadRaw (bool loadData, unsigned int imageNum, bool closeFile, Pro
             }
             {
 #ifdef LIBRAW_USE_OPENMP
-                MyMutex::MyLock lock(*librawMutex);
+                // only the decoders that run their own OpenMP teams are
+                // serialized, the others can run concurrently
+                std::unique_lock<MyMutex> lock(*librawMutex, std::defer_lock);
+                if (libraw_decoder_uses_openmp(libraw_->unpack_function_name())) {
+                    lock.lock();
+                }
 #endif
                 err = libraw_->unpack();
             }
@@ -788,16 +833,31 @@ int RawImage::loadRaw (bool loadData, unsigned int imageNum, bool closeFile, Pro
             }
 
             auto &rd = libraw_->imgdata.rawdata;
+            auto &sz = libraw_->imgdata.sizes;
             raw_image = rd.raw_image;
             if (rd.float_image) {
-                float_raw_image = new float[raw_width * raw_height];
-                for (int y = 0; y < raw_height; ++y) {
-                    for (int x = 0; x < raw_width; ++x) {
-                        size_t idx = y * raw_width + x;
-                        float_raw_image[idx] = rd.float_image[idx];
+                if (sz.raw_pitch == raw_width * sizeof(float)) {
+                    // adopt libraw's buffer, it stays alive until recycle()
+                    float_raw_image = rd.float_image;
+                    float_raw_image_borrowed_ = true;
+                } else {
+                    const int pitch = sz.raw_pitch / sizeof(float);
+                    float_raw_image = new float[raw_width * raw_height];
+                    for (int y = 0; y < raw_height; ++y) {
+                        memcpy(float_raw_image + size_t(y) * raw_width, rd.float_image + size_t(y) * pitch, raw_width * sizeof(float));
                     }
                 }
+            } else if (rd.raw_image && (filters > 1000 || filters == 9 || colors == 1) && !fuji_width && strncmp(libraw_->unpack_function_name(), "phase_one", 9) != 0) {
+                // single-channel data: read it directly in compress_image(),
+                // instead of expanding it to 4 channels with raw2image()
+                float_raw_image = nullptr;
+                libraw_raw_image_ = rd.raw_image;
+                libraw_raw_pitch_ = sz.raw_pitch / sizeof(ushort);
+                libraw_top_margin_ = sz.top_margin;
+                libraw_left_margin_ = sz.left_margin;
             } else {
+                // raw2image() runs its own OpenMP loops, so like the
+                // parallel decoders it is serialized (see also get_image())
 #ifdef LIBRAW_USE_OPENMP
                 MyMutex::MyLock lock(*librawMutex);
 #endif
@@ -1165,12 +1225,60 @@ void RawImage::set_black_from_masked_areas()
 }    
 
 
+RawImage::ImageType RawImage::get_image()
+{
+#ifdef ART_USE_LIBRAW
+    if (!image && libraw_raw_image_) {
+        // the 4-channel image was skipped at load time, build it now.
+        // raw2image() runs its own OpenMP loops, so it takes the same lock
+        // as in loadRaw()
+#ifdef LIBRAW_USE_OPENMP
+        MyMutex::MyLock lock(*librawMutex);
+#endif
+        if (libraw_->raw2image() == LIBRAW_SUCCESS) {
+            image = libraw_->imgdata.image;
+        }
+    }
+#endif // ART_USE_LIBRAW
+    return image;
+}
+
+
+size_t RawImage::get_decoded_size() const
+{
+    size_t n = 0;
+    if (image) {
+        n += size_t(iwidth) * iheight * sizeof(*image);
+    }
+    if (libraw_raw_image_) {
+        n += size_t(libraw_raw_pitch_) * raw_height * sizeof(ushort);
+    }
+    if (float_raw_image) {
+        n += size_t(raw_width) * raw_height * sizeof(float);
+    }
+#ifdef ART_USE_LIBRAW
+    if (libraw_) {
+        // the decoder state itself is sizeable (curves, tables, ...)
+        n += sizeof(LibRaw);
+    }
+#endif // ART_USE_LIBRAW
+    return n;
+}
+
+
 float** RawImage::compress_image(unsigned int frameNum, bool freeImage)
 {
-    if (!image) {
+    if (!image && !libraw_raw_image_ && !float_raw_image) {
         return nullptr;
     }
 
+    // position of pixel (row, col) of the visible area in libraw's raw data
+    const auto libraw_raw =
+        [this](int row, int col) -> float
+        {
+            return libraw_raw_image_[(row + libraw_top_margin_) * libraw_raw_pitch_ + col + libraw_left_margin_];
+        };
+
     if (isBayer() || isXtrans()) {
         if (!allocation) {
             // shift the beginning of all frames but the first by 32 floats to avoid cache miss conflicts on CPUs which have <= 4-way associative L1-Cache
@@ -1213,8 +1321,23 @@ float** RawImage::compress_image(unsigned int frameNum, bool freeImage)
                 this->data[row][col] = float_raw_image[(row + top_margin) * raw_width + col + left_margin];
             }
 
-        delete [] float_raw_image;
+        if (!float_raw_image_borrowed_) {
+            delete [] float_raw_image;
+        }
         float_raw_image = nullptr;
+    } else if (libraw_raw_image_ && !image) {
+        // Bayer, X-Trans or monochrome: every pixel has exactly one value,
+        // no need to pick the channel
+        const int tm = colors == 1 && !filters ? 0 : top_margin;
+        const int lm = colors == 1 && !filters ? 0 : left_margin;
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+
+        for (int row = 0; row < height; row++)
+            for (int col = 0; col < width; col++) {
+                this->data[row][col] = libraw_raw(row + tm, col + lm);
+            }
     } else if (filters != 0 && !isXtrans()) {
 #ifdef _OPENMP
         #pragma omp parallel for
@@ -1268,6 +1391,7 @@ float** RawImage::compress_image(unsigned int frameNum, bool freeImage)
 #endif // ART_USE_LIBRAW
         }
         image = nullptr;
+        libraw_raw_image_ = nullptr;
     }
     return data;
 }
@@ -53,7 +53,10 @@ public:
         }
     }
     typedef dcrawImage_t ImageType;
-    ImageType get_image() { return image; }
+    ImageType get_image();
+    // bytes of decoded data not (yet) moved into data by compress_image(),
+    // including the buffers owned by libraw
+    size_t get_decoded_size() const;
     float** compress_image(unsigned int frameNum, bool freeImage=true); // revert to compressed pixels format and release image data
     float** data;             // holds pixel values, data[i][j] corresponds to the ith row and jth column
     unsigned prefilters;               // original filters saved ( used for 4 color processing )
@@ -80,6 +83,14 @@ protected:
 #ifdef ART_USE_LIBRAW
     std::unique_ptr<LibRaw> libraw_;
 #endif // ART_USE_LIBRAW
+    // single-channel raw data owned by libraw, read directly by
+    // compress_image(). In this case the 4-channel image is built only on
+    // demand, by get_image()
+    const ushort *libraw_raw_image_;
+    int libraw_raw_pitch_; // in pixels
+    int libraw_top_margin_;
+    int libraw_left_margin_;
+    bool float_raw_image_borrowed_; // float_raw_image is owned by libraw
 
 public:
     bool has_gain_map(std::vector<uint8_t> *out_buf) const;
@@ -29,6 +29,7 @@
 #include "iccstore.h"
 #include "curves.h"
 #include "dfmanager.h"
+#include "defectmaps.h"
 #include "ffmanager.h"
 #include "dcp.h"
 #include "rt_math.h"
@@ -40,6 +41,7 @@
 #include "../rtgui/multilangmgr.h"
 #define BENCHMARK
 #include "StopWatch.h"
+#include "trace.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -1217,6 +1219,7 @@ void RawImageSource::vflip (Imagefloat* image)
 
 int RawImageSource::load (const Glib::ustring &fname, bool firstFrameOnly)
 {
+    TRACE_SPAN("RawImageSource::load", "decode");
 
     MyTime t1, t2;
     t1.set();
@@ -1646,11 +1649,37 @@ void RawImageSource::preprocess(const RAWParams &raw, const LensProfParams &lens
             bitmapBads.reset(new PixelsMap(W, H));
         }
 
-        int nFound = findHotDeadPixels(*(bitmapBads.get()), raw.hotdeadpix_thresh, raw.hotPixelFilter, raw.deadPixelFilter );
-        totBP += nFound;
+        // once the defect map of the camera is known, use it instead of
+        // scanning the whole frame
+        const std::string serial = idata->getSerialNumber();
+        const DefectMapStore::Key key = { ri->get_maker(), ri->get_model(), serial, W, H, raw.hotdeadpix_thresh, raw.hotPixelFilter, raw.deadPixelFilter };
+        DefectMapStore *defects = DefectMapStore::getInstance();
+        std::vector<badPix> known;
 
-        if( settings->verbose && nFound > 0) {
-            printf( "Correcting %d hot/dead pixels found inside image\n", nFound );
+        if (!serial.empty() && defects->get(key, known)) {
+            totBP += bitmapBads->set(known);
+
+            if (settings->verbose) {
+                printf("Correcting %d pixels from the defect map of the camera\n", int(known.size()));
+            }
+        } else {
+            int nFound = 0;
+
+            if (!serial.empty() && settings->defect_map_images > 0) {
+                PixelsMap found(W, H);
+                nFound = findHotDeadPixels(found, raw.hotdeadpix_thresh, raw.hotPixelFilter, raw.deadPixelFilter);
+                const std::vector<badPix> pixels = found.pixels();
+                bitmapBads->set(pixels);
+                defects->learn(key, fileName, pixels);
+            } else {
+                nFound = findHotDeadPixels(*(bitmapBads.get()), raw.hotdeadpix_thresh, raw.hotPixelFilter, raw.deadPixelFilter );
+            }
+
+            totBP += nFound;
+
+            if( settings->verbose && nFound > 0) {
+                printf( "Correcting %d hot/dead pixels found inside image\n", nFound );
+            }
         }
     }
 
@@ -1849,6 +1878,7 @@ void RawImageSource::preprocess(const RAWParams &raw, const LensProfParams &lens
 
 void RawImageSource::demosaic(const RAWParams &raw, bool autoContrast, double &contrastThreshold)
 {
+    TRACE_SPAN("RawImageSource::demosaic", "demosaic");
     MyTime t1, t2;
     t1.set();
 
@@ -20,8 +20,10 @@
 
 #include "rawimagesource.h"
 #include "rt_math.h"
+#include "simdkernels.h"
 #include "../rtgui/multilangmgr.h"
 #include "StopWatch.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -52,6 +54,7 @@ namespace rtengine
 
 void RawImageSource::rcd_demosaic()
 {
+    TRACE_FUN("demosaic");
     constexpr size_t chunkSize = 2;
     constexpr bool measure = false;
     
@@ -137,8 +140,11 @@ void RawImageSource::rcd_demosaic()
             float bufferV[3][tileSize - 8];
 
             // Step 1.1: Calculate the square of the vertical and horizontal color difference high pass filter
+            // (here and below, the first part of each row is processed with
+            // the wider vectors, if available)
             for (int row = 3; row < std::min(tileRows - 3, 5); ++row) {
-                for (int col = 4, indx = row * tileSize + col; col < tilecols - 4; ++col, ++indx) {
+                const int start = simd::rcdHighPass(cfa + row * tileSize + 4, w1, bufferV[row - 3], tilecols - 8);
+                for (int col = 4 + start, indx = row * tileSize + col; col < tilecols - 4; ++col, ++indx) {
                     bufferV[row - 3][col - 4] = SQR((cfa[indx - w3] - cfa[indx - w1] - cfa[indx + w1] + cfa[indx + w3]) - 3.f * (cfa[indx - w2] + cfa[indx + w2])  + 6.f * cfa[indx]);
                 }
             }
@@ -149,13 +155,16 @@ void RawImageSource::rcd_demosaic()
             float* V1 = bufferV[1];
             float* V2 = bufferV[2];
             for (int row = 4; row < tileRows - 4; ++row) {
-                for (int col = 3, indx = row * tileSize + col; col < tilecols - 3; ++col, ++indx) {
+                const int hstart = simd::rcdHighPass(cfa + row * tileSize + 3, 1, bufferH, tilecols - 6);
+                for (int col = 3 + hstart, indx = row * tileSize + col; col < tilecols - 3; ++col, ++indx) {
                     bufferH[col - 3] = SQR((cfa[indx -  3] - cfa[indx -  1] - cfa[indx +  1] + cfa[indx +  3]) - 3.f * (cfa[indx -  2] + cfa[indx +  2]) + 6.f * cfa[indx]);
                 }
-                for (int col = 4, indx = (row + 1) * tileSize + col; col < tilecols - 4; ++col, ++indx) {
+                const int vstart = simd::rcdHighPass(cfa + (row + 1) * tileSize + 4, w1, V2, tilecols - 8);
+                for (int col = 4 + vstart, indx = (row + 1) * tileSize + col; col < tilecols - 4; ++col, ++indx) {
                     V2[col - 4] = SQR((cfa[indx - w3] - cfa[indx - w1] - cfa[indx + w1] + cfa[indx + w3]) - 3.f * (cfa[indx - w2] + cfa[indx + w2])  + 6.f * cfa[indx]);
                 }
-                for (int col = 4, indx = row * tileSize + col; col < tilecols - 4; ++col, ++indx) {
+                const int dstart = simd::rcdVHDir(V0, V1, V2, bufferH, VH_Dir + row * tileSize + 4, tilecols - 8, epssq);
+                for (int col = 4 + dstart, indx = row * tileSize + col; col < tilecols - 4; ++col, ++indx) {
 
                     float V_Stat = std::max(epssq, V0[col - 4] + V1[col - 4] + V2[col - 4]);
                     float H_Stat = std::max(epssq, bufferH[col -  4] + bufferH[col - 3] + bufferH[col -  2]);
@@ -169,7 +178,10 @@ void RawImageSource::rcd_demosaic()
 
             // Step 2: Low pass filter incorporating green, red and blue local samples from the raw data
             for (int row = 2; row < tileRows - 2; ++row) {
-                for (int col = 2 + (fc(cfarray, row, 0) & 1), indx = row * tileSize + col, lpindx = indx / 2; col < tilecols - 2; col += 2, indx += 2, ++lpindx) {
+                const int col0 = 2 + (fc(cfarray, row, 0) & 1);
+                const int indx0 = row * tileSize + col0;
+                const int start = simd::rcdLowPassEven(cfa + indx0, w1, lpf + indx0 / 2, (tilecols - 2 - col0 + 1) / 2);
+                for (int col = col0 + 2 * start, indx = indx0 + 2 * start, lpindx = indx / 2; col < tilecols - 2; col += 2, indx += 2, ++lpindx) {
                     lpf[lpindx] = cfa[indx] +
                                   0.5f * (cfa[indx - w1] + cfa[indx + w1] + cfa[indx - 1] + cfa[indx + 1]) +
                                   0.25f * (cfa[indx - w1 - 1] + cfa[indx - w1 + 1] + cfa[indx + w1 - 1] + cfa[indx + w1 + 1]);
@@ -178,7 +190,10 @@ void RawImageSource::rcd_demosaic()
 
             // Step 3: Populate the green channel at blue and red CFA positions
             for (int row = 4; row < tileRows - 4; ++row) {
-                for (int col = 4 + (fc(cfarray, row, 0) & 1), indx = row * tileSize + col, lpindx = indx / 2; col < tilecols - 4; col += 2, indx += 2, ++lpindx) {
+                const int col0 = 4 + (fc(cfarray, row, 0) & 1);
+                const int indx0 = row * tileSize + col0;
+                const int start = simd::rcdGreenEven(cfa + indx0, lpf + indx0 / 2, VH_Dir + indx0, rgb[1] + indx0, w1, (tilecols - 4 - col0 + 1) / 2, eps);
+                for (int col = col0 + 2 * start, indx = indx0 + 2 * start, lpindx = indx / 2; col < tilecols - 4; col += 2, indx += 2, ++lpindx) {
                     // Cardinal gradients
                     const float cfai = cfa[indx];
                     const float N_Grad = eps + (std::fabs(cfa[indx - w1] - cfa[indx + w1]) + std::fabs(cfai - cfa[indx - w2])) + (std::fabs(cfa[indx - w1] - cfa[indx - w3]) + std::fabs(cfa[indx - w2] - cfa[indx - w4]));
@@ -213,7 +228,9 @@ void RawImageSource::rcd_demosaic()
 
             // Step 4.0: Calculate the square of the P/Q diagonals color difference high pass filter
             for (int row = 3; row < tileRows - 3; ++row) {
-                for (int col = 3, indx = row * tileSize + col, indx2 = indx / 2; col < tilecols - 3; col+=2, indx+=2, indx2++ ) {
+                const int indx0 = row * tileSize + 3;
+                const int start = simd::rcdDiagHighPassEven(cfa + indx0, w1, P_CDiff_Hpf + indx0 / 2, Q_CDiff_Hpf + indx0 / 2, (tilecols - 5) / 2);
+                for (int col = 3 + 2 * start, indx = indx0 + 2 * start, indx2 = indx / 2; col < tilecols - 3; col+=2, indx+=2, indx2++ ) {
                     P_CDiff_Hpf[indx2] = SQR((cfa[indx - w3 - 3] - cfa[indx - w1 - 1] - cfa[indx + w1 + 1] + cfa[indx + w3 + 3]) - 3.f * (cfa[indx - w2 - 2] + cfa[indx + w2 + 2]) + 6.f * cfa[indx]);
                     Q_CDiff_Hpf[indx2] = SQR((cfa[indx - w3 + 3] - cfa[indx - w1 + 1] - cfa[indx + w1 - 1] + cfa[indx + w3 - 3]) - 3.f * (cfa[indx - w2 + 2] + cfa[indx + w2 - 2]) + 6.f * cfa[indx]);
                 }
@@ -221,7 +238,11 @@ void RawImageSource::rcd_demosaic()
 
             // Step 4.1: Obtain the P/Q diagonals directional discrimination strength
             for (int row = 4; row < tileRows - 4; ++row) {
-                for (int col = 4 + (fc(cfarray, row, 0) & 1), indx = row * tileSize + col, indx2 = indx / 2, indx3 = (indx - w1 - 1) / 2, indx4 = (indx + w1 - 1) / 2; col < tilecols - 4; col += 2, indx += 2, indx2++, indx3++, indx4++ ) {
+                const int col0 = 4 + (fc(cfarray, row, 0) & 1);
+                const int indx0 = row * tileSize + col0;
+                const int i2 = indx0 / 2, i3 = (indx0 - w1 - 1) / 2, i4 = (indx0 + w1 - 1) / 2;
+                const int start = simd::rcdPQDir(P_CDiff_Hpf + i2, P_CDiff_Hpf + i3, P_CDiff_Hpf + i4, Q_CDiff_Hpf + i2, Q_CDiff_Hpf + i3, Q_CDiff_Hpf + i4, PQ_Dir + i2, (tilecols - 4 - col0 + 1) / 2, epssq);
+                for (int col = col0 + 2 * start, indx = indx0 + 2 * start, indx2 = i2 + start, indx3 = i3 + start, indx4 = i4 + start; col < tilecols - 4; col += 2, indx += 2, indx2++, indx3++, indx4++ ) {
                     float P_Stat = std::max(epssq, P_CDiff_Hpf[indx3] + P_CDiff_Hpf[indx2] + P_CDiff_Hpf[indx4 + 1]);
                     float Q_Stat = std::max(epssq, Q_CDiff_Hpf[indx3 + 1] + Q_CDiff_Hpf[indx2] + Q_CDiff_Hpf[indx4]);
                     PQ_Dir[indx2] = P_Stat / (P_Stat + Q_Stat);
@@ -230,7 +251,12 @@ void RawImageSource::rcd_demosaic()
 
             // Step 4.2: Populate the red and blue channels at blue and red CFA positions
             for (int row = 4; row < tileRows - 4; ++row) {
-                for (int col = 4 + (fc(cfarray, row, 0) & 1), indx = row * tileSize + col, c = 2 - fc(cfarray, row, col), pqindx = indx / 2, pqindx2 = (indx - w1 - 1) / 2, pqindx3 = (indx + w1 - 1) / 2; col < tilecols - 4; col += 2, indx += 2, ++pqindx, ++pqindx2, ++pqindx3) {
+                const int col0 = 4 + (fc(cfarray, row, 0) & 1);
+                const int indx0 = row * tileSize + col0;
+                const int c0 = 2 - fc(cfarray, row, col0);
+                const int p1 = indx0 / 2, p2 = (indx0 - w1 - 1) / 2, p3 = (indx0 + w1 - 1) / 2;
+                const int start = simd::rcdRedBlueEven(PQ_Dir + p1, PQ_Dir + p2, PQ_Dir + p3, rgb[c0] + indx0, rgb[1] + indx0, w1, (tilecols - 4 - col0 + 1) / 2, eps);
+                for (int col = col0 + 2 * start, indx = indx0 + 2 * start, c = c0, pqindx = p1 + start, pqindx2 = p2 + start, pqindx3 = p3 + start; col < tilecols - 4; col += 2, indx += 2, ++pqindx, ++pqindx2, ++pqindx3) {
 
                     // Refined P/Q diagonal local discrimination
                     float PQ_Central_Value   = PQ_Dir[pqindx];
@@ -261,7 +287,10 @@ void RawImageSource::rcd_demosaic()
 
             // Step 4.3: Populate the red and blue channels at green CFA positions
             for (int row = 4; row < tileRows - 4; ++row) {
-                for (int col = 4 + (fc(cfarray, row, 1) & 1), indx = row * tileSize + col; col < tilecols - 4; col += 2, indx += 2) {
+                const int col0 = 4 + (fc(cfarray, row, 1) & 1);
+                const int indx0 = row * tileSize + col0;
+                const int start = simd::rcdRedBlueAtGreenEven(VH_Dir + indx0, rgb[0] + indx0, rgb[1] + indx0, rgb[2] + indx0, w1, (tilecols - 4 - col0 + 1) / 2, eps);
+                for (int col = col0 + 2 * start, indx = indx0 + 2 * start; col < tilecols - 4; col += 2, indx += 2) {
 
                     // Refined vertical and horizontal local discrimination
                     float VH_Central_Value = VH_Dir[indx];
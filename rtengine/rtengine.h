@@ -197,6 +197,9 @@ public:
       * @param pl is a pointer pointing to an object implementing a progress listener. It can be NULL, in this case progress is not reported.
       * @return an object representing the loaded and pre-processed image */
     static InitialImage* load (const Glib::ustring& fname, bool isRaw, int* errorCode, ProgressListener* pl = nullptr);
+
+    /** Frees the decoded raw files kept in memory for reuse by load() (see Settings::decoded_raw_cache_size). */
+    static void clearCache ();
 };
 
 /** When the preview image is ready for display during staged processing (thus the changes have been updated),
@@ -599,6 +602,32 @@ public:
    * @return the resulting image, with the output profile applied, exif and iptc data set. You have to save it or you can access the pixel data directly.  */
 IImagefloat* processImage (ProcessingJob* job, int& errorCode, ProgressListener* pl = nullptr, bool flush = false);
 
+/** The interpolation kernels of the multi-output resampling. */
+enum class ResampleKernel {
+    LANCZOS3,
+    MITCHELL,
+    BOX // for large downscales
+};
+
+/** One output of a multi-output export. The settings below replace the
+  * corresponding ones of the ProcessingJob parameters for this output only.
+  * Only the output profile fields of icm are used. */
+struct ExportBranch {
+    procparams::ResizeParams resize;
+    procparams::SharpeningParams prsharpening;
+    procparams::ColorManagementParams icm;
+    ResampleKernel kernel = ResampleKernel::LANCZOS3;
+
+    ExportBranch() = default;
+    explicit ExportBranch(const procparams::ProcParams &pparams):
+        resize(pparams.resize), prsharpening(pparams.prsharpening), icm(pparams.icm) {}
+};
+
+/** Like processImage, but the pipeline is run only once up to the resizing step, and then branched into one output image per element of
+   * branches (same order). The fast pipeline is never used for multi-output jobs.
+   * @return the resulting images, or an empty vector if an error occurred */
+std::vector<IImagefloat *> processImage(ProcessingJob* job, const std::vector<ExportBranch> &branches, int& errorCode, ProgressListener* pl = nullptr, bool flush = false);
+
 /** This class is used to control the batch processing. The class implementing this interface will be called when the full processing of an
    * image is ready and the next job to process is needed. */
 class BatchProcessingListener : public ProgressListener
@@ -45,6 +45,7 @@ public:
     bool            HistogramWorking;       // true: histogram is display the value of the image computed in the Working profile
                                             // false: histogram is display the value of the image computed in the Output profile
     Glib::ustring   lensfunDbDirectory; ///< The directory containing the lensfun database. If empty, the system defaults will be used (as described in http://lensfun.sourceforge.net/manual/dbsearch.html)
+    Glib::ustring   cacheDirectory;     ///< The directory where the engine can cache data computed at startup. If empty, nothing is cached
 
     enum class ThumbnailInspectorMode {
         JPEG,
@@ -77,6 +78,13 @@ public:
     int thread_pool_size;
 
     bool ctl_scripts_fast_preview;
+    bool preview_half_float_cache; ///< keep the intermediate preview buffers as half floats
+
+    Glib::ustring trace_file; ///< if not empty, record a trace of the processing and save it here (Chrome trace format)
+    int trace_buffer_size;    ///< max number of trace events kept
+
+    int decoded_raw_cache_size; ///< MB of decoded raw files kept in memory for reuse by later loads of the same file (0 disables the cache)
+    int defect_map_images; ///< number of images of a camera after which the pixels found by the hot/dead pixel filter are saved as its defect map, and the filter is skipped (0 disables learning)
 
     enum class StdMonitorProfile {
         SRGB,
@@ -0,0 +1,266 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "simdkernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace rtengine { namespace simd {
+
+// ART_SIMD_AVX2 and ART_SIMD_AVX512 are defined by CMake when the
+// corresponding variants are built
+#ifdef ART_SIMD_AVX2
+namespace avx2 {
+
+int gaussHorizontal(float **src, float **dst, int W, int H, const YvVCoeffs &c);
+int gaussVertical(float **src, float **dst, float **divBuffer, int W, int H, const YvVCoeffs &c, GaussMode mode);
+int boxblurVertical(float **dst, int W, int H, int radius);
+int rcdHighPass(const float *cfa, int step, float *dst, int n);
+int rcdVHDir(const float *V0, const float *V1, const float *V2, const float *H, float *dst, int n, float epssq);
+int rcdLowPassEven(const float *cfa, int w1, float *lpf, int n);
+int rcdGreenEven(const float *cfa, const float *lpf, const float *vhdir, float *green, int w1, int n, float eps);
+int rcdDiagHighPassEven(const float *cfa, int w1, float *P, float *Q, int n);
+int rcdPQDir(const float *P, const float *P3, const float *P4, const float *Q, const float *Q3, const float *Q4, float *dst, int n, float epssq);
+int rcdRedBlueEven(const float *pq, const float *pq2, const float *pq3, float *rgbc, const float *green, int w1, int n, float eps);
+int rcdRedBlueAtGreenEven(const float *vhdir, float *red, const float *green, float *blue, int w1, int n, float eps);
+int rgb2lab(const float *R, const float *G, const float *B, float *L, float *a, float *b, int n, const float ws[3][3], float xdiv, float zdiv, const LUTView &cachef, const LUTView &cachefy, XYZ2LabFunc outOfRange);
+
+} // namespace avx2
+#endif
+
+#ifdef ART_SIMD_AVX512
+namespace avx512 {
+
+int gaussHorizontal(float **src, float **dst, int W, int H, const YvVCoeffs &c);
+int gaussVertical(float **src, float **dst, float **divBuffer, int W, int H, const YvVCoeffs &c, GaussMode mode);
+int boxblurVertical(float **dst, int W, int H, int radius);
+int rcdHighPass(const float *cfa, int step, float *dst, int n);
+int rcdVHDir(const float *V0, const float *V1, const float *V2, const float *H, float *dst, int n, float epssq);
+int rcdLowPassEven(const float *cfa, int w1, float *lpf, int n);
+int rcdGreenEven(const float *cfa, const float *lpf, const float *vhdir, float *green, int w1, int n, float eps);
+int rcdDiagHighPassEven(const float *cfa, int w1, float *P, float *Q, int n);
+int rcdPQDir(const float *P, const float *P3, const float *P4, const float *Q, const float *Q3, const float *Q4, float *dst, int n, float epssq);
+int rcdRedBlueEven(const float *pq, const float *pq2, const float *pq3, float *rgbc, const float *green, int w1, int n, float eps);
+int rcdRedBlueAtGreenEven(const float *vhdir, float *red, const float *green, float *blue, int w1, int n, float eps);
+int rgb2lab(const float *R, const float *G, const float *B, float *L, float *a, float *b, int n, const float ws[3][3], float xdiv, float zdiv, const LUTView &cachef, const LUTView &cachefy, XYZ2LabFunc outOfRange);
+
+} // namespace avx512
+#endif
+
+namespace {
+
+Level detect_level()
+{
+    Level ret = Level::SSE2;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+#   ifdef ART_SIMD_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        ret = Level::AVX2;
+    }
+#   endif
+#   ifdef ART_SIMD_AVX512
+    if (ret == Level::AVX2 && __builtin_cpu_supports("avx512f")) {
+        ret = Level::AVX512;
+    }
+#   endif
+#endif
+
+    const char *env = getenv("ART_SIMD");
+    if (env) {
+        Level cap = ret;
+        if (strcmp(env, "sse2") == 0) {
+            cap = Level::SSE2;
+        } else if (strcmp(env, "avx2") == 0) {
+            cap = Level::AVX2;
+        }
+        if (int(cap) < int(ret)) {
+            ret = cap;
+        }
+    }
+
+    return ret;
+}
+
+
+struct Kernels {
+    int (*gaussHorizontal)(float **, float **, int, int, const YvVCoeffs &);
+    int (*gaussVertical)(float **, float **, float **, int, int, const YvVCoeffs &, GaussMode);
+    int (*boxblurVertical)(float **, int, int, int);
+    int (*rcdHighPass)(const float *, int, float *, int);
+    int (*rcdVHDir)(const float *, const float *, const float *, const float *, float *, int, float);
+    int (*rcdLowPassEven)(const float *, int, float *, int);
+    int (*rcdGreenEven)(const float *, const float *, const float *, float *, int, int, float);
+    int (*rcdDiagHighPassEven)(const float *, int, float *, float *, int);
+    int (*rcdPQDir)(const float *, const float *, const float *, const float *, const float *, const float *, float *, int, float);
+    int (*rcdRedBlueEven)(const float *, const float *, const float *, float *, const float *, int, int, float);
+    int (*rcdRedBlueAtGreenEven)(const float *, float *, const float *, float *, int, int, float);
+    int (*rgb2lab)(const float *, const float *, const float *, float *, float *, float *, int, const float [3][3], float, float, const LUTView &, const LUTView &, XYZ2LabFunc);
+};
+
+
+int no_gaussHorizontal(float **, float **, int, int, const YvVCoeffs &) { return 0; }
+int no_gaussVertical(float **, float **, float **, int, int, const YvVCoeffs &, GaussMode) { return 0; }
+int no_boxblurVertical(float **, int, int, int) { return 0; }
+int no_rcdHighPass(const float *, int, float *, int) { return 0; }
+int no_rcdVHDir(const float *, const float *, const float *, const float *, float *, int, float) { return 0; }
+int no_rcdLowPassEven(const float *, int, float *, int) { return 0; }
+int no_rcdGreenEven(const float *, const float *, const float *, float *, int, int, float) { return 0; }
+int no_rcdDiagHighPassEven(const float *, int, float *, float *, int) { return 0; }
+int no_rcdPQDir(const float *, const float *, const float *, const float *, const float *, const float *, float *, int, float) { return 0; }
+int no_rcdRedBlueEven(const float *, const float *, const float *, float *, const float *, int, int, float) { return 0; }
+int no_rcdRedBlueAtGreenEven(const float *, float *, const float *, float *, int, int, float) { return 0; }
+int no_rgb2lab(const float *, const float *, const float *, float *, float *, float *, int, const float [3][3], float, float, const LUTView &, const LUTView &, XYZ2LabFunc) { return 0; }
+
+
+Kernels get_kernels(Level l)
+{
+    switch (l) {
+#ifdef ART_SIMD_AVX512
+    case Level::AVX512:
+        return {
+            avx512::gaussHorizontal, avx512::gaussVertical, avx512::boxblurVertical,
+            avx512::rcdHighPass, avx512::rcdVHDir, avx512::rcdLowPassEven,
+            avx512::rcdGreenEven, avx512::rcdDiagHighPassEven, avx512::rcdPQDir,
+            avx512::rcdRedBlueEven, avx512::rcdRedBlueAtGreenEven, avx512::rgb2lab
+        };
+#endif
+#ifdef ART_SIMD_AVX2
+    case Level::AVX2:
+        return {
+            avx2::gaussHorizontal, avx2::gaussVertical, avx2::boxblurVertical,
+            avx2::rcdHighPass, avx2::rcdVHDir, avx2::rcdLowPassEven,
+            avx2::rcdGreenEven, avx2::rcdDiagHighPassEven, avx2::rcdPQDir,
+            avx2::rcdRedBlueEven, avx2::rcdRedBlueAtGreenEven, avx2::rgb2lab
+        };
+#endif
+    default:
+        return {
+            no_gaussHorizontal, no_gaussVertical, no_boxblurVertical,
+            no_rcdHighPass, no_rcdVHDir, no_rcdLowPassEven,
+            no_rcdGreenEven, no_rcdDiagHighPassEven, no_rcdPQDir,
+            no_rcdRedBlueEven, no_rcdRedBlueAtGreenEven, no_rgb2lab
+        };
+    }
+}
+
+
+const Kernels &kernels()
+{
+    static const Kernels k = get_kernels(level());
+    return k;
+}
+
+} // namespace
+
+
+Level level()
+{
+    static const Level l = detect_level();
+    return l;
+}
+
+
+const char *levelName(Level l)
+{
+    switch (l) {
+    case Level::AVX2:
+        return "AVX2";
+    case Level::AVX512:
+        return "AVX-512";
+    default:
+        return "SSE2";
+    }
+}
+
+
+int gaussHorizontal(float **src, float **dst, int W, int H, const YvVCoeffs &c)
+{
+    return kernels().gaussHorizontal(src, dst, W, H, c);
+}
+
+
+int gaussVertical(float **src, float **dst, float **divBuffer, int W, int H, const YvVCoeffs &c, GaussMode mode)
+{
+    return kernels().gaussVertical(src, dst, divBuffer, W, H, c, mode);
+}
+
+
+int boxblurVertical(float **dst, int W, int H, int radius)
+{
+    return kernels().boxblurVertical(dst, W, H, radius);
+}
+
+
+int rcdHighPass(const float *cfa, int step, float *dst, int n)
+{
+    return kernels().rcdHighPass(cfa, step, dst, n);
+}
+
+
+int rcdVHDir(const float *V0, const float *V1, const float *V2, const float *H, float *dst, int n, float epssq)
+{
+    return kernels().rcdVHDir(V0, V1, V2, H, dst, n, epssq);
+}
+
+
+int rcdLowPassEven(const float *cfa, int w1, float *lpf, int n)
+{
+    return kernels().rcdLowPassEven(cfa, w1, lpf, n);
+}
+
+
+int rcdGreenEven(const float *cfa, const float *lpf, const float *vhdir, float *green, int w1, int n, float eps)
+{
+    return kernels().rcdGreenEven(cfa, lpf, vhdir, green, w1, n, eps);
+}
+
+
+int rcdDiagHighPassEven(const float *cfa, int w1, float *P, float *Q, int n)
+{
+    return kernels().rcdDiagHighPassEven(cfa, w1, P, Q, n);
+}
+
+
+int rcdPQDir(const float *P, const float *P3, const float *P4, const float *Q, const float *Q3, const float *Q4, float *dst, int n, float epssq)
+{
+    return kernels().rcdPQDir(P, P3, P4, Q, Q3, Q4, dst, n, epssq);
+}
+
+
+int rcdRedBlueEven(const float *pq, const float *pq2, const float *pq3, float *rgbc, const float *green, int w1, int n, float eps)
+{
+    return kernels().rcdRedBlueEven(pq, pq2, pq3, rgbc, green, w1, n, eps);
+}
+
+
+int rcdRedBlueAtGreenEven(const float *vhdir, float *red, const float *green, float *blue, int w1, int n, float eps)
+{
+    return kernels().rcdRedBlueAtGreenEven(vhdir, red, green, blue, w1, n, eps);
+}
+
+
+int rgb2lab(const float *R, const float *G, const float *B, float *L, float *a, float *b, int n, const float ws[3][3], float xdiv, float zdiv, const LUTView &cachef, const LUTView &cachefy, XYZ2LabFunc outOfRange)
+{
+    return kernels().rgb2lab(R, G, B, L, a, b, n, ws, xdiv, zdiv, cachef, cachefy, outOfRange);
+}
+
+}} // namespace rtengine::simd
@@ -0,0 +1,102 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Runtime dispatch of the hottest vector kernels to the widest SIMD unit
+ * available (AVX2 or AVX-512), independently of the compile-time target.
+ *
+ * The kernels are written once against a width-generic vector type (see
+ * simdkernels_impl.h), and compiled once per instruction set in separate
+ * translation units; the variant to use is selected at the first call via
+ * cpuid. The environment variable ART_SIMD (sse2, avx2 or avx512) can be
+ * used to cap the level for testing.
+ *
+ * Each function processes a prefix of the rows/columns with the wide
+ * vectors, and returns how many it processed (0 if no wide unit is
+ * available), so that the caller can finish the job with its usual SSE2 or
+ * scalar code. The whole-image passes (gauss, box blur) contain orphaned
+ * "omp for nowait" loops, and must be called by all the threads of the
+ * enclosing parallel region (if any); the row kernels (RCD, Lab) work on a
+ * single row and can be called from anywhere.
+ * Lanes are computed independently, with the same operations in the same
+ * order as in the SSE2 (or scalar) code, so results do not depend on the
+ * level used.
+ */
+
+namespace rtengine { namespace simd {
+
+enum class Level {
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+Level level();
+const char *levelName(Level l);
+
+
+// coefficients of the Young - van Vliet recursive gaussian, with the
+// Triggs - Sdika boundary conditions already normalized
+struct YvVCoeffs {
+    double B;
+    double b1;
+    double b2;
+    double b3;
+    double M[3][3];
+};
+
+enum class GaussMode {
+    STANDARD, // dst = blur(src)
+    MULT,     // dst *= blur(src)
+    DIV       // dst = divBuffer / blur(src)
+};
+
+int gaussHorizontal(float **src, float **dst, int W, int H, const YvVCoeffs &c);
+int gaussVertical(float **src, float **dst, float **divBuffer, int W, int H, const YvVCoeffs &c, GaussMode mode);
+int boxblurVertical(float **dst, int W, int H, int radius);
+
+// Steps of the RCD demosaic, see rcd_demosaic.cc. n is the number of
+// elements of the row; the *Even kernels handle every other pixel of the
+// tile starting at the given one, and n counts those pixels only.
+int rcdHighPass(const float *cfa, int step, float *dst, int n);
+int rcdVHDir(const float *V0, const float *V1, const float *V2, const float *H, float *dst, int n, float epssq);
+int rcdLowPassEven(const float *cfa, int w1, float *lpf, int n);
+int rcdGreenEven(const float *cfa, const float *lpf, const float *vhdir, float *green, int w1, int n, float eps);
+int rcdDiagHighPassEven(const float *cfa, int w1, float *P, float *Q, int n);
+int rcdPQDir(const float *P, const float *P3, const float *P4, const float *Q, const float *Q3, const float *Q4, float *dst, int n, float epssq);
+int rcdRedBlueEven(const float *pq, const float *pq2, const float *pq3, float *rgbc, const float *green, int w1, int n, float eps);
+int rcdRedBlueAtGreenEven(const float *vhdir, float *red, const float *green, float *blue, int w1, int n, float eps);
+
+// a float LUT as seen by LUT<float>::operator[](vfloat)
+struct LUTView {
+    const float *data;
+    float maxs;  // size - 2
+    float upper; // size - 1
+};
+
+typedef void (*XYZ2LabFunc)(float x, float y, float z, float &L, float &a, float &b);
+
+// one row of Color::RGB2Lab() / Color::rgb2lab(vfloat), with x and z
+// divided by xdiv and zdiv. L, a and b may alias R, G and B
+int rgb2lab(const float *R, const float *G, const float *B, float *L, float *a, float *b, int n, const float ws[3][3], float xdiv, float zdiv, const LUTView &cachef, const LUTView &cachefy, XYZ2LabFunc outOfRange);
+
+}} // namespace rtengine::simd
@@ -0,0 +1,103 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// compiled with -mavx2 -mfma (see rtengine/CMakeLists.txt), and called only
+// if the cpu supports it
+
+#ifndef __AVX2__
+#   error "this file must be compiled with -mavx2 -mfma"
+#endif
+
+#include "simdkernels_impl.h"
+
+namespace rtengine { namespace simd { namespace avx2 {
+
+int gaussHorizontal(float **src, float **dst, int W, int H, const YvVCoeffs &c)
+{
+    return gauss_horizontal<AVX2>(src, dst, W, H, c);
+}
+
+
+int gaussVertical(float **src, float **dst, float **divBuffer, int W, int H, const YvVCoeffs &c, GaussMode mode)
+{
+    return gauss_vertical<AVX2>(src, dst, divBuffer, W, H, c, mode);
+}
+
+
+int boxblurVertical(float **dst, int W, int H, int radius)
+{
+    return boxblur_vertical<AVX2>(dst, W, H, radius);
+}
+
+
+int rcdHighPass(const float *cfa, int step, float *dst, int n)
+{
+    return rcd_high_pass<AVX2>(cfa, step, dst, n);
+}
+
+
+int rcdVHDir(const float *V0, const float *V1, const float *V2, const float *H, float *dst, int n, float epssq)
+{
+    return rcd_vh_dir<AVX2>(V0, V1, V2, H, dst, n, epssq);
+}
+
+
+int rcdLowPassEven(const float *cfa, int w1, float *lpf, int n)
+{
+    return rcd_low_pass_even<AVX2>(cfa, w1, lpf, n);
+}
+
+
+int rcdGreenEven(const float *cfa, const float *lpf, const float *vhdir, float *green, int w1, int n, float eps)
+{
+    return rcd_green_even<AVX2>(cfa, lpf, vhdir, green, w1, n, eps);
+}
+
+
+int rcdDiagHighPassEven(const float *cfa, int w1, float *P, float *Q, int n)
+{
+    return rcd_diag_high_pass_even<AVX2>(cfa, w1, P, Q, n);
+}
+
+
+int rcdPQDir(const float *P, const float *P3, const float *P4, const float *Q, const float *Q3, const float *Q4, float *dst, int n, float epssq)
+{
+    return rcd_pq_dir<AVX2>(P, P3, P4, Q, Q3, Q4, dst, n, epssq);
+}
+
+
+int rcdRedBlueEven(const float *pq, const float *pq2, const float *pq3, float *rgbc, const float *green, int w1, int n, float eps)
+{
+    return rcd_red_blue_even<AVX2>(pq, pq2, pq3, rgbc, green, w1, n, eps);
+}
+
+
+int rcdRedBlueAtGreenEven(const float *vhdir, float *red, const float *green, float *blue, int w1, int n, float eps)
+{
+    return rcd_red_blue_at_green_even<AVX2>(vhdir, red, green, blue, w1, n, eps);
+}
+
+
+int rgb2lab(const float *R, const float *G, const float *B, float *L, float *a, float *b, int n, const float ws[3][3], float xdiv, float zdiv, const LUTView &cachef, const LUTView &cachefy, XYZ2LabFunc outOfRange)
+{
+    return rgb_to_lab<AVX2>(R, G, B, L, a, b, n, ws, xdiv, zdiv, cachef, cachefy, outOfRange);
+}
+
+}}} // namespace rtengine::simd::avx2
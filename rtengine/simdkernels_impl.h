@@ -0,0 +1,870 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Width-generic kernels, included by the per-instruction-set translation
+// units (simdkernels_avx2.cc, simdkernels_avx512.cc) after defining the
+// vector type V. Everything here must have internal linkage: these units are
+// compiled with extra -m flags, and an out-of-line copy of a shared inline
+// function or template could otherwise be picked by the linker for the
+// generic code as well.
+
+#pragma once
+
+#include "simdkernels.h"
+#include <x86intrin.h>
+
+namespace rtengine { namespace simd {
+
+namespace {
+
+/*
+ * Vector types. Only arithmetic operators (GCC vector extensions), loads,
+ * stores and the few helpers below are used by the kernels.
+ */
+#ifdef __AVX2__
+struct AVX2 {
+    typedef __m256 vec;
+    enum { N = 8 };
+
+    static inline vec set1(float a) { return _mm256_set1_ps(a); }
+    static inline vec zero() { return _mm256_setzero_ps(); }
+    static inline vec load(const float *p) { return _mm256_load_ps(p); }
+    static inline vec loadu(const float *p) { return _mm256_loadu_ps(p); }
+    static inline void store(float *p, vec v) { _mm256_store_ps(p, v); }
+    static inline void storeu(float *p, vec v) { _mm256_storeu_ps(p, v); }
+    // element j of N consecutive rows
+    static inline vec gather_rows(float *const *r, int j)
+    {
+        return _mm256_setr_ps(r[0][j], r[1][j], r[2][j], r[3][j], r[4][j], r[5][j], r[6][j], r[7][j]);
+    }
+    // same semantics as vmaxf: returns y if x is NaN
+    static inline vec max(vec x, vec y) { return _mm256_max_ps(x, y); }
+    // x > 0 ? x : 1
+    static inline vec positive_or_one(vec x)
+    {
+        return _mm256_blendv_ps(set1(1.f), x, _mm256_cmp_ps(x, zero(), _CMP_GT_OQ));
+    }
+    // same semantics as vminf: returns y if x is NaN
+    static inline vec min(vec x, vec y) { return _mm256_min_ps(x, y); }
+    static inline vec abs(vec x) { return _mm256_andnot_ps(set1(-0.f), x); }
+    // a < b ? x : y
+    static inline vec select_lt(vec a, vec b, vec x, vec y)
+    {
+        return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+    }
+    // bit k set if lane k of x is greater (resp. less) than that of y
+    static inline unsigned mask_gt(vec x, vec y) { return _mm256_movemask_ps(_mm256_cmp_ps(x, y, _CMP_GT_OQ)); }
+    static inline unsigned mask_lt(vec x, vec y) { return _mm256_movemask_ps(_mm256_cmp_ps(x, y, _CMP_LT_OQ)); }
+
+    // p[0], p[2], ..., p[2 * N - 2] (reads only up to there)
+    static inline vec loadu_even(const float *p)
+    {
+        const vec a = _mm256_loadu_ps(p);
+        const vec b = _mm256_loadu_ps(p + N - 1);
+        const vec t = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 2, 0));
+        return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(t), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    // p[2 * k] = v[k], leaving the odd elements untouched
+    static inline void storeu_even(float *p, vec v)
+    {
+        const vec lo = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+        const vec hi = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7));
+        const vec a = _mm256_blend_ps(_mm256_loadu_ps(p), lo, 0x55);
+        const vec b = _mm256_blend_ps(_mm256_loadu_ps(p + N - 1), hi, 0xaa);
+        _mm256_storeu_ps(p, a);
+        _mm256_storeu_ps(p + N - 1, b);
+    }
+
+    typedef __m256i ivec;
+    static inline ivec truncate(vec x) { return _mm256_cvttps_epi32(x); }
+    static inline vec to_float(ivec i) { return _mm256_cvtepi32_ps(i); }
+    static inline vec gather(const float *base, ivec idx) { return _mm256_i32gather_ps(base, idx, 4); }
+};
+#endif // __AVX2__
+
+
+#ifdef __AVX512F__
+struct AVX512 {
+    typedef __m512 vec;
+    enum { N = 16 };
+
+    static inline vec set1(float a) { return _mm512_set1_ps(a); }
+    static inline vec zero() { return _mm512_setzero_ps(); }
+    static inline vec load(const float *p) { return _mm512_load_ps(p); }
+    static inline vec loadu(const float *p) { return _mm512_loadu_ps(p); }
+    static inline void store(float *p, vec v) { _mm512_store_ps(p, v); }
+    static inline void storeu(float *p, vec v) { _mm512_storeu_ps(p, v); }
+    static inline vec gather_rows(float *const *r, int j)
+    {
+        return _mm512_setr_ps(r[0][j], r[1][j], r[2][j], r[3][j], r[4][j], r[5][j], r[6][j], r[7][j],
+                              r[8][j], r[9][j], r[10][j], r[11][j], r[12][j], r[13][j], r[14][j], r[15][j]);
+    }
+    // _mm512_max_ps() with an all-ones mask: the unmasked form uses
+    // _mm512_undefined_ps() internally, which makes GCC 12 report
+    // -Wmaybe-uninitialized
+    static inline vec max(vec x, vec y) { return _mm512_maskz_max_ps(__mmask16(-1), x, y); }
+    static inline vec positive_or_one(vec x)
+    {
+        return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, zero(), _CMP_GT_OQ), set1(1.f), x);
+    }
+    // as above, the masked forms avoid the -Wmaybe-uninitialized warnings
+    static inline vec min(vec x, vec y) { return _mm512_maskz_min_ps(__mmask16(-1), x, y); }
+    static inline vec abs(vec x) { return _mm512_abs_ps(x); }
+    static inline vec select_lt(vec a, vec b, vec x, vec y)
+    {
+        return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), y, x);
+    }
+    static inline unsigned mask_gt(vec x, vec y) { return _mm512_cmp_ps_mask(x, y, _CMP_GT_OQ); }
+    static inline unsigned mask_lt(vec x, vec y) { return _mm512_cmp_ps_mask(x, y, _CMP_LT_OQ); }
+
+    static inline vec loadu_even(const float *p)
+    {
+        const __m512i idx = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 17, 19, 21, 23, 25, 27, 29, 31);
+        return _mm512_permutex2var_ps(_mm512_loadu_ps(p), idx, _mm512_loadu_ps(p + N - 1));
+    }
+    static inline void storeu_even(float *p, vec v)
+    {
+        const vec lo = _mm512_maskz_permutexvar_ps(__mmask16(-1), _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7), v);
+        const vec hi = _mm512_maskz_permutexvar_ps(__mmask16(-1), _mm512_setr_epi32(8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15), v);
+        const vec a = _mm512_mask_blend_ps(0x5555, _mm512_loadu_ps(p), lo);
+        const vec b = _mm512_mask_blend_ps(0xaaaa, _mm512_loadu_ps(p + N - 1), hi);
+        _mm512_storeu_ps(p, a);
+        _mm512_storeu_ps(p + N - 1, b);
+    }
+
+    typedef __m512i ivec;
+    static inline ivec truncate(vec x) { return _mm512_maskz_cvttps_epi32(__mmask16(-1), x); }
+    static inline vec to_float(ivec i) { return _mm512_maskz_cvtepi32_ps(__mmask16(-1), i); }
+    static inline vec gather(const float *base, ivec idx) { return _mm512_mask_i32gather_ps(zero(), __mmask16(-1), idx, base, 4); }
+};
+#endif // __AVX512F__
+
+
+inline float *alloc_aligned(size_t n)
+{
+    return static_cast<float *>(_mm_malloc(n * sizeof(float), 64));
+}
+
+
+/*
+ * Horizontal pass of the recursive gaussian, N rows at a time. Same
+ * computation as gaussHorizontalSse in gauss.cc.
+ */
+template <class V>
+int gauss_horizontal(float **src, float **dst, int W, int H, const YvVCoeffs &c)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = H - (H % N);
+    if (end == 0) {
+        return 0;
+    }
+
+    const vec Bv = V::set1(c.B);
+    const vec b1v = V::set1(c.b1);
+    const vec b2v = V::set1(c.b2);
+    const vec b3v = V::set1(c.b3);
+    vec Mv[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            Mv[i][j] = V::set1(c.M[i][j]);
+        }
+    }
+
+    float *tmp = alloc_aligned(size_t(W) * N);
+
+    const auto gather =
+        [&](int i, int j) -> vec
+        {
+            return V::gather_rows(src + i, j);
+        };
+
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (int i = 0; i < end; i += N) {
+        vec Tv = gather(i, 0);
+        vec Tm3v = Tv * (Bv + b1v + b2v + b3v);
+        V::store(tmp, Tm3v);
+
+        vec Tm2v = gather(i, 1) * Bv + Tm3v * b1v + Tv * (b2v + b3v);
+        V::store(tmp + N, Tm2v);
+
+        vec Rv = gather(i, 2) * Bv + Tm2v * b1v + Tm3v * b2v + Tv * b3v;
+        V::store(tmp + 2 * N, Rv);
+
+        for (int j = 3; j < W; j++) {
+            Tv = Rv;
+            Rv = gather(i, j) * Bv + Tv * b1v + Tm2v * b2v + Tm3v * b3v;
+            V::store(tmp + size_t(j) * N, Rv);
+            Tm3v = Tm2v;
+            Tm2v = Tv;
+        }
+
+        Tv = gather(i, W - 1);
+
+        const vec temp2Wp1 = Tv + Mv[2][0] * (Rv - Tv) + Mv[2][1] * (Tm2v - Tv) + Mv[2][2] * (Tm3v - Tv);
+        const vec temp2W = Tv + Mv[1][0] * (Rv - Tv) + Mv[1][1] * (Tm2v - Tv) + Mv[1][2] * (Tm3v - Tv);
+
+        Rv = Tv + Mv[0][0] * (Rv - Tv) + Mv[0][1] * (Tm2v - Tv) + Mv[0][2] * (Tm3v - Tv);
+        V::store(tmp + size_t(W - 1) * N, Rv);
+
+        Tm2v = Bv * Tm2v + b1v * Rv + b2v * temp2W + b3v * temp2Wp1;
+        V::store(tmp + size_t(W - 2) * N, Tm2v);
+
+        Tm3v = Bv * Tm3v + b1v * Tm2v + b2v * Rv + b3v * temp2W;
+        V::store(tmp + size_t(W - 3) * N, Tm3v);
+
+        Tv = Rv;
+        Rv = Tm3v;
+        Tm3v = Tv;
+
+        for (int j = W - 4; j >= 0; j--) {
+            Tv = Rv;
+            Rv = V::load(tmp + size_t(j) * N) * Bv + Tv * b1v + Tm2v * b2v + Tm3v * b3v;
+            V::store(tmp + size_t(j) * N, Rv);
+            Tm3v = Tm2v;
+            Tm2v = Tv;
+        }
+
+        for (int k = 0; k < N; ++k) {
+            float *d = dst[i + k];
+            for (int j = 0; j < W; j++) {
+                d[j] = tmp[size_t(j) * N + k];
+            }
+        }
+    }
+
+    _mm_free(tmp);
+    return end;
+}
+
+
+template <class V>
+inline void gauss_store(GaussMode mode, float *d, const float *divb, typename V::vec v, bool clamp)
+{
+    switch (mode) {
+    case GaussMode::MULT:
+        V::storeu(d, V::loadu(d) * v);
+        break;
+    case GaussMode::DIV:
+        if (clamp) {
+            V::storeu(d, V::max(V::loadu(divb) / V::positive_or_one(v), V::zero()));
+        } else {
+            V::storeu(d, V::loadu(divb) / V::positive_or_one(v));
+        }
+        break;
+    default:
+        V::storeu(d, v);
+    }
+}
+
+
+/*
+ * Vertical pass of the recursive gaussian, 2 * N columns at a time. Same
+ * computation as gaussVerticalSse, gaussVerticalSsemult and
+ * gaussVerticalSsediv in gauss.cc (including the lack of clamping of the
+ * last three rows in DIV mode).
+ */
+template <class V>
+int gauss_vertical(float **src, float **dst, float **divBuffer, int W, int H, const YvVCoeffs &c, GaussMode mode)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = W - (W % (2 * N));
+    if (end == 0) {
+        return 0;
+    }
+
+    const vec Bv = V::set1(c.B);
+    const vec b1v = V::set1(c.b1);
+    const vec b2v = V::set1(c.b2);
+    const vec b3v = V::set1(c.b3);
+    vec Mv[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            Mv[i][j] = V::set1(c.M[i][j]);
+        }
+    }
+
+    float *tmp = alloc_aligned(size_t(H) * 2 * N);
+    const auto trow =
+        [&](int j, int h) -> float *
+        {
+            return tmp + (size_t(j) * 2 + h) * N;
+        };
+    const auto divrow =
+        [&](int j, int i) -> const float *
+        {
+            return divBuffer ? divBuffer[j] + i : nullptr;
+        };
+
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (int i = 0; i < end; i += 2 * N) {
+        vec Tv[2], Rv[2], Tm2v[2], Tm3v[2], temp2W[2], temp2Wp1[2];
+
+        for (int h = 0; h < 2; ++h) {
+            const int ii = i + h * N;
+            Tv[h] = V::loadu(src[0] + ii);
+            Rv[h] = Tv[h] * (Bv + b1v + b2v + b3v);
+            Tm3v[h] = Rv[h];
+            V::store(trow(0, h), Rv[h]);
+
+            Rv[h] = V::loadu(src[1] + ii) * Bv + Rv[h] * b1v + Tv[h] * (b2v + b3v);
+            Tm2v[h] = Rv[h];
+            V::store(trow(1, h), Rv[h]);
+
+            Rv[h] = V::loadu(src[2] + ii) * Bv + Rv[h] * b1v + Tm3v[h] * b2v + Tv[h] * b3v;
+            V::store(trow(2, h), Rv[h]);
+        }
+
+        for (int j = 3; j < H; j++) {
+            for (int h = 0; h < 2; ++h) {
+                Tv[h] = Rv[h];
+                Rv[h] = V::loadu(src[j] + i + h * N) * Bv + Tv[h] * b1v + Tm2v[h] * b2v + Tm3v[h] * b3v;
+                V::store(trow(j, h), Rv[h]);
+                Tm3v[h] = Tm2v[h];
+                Tm2v[h] = Tv[h];
+            }
+        }
+
+        for (int h = 0; h < 2; ++h) {
+            const int ii = i + h * N;
+            Tv[h] = V::loadu(src[H - 1] + ii);
+
+            temp2Wp1[h] = Tv[h] + Mv[2][0] * (Rv[h] - Tv[h]) + Mv[2][1] * (Tm2v[h] - Tv[h]) + Mv[2][2] * (Tm3v[h] - Tv[h]);
+            temp2W[h] = Tv[h] + Mv[1][0] * (Rv[h] - Tv[h]) + Mv[1][1] * (Tm2v[h] - Tv[h]) + Mv[1][2] * (Tm3v[h] - Tv[h]);
+
+            Rv[h] = Tv[h] + Mv[0][0] * (Rv[h] - Tv[h]) + Mv[0][1] * (Tm2v[h] - Tv[h]) + Mv[0][2] * (Tm3v[h] - Tv[h]);
+            gauss_store<V>(mode, dst[H - 1] + ii, divrow(H - 1, ii), Rv[h], false);
+
+            Tm2v[h] = Bv * Tm2v[h] + b1v * Rv[h] + b2v * temp2W[h] + b3v * temp2Wp1[h];
+            gauss_store<V>(mode, dst[H - 2] + ii, divrow(H - 2, ii), Tm2v[h], false);
+
+            Tm3v[h] = Bv * Tm3v[h] + b1v * Tm2v[h] + b2v * Rv[h] + b3v * temp2W[h];
+            gauss_store<V>(mode, dst[H - 3] + ii, divrow(H - 3, ii), Tm3v[h], false);
+
+            Tv[h] = Rv[h];
+            Rv[h] = Tm3v[h];
+            Tm3v[h] = Tv[h];
+        }
+
+        for (int j = H - 4; j >= 0; j--) {
+            for (int h = 0; h < 2; ++h) {
+                const int ii = i + h * N;
+                Tv[h] = Rv[h];
+                Rv[h] = V::load(trow(j, h)) * Bv + Tv[h] * b1v + Tm2v[h] * b2v + Tm3v[h] * b3v;
+                gauss_store<V>(mode, dst[j] + ii, divrow(j, ii), Rv[h], true);
+                Tm3v[h] = Tm2v[h];
+                Tm2v[h] = Tv[h];
+            }
+        }
+    }
+
+    _mm_free(tmp);
+    return end;
+}
+
+
+/*
+ * Vertical pass of the box blur, 2 * N columns at a time. Same computation
+ * as the SSE2 code of boxblur(float **, float **, int, int, int, bool) in
+ * boxblur.h.
+ */
+template <class V>
+int boxblur_vertical(float **dst, int W, int H, int radius)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = W - (W % (2 * N));
+    if (end == 0) {
+        return 0;
+    }
+
+    float *rowBuffer = alloc_aligned(size_t(radius + 1) * 2 * N);
+    const auto rb =
+        [&](int pos, int h) -> float *
+        {
+            return rowBuffer + (size_t(pos) * 2 + h) * N;
+        };
+    const vec leninitv = V::set1(radius + 1);
+    const vec onev = V::set1(1.f);
+
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (int col = 0; col < end; col += 2 * N) {
+        vec tempv[2];
+        vec lenv = leninitv;
+
+        for (int h = 0; h < 2; ++h) {
+            const int c = col + h * N;
+            tempv[h] = V::loadu(dst[0] + c);
+            V::store(rb(0, h), tempv[h]);
+
+            for (int i = 1; i <= radius; i++) {
+                tempv[h] = tempv[h] + V::loadu(dst[i] + c);
+            }
+
+            tempv[h] = tempv[h] / lenv;
+            V::storeu(dst[0] + c, tempv[h]);
+        }
+
+        for (int row = 1; row <= radius; row++) {
+            const vec lenp1v = lenv + onev;
+            for (int h = 0; h < 2; ++h) {
+                const int c = col + h * N;
+                V::store(rb(row, h), V::loadu(dst[row] + c));
+                tempv[h] = (tempv[h] * lenv + V::loadu(dst[row + radius] + c)) / lenp1v;
+                V::storeu(dst[row] + c, tempv[h]);
+            }
+            lenv = lenp1v;
+        }
+
+        const vec rlenv = onev / lenv;
+        int pos = 0;
+        for (int row = radius + 1; row < H - radius; row++) {
+            for (int h = 0; h < 2; ++h) {
+                const int c = col + h * N;
+                const vec oldVal = V::load(rb(pos, h));
+                V::store(rb(pos, h), V::loadu(dst[row] + c));
+                tempv[h] = tempv[h] + (V::loadu(dst[row + radius] + c) - oldVal) * rlenv;
+                V::storeu(dst[row] + c, tempv[h]);
+            }
+            ++pos;
+            pos = pos <= radius ? pos : 0;
+        }
+
+        for (int row = H - radius; row < H; row++) {
+            const vec lenm1v = lenv - onev;
+            for (int h = 0; h < 2; ++h) {
+                const int c = col + h * N;
+                tempv[h] = (tempv[h] * lenv - V::load(rb(pos, h))) / lenm1v;
+                V::storeu(dst[row] + c, tempv[h]);
+            }
+            lenv = lenm1v;
+            ++pos;
+            pos = pos <= radius ? pos : 0;
+        }
+    }
+
+    _mm_free(rowBuffer);
+    return end;
+}
+
+
+/*
+ * Row kernels of the RCD demosaic (rcd_demosaic.cc). Each one computes the
+ * first elements of a row of one of the steps, with the same expression as
+ * the scalar code; the pointers are already positioned at the first element
+ * of the row. The "even" variants read and write every other pixel of the
+ * tile (the CFA positions of one colour).
+ */
+
+// square of the colour difference high pass filter along step
+template <class V>
+inline typename V::vec rcd_hpf(const float *c, int step)
+{
+    typedef typename V::vec vec;
+    const vec a = V::loadu(c - 3 * step) - V::loadu(c - step) - V::loadu(c + step) + V::loadu(c + 3 * step);
+    const vec v = a - V::set1(3.f) * (V::loadu(c - 2 * step) + V::loadu(c + 2 * step)) + V::set1(6.f) * V::loadu(c);
+    return v * v;
+}
+
+
+template <class V>
+int rcd_high_pass(const float *cfa, int step, float *dst, int n)
+{
+    const int N = V::N;
+    const int end = n - (n % N);
+    for (int k = 0; k < end; k += N) {
+        V::storeu(dst + k, rcd_hpf<V>(cfa + k, step));
+    }
+    return end;
+}
+
+
+template <class V>
+int rcd_vh_dir(const float *V0, const float *V1, const float *V2, const float *H, float *dst, int n, float epssq)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const vec epssqv = V::set1(epssq);
+    for (int k = 0; k < end; k += N) {
+        const vec vstat = V::max(V::loadu(V0 + k) + V::loadu(V1 + k) + V::loadu(V2 + k), epssqv);
+        const vec hstat = V::max(V::loadu(H + k) + V::loadu(H + k + 1) + V::loadu(H + k + 2), epssqv);
+        V::storeu(dst + k, vstat / (vstat + hstat));
+    }
+    return end;
+}
+
+
+template <class V>
+int rcd_low_pass_even(const float *cfa, int w1, float *lpf, int n)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const auto ld =
+        [&](int k, int off) -> vec
+        {
+            return V::loadu_even(cfa + 2 * k + off);
+        };
+    for (int k = 0; k < end; k += N) {
+        V::storeu(lpf + k, ld(k, 0) +
+                  V::set1(0.5f) * (ld(k, -w1) + ld(k, w1) + ld(k, -1) + ld(k, 1)) +
+                  V::set1(0.25f) * (ld(k, -w1 - 1) + ld(k, -w1 + 1) + ld(k, w1 - 1) + ld(k, w1 + 1)));
+    }
+    return end;
+}
+
+
+// |0.5 - central| < |0.5 - neighbourhood| ? neighbourhood : central
+template <class V>
+inline typename V::vec rcd_disc(typename V::vec central, typename V::vec neighbourhood)
+{
+    const typename V::vec halfv = V::set1(0.5f);
+    return V::select_lt(V::abs(halfv - central), V::abs(halfv - neighbourhood), neighbourhood, central);
+}
+
+
+// a * b + (1 - a) * c, as intp()
+template <class V>
+inline typename V::vec intp(typename V::vec a, typename V::vec b, typename V::vec c)
+{
+    return a * b + (V::set1(1.f) - a) * c;
+}
+
+
+template <class V>
+int rcd_green_even(const float *cfa, const float *lpf, const float *vhdir, float *green, int w1, int n, float eps)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const int w2 = 2 * w1, w3 = 3 * w1, w4 = 4 * w1;
+    const vec epsv = V::set1(eps);
+    for (int k = 0; k < end; k += N) {
+        const float *c = cfa + 2 * k;
+        const float *l = lpf + k;
+        const float *vh = vhdir + 2 * k;
+        const auto ld =
+            [c](int off) -> vec
+            {
+                return V::loadu_even(c + off);
+            };
+        const auto d =
+            [](vec a, vec b) -> vec
+            {
+                return V::abs(a - b);
+            };
+
+        // Cardinal gradients
+        const vec cfai = ld(0);
+        const vec N_Grad = epsv + (d(ld(-w1), ld(w1)) + d(cfai, ld(-w2))) + (d(ld(-w1), ld(-w3)) + d(ld(-w2), ld(-w4)));
+        const vec S_Grad = epsv + (d(ld(-w1), ld(w1)) + d(cfai, ld(w2))) + (d(ld(w1), ld(w3)) + d(ld(w2), ld(w4)));
+        const vec W_Grad = epsv + (d(ld(-1), ld(1)) + d(cfai, ld(-2))) + (d(ld(-1), ld(-3)) + d(ld(-2), ld(-4)));
+        const vec E_Grad = epsv + (d(ld(-1), ld(1)) + d(cfai, ld(2))) + (d(ld(1), ld(3)) + d(ld(2), ld(4)));
+
+        // Cardinal pixel estimations
+        const vec lpfi = V::loadu(l);
+        const vec N_Est = ld(-w1) * (lpfi + lpfi) / (epsv + lpfi + V::loadu(l - w1));
+        const vec S_Est = ld(w1) * (lpfi + lpfi) / (epsv + lpfi + V::loadu(l + w1));
+        const vec W_Est = ld(-1) * (lpfi + lpfi) / (epsv + lpfi + V::loadu(l - 1));
+        const vec E_Est = ld(1) * (lpfi + lpfi) / (epsv + lpfi + V::loadu(l + 1));
+
+        // Vertical and horizontal estimations
+        const vec V_Est = (S_Grad * N_Est + N_Grad * S_Est) / (N_Grad + S_Grad);
+        const vec H_Est = (W_Grad * E_Est + E_Grad * W_Est) / (E_Grad + W_Grad);
+
+        // Refined vertical and horizontal local discrimination
+        const vec VH_Central_Value = V::loadu_even(vh);
+        const vec VH_Neighbourhood_Value = V::set1(0.25f) * ((V::loadu_even(vh - w1 - 1) + V::loadu_even(vh - w1 + 1)) + (V::loadu_even(vh + w1 - 1) + V::loadu_even(vh + w1 + 1)));
+
+        const vec VH_Disc = rcd_disc<V>(VH_Central_Value, VH_Neighbourhood_Value);
+        V::storeu_even(green + 2 * k, intp<V>(VH_Disc, H_Est, V_Est));
+    }
+    return end;
+}
+
+
+// square of the P/Q diagonal colour difference high pass filters
+template <class V>
+int rcd_diag_high_pass_even(const float *cfa, int w1, float *P, float *Q, int n)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const int w2 = 2 * w1, w3 = 3 * w1;
+    for (int k = 0; k < end; k += N) {
+        const float *c = cfa + 2 * k;
+        const auto ld =
+            [c](int off) -> vec
+            {
+                return V::loadu_even(c + off);
+            };
+        const vec c6 = V::set1(6.f) * ld(0);
+        const vec p = (ld(-w3 - 3) - ld(-w1 - 1) - ld(w1 + 1) + ld(w3 + 3)) - V::set1(3.f) * (ld(-w2 - 2) + ld(w2 + 2)) + c6;
+        const vec q = (ld(-w3 + 3) - ld(-w1 + 1) - ld(w1 - 1) + ld(w3 - 3)) - V::set1(3.f) * (ld(-w2 + 2) + ld(w2 - 2)) + c6;
+        V::storeu(P + k, p * p);
+        V::storeu(Q + k, q * q);
+    }
+    return end;
+}
+
+
+// P/Q diagonal discrimination; P3, P4, Q3 and Q4 point to the elements
+// above-left and below-left of the current one in the packed arrays
+template <class V>
+int rcd_pq_dir(const float *P, const float *P3, const float *P4, const float *Q, const float *Q3, const float *Q4, float *dst, int n, float epssq)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const vec epssqv = V::set1(epssq);
+    for (int k = 0; k < end; k += N) {
+        const vec pstat = V::max(V::loadu(P3 + k) + V::loadu(P + k) + V::loadu(P4 + k + 1), epssqv);
+        const vec qstat = V::max(V::loadu(Q3 + k + 1) + V::loadu(Q + k) + V::loadu(Q4 + k), epssqv);
+        V::storeu(dst + k, pstat / (pstat + qstat));
+    }
+    return end;
+}
+
+
+// red at blue and blue at red CFA positions; pq2 and pq3 point to the
+// above-left and below-left neighbours of pq in the packed PQ_Dir
+template <class V>
+int rcd_red_blue_even(const float *pq, const float *pq2, const float *pq3, float *rgbc, const float *green, int w1, int n, float eps)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const int w2 = 2 * w1, w3 = 3 * w1;
+    const vec epsv = V::set1(eps);
+    for (int k = 0; k < end; k += N) {
+        const float *c = rgbc + 2 * k;
+        const float *g = green + 2 * k;
+        const auto ldc =
+            [c](int off) -> vec
+            {
+                return V::loadu_even(c + off);
+            };
+        const auto ldg =
+            [g](int off) -> vec
+            {
+                return V::loadu_even(g + off);
+            };
+        const auto d =
+            [](vec a, vec b) -> vec
+            {
+                return V::abs(a - b);
+            };
+
+        // Refined P/Q diagonal local discrimination
+        const vec PQ_Central_Value = V::loadu(pq + k);
+        const vec PQ_Neighbourhood_Value = V::set1(0.25f) * (V::loadu(pq2 + k) + V::loadu(pq2 + k + 1) + V::loadu(pq3 + k) + V::loadu(pq3 + k + 1));
+        const vec PQ_Disc = rcd_disc<V>(PQ_Central_Value, PQ_Neighbourhood_Value);
+
+        // Diagonal gradients
+        const vec g0 = ldg(0);
+        const vec NW_Grad = epsv + d(ldc(-w1 - 1), ldc(w1 + 1)) + d(ldc(-w1 - 1), ldc(-w3 - 3)) + d(g0, ldg(-w2 - 2));
+        const vec NE_Grad = epsv + d(ldc(-w1 + 1), ldc(w1 - 1)) + d(ldc(-w1 + 1), ldc(-w3 + 3)) + d(g0, ldg(-w2 + 2));
+        const vec SW_Grad = epsv + d(ldc(-w1 + 1), ldc(w1 - 1)) + d(ldc(w1 - 1), ldc(w3 - 3)) + d(g0, ldg(w2 - 2));
+        const vec SE_Grad = epsv + d(ldc(-w1 - 1), ldc(w1 + 1)) + d(ldc(w1 + 1), ldc(w3 + 3)) + d(g0, ldg(w2 + 2));
+
+        // Diagonal colour differences
+        const vec NW_Est = ldc(-w1 - 1) - ldg(-w1 - 1);
+        const vec NE_Est = ldc(-w1 + 1) - ldg(-w1 + 1);
+        const vec SW_Est = ldc(w1 - 1) - ldg(w1 - 1);
+        const vec SE_Est = ldc(w1 + 1) - ldg(w1 + 1);
+
+        // P/Q estimations
+        const vec P_Est = (NW_Grad * SE_Est + SE_Grad * NW_Est) / (NW_Grad + SE_Grad);
+        const vec Q_Est = (NE_Grad * SW_Est + SW_Grad * NE_Est) / (NE_Grad + SW_Grad);
+
+        V::storeu_even(rgbc + 2 * k, g0 + intp<V>(PQ_Disc, Q_Est, P_Est));
+    }
+    return end;
+}
+
+
+// red and blue at green CFA positions
+template <class V>
+int rcd_red_blue_at_green_even(const float *vhdir, float *red, const float *green, float *blue, int w1, int n, float eps)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    const int w2 = 2 * w1, w3 = 3 * w1;
+    const vec epsv = V::set1(eps);
+    const auto d =
+        [](vec a, vec b) -> vec
+        {
+            return V::abs(a - b);
+        };
+    for (int k = 0; k < end; k += N) {
+        const float *vh = vhdir + 2 * k;
+        const float *g = green + 2 * k;
+        const auto ldg =
+            [g](int off) -> vec
+            {
+                return V::loadu_even(g + off);
+            };
+
+        // Refined vertical and horizontal local discrimination
+        const vec VH_Central_Value = V::loadu_even(vh);
+        const vec VH_Neighbourhood_Value = V::set1(0.25f) * ((V::loadu_even(vh - w1 - 1) + V::loadu_even(vh - w1 + 1)) + (V::loadu_even(vh + w1 - 1) + V::loadu_even(vh + w1 + 1)));
+        const vec VH_Disc = rcd_disc<V>(VH_Central_Value, VH_Neighbourhood_Value);
+
+        const vec rgb1 = ldg(0);
+        const vec N1 = epsv + d(rgb1, ldg(-w2));
+        const vec S1 = epsv + d(rgb1, ldg(w2));
+        const vec W1 = epsv + d(rgb1, ldg(-2));
+        const vec E1 = epsv + d(rgb1, ldg(2));
+
+        const vec rgb1mw1 = ldg(-w1);
+        const vec rgb1pw1 = ldg(w1);
+        const vec rgb1m1 = ldg(-1);
+        const vec rgb1p1 = ldg(1);
+
+        float *const channels[2] = { red, blue };
+        for (float *rgbc : channels) {
+            float *c = rgbc + 2 * k;
+            const auto ldc =
+                [c](int off) -> vec
+                {
+                    return V::loadu_even(c + off);
+                };
+
+            // Cardinal gradients
+            const vec SNabs = d(ldc(-w1), ldc(w1));
+            const vec EWabs = d(ldc(-1), ldc(1));
+            const vec N_Grad = N1 + SNabs + d(ldc(-w1), ldc(-w3));
+            const vec S_Grad = S1 + SNabs + d(ldc(w1), ldc(w3));
+            const vec W_Grad = W1 + EWabs + d(ldc(-1), ldc(-3));
+            const vec E_Grad = E1 + EWabs + d(ldc(1), ldc(3));
+
+            // Cardinal colour differences
+            const vec N_Est = ldc(-w1) - rgb1mw1;
+            const vec S_Est = ldc(w1) - rgb1pw1;
+            const vec W_Est = ldc(-1) - rgb1m1;
+            const vec E_Est = ldc(1) - rgb1p1;
+
+            // Vertical and horizontal estimations
+            const vec V_Est = (N_Grad * S_Est + S_Grad * N_Est) / (N_Grad + S_Grad);
+            const vec H_Est = (E_Grad * W_Est + W_Grad * E_Est) / (E_Grad + W_Grad);
+
+            V::storeu_even(c, rgb1 + intp<V>(VH_Disc, H_Est, V_Est));
+        }
+    }
+    return end;
+}
+
+
+/*
+ * Interpolated lookup in a float LUT, as in LUT<float>::operator[](vfloat)
+ * (including its interpolation formula, which is not the one of the scalar
+ * operator[]).
+ */
+template <class V>
+inline typename V::vec lut_lookup(const LUTView &lut, typename V::vec indexv)
+{
+    typedef typename V::vec vec;
+    const vec clamped = V::max(V::min(V::set1(lut.maxs), indexv), V::zero());
+    const typename V::ivec idx = V::truncate(clamped);
+    const vec lower = V::gather(lut.data, idx);
+    const vec upper = V::gather(lut.data + 1, idx);
+    const vec diff = V::max(V::min(V::set1(lut.upper), indexv), V::zero()) - V::to_float(idx);
+    return intp<V>(diff, upper, lower);
+}
+
+
+/*
+ * RGB to Lab of one row, as Color::RGB2Lab() and the vector Color::rgb2lab()
+ * (x and z are divided by xdiv and zdiv). As there, the groups of 4 pixels
+ * that have some XYZ value out of [0, 65535] are computed with the scalar
+ * function outOfRange instead of the LUTs.
+ */
+template <class V>
+int rgb_to_lab(const float *R, const float *G, const float *B, float *L, float *a, float *b, int n, const float ws[3][3], float xdiv, float zdiv, const LUTView &cachef, const LUTView &cachefy, XYZ2LabFunc outOfRange)
+{
+    typedef typename V::vec vec;
+    const int N = V::N;
+    const int end = n - (n % N);
+    vec wsv[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            wsv[i][j] = V::set1(ws[i][j]);
+        }
+    }
+    const vec xdivv = V::set1(xdiv);
+    const vec zdivv = V::set1(zdiv);
+    const vec maxvalv = V::set1(65535.f);
+    const vec c500v = V::set1(500.f);
+    const vec c200v = V::set1(200.f);
+
+    for (int k = 0; k < end; k += N) {
+        const vec rv = V::loadu(R + k);
+        const vec gv = V::loadu(G + k);
+        const vec bv = V::loadu(B + k);
+        const vec xv = (wsv[0][0] * rv + wsv[0][1] * gv + wsv[0][2] * bv) / xdivv;
+        const vec yv = wsv[1][0] * rv + wsv[1][1] * gv + wsv[1][2] * bv;
+        const vec zv = (wsv[2][0] * rv + wsv[2][1] * gv + wsv[2][2] * bv) / zdivv;
+
+        const unsigned out = V::mask_gt(V::max(xv, V::max(yv, zv)), maxvalv) | V::mask_lt(V::min(xv, V::min(yv, zv)), V::zero());
+
+        const vec fx = lut_lookup<V>(cachef, xv);
+        const vec fy = lut_lookup<V>(cachef, yv);
+        const vec fz = lut_lookup<V>(cachef, zv);
+        const vec Lv = lut_lookup<V>(cachefy, yv);
+        const vec av = c500v * (fx - fy);
+        const vec bbv = c200v * (fy - fz);
+
+        if (out) {
+            // L, a and b may alias R, G and B
+            float x[N], y[N], z[N];
+            V::storeu(x, xv);
+            V::storeu(y, yv);
+            V::storeu(z, zv);
+            V::storeu(L + k, Lv);
+            V::storeu(a + k, av);
+            V::storeu(b + k, bbv);
+            for (int j = 0; j < N; j += 4) {
+                if (out & (0xfu << j)) {
+                    for (int i = j; i < j + 4; ++i) {
+                        outOfRange(x[i], y[i], z[i], L[k + i], a[k + i], b[k + i]);
+                    }
+                }
+            }
+        } else {
+            V::storeu(L + k, Lv);
+            V::storeu(a + k, av);
+            V::storeu(b + k, bbv);
+        }
+    }
+    return end;
+}
+
+} // namespace
+
+}} // namespace rtengine::simd
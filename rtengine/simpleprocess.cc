@@ -32,6 +32,8 @@
 #include "rescale.h"
 #include "metadata.h"
 #include "threadpool.h"
+#include "trace.h"
+#include <algorithm>
 
 #undef THREAD_PRIORITY_NORMAL
 
@@ -71,6 +73,11 @@ public:
         }
     }
 
+    std::vector<IImagefloat *> operator()(const std::vector<ExportBranch> &branches)
+    {
+        return multi_output(branches);
+    }
+
 private:
     Imagefloat *normal_pipeline()
     {
@@ -346,6 +353,107 @@ private:
         procparams::ProcParams& params = job->pparams;
         ImProcFunctions &ipf = * (ipf_p.get());
 
+        stage_process();
+
+        if (params.resize.enabled) {
+            if (!is_fast) {
+                int imw, imh;
+                double scale = ipf.resizeScale(&params, fw, fh, imw, imh);
+                bool allow_upscaling = params.resize.allowUpscaling || params.resize.dataspec == 0;
+                if (scale < 1.0 || (scale > 1.0 && allow_upscaling)) {
+                    Imagefloat *resized = new Imagefloat(imw, imh, img);
+                    ipf.Lanczos(img, resized, scale);
+                    delete img;
+                    img = resized;
+                }
+            }
+        }
+
+        Imagefloat *readyImg = stage_output(img, params.prsharpening, params.icm);
+        img = nullptr;
+
+        stage_cleanup();
+
+        return readyImg;
+    }
+
+    std::vector<IImagefloat *> multi_output(const std::vector<ExportBranch> &branches)
+    {
+        std::vector<IImagefloat *> ret;
+        
+        if (settings->verbose) {
+            std::cout << "Processing with the normal pipeline, "
+                      << branches.size() << " outputs" << std::endl;
+        }
+        
+        if (!stage_init(false)) {
+            return ret;
+        }
+
+        stage_denoise();
+        stage_transform();
+        stage_process();
+
+        ImProcFunctions &ipf = * (ipf_p.get());
+        procparams::ProcParams bparams = job->pparams;
+
+        // compute the sizes of all the outputs, and resample the image to
+        // all of them in one go
+        std::vector<Imagefloat *> imgs(branches.size(), img);
+        std::vector<Imagefloat *> resized;
+        std::vector<ResampleKernel> kernels;
+        for (size_t i = 0; i < branches.size(); ++i) {
+            bparams.resize = branches[i].resize;
+            if (bparams.resize.enabled) {
+                int imw, imh;
+                double scale = ipf.resizeScale(&bparams, fw, fh, imw, imh);
+                bool allow_upscaling = bparams.resize.allowUpscaling || bparams.resize.dataspec == 0;
+                if (scale < 1.0 || (scale > 1.0 && allow_upscaling)) {
+                    imgs[i] = new Imagefloat(imw, imh, img);
+                    resized.push_back(imgs[i]);
+                    kernels.push_back(branches[i].kernel);
+                }
+            }
+        }
+
+        if (!resized.empty()) {
+            // same color space as Lanczos(), for consistency with the single
+            // output case
+            auto mode = img->mode();
+            img->setMode(Imagefloat::Mode::LAB, true);
+            ipf.resampleLadder(img, resized, kernels);
+            img->setMode(mode, true);
+            for (auto r : resized) {
+                r->setMode(mode, true);
+            }
+        }
+
+        int unresized = std::count(imgs.begin(), imgs.end(), img);
+        for (size_t i = 0; i < branches.size(); ++i) {
+            Imagefloat *im = imgs[i];
+            if (im == img && --unresized > 0) {
+                // stage_output modifies its input, so all but the last
+                // branch at full size need their own copy
+                im = new Imagefloat(img->getWidth(), img->getHeight(), img);
+                img->copyTo(im);
+            }
+            ret.push_back(stage_output(im, branches[i].prsharpening, branches[i].icm));
+        }
+        if (std::find(imgs.begin(), imgs.end(), img) == imgs.end()) {
+            delete img;
+        }
+        img = nullptr;
+
+        stage_cleanup();
+
+        return ret;
+    }
+
+    void stage_process()
+    {
+        procparams::ProcParams& params = job->pparams;
+        ImProcFunctions &ipf = * (ipf_p.get());
+
         int cx = 0, cy = 0, cw = img->getWidth(), ch = img->getHeight();
         if (params.crop.enabled) {
             int iw = img->getWidth();
@@ -390,33 +498,26 @@ private:
         if (pl) {
             pl->setProgress (0.60);
         }
+    }
 
-        if (params.resize.enabled) {
-            if (!is_fast) {
-                int imw, imh;
-                double scale = ipf.resizeScale(&params, fw, fh, imw, imh);
-                bool allow_upscaling = params.resize.allowUpscaling || params.resize.dataspec == 0;
-                if (scale < 1.0 || (scale > 1.0 && allow_upscaling)) {
-                    Imagefloat *resized = new Imagefloat(imw, imh, img);
-                    ipf.Lanczos(img, resized, scale);
-                    delete img;
-                    img = resized;
-                }
-            }
-        }
-        if (params.prsharpening.enabled) {
+    // output sharpening, output profile and metadata. Takes ownership of im
+    Imagefloat *stage_output(Imagefloat *im, const procparams::SharpeningParams &prsharpening, const procparams::ColorManagementParams &icm)
+    {
+        procparams::ProcParams& params = job->pparams;
+        ImProcFunctions &ipf = * (ipf_p.get());
+
+        if (prsharpening.enabled) {
             ipf.setScale(1);
-            ipf.prsharpening(img);
+            ipf.doSharpening(im, prsharpening, false);
         }
 
-        Imagefloat *readyImg = ipf.rgb2out(img, params.icm);
+        Imagefloat *readyImg = ipf.rgb2out(im, icm);
 
         if (settings->verbose) {
-            printf ("Output profile_: \"%s\"\n", params.icm.outputProfile.c_str());
+            printf ("Output profile_: \"%s\"\n", icm.outputProfile.c_str());
         }
 
-        delete img;
-        img = nullptr;
+        delete im;
 
         if (pl) {
             pl->setProgress (0.70);
@@ -443,23 +544,23 @@ private:
 
 
         // Setting the output curve to readyImg
-        if (params.icm.outputProfile != "" && params.icm.outputProfile != ColorManagementParams::NoICMString && params.icm.outputProfile != ColorManagementParams::NoProfileString) {
+        if (icm.outputProfile != "" && icm.outputProfile != ColorManagementParams::NoICMString && icm.outputProfile != ColorManagementParams::NoProfileString) {
 
-            cmsHPROFILE jprof = ICCStore::getInstance()->getProfile (params.icm.outputProfile); //get outProfile
+            cmsHPROFILE jprof = ICCStore::getInstance()->getProfile (icm.outputProfile); //get outProfile
 
             if (jprof == nullptr) {
                 if (settings->verbose) {
-                    printf ("\"%s\" ICC output profile not found!\n - use LCMS2 substitution\n", params.icm.outputProfile.c_str());
+                    printf ("\"%s\" ICC output profile not found!\n - use LCMS2 substitution\n", icm.outputProfile.c_str());
                 }
             } else {
                 if (settings->verbose) {
-                    printf ("Using \"%s\" output profile\n", params.icm.outputProfile.c_str());
+                    printf ("Using \"%s\" output profile\n", icm.outputProfile.c_str());
                 }
 
-                ProfileContent pc = ICCStore::getInstance()->getContent (params.icm.outputProfile);
+                ProfileContent pc = ICCStore::getInstance()->getContent (icm.outputProfile);
                 readyImg->setOutputProfile (pc.getData().c_str(), pc.getData().size());
             }
-        } else if (params.icm.outputProfile == ColorManagementParams::NoProfileString) {
+        } else if (icm.outputProfile == ColorManagementParams::NoProfileString) {
             cmsHPROFILE wp = ICCStore::getInstance()->workingSpace(params.icm.workingProfile);
             ProfileContent wpc(wp);
             readyImg->setOutputProfile(wpc.getData().c_str(), wpc.getData().size());
@@ -468,6 +569,11 @@ private:
             readyImg->setOutputProfile(nullptr, 0);
         }
 
+        return readyImg;
+    }
+
+    void stage_cleanup()
+    {
         if (!job->initialImage) {
             ii->decreaseRef ();
         }
@@ -477,8 +583,6 @@ private:
         if (pl) {
             pl->setProgress (0.75);
         }
-
-        return readyImg;
     }
 
     void stage_early_resize()
@@ -571,10 +675,21 @@ private:
 
 IImagefloat* processImage (ProcessingJob* pjob, int& errorCode, ProgressListener* pl, bool flush)
 {
+    trace::ImageScope tscope(static_cast<ProcessingJobImpl *>(pjob)->fname);
+    TRACE_SPAN("processImage", "job");
     ImageProcessor proc (pjob, errorCode, pl, flush);
     return proc();
 }
 
+
+std::vector<IImagefloat *> processImage(ProcessingJob* pjob, const std::vector<ExportBranch> &branches, int& errorCode, ProgressListener* pl, bool flush)
+{
+    trace::ImageScope tscope(static_cast<ProcessingJobImpl *>(pjob)->fname);
+    TRACE_SPAN("processImage", "job");
+    ImageProcessor proc (pjob, errorCode, pl, flush);
+    return proc(branches);
+}
+
 void batchProcessingThread (ProcessingJob* job, BatchProcessingListener* bpl)
 {
 
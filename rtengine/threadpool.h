@@ -38,6 +38,7 @@ freely, subject to the following restrictions:
 #include <limits>
 
 #include "noncopyable.h"
+#include "trace.h"
 
 namespace rtengine {
 
@@ -156,7 +157,7 @@ auto ThreadPool::enqueue(Priority p, F&& f, Args&&... args)
             throw std::runtime_error("enqueue on stopped ThreadPool");
         }
 
-        tasks_.emplace(p, idx_++, [task](){ (*task)(); });
+        tasks_.emplace(p, idx_++, [task](){ TRACE_SPAN("ThreadPool task", "threadpool"); (*task)(); });
     }
     condition_.notify_one();
     return res;
@@ -0,0 +1,234 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trace.h"
+#include "settings.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <glib/gstdio.h>
+
+namespace rtengine {
+
+extern const Settings *settings;
+
+namespace trace {
+
+namespace detail {
+
+std::atomic<bool> active(false);
+
+} // namespace detail
+
+namespace {
+
+struct Event {
+    const char *name;
+    const char *category;
+    int stage;
+    int tid;
+    int image;
+    int64_t start; // microseconds since start()
+    int64_t dur;
+    uint64_t bytes;
+};
+
+std::unique_ptr<Event[]> buffer;
+size_t capacity = 0;
+std::atomic<uint64_t> next_event(0);
+std::chrono::steady_clock::time_point epoch;
+Glib::ustring out_fname;
+
+std::mutex images_mutex;
+std::vector<Glib::ustring> images; // index 0 is "no image"
+
+std::atomic<int> next_tid(0);
+thread_local int cur_tid = -1;
+thread_local int cur_image = 0;
+
+
+int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+int thread_id()
+{
+    if (cur_tid < 0) {
+        cur_tid = next_tid.fetch_add(1) + 1;
+    }
+    return cur_tid;
+}
+
+
+std::string json_escape(const std::string &s)
+{
+    std::string ret;
+    ret.reserve(s.size());
+    for (unsigned char c : s) {
+        switch (c) {
+        case '"':  ret += "\\\""; break;
+        case '\\': ret += "\\\\"; break;
+        case '\n': ret += "\\n"; break;
+        case '\t': ret += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                ret += buf;
+            } else {
+                ret += c;
+            }
+        }
+    }
+    return ret;
+}
+
+} // namespace
+
+
+void start(const Glib::ustring &fname, size_t cap)
+{
+    if (active() || fname.empty()) {
+        return;
+    }
+
+    capacity = std::max(cap, size_t(1024));
+    buffer.reset(new Event[capacity]);
+    next_event = 0;
+    out_fname = fname;
+    {
+        std::lock_guard<std::mutex> lock(images_mutex);
+        images.assign(1, "");
+    }
+    epoch = std::chrono::steady_clock::now();
+    detail::active = true;
+}
+
+
+bool finish()
+{
+    if (!active()) {
+        return false;
+    }
+    detail::active = false;
+
+    FILE *f = g_fopen(out_fname.c_str(), "wb");
+    if (!f) {
+        if (settings && settings->verbose) {
+            printf("ERROR: can't write trace to %s\n", out_fname.c_str());
+        }
+        return false;
+    }
+
+    const uint64_t n = next_event.load();
+    const uint64_t count = std::min(n, uint64_t(capacity));
+    const uint64_t first = n - count;
+
+    std::vector<std::string> image_names;
+    {
+        std::lock_guard<std::mutex> lock(images_mutex);
+        for (auto &s : images) {
+            image_names.push_back(json_escape(s));
+        }
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"dropped_events\": %llu},\n\"traceEvents\": [\n", static_cast<unsigned long long>(first));
+    fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"ART\"}}");
+    for (uint64_t i = first; i < n; ++i) {
+        const Event &e = buffer[i % capacity];
+        fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %lld, \"dur\": %lld, \"args\": {",
+                e.name, e.category, e.tid, static_cast<long long>(e.start), static_cast<long long>(e.dur));
+        const char *sep = "";
+        if (e.image > 0 && size_t(e.image) < image_names.size()) {
+            fprintf(f, "\"image\": \"%s\"", image_names[e.image].c_str());
+            sep = ", ";
+        }
+        if (e.stage >= 0) {
+            fprintf(f, "%s\"stage\": %d", sep, e.stage);
+            sep = ", ";
+        }
+        if (e.bytes) {
+            fprintf(f, "%s\"bytes\": %llu", sep, static_cast<unsigned long long>(e.bytes));
+        }
+        fprintf(f, "}}");
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    if (settings && settings->verbose) {
+        printf("trace with %llu events written to %s\n", static_cast<unsigned long long>(count), out_fname.c_str());
+    }
+
+    return true;
+}
+
+
+void Span::begin(const char *name, const char *category, int stage)
+{
+    name_ = name;
+    category_ = category;
+    stage_ = stage;
+    start_ = now();
+}
+
+
+void Span::end()
+{
+    if (!active()) {
+        return;
+    }
+    const int64_t stop = now();
+    // no locking: if the buffer wraps around while another thread is still
+    // writing the same slot, that (old) event might come out garbled
+    Event &e = buffer[next_event.fetch_add(1, std::memory_order_relaxed) % capacity];
+    e.name = name_;
+    e.category = category_;
+    e.stage = stage_;
+    e.tid = thread_id();
+    e.image = cur_image;
+    e.start = start_;
+    e.dur = stop - start_;
+    e.bytes = bytes_;
+}
+
+
+ImageScope::ImageScope(const Glib::ustring &fname):
+    prev_(cur_image)
+{
+    if (active()) {
+        std::lock_guard<std::mutex> lock(images_mutex);
+        cur_image = images.size();
+        images.push_back(fname);
+    }
+}
+
+
+ImageScope::~ImageScope()
+{
+    cur_image = prev_;
+}
+
+}} // namespace rtengine::trace
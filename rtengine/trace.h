@@ -0,0 +1,123 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <glibmm/ustring.h>
+
+/*
+ * Lightweight tracing of the processing hot paths.
+ *
+ * Spans are recorded into a fixed-size ring buffer (the oldest events are
+ * overwritten when full) and written out in the Chrome trace-event JSON
+ * format, which can be loaded in chrome://tracing or https://ui.perfetto.dev.
+ * When tracing is not active, a Span costs a single relaxed atomic load.
+ *
+ * Tracing is enabled by setting Settings::trace_file (e.g. with --trace=<file>
+ * from ART-cli); the trace is written by finish(), called from
+ * rtengine::cleanup() or at the end of the command-line processing.
+ */
+
+namespace rtengine { namespace trace {
+
+namespace detail {
+
+extern std::atomic<bool> active;
+
+} // namespace detail
+
+inline bool active()
+{
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+// starts recording, keeping at most capacity events; does nothing if
+// tracing is already active
+void start(const Glib::ustring &fname, size_t capacity);
+
+// stops recording and writes the trace to the file given to start(). Must be
+// called when no processing is running anymore
+bool finish();
+
+
+// A traced region of code. The category is used for grouping the events
+// (e.g. "pipeline", "decode", "encode"); name and category must be string
+// literals (or outlive the tracing session)
+class Span {
+public:
+    explicit Span(const char *name, const char *category="", int stage=-1):
+        bytes_(0)
+    {
+        if (active()) {
+            begin(name, category, stage);
+        } else {
+            start_ = -1;
+        }
+    }
+
+    ~Span()
+    {
+        if (start_ >= 0) {
+            end();
+        }
+    }
+
+    void addBytes(uint64_t n) { bytes_ += n; }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    void begin(const char *name, const char *category, int stage);
+    void end();
+
+    const char *name_;
+    const char *category_;
+    int stage_;
+    int64_t start_;
+    uint64_t bytes_;
+};
+
+
+// Tags all the spans of the current thread with the given image name, for
+// the lifetime of the object. Spans opened by worker threads (OpenMP or the
+// thread pool) are not tagged
+class ImageScope {
+public:
+    explicit ImageScope(const Glib::ustring &fname);
+    ~ImageScope();
+
+    ImageScope(const ImageScope &) = delete;
+    ImageScope &operator=(const ImageScope &) = delete;
+
+private:
+    int prev_;
+};
+
+}} // namespace rtengine::trace
+
+// a Span for the rest of the enclosing block, named after name or after the
+// enclosing function (for spans which don't need addBytes() or a stage)
+#define TRACE_CONCAT_(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name, category) rtengine::trace::Span TRACE_CONCAT(trace_span_, __LINE__)(name, category)
+#define TRACE_FUN(category) rtengine::trace::Span TRACE_CONCAT(trace_span_, __LINE__)(__func__, category)
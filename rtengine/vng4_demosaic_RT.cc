@@ -20,94 +20,56 @@
 //
 ////////////////////////////////////////////////////////////////
 
+#include <cstring>
 #include "rtengine.h"
 #include "rawimagesource.h"
 #include "../rtgui/multilangmgr.h"
 //#define BENCHMARK
 #include "StopWatch.h"
+#include "trace.h"
+
+#define fc(row,col) (prefilters >> ((((row) << 1 & 14) + ((col) & 1)) << 1) & 3)
 
 namespace {
 
 using namespace rtengine;
 
-inline void vng4interpolate_row_redblue (const RawImage *ri, const array2D<float> &rawData, float* ar, float* ab, const float * const pg, const float * const cg, const float * const ng, int i, int width)
+constexpr unsigned int colors = 4;
+
+const signed short int terms[] = {
+    -2, -2, +0, -1, 0, 0x01, -2, -2, +0, +0, 1, 0x01, -2, -1, -1, +0, 0, 0x01,
+    -2, -1, +0, -1, 0, 0x02, -2, -1, +0, +0, 0, 0x03, -2, -1, +0, +1, 1, 0x01,
+    -2, +0, +0, -1, 0, 0x06, -2, +0, +0, +0, 1, 0x02, -2, +0, +0, +1, 0, 0x03,
+    -2, +1, -1, +0, 0, 0x04, -2, +1, +0, -1, 1, 0x04, -2, +1, +0, +0, 0, 0x06,
+    -2, +1, +0, +1, 0, 0x02, -2, +2, +0, +0, 1, 0x04, -2, +2, +0, +1, 0, 0x04,
+    -1, -2, -1, +0, 0, 0x80, -1, -2, +0, -1, 0, 0x01, -1, -2, +1, -1, 0, 0x01,
+    -1, -2, +1, +0, 1, 0x01, -1, -1, -1, +1, 0, 0x88, -1, -1, +1, -2, 0, 0x40,
+    -1, -1, +1, -1, 0, 0x22, -1, -1, +1, +0, 0, 0x33, -1, -1, +1, +1, 1, 0x11,
+    -1, +0, -1, +2, 0, 0x08, -1, +0, +0, -1, 0, 0x44, -1, +0, +0, +1, 0, 0x11,
+    -1, +0, +1, -2, 1, 0x40, -1, +0, +1, -1, 0, 0x66, -1, +0, +1, +0, 1, 0x22,
+    -1, +0, +1, +1, 0, 0x33, -1, +0, +1, +2, 1, 0x10, -1, +1, +1, -1, 1, 0x44,
+    -1, +1, +1, +0, 0, 0x66, -1, +1, +1, +1, 0, 0x22, -1, +1, +1, +2, 0, 0x10,
+    -1, +2, +0, +1, 0, 0x04, -1, +2, +1, +0, 1, 0x04, -1, +2, +1, +1, 0, 0x04,
+    +0, -2, +0, +0, 1, 0x80, +0, -1, +0, +1, 1, 0x88, +0, -1, +1, -2, 0, 0x40,
+    +0, -1, +1, +0, 0, 0x11, +0, -1, +2, -2, 0, 0x40, +0, -1, +2, -1, 0, 0x20,
+    +0, -1, +2, +0, 0, 0x30, +0, -1, +2, +1, 1, 0x10, +0, +0, +0, +2, 1, 0x08,
+    +0, +0, +2, -2, 1, 0x40, +0, +0, +2, -1, 0, 0x60, +0, +0, +2, +0, 1, 0x20,
+    +0, +0, +2, +1, 0, 0x30, +0, +0, +2, +2, 1, 0x10, +0, +1, +1, +0, 0, 0x44,
+    +0, +1, +1, +2, 0, 0x10, +0, +1, +2, -1, 1, 0x40, +0, +1, +2, +0, 0, 0x60,
+    +0, +1, +2, +1, 0, 0x20, +0, +1, +2, +2, 0, 0x10, +1, -2, +1, +0, 0, 0x80,
+    +1, -1, +1, +1, 0, 0x88, +1, +0, +1, +2, 0, 0x08, +1, +0, +2, -1, 0, 0x40,
+    +1, +0, +2, +1, 0, 0x10
+};
+
+const signed short int chood[] = { -1, -1, -1, 0, -1, +1, 0, +1, +1, +1, +1, 0, +1, -1, 0, -1 };
+
+constexpr int prow = 7, pcol = 1;
+
+// precalculates the offsets and weights of the linear interpolation and of
+// the VNG gradients for an image buffer with rows of the given width.
+// code[0][0] is allocated with calloc and must be freed by the caller
+void vng4_tables(unsigned prefilters, int width, int lcode[16][16][32], float mul[16][16][8], float csum[16][16][3], int32_t *code[8][2])
 {
-    if (ri->ISBLUE(i, 0) || ri->ISBLUE(i, 1)) {
-        std::swap(ar, ab);
-    }
-
-    // RGRGR or GRGRGR line
-    for (int j = 3; j < width - 3; ++j) {
-        if (!ri->ISGREEN(i, j)) {
-            // keep original value
-            ar[j] = rawData[i][j];
-            // cross interpolation of red/blue
-            float rb = (rawData[i - 1][j - 1] - pg[j - 1] + rawData[i + 1][j - 1] - ng[j - 1]);
-            rb += (rawData[i - 1][j + 1] - pg[j + 1] + rawData[i + 1][j + 1] - ng[j + 1]);
-            ab[j] = std::max(0.f, cg[j] + rb * 0.25f);
-        } else {
-            // linear R/B-G interpolation horizontally
-            ar[j] = std::max(0.f, cg[j] + (rawData[i][j - 1] - cg[j - 1] + rawData[i][j + 1] - cg[j + 1]) / 2);
-            // linear B/R-G interpolation vertically
-            ab[j] = std::max(0.f, cg[j] + (rawData[i - 1][j] - pg[j] + rawData[i + 1][j] - ng[j]) / 2);
-        }
-    }
-}
-}
-
-namespace rtengine
-
-{
-#define fc(row,col) (prefilters >> ((((row) << 1 & 14) + ((col) & 1)) << 1) & 3)
-
-void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
-{
-    BENCHFUN
-    const signed short int *cp, terms[] = {
-        -2, -2, +0, -1, 0, 0x01, -2, -2, +0, +0, 1, 0x01, -2, -1, -1, +0, 0, 0x01,
-        -2, -1, +0, -1, 0, 0x02, -2, -1, +0, +0, 0, 0x03, -2, -1, +0, +1, 1, 0x01,
-        -2, +0, +0, -1, 0, 0x06, -2, +0, +0, +0, 1, 0x02, -2, +0, +0, +1, 0, 0x03,
-        -2, +1, -1, +0, 0, 0x04, -2, +1, +0, -1, 1, 0x04, -2, +1, +0, +0, 0, 0x06,
-        -2, +1, +0, +1, 0, 0x02, -2, +2, +0, +0, 1, 0x04, -2, +2, +0, +1, 0, 0x04,
-        -1, -2, -1, +0, 0, 0x80, -1, -2, +0, -1, 0, 0x01, -1, -2, +1, -1, 0, 0x01,
-        -1, -2, +1, +0, 1, 0x01, -1, -1, -1, +1, 0, 0x88, -1, -1, +1, -2, 0, 0x40,
-        -1, -1, +1, -1, 0, 0x22, -1, -1, +1, +0, 0, 0x33, -1, -1, +1, +1, 1, 0x11,
-        -1, +0, -1, +2, 0, 0x08, -1, +0, +0, -1, 0, 0x44, -1, +0, +0, +1, 0, 0x11,
-        -1, +0, +1, -2, 1, 0x40, -1, +0, +1, -1, 0, 0x66, -1, +0, +1, +0, 1, 0x22,
-        -1, +0, +1, +1, 0, 0x33, -1, +0, +1, +2, 1, 0x10, -1, +1, +1, -1, 1, 0x44,
-        -1, +1, +1, +0, 0, 0x66, -1, +1, +1, +1, 0, 0x22, -1, +1, +1, +2, 0, 0x10,
-        -1, +2, +0, +1, 0, 0x04, -1, +2, +1, +0, 1, 0x04, -1, +2, +1, +1, 0, 0x04,
-        +0, -2, +0, +0, 1, 0x80, +0, -1, +0, +1, 1, 0x88, +0, -1, +1, -2, 0, 0x40,
-        +0, -1, +1, +0, 0, 0x11, +0, -1, +2, -2, 0, 0x40, +0, -1, +2, -1, 0, 0x20,
-        +0, -1, +2, +0, 0, 0x30, +0, -1, +2, +1, 1, 0x10, +0, +0, +0, +2, 1, 0x08,
-        +0, +0, +2, -2, 1, 0x40, +0, +0, +2, -1, 0, 0x60, +0, +0, +2, +0, 1, 0x20,
-        +0, +0, +2, +1, 0, 0x30, +0, +0, +2, +2, 1, 0x10, +0, +1, +1, +0, 0, 0x44,
-        +0, +1, +1, +2, 0, 0x10, +0, +1, +2, -1, 1, 0x40, +0, +1, +2, +0, 0, 0x60,
-        +0, +1, +2, +1, 0, 0x20, +0, +1, +2, +2, 0, 0x10, +1, -2, +1, +0, 0, 0x80,
-        +1, -1, +1, +1, 0, 0x88, +1, +0, +1, +2, 0, 0x08, +1, +0, +2, -1, 0, 0x40,
-        +1, +0, +2, +1, 0, 0x10
-    },
-    chood[] = { -1, -1, -1, 0, -1, +1, 0, +1, +1, +1, +1, 0, +1, -1, 0, -1 };
-
-    double progress = 0.0;
-    const bool plistenerActive = plistener;
-
-    if (plistenerActive) {
-        plistener->setProgressStr (Glib::ustring::compose(M("TP_RAW_DMETHOD_PROGRESSBAR"), RAWParams::BayerSensor::getMethodString(RAWParams::BayerSensor::Method::VNG4)));
-        plistener->setProgress (progress);
-    }
-
-    const unsigned prefilters = ri->prefilters;
-    const int width = W, height = H;
-    constexpr unsigned int colors = 4;
-
-    float (*image)[4] = (float (*)[4]) calloc (height * width, sizeof * image);
-
-    int lcode[16][16][32];
-    float mul[16][16][8];
-    float csum[16][16][3];
-
-    // first linear interpolation
     for (int row = 0; row < 16; row++)
         for (int col = 0; col < 16; col++) {
             int * ip = lcode[row][col];
@@ -141,82 +103,7 @@ void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float
                 }
         }
 
-#ifdef _OPENMP
-    #pragma omp parallel
-#endif
-    {
-        int firstRow = -1;
-        int lastRow = -1;
-#ifdef _OPENMP
-        // note, static scheduling is important in this implementation
-        #pragma omp for schedule(static)
-#endif
-
-        for (int ii = 0; ii < H; ii++) {
-            if (firstRow == -1) {
-                firstRow = ii;
-            }
-            lastRow = ii;
-            for (int jj = 0; jj < W; jj++) {
-                image[ii * W + jj][fc(ii, jj)] = rawData[ii][jj];
-            }
-            if (ii - 1 > firstRow) {
-                int row = ii - 1;
-                for (int col = 1; col < width - 1; col++) {
-                    float * pix = image[row * width + col];
-                    int * ip = lcode[row & 15][col & 15];
-                    float sum[4] = {};
-
-                    for (int i = 0; i < 8; i++, ip += 2) {
-                        sum[ip[1]] += pix[ip[0]] * mul[row & 15][col & 15][i];
-                    }
-
-                    for (unsigned int i = 0; i < colors - 1; i++, ip++) {
-                        pix[ip[0]] = sum[ip[0]] * csum[row & 15][col & 15][i];
-                    }
-                }
-            }
-        }
-
-        // now all rows are processed except the first and last row of each chunk
-        // let's process them now but skip row 0 and row H - 1
-        if (firstRow > 0 && firstRow < H - 1) {
-            const int row = firstRow;
-            for (int col = 1; col < width - 1; col++) {
-                float * pix = image[row * width + col];
-                int * ip = lcode[row & 15][col & 15];
-                float sum[4] = {};
-
-                for (int i = 0; i < 8; i++, ip += 2) {
-                    sum[ip[1]] += pix[ip[0]] * mul[row & 15][col & 15][i];
-                }
-
-                for (unsigned int i = 0; i < colors - 1; i++, ip++) {
-                    pix[ip[0]] = sum[ip[0]] * csum[row & 15][col & 15][i];
-                }
-            }
-        }
-
-        if (lastRow > 0 && lastRow < H - 1) {
-            const int row = lastRow;
-            for (int col = 1; col < width - 1; col++) {
-                float * pix = image[row * width + col];
-                int * ip = lcode[row & 15][col & 15];
-                float sum[4] = {};
-
-                for (int i = 0; i < 8; i++, ip += 2) {
-                    sum[ip[1]] += pix[ip[0]] * mul[row & 15][col & 15][i];
-                }
-
-                for (unsigned int i = 0; i < colors - 1; i++, ip++) {
-                    pix[ip[0]] = sum[ip[0]] * csum[row & 15][col & 15][i];
-                }
-            }
-        }
-    }
-
-    constexpr int prow = 7, pcol = 1;
-    int32_t *code[8][2];
+    const signed short int *cp;
     int32_t * ip = (int32_t *) calloc ((prow + 1) * (pcol + 1), 1280);
 
     for (int row = 0; row <= prow; row++)   /* Precalculate for VNG */
@@ -274,6 +161,212 @@ void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float
                 }
             }
         }
+}
+
+inline void vng4interpolate_pixel_linear(float *pix, const int *ip, const float *mul, const float *csum)
+{
+    float sum[4] = {};
+
+    for (int i = 0; i < 8; i++, ip += 2) {
+        sum[ip[1]] += pix[ip[0]] * mul[i];
+    }
+
+    for (unsigned int i = 0; i < colors - 1; i++, ip++) {
+        pix[ip[0]] = sum[ip[0]] * csum[i];
+    }
+}
+
+inline float vng4interpolate_pixel_green(const float *pix, int color, const int32_t *ip)
+{
+    float gval[8] = {};
+
+    while (ip[0] != INT_MAX) {        /* Calculate gradients */
+#ifdef __SSE2__
+        // at least on machines with SSE2 feature this cast is save and saves a lot of int => float conversions
+        const float diff = std::fabs(pix[ip[0]] - pix[ip[1]]) * reinterpret_cast<const float*>(ip)[2];
+#else
+        const float diff = std::fabs(pix[ip[0]] - pix[ip[1]]) * ip[2];
+#endif
+        gval[ip[3]] += diff;
+        ip += 5;
+        if (UNLIKELY(ip[-1] != -1)) {
+            gval[ip[-1]] += diff;
+            ip++;
+        }
+    }
+    ip++;
+
+    const float thold = rtengine::min(gval[0], gval[1], gval[2], gval[3], gval[4], gval[5], gval[6], gval[7])
+                      + rtengine::max(gval[0], gval[1], gval[2], gval[3], gval[4], gval[5], gval[6], gval[7]) * 0.5f;
+
+    float sum0 = 0.f;
+    float sum1 = 0.f;
+    const float greenval = pix[color];
+    int num = 0;
+
+    if(color & 1) {
+        color ^= 2;
+        for (int g = 0; g < 8; g++, ip += 2) {  /* Average the neighbors */
+            if (gval[g] <= thold) {
+                if(ip[1]) {
+                    sum0 += greenval + pix[ip[1]];
+                }
+
+                sum1 += pix[ip[0] + color];
+                num++;
+            }
+        }
+        sum0 *= 0.5f;
+    } else {
+        for (int g = 0; g < 8; g++, ip += 2) {  /* Average the neighbors */
+            if (gval[g] <= thold) {
+                if(ip[1]) {
+                    sum0 += greenval + pix[ip[1]];
+                }
+
+                sum1 += pix[ip[0] + 1] + pix[ip[0] + 3];
+                num++;
+            }
+        }
+    }
+    return std::max(0.f, greenval + (sum1 - sum0) / (2 * num));
+}
+
+// interpolates red and blue of row i in the columns [start, end). The
+// output rows and the green rows pg, cg, ng are indexed by column - offset
+inline void vng4interpolate_row_redblue (const RawImage *ri, const array2D<float> &rawData, float* ar, float* ab, const float * const pg, const float * const cg, const float * const ng, int i, int start, int end, int offset)
+{
+    if (ri->ISBLUE(i, 0) || ri->ISBLUE(i, 1)) {
+        std::swap(ar, ab);
+    }
+
+    // RGRGR or GRGRGR line
+    for (int j = start; j < end; ++j) {
+        const int k = j - offset;
+        if (!ri->ISGREEN(i, j)) {
+            // keep original value
+            ar[k] = rawData[i][j];
+            // cross interpolation of red/blue
+            float rb = (rawData[i - 1][j - 1] - pg[k - 1] + rawData[i + 1][j - 1] - ng[k - 1]);
+            rb += (rawData[i - 1][j + 1] - pg[k + 1] + rawData[i + 1][j + 1] - ng[k + 1]);
+            ab[k] = std::max(0.f, cg[k] + rb * 0.25f);
+        } else {
+            // linear R/B-G interpolation horizontally
+            ar[k] = std::max(0.f, cg[k] + (rawData[i][j - 1] - cg[k - 1] + rawData[i][j + 1] - cg[k + 1]) / 2);
+            // linear B/R-G interpolation vertically
+            ab[k] = std::max(0.f, cg[k] + (rawData[i - 1][j] - pg[k] + rawData[i + 1][j] - ng[k]) / 2);
+        }
+    }
+}
+
+// same as RawImageSource::border_interpolate2, for a single pixel
+inline void border_interpolate_pixel(const RawImage *ri, const array2D<float> &rawData, int width, int height, int i, int j, float &r, float &g, float &b)
+{
+    float sum[6] = {};
+
+    for (int i1 = i - 1; i1 < i + 2; i1++)
+        for (int j1 = j - 1; j1 < j + 2; j1++) {
+            if (i1 > -1 && i1 < height && j1 > -1 && j1 < width) {
+                int c = ri->FC(i1, j1);
+                sum[c] += rawData[i1][j1];
+                sum[c + 3]++;
+            }
+        }
+
+    int c = ri->FC(i, j);
+
+    if (c == 1) {
+        r = sum[0] / sum[3];
+        g = rawData[i][j];
+        b = sum[2] / sum[5];
+    } else {
+        g = sum[1] / sum[4];
+
+        if (c == 0) {
+            r = rawData[i][j];
+            b = sum[2] / sum[5];
+        } else {
+            r = sum[0] / sum[3];
+            b = rawData[i][j];
+        }
+    }
+}
+
+} // namespace
+
+namespace rtengine
+
+{
+
+void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
+{
+    BENCHFUN
+    TRACE_FUN("demosaic");
+
+    double progress = 0.0;
+    const bool plistenerActive = plistener;
+
+    if (plistenerActive) {
+        plistener->setProgressStr (Glib::ustring::compose(M("TP_RAW_DMETHOD_PROGRESSBAR"), RAWParams::BayerSensor::getMethodString(RAWParams::BayerSensor::Method::VNG4)));
+        plistener->setProgress (progress);
+    }
+
+    const unsigned prefilters = ri->prefilters;
+    const int width = W, height = H;
+
+    float (*image)[4] = (float (*)[4]) calloc (height * width, sizeof * image);
+
+    int lcode[16][16][32];
+    float mul[16][16][8];
+    float csum[16][16][3];
+    int32_t *code[8][2];
+
+    vng4_tables(prefilters, width, lcode, mul, csum, code);
+
+    // first linear interpolation
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        int firstRow = -1;
+        int lastRow = -1;
+#ifdef _OPENMP
+        // note, static scheduling is important in this implementation
+        #pragma omp for schedule(static)
+#endif
+
+        for (int ii = 0; ii < H; ii++) {
+            if (firstRow == -1) {
+                firstRow = ii;
+            }
+            lastRow = ii;
+            for (int jj = 0; jj < W; jj++) {
+                image[ii * W + jj][fc(ii, jj)] = rawData[ii][jj];
+            }
+            if (ii - 1 > firstRow) {
+                int row = ii - 1;
+                for (int col = 1; col < width - 1; col++) {
+                    vng4interpolate_pixel_linear(image[row * width + col], lcode[row & 15][col & 15], mul[row & 15][col & 15], csum[row & 15][col & 15]);
+                }
+            }
+        }
+
+        // now all rows are processed except the first and last row of each chunk
+        // let's process them now but skip row 0 and row H - 1
+        if (firstRow > 0 && firstRow < H - 1) {
+            const int row = firstRow;
+            for (int col = 1; col < width - 1; col++) {
+                vng4interpolate_pixel_linear(image[row * width + col], lcode[row & 15][col & 15], mul[row & 15][col & 15], csum[row & 15][col & 15]);
+            }
+        }
+
+        if (lastRow > 0 && lastRow < H - 1) {
+            const int row = lastRow;
+            for (int col = 1; col < width - 1; col++) {
+                vng4interpolate_pixel_linear(image[row * width + col], lcode[row & 15][col & 15], mul[row & 15][col & 15], csum[row & 15][col & 15]);
+            }
+        }
+    }
 
     if(plistenerActive) {
         progress = 0.2;
@@ -299,64 +392,10 @@ void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float
             }
             lastRow = row;
             for (int col = 2; col < width - 2; col++) {
-                float * pix = image[row * width + col];
-                int color = fc(row, col);
-                int32_t * ip = code[row & prow][col & pcol];
-                float gval[8] = {};
-
-                while (ip[0] != INT_MAX) {        /* Calculate gradients */
-#ifdef __SSE2__
-                    // at least on machines with SSE2 feature this cast is save and saves a lot of int => float conversions
-                    const float diff = std::fabs(pix[ip[0]] - pix[ip[1]]) * reinterpret_cast<float*>(ip)[2];
-#else
-                    const float diff = std::fabs(pix[ip[0]] - pix[ip[1]]) * ip[2];
-#endif
-                    gval[ip[3]] += diff;
-                    ip += 5;
-                    if (UNLIKELY(ip[-1] != -1)) {
-                        gval[ip[-1]] += diff;
-                        ip++;
-                    }
-                }
-                ip++;
-
-                const float thold = rtengine::min(gval[0], gval[1], gval[2], gval[3], gval[4], gval[5], gval[6], gval[7])
-                                  + rtengine::max(gval[0], gval[1], gval[2], gval[3], gval[4], gval[5], gval[6], gval[7]) * 0.5f;
-
-                float sum0 = 0.f;
-                float sum1 = 0.f;
-                const float greenval = pix[color];
-                int num = 0;
-
-                if(color & 1) {
-                    color ^= 2;
-                    for (int g = 0; g < 8; g++, ip += 2) {  /* Average the neighbors */
-                        if (gval[g] <= thold) {
-                            if(ip[1]) {
-                                sum0 += greenval + pix[ip[1]];
-                            }
-
-                            sum1 += pix[ip[0] + color];
-                            num++;
-                        }
-                    }
-                    sum0 *= 0.5f;
-                } else {
-                    for (int g = 0; g < 8; g++, ip += 2) {  /* Average the neighbors */
-                        if (gval[g] <= thold) {
-                            if(ip[1]) {
-                                sum0 += greenval + pix[ip[1]];
-                            }
-
-                            sum1 += pix[ip[0] + 1] + pix[ip[0] + 3];
-                            num++;
-                        }
-                    }
-                }
-                green[row][col] = std::max(0.f, greenval + (sum1 - sum0) / (2 * num));
+                green[row][col] = vng4interpolate_pixel_green(image[row * width + col], fc(row, col), code[row & prow][col & pcol]);
             }
             if (row - 1 > firstRow) {
-                vng4interpolate_row_redblue(ri, rawData, red[row - 1], blue[row - 1], green[row - 2], green[row - 1], green[row], row - 1, W);
+                vng4interpolate_row_redblue(ri, rawData, red[row - 1], blue[row - 1], green[row - 2], green[row - 1], green[row], row - 1, 3, W - 3, 0);
             }
 
             if(plistenerActive) {
@@ -372,11 +411,11 @@ void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float
         }
 
         if (firstRow > 2 && firstRow < H - 3) {
-            vng4interpolate_row_redblue(ri, rawData, red[firstRow], blue[firstRow], green[firstRow - 1], green[firstRow], green[firstRow + 1], firstRow, W);
+            vng4interpolate_row_redblue(ri, rawData, red[firstRow], blue[firstRow], green[firstRow - 1], green[firstRow], green[firstRow + 1], firstRow, 3, W - 3, 0);
         }
 
         if (lastRow > 2 && lastRow < H - 3) {
-            vng4interpolate_row_redblue(ri, rawData, red[lastRow], blue[lastRow], green[lastRow - 1], green[lastRow], green[lastRow + 1], lastRow, W);
+            vng4interpolate_row_redblue(ri, rawData, red[lastRow], blue[lastRow], green[lastRow - 1], green[lastRow], green[lastRow + 1], lastRow, 3, W - 3, 0);
         }
 #ifdef _OPENMP
         #pragma omp single
@@ -394,4 +433,145 @@ void RawImageSource::vng4_demosaic (const array2D<float> &rawData, array2D<float
         plistener->setProgress (1.0);
     }
 }
+
+
+/*
+ * VNG4 demosaic blended into the output of another demosaicer, as
+ * red = intp(blend, red, vng4_red) and the same for green and blue.
+ *
+ * The result is the same as running vng4_demosaic into temporary planes and
+ * blending afterwards, but the image is processed in tiles: each tile is
+ * interpolated in a small buffer (with the border needed by the VNG
+ * gradients) and blended right away, so no full size buffer is needed.
+ */
+void RawImageSource::vng4_demosaic_blend(const float *const *blend, const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
+{
+    BENCHFUN
+    TRACE_FUN("demosaic");
+
+    const bool plistenerActive = plistener;
+
+    if (plistenerActive) {
+        plistener->setProgressStr (Glib::ustring::compose(M("TP_RAW_DMETHOD_PROGRESSBAR"), RAWParams::BayerSensor::getMethodString(RAWParams::BayerSensor::Method::VNG4)));
+        plistener->setProgress (0.0);
+    }
+
+    // the green of a pixel needs the linear interpolation of its 3x3
+    // neighbourhood, which in turn needs one more pixel of raw data. The
+    // red/blue interpolation needs the green of the neighbours, hence a
+    // border of 3 for the raw data, 2 for the linear interpolation and 1
+    // for green
+    constexpr int ts = 256;
+    constexpr int border = 3;
+    constexpr int bw = ts + 2 * border;
+    constexpr int gw = ts + 2;
+
+    const unsigned prefilters = ri->prefilters;
+
+    int lcode[16][16][32];
+    float mul[16][16][8];
+    float csum[16][16][3];
+    int32_t *code[8][2];
+
+    vng4_tables(prefilters, bw, lcode, mul, csum, code);
+
+    const int numTiles = ((H + ts - 1) / ts) * ((W + ts - 1) / ts);
+    int tilesDone = 0;
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        float (*image)[4] = (float (*)[4]) malloc (bw * bw * sizeof * image);
+        float *vgreen = (float *) malloc (gw * gw * sizeof(float));
+        float *vred = (float *) malloc (gw * sizeof(float));
+        float *vblue = (float *) malloc (gw * sizeof(float));
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic) collapse(2)
+#endif
+        for (int y0 = 0; y0 < H; y0 += ts) {
+            for (int x0 = 0; x0 < W; x0 += ts) {
+                const int y1 = std::min(y0 + ts, H);
+                const int x1 = std::min(x0 + ts, W);
+                const int by0 = std::max(y0 - border, 0);
+                const int bx0 = std::max(x0 - border, 0);
+                const int by1 = std::min(y1 + border, H);
+                const int bx1 = std::min(x1 + border, W);
+
+                memset(image, 0, bw * bw * sizeof * image);
+
+                for (int row = by0; row < by1; ++row) {
+                    for (int col = bx0; col < bx1; ++col) {
+                        image[(row - by0) * bw + col - bx0][fc(row, col)] = rawData[row][col];
+                    }
+                }
+
+                // first linear interpolation, skipping row 0, row H - 1,
+                // column 0 and column W - 1 as vng4_demosaic does
+                for (int row = std::max(y0 - 2, 1); row < std::min(y1 + 2, H - 1); ++row) {
+                    for (int col = std::max(x0 - 2, 1); col < std::min(x1 + 2, W - 1); ++col) {
+                        vng4interpolate_pixel_linear(image[(row - by0) * bw + col - bx0], lcode[row & 15][col & 15], mul[row & 15][col & 15], csum[row & 15][col & 15]);
+                    }
+                }
+
+                // VNG interpolation of green, vgreen is indexed relative
+                // to (y0 - 1, x0 - 1)
+                for (int row = std::max(y0 - 1, 2); row < std::min(y1 + 1, H - 2); ++row) {
+                    for (int col = std::max(x0 - 1, 2); col < std::min(x1 + 1, W - 2); ++col) {
+                        vgreen[(row - y0 + 1) * gw + col - x0 + 1] = vng4interpolate_pixel_green(image[(row - by0) * bw + col - bx0], fc(row, col), code[row & prow][col & pcol]);
+                    }
+                }
+
+                for (int row = y0; row < y1; ++row) {
+                    const bool borderRow = row < 3 || row >= H - 3;
+                    const float *cg = vgreen + (row - y0 + 1) * gw;
+
+                    if (!borderRow) {
+                        vng4interpolate_row_redblue(ri, rawData, vred, vblue, cg - gw, cg, cg + gw, row, std::max(x0, 3), std::min(x1, W - 3), x0 - 1);
+                    }
+
+                    for (int col = x0; col < x1; ++col) {
+                        float r, g, b;
+
+                        if (borderRow || col < 3 || col >= W - 3) {
+                            border_interpolate_pixel(ri, rawData, W, H, row, col, r, g, b);
+                        } else {
+                            r = vred[col - x0 + 1];
+                            g = cg[col - x0 + 1];
+                            b = vblue[col - x0 + 1];
+                        }
+
+                        red[row][col] = intp(blend[row][col], red[row][col], r);
+                        green[row][col] = intp(blend[row][col], green[row][col], g);
+                        blue[row][col] = intp(blend[row][col], blue[row][col], b);
+                    }
+                }
+
+                if (plistenerActive) {
+#ifdef _OPENMP
+                    #pragma omp critical (vng4blendprogress)
+#endif
+                    {
+                        if (++tilesDone % 16 == 0) {
+                            plistener->setProgress (double(tilesDone) / numTiles);
+                        }
+                    }
+                }
+            }
+        }
+
+        free (vblue);
+        free (vred);
+        free (vgreen);
+        free (image);
+    }
+
+    free (code[0][0]);
+
+    if (plistenerActive) {
+        plistener->setProgress (1.0);
+    }
 }
+
+} // namespace rtengine
@@ -28,6 +28,7 @@
 #include "../rtgui/multilangmgr.h"
 #include "opthelper.h"
 #include "StopWatch.h"
+#include "trace.h"
 
 namespace rtengine
 {
@@ -180,6 +181,7 @@ void RawImageSource::xtransborder_interpolate (int border, array2D<float> &red,
 #define CLIP(x) (x)
 void RawImageSource::xtrans_interpolate(const int passes, const bool useCieLab)
 {
+    TRACE_FUN("demosaic");
     const size_t chunkSize = 2;
     constexpr bool measure = false;
     
@@ -970,6 +972,7 @@ void RawImageSource::xtrans_interpolate(const int passes, const bool useCieLab)
 #undef CLIP
 void RawImageSource::fast_xtrans_interpolate (const array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
 {
+    TRACE_FUN("demosaic");
 
     if (plistener) {
         plistener->setProgressStr(Glib::ustring::compose(M("TP_RAW_DMETHOD_PROGRESSBAR"), M("TP_RAW_XTRANSFAST")));
@@ -35,7 +35,6 @@
 #include "batchqueuebuttonset.h"
 #include "guiutils.h"
 #include "rtimage.h"
-#include <sys/time.h>
 #include "../rtengine/imgiomanager.h"
 
 using namespace std;
@@ -46,7 +45,12 @@ BatchQueue::BatchQueue (FileCatalog* aFileCatalog):
     fileCatalog(aFileCatalog),
     sequence(0),
     listener(nullptr),
-    batch_profile_(nullptr)
+    batch_profile_(nullptr),
+    journal_(Glib::build_filename(options.user_config_dir, "batch")),
+    write_failed_(false),
+    // each pending write holds a full-size image: two are enough to keep
+    // the processing going while the previous output is being encoded
+    writer_(2, 2)
 {
     fileCatalog->setBatchQueue(this);
     
@@ -108,6 +112,9 @@ BatchQueue::BatchQueue (FileCatalog* aFileCatalog):
 
 BatchQueue::~BatchQueue ()
 {
+    // let the images already processed be written
+    writer_.wait();
+
     std::set<BatchQueueEntry*> removable_bqes;
 
     mutex_removable_batch_queue_entries.lock();
@@ -115,7 +122,6 @@ BatchQueue::~BatchQueue ()
     mutex_removable_batch_queue_entries.unlock();
 
     for (const auto entry : removable_bqes) {
-        ::g_remove(entry->savedParamsFile.c_str());
         delete entry;
     }
 
@@ -255,11 +261,14 @@ void BatchQueue::addEntries (const std::vector<BatchQueueEntry*>& entries, bool
             entry->resize (getThumbnailHeight());
 
             // recovery save
-            const auto tempFile = getTempFilenameForParams (entry->filename);
-
-            if (!entry->params.save(this, tempFile)) {
-                entry->savedParamsFile = tempFile;
-            }
+            BatchQueueJournal::Entry je;
+            je.source = entry->filename;
+            je.output = entry->outFileName;
+            je.saveFormat = entry->saveFormat;
+            je.forceFormatOpts = entry->forceFormatOpts;
+            je.fast = entry->fast_pipeline;
+            je.params = entry->params.to_data();
+            entry->journalId = journal_.add(je, head);
 
             entry->selected = false;
 
@@ -285,128 +294,40 @@ void BatchQueue::addEntries (const std::vector<BatchQueueEntry*>& entries, bool
 
 bool BatchQueue::saveBatchQueue ()
 {
-    const auto fileName = Glib::build_filename (options.user_config_dir, "batch", "queue.csv");
-
-    std::ofstream file (fileName, std::ios::binary | std::ios::trunc);
-
-    if (!file.is_open ())
-        return false;
-
-    {
-        MYREADERLOCK(l, entryRW);
-
-        if (fd.empty ())
-            return true;
-
-        // The column's header is mandatory (the first line will be skipped when loaded)
-        file << "input image full path|param file full path|output image full path|file format|jpeg quality|jpeg subsampling|"
-             << "png bit depth|png compression|tiff bit depth|tiff is float|uncompressed tiff|save output params|force format options|fast export|<end of line>"
-             << std::endl;
-
-        // method is already running with entryLock, so no need to lock again
-        for (const auto fdEntry : fd) {
-
-            const auto entry = static_cast<BatchQueueEntry*> (fdEntry);
-            const auto& saveFormat = entry->saveFormat;
-
-            // Warning: for code's simplicity in loadBatchQueue, each field must end by the '|' character, safer than ';' or ',' since it can't be used in paths
-#ifdef WIN32
-            // on windows it crashes if we don't use c_str() and filename etc. contain special (e.g. chinese) characters, see issue 3387
-            file << entry->filename.c_str() << '|' << entry->savedParamsFile.c_str() << '|' << entry->outFileName.c_str() << '|' << saveFormat.format << '|'
-#else
-            file << entry->filename << '|' << entry->savedParamsFile << '|' << entry->outFileName << '|' << saveFormat.format << '|'
-#endif
-                 << saveFormat.jpegQuality << '|' << saveFormat.jpegSubSamp << '|'
-                 << saveFormat.pngBits << '|'
-                 << saveFormat.tiffBits << '|'  << (saveFormat.tiffFloat ? 1 : 0) << '|'  << saveFormat.tiffUncompressed << '|'
-                 << saveFormat.saveParams << '|' << entry->forceFormatOpts << '|'
-                 << entry->fast_pipeline << '|'
-                 << std::endl;
-        }
-    }
-
-    return true;
+    return journal_.flush();
 }
 
 bool BatchQueue::loadBatchQueue ()
 {
-    const auto fileName = Glib::build_filename (options.user_config_dir, "batch", "queue.csv");
+    const auto entries = journal_.load();
 
-    std::ifstream file (fileName, std::ios::binary);
-
-    if (file.is_open ()) {
+    {
         // Yes, it's better to get the lock for the whole file reading,
         // to update the list in one shot without any other concurrent access!
         MYWRITERLOCK(l, entryRW);
 
-        std::string row, column;
-        std::vector<std::string> values;
-
-        // skipping the first row
-        std::getline (file, row);
-
-        while (std::getline (file, row)) {
-
-            std::istringstream line (row);
-
-            values.clear ();
-
-            while (std::getline(line, column, '|')) {
-                values.push_back (column);
-            }
-
-            auto value = values.begin ();
-
-            const auto nextStringOr = [&] (const Glib::ustring& defaultValue) -> Glib::ustring
-            {
-                return value != values.end () ? Glib::ustring(*value++) : defaultValue;
-            };
-            const auto nextIntOr = [&] (int defaultValue) -> int
-            {
-                try {
-                    return value != values.end () ? std::stoi(*value++) : defaultValue;
-                }
-                catch (std::exception&) {
-                    return defaultValue;
-                }
-            };
-
-            const auto source = nextStringOr (Glib::ustring ());
-            const auto paramsFile = nextStringOr (Glib::ustring ());
-
-            if (source.empty () || paramsFile.empty ())
-                continue;
-
-            const auto outputFile = nextStringOr (Glib::ustring ());
-            const auto saveFmt = nextStringOr (options.saveFormat.format);
-            const auto jpegQuality = nextIntOr (options.saveFormat.jpegQuality);
-            const auto jpegSubSamp = nextIntOr (options.saveFormat.jpegSubSamp);
-            const auto pngBits = nextIntOr (options.saveFormat.pngBits);
-            const auto tiffBits = nextIntOr (options.saveFormat.tiffBits);
-            const auto tiffFloat = nextIntOr (options.saveFormat.tiffFloat);
-            const auto tiffUncompressed = nextIntOr (options.saveFormat.tiffUncompressed);
-            const auto saveParams = nextIntOr (options.saveFormat.saveParams);
-            const auto forceFormatOpts = nextIntOr (options.forceFormatOpts);
-            const auto fast = nextIntOr(false);
-
+        for (const auto &e : entries) {
             rtengine::procparams::ProcParams pparams;
 
-            if (pparams.load(this, paramsFile)) {
+            if (!pparams.from_data(e.params.c_str())) {
+                journal_.cancel(e.id);
                 continue;
             }
 
-            auto thumb = CacheManager::getInstance ()->getEntry (source);
+            auto thumb = CacheManager::getInstance ()->getEntry (e.source);
 
-            if (!thumb)
+            if (!thumb) {
+                journal_.cancel(e.id);
                 continue;
+            }
 
-            auto job = rtengine::ProcessingJob::create (source, thumb->getType () == FT_Raw, pparams, fast);
+            auto job = rtengine::ProcessingJob::create (e.source, thumb->getType () == FT_Raw, pparams, e.fast);
 
             auto prevh = getMaxThumbnailHeight ();
             auto prevw = prevh;
             thumb->getThumbnailSize (prevw, prevh, &pparams);
 
-            auto entry = new BatchQueueEntry (job, pparams, source, prevw, prevh, thumb);
+            auto entry = new BatchQueueEntry (job, pparams, e.source, prevw, prevh, thumb);
             thumb->decreaseRef ();  // Removing the refCount acquired by cacheMgr->getEntry
             entry->setParent (this);
 
@@ -415,57 +336,27 @@ bool BatchQueue::loadBatchQueue ()
             bqbs->setButtonListener (this);
             entry->addButtonSet (bqbs);
 
-            entry->savedParamsFile = paramsFile;
+            entry->journalId = e.id;
             entry->selected = false;
-            entry->outFileName = outputFile;
-
-            if (!outputFile.empty ()) {
-                auto& saveFormat = entry->saveFormat;
-                saveFormat.format = saveFmt;
-                saveFormat.jpegQuality = jpegQuality;
-                saveFormat.jpegSubSamp = jpegSubSamp;
-                saveFormat.pngBits = pngBits;
-                saveFormat.tiffBits = tiffBits;
-                saveFormat.tiffFloat = tiffFloat == 1;
-                saveFormat.tiffUncompressed = tiffUncompressed != 0;
-                saveFormat.saveParams = saveParams != 0;
-                entry->forceFormatOpts = forceFormatOpts != 0;
-            } else {
-                entry->forceFormatOpts = false;
+            entry->outFileName = e.output;
+            entry->forceFormatOpts = e.forceFormatOpts;
+
+            if (!e.output.empty ()) {
+                entry->saveFormat = e.saveFormat;
             }
 
             fd.push_back (entry);
         }
     }
 
+    journal_.flush();
+
     redraw ();
     notifyListener ();
 
     return !fd.empty ();
 }
 
-Glib::ustring BatchQueue::getTempFilenameForParams( const Glib::ustring &filename )
-{
-    timeval tv;
-    gettimeofday(&tv, nullptr);
-    char mseconds[11];
-    sprintf(mseconds, "%d", (int)(tv.tv_usec / 1000));
-    time_t rawtime;
-    struct tm *timeinfo;
-    char stringTimestamp [80];
-    time ( &rawtime );
-    timeinfo = localtime ( &rawtime );
-    strftime (stringTimestamp, sizeof(stringTimestamp), "_%Y%m%d%H%M%S_", timeinfo);
-    Glib::ustring savedParamPath;
-    savedParamPath = options.user_config_dir + "/batch/";
-    g_mkdir_with_parents (savedParamPath.c_str (), 0755);
-    savedParamPath += Glib::path_get_basename (filename);
-    savedParamPath += stringTimestamp;
-    savedParamPath += mseconds;
-    savedParamPath += paramFileExtension;
-    return savedParamPath;
-}
-
 void BatchQueue::cancelItems(const std::vector<ThumbBrowserEntryBase*>& items, bool immediately)
 {
     std::set<BatchQueueEntry*> removable_bqes;
@@ -486,6 +377,7 @@ void BatchQueue::cancelItems(const std::vector<ThumbBrowserEntryBase*>& items, b
                 continue;
 
             fd.erase (pos);
+            journal_.cancel(entry->journalId);
 
             rtengine::ProcessingJob::destroy (entry->job);
 
@@ -505,7 +397,6 @@ void BatchQueue::cancelItems(const std::vector<ThumbBrowserEntryBase*>& items, b
     if (!removable_bqes.empty()) {
         if (immediately) {
             for (const auto entry : removable_bqes) {
-                ::g_remove(entry->savedParamsFile.c_str());
                 delete entry;
             }
         } else {
@@ -523,7 +414,6 @@ void BatchQueue::cancelItems(const std::vector<ThumbBrowserEntryBase*>& items, b
                     mutex_removable_batch_queue_entries.unlock();
 
                     for (const auto entry : removable_bqes) {
-                        ::g_remove(entry->savedParamsFile.c_str());
                         delete entry;
                     }
 
@@ -561,6 +451,7 @@ void BatchQueue::headItems (const std::vector<ThumbBrowserEntryBase*>& items)
             const auto newPos = std::find_if (fd.begin (), fd.end (), [] (const ThumbBrowserEntryBase* fdEntry) { return !fdEntry->processing; });
 
             fd.insert (newPos, entry);
+            journal_.moveToHead(entry->journalId);
         }
     }
 
@@ -589,6 +480,7 @@ void BatchQueue::tailItems (const std::vector<ThumbBrowserEntryBase*>& items)
             fd.erase (pos);
 
             fd.push_back (entry);
+            journal_.moveToTail(entry->journalId);
         }
     }
 
@@ -652,6 +544,7 @@ void BatchQueue::startProcessing ()
             next->processing = true;
             next->sequence = sequence = 1;
             processing = next;
+            write_failed_ = false;
 
             // remove from selection
             if (processing->selected) {
@@ -715,6 +608,11 @@ void BatchQueue::error(const Glib::ustring& descr)
         redraw ();
     }
 
+    notifyError(descr);
+}
+
+void BatchQueue::notifyError(const Glib::ustring& descr)
+{
     if (listener) {
         BatchQueueListener* const bql = listener;
         const bool running = processing;
@@ -905,6 +803,24 @@ Glib::ustring calcAutoFileNameBase(const Glib::ustring& origFileName, rtengine::
     return path;
 }
 
+
+// the listener of the writer threads. It reports the errors of the images
+// and params being saved (e.g. of their metadata), without touching the
+// state of the job being processed as BatchQueue::error does. The progress
+// of a write is not shown, since its entry has already left the queue
+class WriteListener: public rtengine::ProgressListener {
+public:
+    explicit WriteListener(std::function<void(const Glib::ustring &)> report): report_(report) {}
+
+    void setProgress(double p) override {}
+    void setProgressStr(const Glib::ustring &str) override {}
+    void setProgressState(bool inProcessing) override {}
+    void error(const Glib::ustring &descr) override { report_(descr); }
+
+private:
+    std::function<void(const Glib::ustring &)> report_;
+};
+
 } // namespace
 
 
@@ -933,66 +849,40 @@ rtengine::ProcessingJob* BatchQueue::imageReady(rtengine::IImagefloat* img)
 
     //printf ("fname=%s, %s\n", fname.c_str(), removeExtension(fname).c_str());
 
-    if (img && fname != "") {
-        int err = 0;
-        processing->processing = false;
-
-        img->setSaveProgressListener(this);
-
-        if (saveFormat.format == "tif") {
-            err = img->saveAsTIFF (fname, saveFormat.tiffBits, saveFormat.tiffFloat, saveFormat.tiffUncompressed);
-        } else if (saveFormat.format == "png") {
-            err = img->saveAsPNG (fname, saveFormat.pngBits);
-        } else if (saveFormat.format == "jpg") {
-            err = img->saveAsJPEG (fname, saveFormat.jpegQuality, saveFormat.jpegSubSamp);
-        } else {
-            err = rtengine::ImageIOManager::getInstance()->save(img, saveFormat.format, fname, this) ? 0 : 1;
-        }
+    BatchQueueEntry* const entry = processing;
+    const bool write = img && fname != "";
 
-        img->free ();
+    if (write) {
+        entry->processing = false;
 
-        if (err) {
-            throw Glib::FileError(Glib::FileError::FAILED, M("MAIN_MSG_CANNOTSAVE") + ": " + fname);
+        if (saveFormat.saveParams && batch_profile_ && entry->use_batch_profile) {
+            batch_profile_->applyTo(entry->params);
         }
 
-        if (saveFormat.saveParams) {
-            // We keep the extension to avoid overwriting the profile when we have
-            // the same output filename with different extension
-            //processing->params.save (removeExtension(fname) + paramFileExtension);
-            if (batch_profile_ && processing->use_batch_profile) {
-                batch_profile_->applyTo(processing->params);
-            }
-            auto sidecar = fname + ".out" + paramFileExtension;
-            if (!options.params_out_embed) {
-                processing->params.save(this, sidecar);
-            } else if (processing->params.saveEmbedded(this, fname) != 0) {
-                error(Glib::ustring::compose(M("PROCPARAMS_EMBEDDED_SAVE_WARNING"), fname, sidecar));
-                processing->params.save(this, sidecar);
-            }
-        }
-
-        if (processing->thumbnail) {
-            processing->thumbnail->imageDeveloped ();
-            processing->thumbnail->imageRemovedFromQueue ();
-        }
+        MyMutex::MyLock lock(pending_outputs_mutex_);
+        pending_outputs_.insert(fname);
+    } else {
+        journal_.complete(entry->journalId);
     }
 
-    // save temporary params file name: delete as last thing
-    Glib::ustring processedParams = processing->savedParamsFile;
-
     // delete from the queue
     bool remove_button_set = false;
 
     {
         MYWRITERLOCK(l, entryRW);
 
-        delete processing;
         processing = nullptr;
 
-        fd.erase (fd.begin());
+        // not necessarily the first one, a failed write might have been
+        // put back at the head in the meantime
+        fd.erase (std::find (fd.begin(), fd.end(), entry));
+
+        if (!write) {
+            delete entry;
+        }
 
         // return next job
-        if (!fd.empty() && listener && listener->canStartNext ()) {
+        if (!fd.empty() && listener && listener->canStartNext () && !write_failed_) {
             BatchQueueEntry* next = static_cast<BatchQueueEntry*>(fd[0]);
             // tag it as selected and set sequence
             next->processing = true;
@@ -1015,6 +905,17 @@ rtengine::ProcessingJob* BatchQueue::imageReady(rtengine::IImagefloat* img)
         }
     }
 
+    if (write) {
+        // encode and save in the background, the writer takes care of
+        // the entry from now on. This blocks while too many images are
+        // waiting to be written
+        writer_.push(
+            [this, entry, img, fname, saveFormat]() -> void
+            {
+                writeImage(entry, img, fname, saveFormat);
+            });
+    }
+
     if (remove_button_set) {
         // ButtonSet have Cairo::Surface which might be rendered while we're trying to delete them
         GThreadLock lock;
@@ -1022,8 +923,6 @@ rtengine::ProcessingJob* BatchQueue::imageReady(rtengine::IImagefloat* img)
     }
 
     if (saveBatchQueue ()) {
-        ::g_remove (processedParams.c_str ());
-
         // Delete all files in directory batch when finished, just to be sure to remove zombies
         auto isEmpty = false;
 
@@ -1042,7 +941,11 @@ rtengine::ProcessingJob* BatchQueue::imageReady(rtengine::IImagefloat* img)
                 auto enumerator = dir->enumerate_children ("standard::name");
 
                 while (auto file = enumerator->next_file ()) {
-                    ::g_remove (Glib::build_filename (batchdir, file->get_name ()).c_str ());
+                    // the journal removes its own files when the queue
+                    // is empty, leave alone those of entries added since
+                    if (!BatchQueueJournal::owns(file->get_name ())) {
+                        ::g_remove (Glib::build_filename (batchdir, file->get_name ()).c_str ());
+                    }
                 }
 
             } catch (Glib::Exception&) {}
@@ -1056,6 +959,93 @@ rtengine::ProcessingJob* BatchQueue::imageReady(rtengine::IImagefloat* img)
 }
 
 
+void BatchQueue::writeImage(BatchQueueEntry* entry, rtengine::IImagefloat* img, const Glib::ustring& fname, const SaveFormat& saveFormat)
+{
+    int err = 0;
+
+    WriteListener pl([this](const Glib::ustring &descr) { notifyError(descr); });
+    img->setSaveProgressListener(&pl);
+
+    if (saveFormat.format == "tif") {
+        err = img->saveAsTIFF (fname, saveFormat.tiffBits, saveFormat.tiffFloat, saveFormat.tiffUncompressed);
+    } else if (saveFormat.format == "png") {
+        err = img->saveAsPNG (fname, saveFormat.pngBits);
+    } else if (saveFormat.format == "jpg") {
+        err = img->saveAsJPEG (fname, saveFormat.jpegQuality, saveFormat.jpegSubSamp);
+    } else {
+        err = rtengine::ImageIOManager::getInstance()->save(img, saveFormat.format, fname, &pl) ? 0 : 1;
+    }
+
+    img->free ();
+
+    if (err) {
+        writeFailed(entry, M("MAIN_MSG_CANNOTSAVE") + ": " + fname);
+    } else {
+        if (saveFormat.saveParams) {
+            // We keep the extension to avoid overwriting the profile when we have
+            // the same output filename with different extension
+            auto sidecar = fname + ".out" + paramFileExtension;
+            if (!options.params_out_embed) {
+                entry->params.save(&pl, sidecar);
+            } else if (entry->params.saveEmbedded(&pl, fname) != 0) {
+                notifyError(Glib::ustring::compose(M("PROCPARAMS_EMBEDDED_SAVE_WARNING"), fname, sidecar));
+                entry->params.save(&pl, sidecar);
+            }
+        }
+
+        if (entry->thumbnail) {
+            entry->thumbnail->imageDeveloped ();
+            entry->thumbnail->imageRemovedFromQueue ();
+        }
+
+        journal_.complete(entry->journalId);
+        saveBatchQueue ();
+
+        delete entry;
+    }
+
+    {
+        MyMutex::MyLock lock(pending_outputs_mutex_);
+        pending_outputs_.erase(fname);
+    }
+
+    notifyListener ();
+}
+
+
+void BatchQueue::writeFailed(BatchQueueEntry* entry, const Glib::ustring& descr)
+{
+    // put the entry back at the head of the queue, and stop the processing
+    // after the current job
+    write_failed_ = true;
+
+    bool is_raw = false;
+    if (entry->thumbnail) {
+        is_raw = entry->thumbnail->getType() == FT_Raw;
+    } else if (auto thumb = CacheManager::getInstance()->getEntry(entry->filename)) {
+        is_raw = thumb->getType() == FT_Raw;
+        thumb->decreaseRef();
+    }
+    entry->job = rtengine::ProcessingJob::create(entry->filename, is_raw, entry->params, entry->fast_pipeline);
+
+    BatchQueueButtonSet* bqbs = new BatchQueueButtonSet (entry);
+    bqbs->setButtonListener (this);
+    entry->addButtonSet (bqbs);
+
+    {
+        MYWRITERLOCK(l, entryRW);
+
+        const auto pos = std::find_if (fd.begin (), fd.end (), [] (const ThumbBrowserEntryBase* fdEntry) { return !fdEntry->processing; });
+        fd.insert (pos, entry);
+        journal_.moveToHead(entry->journalId);
+    }
+
+    saveBatchQueue ();
+    redraw ();
+    notifyError(descr);
+}
+
+
 Glib::ustring BatchQueue::autoCompleteFileName (const Glib::ustring& fileName, const Glib::ustring& format)
 {
 
@@ -1086,6 +1076,14 @@ Glib::ustring BatchQueue::autoCompleteFileName (const Glib::ustring& fileName, c
             fname = Glib::ustring::compose ("%1-%2.%3", Glib::build_filename (dstdir,  dstfname), tries, ext);
         }
 
+        {
+            // taken by an earlier job whose output is still being written
+            MyMutex::MyLock lock(pending_outputs_mutex_);
+            if (pending_outputs_.count(fname)) {
+                continue;
+            }
+        }
+
         int fileExists = Glib::file_test (fname, Glib::FILE_TEST_EXISTS);
 
         if (inOverwriteMode && fileExists) {
@@ -1119,7 +1117,11 @@ void BatchQueue::buttonPressed (LWButton* button, int actionCode, void* actionDa
 
 void BatchQueue::notifyListener ()
 {
-    const bool queueRunning = processing;
+    bool queueRunning = processing;
+    if (!queueRunning) {
+        MyMutex::MyLock lock(pending_outputs_mutex_);
+        queueRunning = !pending_outputs_.empty();
+    }
     if (listener) {
         BatchQueueListener* const bql = listener;
 
@@ -19,6 +19,7 @@
 #ifndef _BATCHQUEUE_
 #define _BATCHQUEUE_
 
+#include <atomic>
 #include <set>
 
 #include <gtkmm.h>
@@ -26,6 +27,8 @@
 #include "../rtengine/rtengine.h"
 
 #include "batchqueueentry.h"
+#include "batchqueuejournal.h"
+#include "batchqueuewriter.h"
 #include "lwbuttonset.h"
 #include "options.h"
 #include "threadutils.h"
@@ -100,9 +103,13 @@ private:
     int  getThumbnailHeight () override;
 
     Glib::ustring autoCompleteFileName (const Glib::ustring& fileName, const Glib::ustring& format);
-    Glib::ustring getTempFilenameForParams( const Glib::ustring &filename );
     bool saveBatchQueue ();
     void notifyListener ();
+    void notifyError(const Glib::ustring& descr);
+
+    // these run on the threads of writer_
+    void writeImage(BatchQueueEntry* entry, rtengine::IImagefloat* img, const Glib::ustring& fname, const SaveFormat& saveFormat);
+    void writeFailed(BatchQueueEntry* entry, const Glib::ustring& descr);
 
     using ThumbBrowserBase::redrawEntryNeeded;
 
@@ -129,6 +136,14 @@ private:
 
     const rtengine::procparams::PartialProfile *batch_profile_;
 
+    BatchQueueJournal journal_;
+
+    // output file names of the images not yet written by writer_
+    std::set<Glib::ustring> pending_outputs_;
+    MyMutex pending_outputs_mutex_;
+    std::atomic<bool> write_failed_;
+    BatchQueueWriter writer_;
+
     std::unordered_map<std::string, std::string> format2ext_;
 };
 
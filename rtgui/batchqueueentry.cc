@@ -37,6 +37,7 @@ BatchQueueEntry::BatchQueueEntry (rtengine::ProcessingJob* pjob, const rtengine:
     origph(prevh),
     job(pjob),
     params(pparams),
+    journalId(0),
     progress(0),
     outFileName(""),
     sequence(0),
@@ -48,7 +48,7 @@ public:
 
     rtengine::ProcessingJob* job;
     rtengine::procparams::ProcParams params;
-    Glib::ustring savedParamsFile;
+    size_t journalId; // id of the entry in the journal of the queue
     double progress;
     Glib::ustring outFileName;
     int sequence;
@@ -0,0 +1,666 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchqueuejournal.h"
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+#include <glib/gstdio.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+/*
+ * Format of the journal: a header line followed by one record per line.
+ * As in the old queue.csv, each field is terminated by '|', which can't
+ * appear in paths; a line not ending with '|' is a record interrupted by a
+ * crash, and it is ignored.
+ *
+ *   ART batch queue journal|<version>|<generation of the params store>|
+ *   +|<id>|<at head>|<params offset>|<params length>|<source>|<output>|<format>|...|
+ *   -|<id>|    completed
+ *   x|<id>|    cancelled
+ *   ^|<id>|    moved to the head of the queue
+ *   $|<id>|    moved to the tail of the queue
+ *
+ * The params of an entry are stored at the given offset of
+ * queue-<generation>.params.
+ */
+
+namespace {
+
+constexpr const char *JOURNAL_NAME = "queue.journal";
+constexpr const char *HEADER = "ART batch queue journal";
+constexpr int VERSION = 1;
+
+// number of fields of the info part of a '+' record
+constexpr size_t INFO_FIELDS = 12;
+
+// the journal is compacted when it has more than twice as many records as
+// entries in the queue, plus this
+constexpr size_t COMPACT_SLACK = 256;
+
+
+void split(const std::string &line, std::vector<std::string> &fields)
+{
+    fields.clear();
+    std::istringstream in(line);
+    std::string f;
+    while (std::getline(in, f, '|')) {
+        fields.push_back(f);
+    }
+}
+
+
+std::string format_info(const BatchQueueJournal::Entry &e)
+{
+    const auto &sf = e.saveFormat;
+    std::ostringstream out;
+    out << e.source.raw() << '|' << e.output.raw() << '|' << sf.format.raw() << '|'
+        << sf.jpegQuality << '|' << sf.jpegSubSamp << '|'
+        << sf.pngBits << '|'
+        << sf.tiffBits << '|' << (sf.tiffFloat ? 1 : 0) << '|' << (sf.tiffUncompressed ? 1 : 0) << '|'
+        << (sf.saveParams ? 1 : 0) << '|' << (e.forceFormatOpts ? 1 : 0) << '|'
+        << (e.fast ? 1 : 0) << '|';
+    return out.str();
+}
+
+
+// parses the fields of a line of the journal or of the old queue.csv,
+// starting at begin (source, output, format, ...); missing or invalid
+// values get the defaults from the options
+void parse_info(const std::vector<std::string> &fields, size_t begin, BatchQueueJournal::Entry &e)
+{
+    auto value = fields.begin() + std::min(begin, fields.size());
+
+    const auto nextStringOr =
+        [&](const Glib::ustring &defaultValue) -> Glib::ustring
+        {
+            return value != fields.end() ? Glib::ustring(*value++) : defaultValue;
+        };
+    const auto nextIntOr =
+        [&](int defaultValue) -> int
+        {
+            try {
+                return value != fields.end() ? std::stoi(*value++) : defaultValue;
+            } catch (std::exception &) {
+                return defaultValue;
+            }
+        };
+
+    e.source = nextStringOr(Glib::ustring());
+    e.output = nextStringOr(Glib::ustring());
+
+    auto &sf = e.saveFormat;
+    sf.format = nextStringOr(options.saveFormat.format);
+    sf.jpegQuality = nextIntOr(options.saveFormat.jpegQuality);
+    sf.jpegSubSamp = nextIntOr(options.saveFormat.jpegSubSamp);
+    sf.pngBits = nextIntOr(options.saveFormat.pngBits);
+    sf.tiffBits = nextIntOr(options.saveFormat.tiffBits);
+    sf.tiffFloat = nextIntOr(options.saveFormat.tiffFloat) == 1;
+    sf.tiffUncompressed = nextIntOr(options.saveFormat.tiffUncompressed) != 0;
+    sf.saveParams = nextIntOr(options.saveFormat.saveParams) != 0;
+    e.forceFormatOpts = nextIntOr(options.forceFormatOpts) != 0;
+    e.fast = nextIntOr(false) != 0;
+
+    if (e.output.empty()) {
+        e.forceFormatOpts = false;
+    }
+}
+
+
+std::string record(char op, size_t id)
+{
+    std::string ret(1, op);
+    ret += '|';
+    ret += std::to_string(id);
+    ret += "|\n";
+    return ret;
+}
+
+
+bool write_all(FILE *f, const std::string &data)
+{
+    return data.empty() || fwrite(data.data(), 1, data.size(), f) == data.size();
+}
+
+} // namespace
+
+
+BatchQueueJournal::BatchQueueJournal(const Glib::ustring &dir):
+    dir_(dir),
+    next_id_(1),
+    generation_(0),
+    store_size_(0),
+    records_(0),
+    has_header_(false),
+    pending_records_(0)
+{
+}
+
+
+Glib::ustring BatchQueueJournal::journalFile() const
+{
+    return Glib::build_filename(dir_, JOURNAL_NAME);
+}
+
+
+Glib::ustring BatchQueueJournal::storeFile(int generation) const
+{
+    return Glib::build_filename(dir_, "queue-" + std::to_string(generation) + ".params");
+}
+
+
+bool BatchQueueJournal::owns(const Glib::ustring &basename)
+{
+    const std::string name = basename;
+    const std::string journal = JOURNAL_NAME;
+    const std::string ext = ".params";
+    return name == journal || name == journal + ".tmp" ||
+        (name.compare(0, 6, "queue-") == 0 && name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0);
+}
+
+
+void BatchQueueJournal::insert(size_t id, Item &&item, bool head)
+{
+    if (items_.find(id) != items_.end()) {
+        return;
+    }
+    item.pos = order_.insert(head ? order_.begin() : order_.end(), id);
+    items_.emplace(id, std::move(item));
+    next_id_ = std::max(next_id_, id + 1);
+}
+
+
+void BatchQueueJournal::drop(size_t id)
+{
+    auto it = items_.find(id);
+    if (it != items_.end()) {
+        order_.erase(it->second.pos);
+        items_.erase(it);
+    }
+}
+
+
+void BatchQueueJournal::relocate(size_t id, bool head)
+{
+    auto it = items_.find(id);
+    if (it != items_.end()) {
+        order_.splice(head ? order_.begin() : order_.end(), order_, it->second.pos);
+    }
+}
+
+
+void BatchQueueJournal::log(const std::string &rec)
+{
+    pending_ += rec;
+    ++pending_records_;
+}
+
+
+bool BatchQueueJournal::apply(const std::string &line, std::vector<std::string> &fields)
+{
+    if (line.empty() || line.back() != '|') {
+        return false;
+    }
+
+    split(line, fields);
+    if (fields.size() < 2 || fields[0].size() != 1) {
+        return false;
+    }
+
+    try {
+        const size_t id = std::stoull(fields[1]);
+
+        switch (fields[0][0]) {
+        case '+': {
+            if (fields.size() != 5 + INFO_FIELDS) {
+                return false;
+            }
+            Item item;
+            item.offset = std::stoll(fields[3]);
+            item.length = std::stoll(fields[4]);
+            for (size_t i = 5; i < fields.size(); ++i) {
+                item.info += fields[i];
+                item.info += '|';
+            }
+            insert(id, std::move(item), fields[2] == "1");
+            break;
+        }
+        case '-':
+        case 'x':
+            drop(id);
+            break;
+        case '^':
+        case '$':
+            relocate(id, fields[0][0] == '^');
+            break;
+        default:
+            return false;
+        }
+    } catch (std::exception &) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void BatchQueueJournal::importLegacy(std::unordered_map<size_t, std::string> &params, std::vector<Glib::ustring> &files)
+{
+    const auto fileName = Glib::build_filename(dir_, "queue.csv");
+
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    files.push_back(fileName);
+
+    std::string row;
+    std::vector<std::string> values;
+
+    // skipping the first row
+    std::getline(file, row);
+
+    while (std::getline(file, row)) {
+        split(row, values);
+
+        // input image|param file|output image|format|...
+        if (values.size() < 2 || values[0].empty() || values[1].empty()) {
+            continue;
+        }
+
+        const Glib::ustring paramsFile = values[1];
+        files.push_back(paramsFile);
+
+        std::string data;
+        try {
+            data = Glib::file_get_contents(paramsFile);
+        } catch (Glib::Exception &) {
+            continue;
+        }
+
+        values.erase(values.begin() + 1);
+
+        Entry e;
+        parse_info(values, 0, e);
+
+        Item item;
+        item.offset = 0;
+        item.length = data.size();
+        item.info = format_info(e);
+
+        const size_t id = next_id_;
+        insert(id, std::move(item), false);
+        params[id] = std::move(data);
+    }
+}
+
+
+bool BatchQueueJournal::rewrite(const std::function<bool(size_t, const Item &, std::string &)> &get_params)
+{
+    g_mkdir_with_parents(dir_.c_str(), 0755);
+
+    const int generation = generation_ + 1;
+    const auto store_name = storeFile(generation);
+    const auto tmp_name = journalFile() + ".tmp";
+
+    FILE *store = g_fopen(store_name.c_str(), "wb");
+    FILE *journal = g_fopen(tmp_name.c_str(), "wb");
+
+    bool ok = store && journal;
+
+    std::string out = std::string(HEADER) + "|" + std::to_string(VERSION) + "|" + std::to_string(generation) + "|\n";
+    std::vector<std::pair<size_t, int64_t>> offsets;
+    std::vector<size_t> missing;
+    std::string data;
+    int64_t offset = 0;
+
+    for (auto id : order_) {
+        if (!ok) {
+            break;
+        }
+
+        const auto &item = items_[id];
+        if (!get_params(id, item, data)) {
+            missing.push_back(id);
+            continue;
+        }
+
+        ok = write_all(store, data);
+        offsets.emplace_back(id, offset);
+        out += "+|" + std::to_string(id) + "|0|" + std::to_string(offset) + "|" + std::to_string(data.size()) + "|" + item.info + "\n";
+        offset += data.size();
+    }
+
+    ok = ok && write_all(journal, out);
+    if (store) {
+        ok = (fclose(store) == 0) && ok;
+    }
+    if (journal) {
+        ok = (fclose(journal) == 0) && ok;
+    }
+
+    if (ok) {
+#ifdef WIN32
+        // rename does not replace existing files on Windows
+        ::g_remove(journalFile().c_str());
+#endif
+        ok = ::g_rename(tmp_name.c_str(), journalFile().c_str()) == 0;
+    }
+
+    if (!ok) {
+        ::g_remove(store_name.c_str());
+        ::g_remove(tmp_name.c_str());
+        return false;
+    }
+
+    ::g_remove(storeFile(generation_).c_str());
+
+    for (auto id : missing) {
+        drop(id);
+    }
+    for (auto &p : offsets) {
+        auto &item = items_[p.first];
+        item.offset = p.second;
+    }
+
+    generation_ = generation;
+    store_size_ = offset;
+    records_ = order_.size();
+    has_header_ = true;
+    pending_.clear();
+    pending_params_.clear();
+    pending_records_ = 0;
+
+    return true;
+}
+
+
+std::vector<BatchQueueJournal::Entry> BatchQueueJournal::load()
+{
+    MyMutex::MyLock lock(mutex_);
+
+    order_.clear();
+    items_.clear();
+    pending_.clear();
+    pending_params_.clear();
+    pending_records_ = 0;
+    records_ = 0;
+    store_size_ = 0;
+    has_header_ = false;
+
+    std::unordered_map<size_t, std::string> params;
+    std::vector<Glib::ustring> legacy_files;
+
+    std::string data;
+    bool found = false;
+    for (auto name : { journalFile(), journalFile() + ".tmp" }) {
+        // the .tmp file is used only if a crash happened at the wrong
+        // moment while rewriting the journal on Windows
+        try {
+            data = Glib::file_get_contents(name);
+            found = true;
+            break;
+        } catch (Glib::Exception &) {
+        }
+    }
+
+    if (found) {
+        std::istringstream in(data);
+        std::string line;
+        std::vector<std::string> fields;
+
+        std::getline(in, line);
+        split(line, fields);
+        bool valid = fields.size() == 3 && fields[0] == HEADER && fields[1] == std::to_string(VERSION);
+        if (valid) {
+            try {
+                generation_ = std::stoi(fields[2]);
+            } catch (std::exception &) {
+                valid = false;
+            }
+        }
+
+        if (valid) {
+            while (std::getline(in, line)) {
+                apply(line, fields);
+            }
+
+            FILE *store = g_fopen(storeFile(generation_).c_str(), "rb");
+            if (store) {
+                for (auto &p : items_) {
+                    auto &s = params[p.first];
+                    s.resize(p.second.length);
+                    if (fseek(store, p.second.offset, SEEK_SET) != 0 || fread(&s[0], 1, s.size(), store) != s.size()) {
+                        params.erase(p.first);
+                    }
+                }
+                fclose(store);
+            }
+        }
+    } else {
+        importLegacy(params, legacy_files);
+    }
+
+    std::vector<Entry> ret;
+    std::vector<std::string> fields;
+    for (auto id : order_) {
+        auto it = params.find(id);
+        if (it != params.end()) {
+            ret.emplace_back();
+            auto &e = ret.back();
+            e.id = id;
+            split(items_[id].info, fields);
+            parse_info(fields, 0, e);
+            e.params = it->second;
+        }
+    }
+
+    if (order_.empty()) {
+        ::g_remove(journalFile().c_str());
+        ::g_remove((journalFile() + ".tmp").c_str());
+        ::g_remove(storeFile(generation_).c_str());
+        for (auto &f : legacy_files) {
+            ::g_remove(f.c_str());
+        }
+    } else {
+        // compact the journal, so that it does not contain any incomplete
+        // record (and it does not refer to any missing params)
+        const bool ok = rewrite(
+            [&](size_t id, const Item &item, std::string &out) -> bool
+            {
+                auto it = params.find(id);
+                if (it == params.end()) {
+                    return false;
+                }
+                out = it->second;
+                return true;
+            });
+        if (ok) {
+            for (auto &f : legacy_files) {
+                ::g_remove(f.c_str());
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+size_t BatchQueueJournal::add(const Entry &entry, bool head)
+{
+    MyMutex::MyLock lock(mutex_);
+
+    const size_t id = next_id_;
+
+    Item item;
+    item.offset = store_size_ + pending_params_.size();
+    item.length = entry.params.size();
+    item.info = format_info(entry);
+
+    log("+|" + std::to_string(id) + "|" + (head ? "1" : "0") + "|" + std::to_string(item.offset) + "|" + std::to_string(item.length) + "|" + item.info + "\n");
+    pending_params_ += entry.params;
+    insert(id, std::move(item), head);
+
+    return id;
+}
+
+
+void BatchQueueJournal::complete(size_t id)
+{
+    MyMutex::MyLock lock(mutex_);
+    drop(id);
+    log(record('-', id));
+}
+
+
+void BatchQueueJournal::cancel(size_t id)
+{
+    MyMutex::MyLock lock(mutex_);
+    drop(id);
+    log(record('x', id));
+}
+
+
+void BatchQueueJournal::moveToHead(size_t id)
+{
+    MyMutex::MyLock lock(mutex_);
+    relocate(id, true);
+    log(record('^', id));
+}
+
+
+void BatchQueueJournal::moveToTail(size_t id)
+{
+    MyMutex::MyLock lock(mutex_);
+    relocate(id, false);
+    log(record('$', id));
+}
+
+
+bool BatchQueueJournal::append()
+{
+    g_mkdir_with_parents(dir_.c_str(), 0755);
+
+    FILE *store = g_fopen(storeFile(generation_).c_str(), "ab");
+    if (!store) {
+        return false;
+    }
+    // after a failed write, the store might contain garbage at the end:
+    // the offsets of the pending params would be wrong
+    bool ok = fseek(store, 0, SEEK_END) == 0 && int64_t(ftell(store)) == store_size_;
+    ok = ok && write_all(store, pending_params_);
+    ok = (fclose(store) == 0) && ok;
+    if (!ok) {
+        return false;
+    }
+
+    FILE *journal = g_fopen(journalFile().c_str(), "ab");
+    if (!journal) {
+        return false;
+    }
+    if (!has_header_) {
+        ok = write_all(journal, std::string(HEADER) + "|" + std::to_string(VERSION) + "|" + std::to_string(generation_) + "|\n");
+    }
+    ok = ok && write_all(journal, pending_);
+    ok = (fclose(journal) == 0) && ok;
+    if (!ok) {
+        return false;
+    }
+
+    store_size_ += pending_params_.size();
+    records_ += pending_records_;
+    has_header_ = true;
+    pending_.clear();
+    pending_params_.clear();
+    pending_records_ = 0;
+
+    return true;
+}
+
+
+bool BatchQueueJournal::flush()
+{
+    MyMutex::MyLock lock(mutex_);
+
+    if (order_.empty()) {
+        // nothing left to recover
+        if (has_header_ || pending_records_) {
+            ::g_remove(journalFile().c_str());
+            ::g_remove(storeFile(generation_).c_str());
+        }
+        records_ = 0;
+        store_size_ = 0;
+        has_header_ = false;
+        pending_.clear();
+        pending_params_.clear();
+        pending_records_ = 0;
+        return true;
+    }
+
+    if (!pending_records_) {
+        return true;
+    }
+
+    if (records_ + pending_records_ <= 2 * order_.size() + COMPACT_SLACK && append()) {
+        return true;
+    }
+
+    // too many obsolete records, or the files are in an inconsistent
+    // state because of a failed write: rewrite everything
+    FILE *store = has_header_ ? g_fopen(storeFile(generation_).c_str(), "rb") : nullptr;
+    const bool ok = rewrite(
+        [&](size_t id, const Item &item, std::string &out) -> bool
+        {
+            out.resize(item.length);
+            if (item.offset >= store_size_) {
+                const size_t start = item.offset - store_size_;
+                if (start + item.length > pending_params_.size()) {
+                    return false;
+                }
+                out.assign(pending_params_, start, item.length);
+                return true;
+            }
+            return store && fseek(store, item.offset, SEEK_SET) == 0 && fread(&out[0], 1, out.size(), store) == out.size();
+        });
+    if (store) {
+        fclose(store);
+    }
+
+    return ok;
+}
+
+
+void BatchQueueJournal::clear()
+{
+    MyMutex::MyLock lock(mutex_);
+
+    ::g_remove(journalFile().c_str());
+    ::g_remove(storeFile(generation_).c_str());
+
+    order_.clear();
+    items_.clear();
+    records_ = 0;
+    store_size_ = 0;
+    has_header_ = false;
+    pending_.clear();
+    pending_params_.clear();
+    pending_records_ = 0;
+}
@@ -0,0 +1,123 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glibmm/ustring.h>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "options.h"
+#include "threadutils.h"
+
+/*
+ * Crash-recovery store for the batch queue.
+ *
+ * Operations on the queue (enqueue, completion, cancellation, moving to
+ * the head or the tail) are appended as one-line records to a journal,
+ * and the processing parameters of the queued images are appended to a
+ * single packed store, so that the cost of each operation does not depend
+ * on the length of the queue. Records are buffered and written by
+ * flush(), once per operation on the GUI side. When the journal contains
+ * too many obsolete records, it is compacted by rewriting it (and the
+ * params store) with just the entries still in the queue.
+ *
+ * Both files live in the "batch" subdirectory of the config dir. A queue
+ * saved in the old format (queue.csv plus one params file per entry) is
+ * imported by load().
+ */
+class BatchQueueJournal {
+public:
+    struct Entry {
+        size_t id;
+        Glib::ustring source;
+        Glib::ustring output;
+        SaveFormat saveFormat;
+        bool forceFormatOpts;
+        bool fast;
+        std::string params; // serialized ProcParams
+
+        Entry(): id(0), forceFormatOpts(false), fast(false) {}
+    };
+
+    explicit BatchQueueJournal(const Glib::ustring &dir);
+
+    // replays the journal, returning the entries still in the queue in
+    // their order. The journal is compacted afterwards, discarding any
+    // incomplete record left by a crash
+    std::vector<Entry> load();
+
+    // adds an entry, at the head or at the tail of the queue, and returns
+    // its id (the id field of entry is ignored)
+    size_t add(const Entry &entry, bool head);
+
+    void complete(size_t id);
+    void cancel(size_t id);
+    void moveToHead(size_t id);
+    void moveToTail(size_t id);
+
+    // writes the pending records to disk
+    bool flush();
+
+    // forgets all the entries, removing the files from disk
+    void clear();
+
+    // true if basename is the name of one of the files of the journal
+    static bool owns(const Glib::ustring &basename);
+
+private:
+    struct Item {
+        std::string info;  // source, output and format fields of the record
+        int64_t offset;    // location of the params in the store
+        int64_t length;
+        std::list<size_t>::iterator pos;
+    };
+
+    Glib::ustring journalFile() const;
+    Glib::ustring storeFile(int generation) const;
+
+    // these only update the in-memory state
+    void insert(size_t id, Item &&item, bool head);
+    void drop(size_t id);
+    void relocate(size_t id, bool head);
+
+    void log(const std::string &rec);
+    bool apply(const std::string &line, std::vector<std::string> &fields);
+    void importLegacy(std::unordered_map<size_t, std::string> &params, std::vector<Glib::ustring> &files);
+    bool append();
+    bool rewrite(const std::function<bool(size_t, const Item &, std::string &)> &get_params);
+
+    Glib::ustring dir_;
+    MyMutex mutex_;
+
+    std::list<size_t> order_;
+    std::unordered_map<size_t, Item> items_;
+    size_t next_id_;
+
+    int generation_;      // of the params store in use
+    int64_t store_size_;  // bytes of the store on disk
+    size_t records_;      // number of records in the journal on disk
+    bool has_header_;
+
+    std::string pending_;         // records not yet written
+    std::string pending_params_;  // params not yet written
+    size_t pending_records_;
+};
@@ -0,0 +1,97 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchqueuewriter.h"
+#include <algorithm>
+
+
+BatchQueueWriter::BatchQueueWriter(size_t workers, size_t capacity):
+    num_workers_(std::max(workers, size_t(1))),
+    capacity_(std::max(capacity, size_t(1))),
+    pending_(0),
+    stop_(false)
+{
+}
+
+
+BatchQueueWriter::~BatchQueueWriter()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    has_task_.notify_all();
+
+    for (auto &t : workers_) {
+        t.join();
+    }
+}
+
+
+void BatchQueueWriter::push(std::function<void()> &&task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    has_room_.wait(lock, [this]() { return pending_ < capacity_; });
+
+    // the workers are started on demand, most sessions never use the
+    // batch queue
+    if (workers_.empty()) {
+        for (size_t i = 0; i < num_workers_; ++i) {
+            workers_.emplace_back(&BatchQueueWriter::run, this);
+        }
+    }
+
+    tasks_.emplace_back(std::move(task));
+    ++pending_;
+    has_task_.notify_one();
+}
+
+
+void BatchQueueWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    has_room_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+
+void BatchQueueWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        has_task_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+
+        // pending tasks are completed even when stopping, they hold
+        // images that have already been processed
+        if (tasks_.empty()) {
+            break;
+        }
+
+        auto task = std::move(tasks_.front());
+        tasks_.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        --pending_;
+        has_room_.notify_all();
+    }
+}
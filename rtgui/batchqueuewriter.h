@@ -0,0 +1,65 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../rtengine/noncopyable.h"
+
+/*
+ * Write-behind stage of the batch queue: encoding and saving the output
+ * images runs on a few dedicated worker threads, so that the processing
+ * of the next image can start right away. At most "capacity" tasks
+ * (each holding a full-size output image) can be pending at any time;
+ * push() blocks until there is room for a new one.
+ *
+ * Dedicated threads are used instead of the global ThreadPool because
+ * push() is called from a ThreadPool task, which would deadlock waiting
+ * for room if the pool had a single worker.
+ */
+class BatchQueueWriter: public rtengine::NonCopyable {
+public:
+    BatchQueueWriter(size_t workers, size_t capacity);
+    // waits for the pending tasks to complete
+    ~BatchQueueWriter();
+
+    void push(std::function<void()> &&task);
+
+    // waits until there are no pending tasks
+    void wait();
+
+private:
+    void run();
+
+    const size_t num_workers_;
+    const size_t capacity_;
+
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    std::condition_variable has_room_;
+    std::deque<std::function<void()>> tasks_;
+    size_t pending_;
+    bool stop_;
+    std::vector<std::thread> workers_;
+};
@@ -30,6 +30,7 @@
 #include "../rtengine/ffmanager.h"
 #include "rtimage.h"
 #include "threadutils.h"
+#include "thumbbrowserlayout.h"
 #include "session.h"
 
 extern Options options;
@@ -236,6 +237,10 @@ FileBrowser::~FileBrowser ()
 {
     idle_register.destroy();
 
+    for (auto &p : pending) {
+        delete p.first;
+    }
+
     ProfileStore::getInstance()->removeListener(this);
     delete pmenu;
     delete pmenuColorLabels;
@@ -667,58 +672,93 @@ void FileBrowser::addEntry (FileBrowserEntry* entry)
 
     const unsigned int sid = session_id();
 
-    idle_register.add(
-        [this, entry, sid]() -> bool
-        {
-            if (sid != session_id()) {
-                delete entry;
-            } else {
-                addEntry_(entry);
+    // entries are collected and inserted in batches, so that loading a big
+    // directory doesn't cost one vector insertion and one relayout per file
+    bool schedule = false;
+    {
+        MyMutex::MyLock lock(pendingMutex);
+        schedule = pending.empty();
+        pending.emplace_back(entry, sid);
+    }
+
+    if (schedule) {
+        idle_register.add(
+            [this]() -> bool
+            {
+                flushPending();
+                return false;
             }
+        );
+    }
+}
 
-            return false;
+
+void FileBrowser::flushPending()
+{
+    std::vector<std::pair<FileBrowserEntry*, unsigned int>> batch;
+    {
+        MyMutex::MyLock lock(pendingMutex);
+        batch.swap(pending);
+    }
+
+    std::vector<FileBrowserEntry*> entries;
+    entries.reserve(batch.size());
+
+    for (auto &p : batch) {
+        if (p.second != session_id()) {
+            delete p.first;
+        } else {
+            entries.push_back(p.first);
         }
-    );
+    }
+
+    if (!entries.empty()) {
+        addEntries_(entries);
+    }
 }
 
+
 void FileBrowser::addEntry_ (FileBrowserEntry* entry)
 {
-    entry->selected = false;
-    entry->drawable = false;
-    entry->framed = editedFiles.find(entry->filename) != editedFiles.end();
-
-    // add button set to the thumbbrowserentry
-    entry->addButtonSet(new FileThumbnailButtonSet(entry));
-    entry->getThumbButtonSet()->setRank(entry->thumbnail->getRank());
-    entry->getThumbButtonSet()->setColorLabel(entry->thumbnail->getColorLabel());
-    entry->getThumbButtonSet()->setInTrash (entry->thumbnail->getInTrash());
-    entry->getThumbButtonSet()->setButtonListener(this);
-    entry->resize(getThumbnailHeight());
-    entry->filtered = !checkFilter(entry);
-
-    // find place in abc order
+    std::vector<FileBrowserEntry*> entries(1, entry);
+    addEntries_(entries);
+}
+
+
+void FileBrowser::addEntries_(std::vector<FileBrowserEntry*> &entries)
+{
+    for (auto entry : entries) {
+        entry->selected = false;
+        entry->drawable = false;
+        entry->framed = editedFiles.find(entry->filename) != editedFiles.end();
+
+        // add button set to the thumbbrowserentry
+        entry->addButtonSet(new FileThumbnailButtonSet(entry));
+        entry->getThumbButtonSet()->setRank(entry->thumbnail->getRank());
+        entry->getThumbButtonSet()->setColorLabel(entry->thumbnail->getColorLabel());
+        entry->getThumbButtonSet()->setInTrash (entry->thumbnail->getInTrash());
+        entry->getThumbButtonSet()->setButtonListener(this);
+        entry->resize(getThumbnailHeight());
+        entry->filtered = !checkFilter(entry);
+    }
+
+    ThumbnailSorter order(options.thumbnailOrder);
+    std::vector<ThumbBrowserEntryBase*> batch(entries.begin(), entries.end());
+    std::stable_sort(batch.begin(), batch.end(), order);
+
+    // merge the sorted batch into fd in a single linear pass, and lay out
+    // only what follows its first entry
+    size_t first = 0;
     {
         MYWRITERLOCK(l, entryRW);
 
-        ThumbnailSorter order(options.thumbnailOrder);
-
-        fd.insert(
-            std::lower_bound(
-                fd.begin(),
-                fd.end(),
-                entry,
-                // [](const ThumbBrowserEntryBase* a, const ThumbBrowserEntryBase* b)
-                // {
-                //     return *a < *b;
-                // }
-                order
-            ),
-            entry
-        );
+        first = thumbbrowserlayout::merge(fd, batch, order);
 
-        initEntry(entry);
+        for (auto entry : entries) {
+            initEntry(entry);
+        }
     }
-    redraw(false);
+    redrawNew(first);
 }
 
 FileBrowserEntry* FileBrowser::delEntry (const Glib::ustring& fname)
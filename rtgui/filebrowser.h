@@ -29,6 +29,7 @@
 #include "partialpastedlg.h"
 #include "extprog.h"
 #include "profilestorecombobox.h"
+#include "threadutils.h"
 
 class ProfileStoreLabel;
 class FileBrowser;
@@ -62,6 +63,11 @@ private:
     IdleRegister idle_register;
     unsigned int session_id_;
 
+    // entries produced by the thumbnail loader, waiting to be inserted
+    MyMutex pendingMutex;
+    std::vector<std::pair<FileBrowserEntry*, unsigned int>> pending;
+    void flushPending();
+
 protected:
     Gtk::MenuItem* rank[6];
     MyImageMenuItem* colorlabel[6];
@@ -142,6 +148,7 @@ public:
 
     void addEntry (FileBrowserEntry* entry); // can be called from any thread
     void addEntry_ (FileBrowserEntry* entry); // this must be executed inside the gtk thread
+    void addEntries_(std::vector<FileBrowserEntry*> &entries); // as above, for a batch of entries
     FileBrowserEntry*  delEntry (const Glib::ustring& fname);    // return the entry if found here return NULL otherwise
     void close ();
 
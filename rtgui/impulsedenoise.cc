@@ -21,6 +21,8 @@
 #include <cmath>
 #include <iomanip>
 #include "guiutils.h"
+#include "eventmapper.h"
+#include "../rtengine/medianfilter.h"
 
 using namespace rtengine;
 using namespace rtengine::procparams;
@@ -28,12 +30,19 @@ using namespace rtengine::procparams;
 ImpulseDenoise::ImpulseDenoise () : FoldableToolPanel(this, "impulsedenoise", M("TP_IMPULSEDENOISE_LABEL"), false, true, true)
 {
     EvToolReset.set_action(DETAIL);
+
+    auto m = ProcEventMapper::getInstance();
+    EvMedianRadius = m->newEvent(DETAIL, "HISTORY_MSG_IMPULSEDENOISE_MEDIAN_RADIUS");
     
     thresh = Gtk::manage (new Adjuster (M("TP_IMPULSEDENOISE_THRESH"), 0, 100, 1, 50));
+    medianRadius = Gtk::manage(new Adjuster(M("TP_IMPULSEDENOISE_MEDIAN_RADIUS"), 0, MEDIAN_FILTER_MAX_RADIUS, 1, 0));
+    medianRadius->set_tooltip_text(M("TP_IMPULSEDENOISE_MEDIAN_RADIUS_TOOLTIP"));
 
     pack_start (*thresh);
+    pack_start(*medianRadius);
 
     thresh->setAdjusterListener (this);
+    medianRadius->setAdjusterListener(this);
 
     show_all_children ();
 }
@@ -44,6 +53,7 @@ void ImpulseDenoise::read(const ProcParams* pp)
 
     setEnabled(pp->impulseDenoise.enabled);
     thresh->setValue (pp->impulseDenoise.thresh);
+    medianRadius->setValue(pp->impulseDenoise.medianRadius);
 
     enableListener ();
 }
@@ -51,19 +61,25 @@ void ImpulseDenoise::read(const ProcParams* pp)
 void ImpulseDenoise::write(ProcParams* pp)
 {
     pp->impulseDenoise.thresh    = thresh->getValue ();
+    pp->impulseDenoise.medianRadius = medianRadius->getValue();
     pp->impulseDenoise.enabled   = getEnabled();
 }
 
 void ImpulseDenoise::setDefaults(const ProcParams* defParams)
 {
     thresh->setDefault(defParams->impulseDenoise.thresh);
+    medianRadius->setDefault(defParams->impulseDenoise.medianRadius);
     initial_params = defParams->impulseDenoise;
 }
 
 void ImpulseDenoise::adjusterChanged(Adjuster* a, double newval)
 {
     if (listener && getEnabled()) {
-        listener->panelChanged (EvIDNThresh, Glib::ustring::format (std::setw(2), std::fixed, std::setprecision(1), a->getValue()));
+        if (a == medianRadius) {
+            listener->panelChanged(EvMedianRadius, a->getTextValue());
+        } else {
+            listener->panelChanged (EvIDNThresh, Glib::ustring::format (std::setw(2), std::fixed, std::setprecision(1), a->getValue()));
+        }
     }
 }
 
@@ -89,6 +105,7 @@ void ImpulseDenoise::trimValues (rtengine::procparams::ProcParams* pp)
 {
 
     thresh->trimValue(pp->impulseDenoise.thresh);
+    medianRadius->trimValue(pp->impulseDenoise.medianRadius);
 }
 
 
@@ -29,8 +29,11 @@ class ImpulseDenoise : public ToolParamBlock, public AdjusterListener, public Fo
 
 protected:
     Adjuster* thresh;
+    Adjuster* medianRadius;
     //Adjuster* edge;
 
+    rtengine::ProcEvent EvMedianRadius;
+
     rtengine::procparams::ImpulseDenoiseParams initial_params;
 
 public:
@@ -44,6 +44,7 @@
 #include "makeicc.h"
 #include "../rtengine/clutstore.h"
 #include "../rtengine/settings.h"
+#include "../rtengine/trace.h"
 
 #ifndef WIN32
 #include <glibmm/fileutils.h>
@@ -84,6 +85,164 @@ bool check_partial_profile(const PartialProfile &pp)
     return pp->applyTo(params);
 }
 
+
+int default_bits(const std::string &outputType)
+{
+    if (outputType == "jpg" || outputType == "png") {
+        return 8;
+    } else if (outputType == "tif") {
+        return 16;
+    } else {
+        return 32;
+    }
+}
+
+
+int save_output(rtengine::IImagefloat *img, const std::string &outputType, const Glib::ustring &outputFile, int compression, int subsampling, int bits, bool isFloat)
+{
+    if (outputType == "jpg") {
+        return img->saveAsJPEG(outputFile, compression, subsampling);
+    } else if (outputType == "tif") {
+        return img->saveAsTIFF(outputFile, bits, isFloat, compression == 0);
+    } else if (outputType == "png") {
+        return img->saveAsPNG(outputFile, bits);
+    } else {
+        return rtengine::ImageIOManager::getInstance()->save(img, outputType, outputFile, nullptr) ? 0 : 1;
+    }
+}
+
+
+/*
+ * An additional output requested with -x. Settings not given in the recipe
+ * are taken from the main output and the processing profile.
+ */
+struct OutputRecipe {
+    Glib::ustring suffix;
+    std::string type;
+    int compression;
+    int bits;
+    bool isFloat;
+    int resize; // -1: from the profile, 0: disabled, 1: enabled
+    int dataspec;
+    int width;
+    int height;
+    double scale;
+    Glib::ustring icc;
+    int sharpen; // -1: from the profile, 0: disabled, 1: enabled
+    rtengine::ResampleKernel kernel;
+
+    OutputRecipe():
+        compression(-1), bits(-1), isFloat(false),
+        resize(-1), dataspec(0), width(0), height(0), scale(1.0),
+        sharpen(-1), kernel(rtengine::ResampleKernel::LANCZOS3) {}
+
+    void apply(rtengine::procparams::ProcParams &params) const
+    {
+        if (resize == 0) {
+            params.resize.enabled = false;
+        } else if (resize == 1) {
+            params.resize.enabled = true;
+            params.resize.dataspec = dataspec;
+            params.resize.scale = scale;
+            params.resize.width = width;
+            params.resize.height = height;
+            params.resize.unit = rtengine::procparams::ResizeParams::PX;
+        }
+        if (!icc.empty()) {
+            params.icm.outputProfile = icc;
+        }
+        if (sharpen >= 0) {
+            params.prsharpening.enabled = sharpen;
+        }
+    }
+};
+
+
+// syntax: key=value[,key=value...], see ART_print_help
+bool parse_recipe(const Glib::ustring &recipe, size_t idx, OutputRecipe &out)
+{
+    out = OutputRecipe();
+    out.suffix = "_" + std::to_string(idx);
+
+    for (auto &item : Glib::Regex::split_simple(",", recipe)) {
+        auto pos = item.find('=');
+        if (pos == Glib::ustring::npos) {
+            return false;
+        }
+        Glib::ustring key = item.substr(0, pos);
+        Glib::ustring val = item.substr(pos+1);
+
+        try {
+            if (key == "suffix") {
+                out.suffix = val;
+            } else if (key == "type") {
+                out.type = val.lowercase();
+                if (out.type == "tifz") {
+                    out.type = "tif";
+                    out.compression = 1;
+                } else if (out.type == "tif") {
+                    out.compression = 0;
+                }
+            } else if (key == "q") {
+                out.compression = std::stoi(val);
+                if (out.compression < 1 || out.compression > 100) {
+                    return false;
+                }
+            } else if (key == "bits") {
+                out.isFloat = (val == "16f" || val == "32");
+                out.bits = std::stoi(val);
+                if (out.bits != 8 && out.bits != 16 && out.bits != 32) {
+                    return false;
+                }
+            } else if (key == "size") {
+                if (val == "full") {
+                    out.resize = 0;
+                } else {
+                    auto x = val.find('x');
+                    if (x == Glib::ustring::npos) {
+                        return false;
+                    }
+                    out.resize = 1;
+                    out.dataspec = 3;
+                    out.width = std::stoi(val.substr(0, x));
+                    out.height = std::stoi(val.substr(x+1));
+                }
+            } else if (key == "width") {
+                out.resize = 1;
+                out.dataspec = 1;
+                out.width = std::stoi(val);
+            } else if (key == "height") {
+                out.resize = 1;
+                out.dataspec = 2;
+                out.height = std::stoi(val);
+            } else if (key == "scale") {
+                out.resize = 1;
+                out.dataspec = 0;
+                out.scale = std::stod(val);
+            } else if (key == "icc") {
+                out.icc = val;
+            } else if (key == "sharpen") {
+                out.sharpen = std::stoi(val) != 0;
+            } else if (key == "kernel") {
+                if (val == "lanczos") {
+                    out.kernel = rtengine::ResampleKernel::LANCZOS3;
+                } else if (val == "mitchell") {
+                    out.kernel = rtengine::ResampleKernel::MITCHELL;
+                } else if (val == "box") {
+                    out.kernel = rtengine::ResampleKernel::BOX;
+                } else {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        } catch (std::exception &) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace
 
 
@@ -247,6 +406,8 @@ int main (int argc, char **argv)
         std::cout << "Terminating without anything to do." << std::endl;
     }
 
+    rtengine::trace::finish();
+
     return ret;
 }
 
@@ -350,6 +511,109 @@ private:
 };
 
 
+namespace {
+
+/*
+ * Runs the pipeline once for the main output and all the additional ones
+ * given with -x, and saves the results in parallel.
+ */
+bool process_multi(rtengine::ProcessingJob *job, rtengine::procparams::ProcParams &params, const std::vector<OutputRecipe> &recipes, const std::unordered_map<std::string, Glib::ustring> &output_ext, const Glib::ustring &outputFile, const std::string &outputType, int compression, int subsampling, int bits, bool isFloat, bool overwriteFiles, bool copyParamsFile, ConsoleProgressListener &cpl, rtengine::ProgressListener *pl)
+{
+    struct Output {
+        Glib::ustring fname;
+        std::string type;
+        int compression;
+        int bits;
+        bool isFloat;
+        rtengine::IImagefloat *img;
+        int error;
+    };
+    
+    std::vector<Output> outputs;
+    std::vector<rtengine::ExportBranch> branches;
+    std::vector<rtengine::procparams::ProcParams> outparams; // saved with each output
+
+    outputs.push_back({ outputFile, outputType, compression, bits, isFloat, nullptr, 0 });
+    branches.emplace_back(params);
+    outparams.push_back(params);
+
+    const Glib::ustring base = outputFile.substr(0, outputFile.find_last_of('.'));
+    for (auto &r : recipes) {
+        Output o;
+        o.type = r.type.empty() ? outputType : r.type;
+        auto it = output_ext.find(o.type);
+        o.fname = base + r.suffix + "." + (it != output_ext.end() && !it->second.empty() ? it->second : Glib::ustring(o.type));
+        o.compression = r.compression >= 0 ? r.compression : (o.type == outputType ? compression : (o.type == "jpg" ? 92 : (o.type == "png" ? -1 : 0)));
+        o.bits = r.bits > 0 ? r.bits : (o.type == outputType ? bits : default_bits(o.type));
+        o.isFloat = r.bits > 0 ? r.isFloat : (o.type == outputType && isFloat);
+        o.img = nullptr;
+        o.error = 0;
+
+        if (!overwriteFiles && Glib::file_test(o.fname, Glib::FILE_TEST_EXISTS)) {
+            cpl.error(Glib::ustring::compose("%1 already exists: use -Y option to overwrite. This image has been skipped.", o.fname));
+            rtengine::ProcessingJob::destroy(job);
+            return false;
+        }
+
+        rtengine::procparams::ProcParams bparams = params;
+        auto p = rtengine::ImageIOManager::getInstance()->getSaveProfile(o.type);
+        if (p) {
+            p->applyTo(bparams);
+        }
+        r.apply(bparams);
+        
+        outputs.push_back(o);
+        branches.emplace_back(bparams);
+        branches.back().kernel = r.kernel;
+        outparams.push_back(bparams);
+    }
+
+    int errorCode = 0;
+    auto imgs = rtengine::processImage(job, branches, errorCode, pl);
+    if (imgs.size() != outputs.size()) {
+        cpl.error(Glib::ustring::compose("failure in processing: %1", outputFile));
+        for (auto img : imgs) {
+            img->free();
+        }
+        return false;
+    }
+
+    // encoding is mostly single-threaded, so save all the outputs at once
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        outputs[i].img = imgs[i];
+        workers.emplace_back(
+            [&](Output &o) -> void
+            {
+                o.error = save_output(o.img, o.type, o.fname, o.compression, subsampling, o.bits, o.isFloat);
+            }, std::ref(outputs[i]));
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        auto &o = outputs[i];
+        if (o.error) {
+            ok = false;
+            cpl.error(Glib::ustring::compose("failure in saving to: %1", o.fname));
+        } else if (copyParamsFile) {
+            auto &oparams = outparams[i];
+            Glib::ustring outputProcessingParams = o.fname + paramFileExtension;
+            if (!options.params_out_embed || oparams.saveEmbedded(pl, o.fname) != 0) {
+                oparams.save(pl, outputProcessingParams);
+            }
+        }
+        o.img->free();
+    }
+    
+    return ok;
+}
+
+} // namespace
+
+
 int processLineParams ( int argc, char **argv )
 {
     PartialProfile rawParams, imgParams;
@@ -370,6 +634,7 @@ int processLineParams ( int argc, char **argv )
     int bits = -1;
     bool isFloat = false;
     std::string outputType = "";
+    std::vector<OutputRecipe> recipes;
     unsigned errors = 0;
 
     for ( int iArg = 1; iArg < argc; iArg++) {
@@ -381,7 +646,15 @@ int processLineParams ( int argc, char **argv )
         if ( currParam.at (0) == '-' && currParam.size() > 1) {
             switch ( currParam.at (1) ) {
             case '-':
-                // GTK --argument, we're skipping it
+                if (currParam.substr(0, 8) == "--trace=") {
+                    Glib::ustring fname = fname_to_utf8(currParam.substr(8).c_str());
+                    if (fname.empty()) {
+                        std::cerr << "Error: --trace requires a file name" << std::endl;
+                        return -3;
+                    }
+                    rtengine::trace::start(fname, options.rtSettings.trace_buffer_size);
+                }
+                // otherwise, GTK --argument, we're skipping it
                 break;
 
             case 'O':
@@ -531,6 +804,21 @@ int processLineParams ( int argc, char **argv )
                 }
                 break;
 
+            case 'x':
+                if (iArg + 1 < argc) {
+                    ++iArg;
+                    OutputRecipe r;
+                    if (!parse_recipe(argv[iArg], recipes.size()+1, r)) {
+                        std::cerr << "Error: invalid output recipe \"" << argv[iArg] << "\"" << std::endl;
+                        return -3;
+                    }
+                    recipes.push_back(r);
+                } else {
+                    std::cerr << "Error: the -x switch requires a mandatory value!" << std::endl;
+                    return -3;
+                }
+                break;
+
             case 'c': // MUST be last option
                 while (iArg + 1 < argc) {
                     iArg++;
@@ -649,15 +937,7 @@ int processLineParams ( int argc, char **argv )
     }
 
     if (bits == -1) {
-        if (outputType == "jpg") {
-            bits = 8;
-        } else if (outputType == "png") {
-            bits = 8;
-        } else if (outputType == "tif") {
-            bits = 16;
-        } else {
-            bits = 32;
-        }
+        bits = default_bits(outputType);
     }
 
     if (!argv1.empty()) {
@@ -864,6 +1144,14 @@ int processLineParams ( int argc, char **argv )
             continue;
         }
 
+        if (!recipes.empty()) {
+            if (!process_multi(job, currentParams, recipes, output_ext, outputFile, outputType, compression, subsampling, bits, isFloat, overwriteFiles, copyParamsFile, cpl, pl)) {
+                errors++;
+            }
+            ii->decreaseRef();
+            continue;
+        }
+
         // Process image
         rtengine::IImagefloat *resultImage = rtengine::processImage(job, errorCode, pl);
 
@@ -875,16 +1163,7 @@ int processLineParams ( int argc, char **argv )
         }
 
         // save image to disk
-        if (outputType == "jpg") {
-            errorCode = resultImage->saveAsJPEG(outputFile, compression, subsampling);
-        } else if (outputType == "tif") {
-            errorCode = resultImage->saveAsTIFF(outputFile, bits, isFloat, compression == 0);
-        } else if (outputType == "png") {
-            errorCode = resultImage->saveAsPNG(outputFile, bits);
-        } else {
-            errorCode = rtengine::ImageIOManager::getInstance()->save(resultImage, outputType, outputFile, nullptr) ? 0 : 1;
-            //errorCode = resultImage->saveToFile(outputFile);
-        }
+        errorCode = save_output(resultImage, outputType, outputFile, compression, subsampling, bits, isFloat);
 
         if (errorCode) {
             errors++;
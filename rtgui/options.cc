@@ -574,6 +574,11 @@ void Options::setDefaults()
 #endif
     rtSettings.thread_pool_size = 0;
     rtSettings.ctl_scripts_fast_preview = true;
+    rtSettings.preview_half_float_cache = false;
+    rtSettings.trace_file = "";
+    rtSettings.trace_buffer_size = 1 << 20;
+    rtSettings.decoded_raw_cache_size = 0;
+    rtSettings.defect_map_images = 0;
     show_exiftool_makernotes = false;
 
     browser_width_for_inspector = 0;
@@ -1147,6 +1152,26 @@ void Options::readFromFile(Glib::ustring fname)
                 if (keyFile.has_key("Performance", "CTLScriptsFastPreview")) {
                     rtSettings.ctl_scripts_fast_preview = keyFile.get_boolean("Performance", "CTLScriptsFastPreview");
                 }
+
+                if (keyFile.has_key("Performance", "PreviewHalfFloatCache")) {
+                    rtSettings.preview_half_float_cache = keyFile.get_boolean("Performance", "PreviewHalfFloatCache");
+                }
+
+                if (keyFile.has_key("Performance", "TraceFile")) {
+                    rtSettings.trace_file = keyFile.get_string("Performance", "TraceFile");
+                }
+
+                if (keyFile.has_key("Performance", "TraceBufferSize")) {
+                    rtSettings.trace_buffer_size = keyFile.get_integer("Performance", "TraceBufferSize");
+                }
+
+                if (keyFile.has_key("Performance", "DecodedRawCacheSize")) {
+                    rtSettings.decoded_raw_cache_size = keyFile.get_integer("Performance", "DecodedRawCacheSize");
+                }
+
+                if (keyFile.has_key("Performance", "DefectMapImages")) {
+                    rtSettings.defect_map_images = keyFile.get_integer("Performance", "DefectMapImages");
+                }
             }
 
             if (keyFile.has_group("Inspector")) {
@@ -1886,6 +1911,11 @@ void Options::saveToFile(Glib::ustring fname)
         keyFile.set_boolean("Performance", "ThumbLazyCaching", thumb_lazy_caching);
         keyFile.set_boolean("Performance", "ThumbCacheProcessed", thumb_cache_processed);
         keyFile.set_boolean("Performance", "CTLScriptsFastPreview", rtSettings.ctl_scripts_fast_preview);
+        keyFile.set_boolean("Performance", "PreviewHalfFloatCache", rtSettings.preview_half_float_cache);
+        keyFile.set_string("Performance", "TraceFile", rtSettings.trace_file);
+        keyFile.set_integer("Performance", "TraceBufferSize", rtSettings.trace_buffer_size);
+        keyFile.set_integer("Performance", "DecodedRawCacheSize", rtSettings.decoded_raw_cache_size);
+        keyFile.set_integer("Performance", "DefectMapImages", rtSettings.defect_map_images);
         
         keyFile.set_integer("Performance", "WBPreviewMode", wb_preview_mode);
         keyFile.set_integer("Inspector", "Mode", int(rtSettings.thumbnail_inspector_mode));
@@ -2276,6 +2306,8 @@ void Options::load(bool lightweight, int verbose)
         printf("Cache directory (cacheBaseDir) = %s\n", cacheBaseDir.c_str());
     }
 
+    options.rtSettings.cacheDirectory = cacheBaseDir;
+
     // Update profile's path and recreate it if necessary
     options.updatePaths();
 
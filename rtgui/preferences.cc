@@ -415,6 +415,9 @@ Gtk::Widget* Preferences::getPerformancePanel ()
 #ifdef ART_USE_CTL
     vb->pack_start(*ctl_scripts_fast_preview_);
 #endif
+    preview_half_float_cache_ = Gtk::manage(new Gtk::CheckButton(M("PREFERENCES_PREVIEW_HALF_FLOAT_CACHE")));
+    preview_half_float_cache_->set_tooltip_text(M("PREFERENCES_PREVIEW_HALF_FLOAT_CACHE_TOOLTIP"));
+    vb->pack_start(*preview_half_float_cache_);
     fprevdemo->add(*vb);
     vbPerformance->pack_start (*fprevdemo, Gtk::PACK_SHRINK, 4);
 
@@ -1894,6 +1897,7 @@ void Preferences::storePreferences ()
     moptions.thumb_lazy_caching = thumbLazyCaching->get_active();
     moptions.thumb_cache_processed = thumb_cache_processed_->get_active();
     moptions.rtSettings.ctl_scripts_fast_preview = ctl_scripts_fast_preview_->get_active();
+    moptions.rtSettings.preview_half_float_cache = preview_half_float_cache_->get_active();
 
 // Sounds only on Windows and Linux
 #if defined(WIN32) || defined(__linux__)
@@ -2161,6 +2165,7 @@ void Preferences::fillPreferences ()
     thumbLazyCaching->set_active(moptions.thumb_lazy_caching);
     thumb_cache_processed_->set_active(moptions.thumb_cache_processed);
     ctl_scripts_fast_preview_->set_active(moptions.rtSettings.ctl_scripts_fast_preview);
+    preview_half_float_cache_->set_active(moptions.rtSettings.preview_half_float_cache);
 
     if (!moptions.rtSettings.darkFramesPath.empty()) {
         darkFrameDir->set_current_folder(moptions.rtSettings.darkFramesPath);
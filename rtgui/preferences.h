@@ -156,6 +156,7 @@ class Preferences : public Gtk::Dialog, public ProfileStoreListener {
     Gtk::CheckButton *thumbLazyCaching;
     Gtk::CheckButton *thumb_cache_processed_;
     Gtk::CheckButton *ctl_scripts_fast_preview_;
+    Gtk::CheckButton *preview_half_float_cache_;
 
     // Gtk::CheckButton* ckbmenuGroupRank;
     // Gtk::CheckButton* ckbmenuGroupLabel;
@@ -47,7 +47,7 @@ inline void ART_print_help(std::ostream &out, const char *progname, bool gui)
         out << "  " << pn << " --check-lut <lut-filename>   Check the validity of the given LUT file." << std::endl;
         out << std::endl;
         out << "Options:" << std::endl;
-        out << "  " << pn << "[-o <output>|-O <output>] [-q] [-a] [-s|-S] [-p <one" << paramFileExtension << "> [-p <two" << paramFileExtension << "> ...] ] [-d] [ -j[1-100] -js<1-3> | -t[z] -b<8|16|16f|32> | -n -b<8|16> | -Ttype ] [-Y] [-f] -c <input>" << std::endl;
+        out << "  " << pn << "[-o <output>|-O <output>] [-q] [-a] [-s|-S] [-p <one" << paramFileExtension << "> [-p <two" << paramFileExtension << "> ...] ] [-d] [ -j[1-100] -js<1-3> | -t[z] -b<8|16|16f|32> | -n -b<8|16> | -Ttype ] [-x <recipe> ...] [-Y] [-f] -c <input>" << std::endl;
         out << std::endl;
         out << "  -c <files>       Specify one or more input files or folders. When specifying\n"
             << "                   folders, ART will look for image file types which comply with\n"
@@ -96,10 +96,29 @@ inline void ART_print_help(std::ostream &out, const char *progname, bool gui)
         out << "                   Compression is hard-coded to PNG_FILTER_PAETH, Z_RLE." << std::endl;
         out << "  -Ttype           Select the given (custom) output type. Must be supported\n"
             << "                   by a user-defined custom image saver." << std::endl;
+        out << "  -x <recipe>      Save an additional output from the same processing run.\n"
+            << "                   Can be given multiple times. <recipe> is a comma-separated\n"
+            << "                   list of key=value settings, e.g.\n"
+            << "                   \"suffix=_web,type=jpg,q=85,size=2048x2048,icc=RTv4_sRGB\"\n"
+            << "                   suffix=<s>    appended to the output file name (default: _N)\n"
+            << "                   type=<t>      jpg, png, tif, tifz or a custom type\n"
+            << "                   q=<1-100>     JPEG quality\n"
+            << "                   bits=<8|16|16f|32>  bit depth per channel\n"
+            << "                   size=<W>x<H>|full, width=<W>, height=<H>, scale=<s>\n"
+            << "                                 resize (overrides the profile)\n"
+            << "                   icc=<name>    output color profile\n"
+            << "                   sharpen=<0|1> output sharpening\n"
+            << "                   kernel=<k>    resampling kernel: lanczos (default),\n"
+            << "                                 mitchell or box\n"
+            << "                   Unspecified settings are taken from the main output and\n"
+            << "                   the processing profile. Implies the normal pipeline." << std::endl;
         out << "  -Y               Overwrite output if present." << std::endl;
         out << "  -f               Use the custom fast-export processing pipeline." << std::endl;
         out << "  -V               Verbose output." << std::endl;
         out << "  --progress       Show progress info in a format compatible with zenity." << std::endl;
+        out << "  --trace=<file>   Record a trace of the processing steps and save it to <file>\n"
+            << "                   in the Chrome trace-event JSON format (for chrome://tracing\n"
+            << "                   or https://ui.perfetto.dev)." << std::endl;
         out << std::endl;
         out << "Your " << pparamsExt << " files can be incomplete, ART will build the final values as follows:" << std::endl;
         out << "  1- A new processing profile is created using neutral values," << std::endl;
@@ -14,7 +14,6 @@
  *  You should have received a copy of the GNU General Public License
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <numeric>
 #include <iostream>
 
 #include <glibmm.h>
@@ -22,6 +21,7 @@
 #include "multilangmgr.h"
 #include "options.h"
 #include "thumbbrowserbase.h"
+#include "thumbbrowserlayout.h"
 
 #include "../rtengine/mytime.h"
 #include "../rtengine/rt_math.h"
@@ -30,6 +30,7 @@ using namespace std;
 
 ThumbBrowserBase::ThumbBrowserBase ()
     : location(THLOC_FILEBROWSER), inspector(nullptr), isInspectorActive(false), eventTime(0), lastClicked(nullptr), anchor(nullptr), previewHeight(options.thumbSize), numOfCols(1), arrangement(TB_Horizontal),
+      layoutValid(false), layoutArrangement(TB_Horizontal), layoutRowHeight(0), layoutAvailWidth(0),
       use_hscroll_(true),
       use_vscroll_(true)
 {
@@ -629,117 +630,71 @@ void ThumbBrowserBase::arrangeFiles(bool checkfilter)
     // We could lock it one more time, there's no harm excepted (negligible) speed penalty
     //GThreadLock lock;
 
-    int rowHeight = 0;
-    for (const auto entry : fd) {
-        if (checkfilter) {
+    if (checkfilter) {
+        for (const auto entry : fd) {
             // apply filter
             entry->filtered = !checkFilter(entry);
         }
-
-        // compute size of the items
-        if (!entry->filtered) {
-            rowHeight = std::max(entry->getMinimalHeight(), rowHeight);
-        }
     }
-    if (arrangement == TB_Horizontal) {
-        numOfCols = 1;
 
-        int currx = 0;
+    // compute size of the items
+    const int rowHeight = thumbbrowserlayout::rowHeight(fd);
 
-        for (unsigned int ct = 0; ct < fd.size(); ++ct) {
-            // arrange items in the column
-            int curry = 0;
+    layoutArrangement = arrangement;
+    layoutRowHeight = rowHeight;
 
-            for (; ct < fd.size() && fd[ct]->filtered; ++ct) {
-                fd[ct]->drawable = false;
-            }
-
-            if (ct < fd.size()) {
-                const int maxw = fd[ct]->getMinimalWidth();
+    if (arrangement == TB_Horizontal) {
+        numOfCols = 1;
 
-                fd[ct]->setPosition(currx, curry, maxw, rowHeight);
-                fd[ct]->drawable = true;
-                currx += maxw;
-                curry += rowHeight;
-            }
-        }
+        const int currx = thumbbrowserlayout::arrangeRow(fd, rowHeight);
+        layoutValid = true;
 
         MYREADERLOCK_RELEASE(l);
         // This will require a Writer access
         resizeThumbnailArea(currx, !fd.empty() ? fd[0]->getEffectiveHeight() : rowHeight);
     } else {
         const int availWidth = internal.get_width();
+        const auto size = thumbbrowserlayout::arrangeGrid(fd, rowHeight, availWidth, numOfCols, &layoutColWidths);
+        layoutAvailWidth = availWidth;
+        // with a single row, the number of columns might still grow with
+        // new entries
+        layoutValid = size.second > rowHeight;
 
-        // initial number of columns
-        numOfCols = 0;
-        int colsWidth = 0;
-
-        for (unsigned int i = 0; i < fd.size(); ++i) {
-            if (!fd[i]->filtered && colsWidth + fd[i]->getMinimalWidth() <= availWidth) {
-                colsWidth += fd[numOfCols]->getMinimalWidth();
-                ++numOfCols;
-                if(colsWidth > availWidth) {
-                    break;
-                }
-            }
-        }
-
-        if (numOfCols < 1) {
-            numOfCols = 1;
-        }
-
-        std::vector<int> colWidths;
-
-        for (; numOfCols > 0; --numOfCols) {
-            // compute column widths
-            colWidths.assign(numOfCols, 0);
-
-            for (unsigned int i = 0, j = 0; i < fd.size(); ++i) {
-                if (!fd[i]->filtered && fd[i]->getMinimalWidth() > colWidths[j % numOfCols]) {
-                    colWidths[j % numOfCols] = fd[i]->getMinimalWidth();
-                }
-
-                if (!fd[i]->filtered) {
-                    ++j;
-                }
-            }
-
-            // if not wider than the space available, arrange it and we are ready
-            colsWidth = std::accumulate(colWidths.begin(), colWidths.end(), 0);
-
-            if (numOfCols == 1 || colsWidth < availWidth) {
-                break;
-            }
-        }
+        MYREADERLOCK_RELEASE(l);
+        // This will require a Writer access
+        resizeThumbnailArea(size.first, size.second);
+    }
+}
 
-        // arrange files
-        int curry = 0;
+void ThumbBrowserBase::arrangeNewFiles(size_t first)
+{
+    MYREADERLOCK(l, entryRW);
 
-        for (unsigned int ct = 0; ct < fd.size();) {
-            // arrange items in the row
+    // with first == 0 nothing is left of the previous layout (e.g. fd was
+    // cleared in the meantime)
+    if (layoutValid && layoutArrangement == arrangement && first > 0 && first <= fd.size()) {
+        if (arrangement == TB_Horizontal) {
             int currx = 0;
 
-            for (int i = 0; ct < fd.size() && i < numOfCols; ++i, ++ct) {
-                for (; ct < fd.size() && fd[ct]->filtered; ++ct) {
-                    fd[ct]->drawable = false;
-                }
-
-                if (ct < fd.size()) {
-                    fd[ct]->setPosition(currx, curry, colWidths[i], rowHeight);
-                    fd[ct]->drawable = true;
-                    currx += colWidths[i];
-                }
+            if (thumbbrowserlayout::updateRow(fd, first, layoutRowHeight, currx)) {
+                MYREADERLOCK_RELEASE(l);
+                resizeThumbnailArea(currx, !fd.empty() ? fd[0]->getEffectiveHeight() : layoutRowHeight);
+                return;
             }
+        } else if (layoutAvailWidth == internal.get_width()) {
+            std::pair<int, int> size;
 
-            if (currx > 0) { // there were thumbnails placed in the row
-                curry += rowHeight;
+            if (thumbbrowserlayout::updateGrid(fd, first, layoutRowHeight, layoutColWidths, size)) {
+                MYREADERLOCK_RELEASE(l);
+                resizeThumbnailArea(size.first, size.second);
+                return;
             }
         }
-
-        MYREADERLOCK_RELEASE(l);
-        // This will require a Writer access
-        resizeThumbnailArea (colsWidth, curry);
     }
+
+    // the new entries don't fit in the current layout
+    MYREADERLOCK_RELEASE(l);
+    arrangeFiles(false);
 }
 
 void ThumbBrowserBase::disableInspector()
@@ -1057,6 +1012,13 @@ void ThumbBrowserBase::redraw (bool checkfilter)
     queue_draw();
 }
 
+void ThumbBrowserBase::redrawNew (size_t first)
+{
+    GThreadLock lock;
+    arrangeNewFiles(first);
+    queue_draw();
+}
+
 void ThumbBrowserBase::zoomChanged (bool zoomIn)
 {
 
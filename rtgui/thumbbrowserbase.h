@@ -186,12 +186,22 @@ protected:
     int numOfCols;
 
     Arrangement arrangement;
+
+    // the last full layout, which arrangeNewFiles() extends
+    bool layoutValid;
+    Arrangement layoutArrangement;
+    int layoutRowHeight;
+    int layoutAvailWidth;
+    std::vector<int> layoutColWidths;
     bool use_hscroll_;
     bool use_vscroll_;
 
     std::set<Glib::ustring> editedFiles;
 
     void arrangeFiles (bool checkfilter = true);
+    // like arrangeFiles(false), after new entries have been merged into fd
+    // at first or after it (see thumbbrowserlayout::merge)
+    void arrangeNewFiles (size_t first);
     void zoomChanged (bool zoomIn);
 
 public:
@@ -214,6 +224,7 @@ public:
     }
     void on_style_updated () override;
     void redraw (bool checkfilter = true);   // arrange files and draw area
+    void redrawNew (size_t first);   // arrange the files merged from first on and draw area
     void refreshThumbImages (); // refresh thumbnail sizes, re-generate thumbnail images, arrange and draw
     void refreshQuickThumbImages (); // refresh thumbnail sizes, re-generate thumbnail images, arrange and draw
     void refreshEditedState (const std::set<Glib::ustring>& efiles);
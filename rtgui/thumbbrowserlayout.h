@@ -0,0 +1,288 @@
+/* -*- C++ -*-
+ *
+ *  This file is part of ART.
+ *
+ *  Copyright 2026 Alberto Griggio <alberto.griggio@gmail.com>
+ *
+ *  ART is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ART is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ART.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/*
+ * The insertion of entries and the layout of the thumbnail browsers.
+ *
+ * This is independent of GTK, so that it can also be used by the benchmarks.
+ * Entry must have the "filtered" and "drawable" fields, and the
+ * getMinimalWidth(), getMinimalHeight(), getStartX(), getStartY() and
+ * setPosition(x, y, w, h) methods of ThumbBrowserEntryBase.
+ */
+namespace thumbbrowserlayout {
+
+// merges batch, which must be sorted (e.g. with std::stable_sort), into
+// the already sorted entries, with a single linear pass over the entries
+// from the first position of batch on. Returns that position: the entries
+// before it are unchanged
+template <class Entry, class Less>
+size_t merge(std::vector<Entry *> &entries, const std::vector<Entry *> &batch, Less less)
+{
+    if (batch.empty()) {
+        return entries.size();
+    }
+    const size_t first = std::upper_bound(entries.begin(), entries.end(), batch.front(), less) - entries.begin();
+    const size_t n = entries.size();
+    entries.insert(entries.end(), batch.begin(), batch.end());
+    std::inplace_merge(entries.begin() + first, entries.begin() + n, entries.end(), less);
+    return first;
+}
+
+
+// the height of the rows, i.e. the maximal height of the visible entries
+template <class Entry>
+int rowHeight(const std::vector<Entry *> &entries)
+{
+    int ret = 0;
+    for (const auto entry : entries) {
+        if (!entry->filtered) {
+            ret = std::max(entry->getMinimalHeight(), ret);
+        }
+    }
+    return ret;
+}
+
+
+// arranges the visible entries in a single row, and returns its width
+template <class Entry>
+int arrangeRow(const std::vector<Entry *> &fd, int rowHeight)
+{
+    int currx = 0;
+
+    for (size_t ct = 0; ct < fd.size(); ++ct) {
+        // arrange items in the column
+        int curry = 0;
+
+        for (; ct < fd.size() && fd[ct]->filtered; ++ct) {
+            fd[ct]->drawable = false;
+        }
+
+        if (ct < fd.size()) {
+            const int maxw = fd[ct]->getMinimalWidth();
+
+            fd[ct]->setPosition(currx, curry, maxw, rowHeight);
+            fd[ct]->drawable = true;
+            currx += maxw;
+            curry += rowHeight;
+        }
+    }
+
+    return currx;
+}
+
+
+// arranges the visible entries in as many columns as fit in availWidth,
+// whose number is stored in numOfCols, and their widths in colWidthsOut (if
+// given). Returns the size of the grid
+template <class Entry>
+std::pair<int, int> arrangeGrid(const std::vector<Entry *> &fd, int rowHeight, int availWidth, int &numOfCols, std::vector<int> *colWidthsOut = nullptr)
+{
+    // initial number of columns
+    numOfCols = 0;
+    int colsWidth = 0;
+
+    for (size_t i = 0; i < fd.size(); ++i) {
+        if (!fd[i]->filtered && colsWidth + fd[i]->getMinimalWidth() <= availWidth) {
+            colsWidth += fd[numOfCols]->getMinimalWidth();
+            ++numOfCols;
+            if (colsWidth > availWidth) {
+                break;
+            }
+        }
+    }
+
+    if (numOfCols < 1) {
+        numOfCols = 1;
+    }
+
+    std::vector<int> colWidths;
+
+    for (; numOfCols > 0; --numOfCols) {
+        // compute column widths
+        colWidths.assign(numOfCols, 0);
+
+        for (size_t i = 0, j = 0; i < fd.size(); ++i) {
+            if (!fd[i]->filtered && fd[i]->getMinimalWidth() > colWidths[j % numOfCols]) {
+                colWidths[j % numOfCols] = fd[i]->getMinimalWidth();
+            }
+
+            if (!fd[i]->filtered) {
+                ++j;
+            }
+        }
+
+        // if not wider than the space available, arrange it and we are ready
+        colsWidth = std::accumulate(colWidths.begin(), colWidths.end(), 0);
+
+        if (numOfCols == 1 || colsWidth < availWidth) {
+            break;
+        }
+    }
+
+    // arrange files
+    int curry = 0;
+
+    for (size_t ct = 0; ct < fd.size();) {
+        // arrange items in the row
+        int currx = 0;
+
+        for (int i = 0; ct < fd.size() && i < numOfCols; ++i, ++ct) {
+            for (; ct < fd.size() && fd[ct]->filtered; ++ct) {
+                fd[ct]->drawable = false;
+            }
+
+            if (ct < fd.size()) {
+                fd[ct]->setPosition(currx, curry, colWidths[i], rowHeight);
+                fd[ct]->drawable = true;
+                currx += colWidths[i];
+            }
+        }
+
+        if (currx > 0) { // there were thumbnails placed in the row
+            curry += rowHeight;
+        }
+    }
+
+    if (colWidthsOut) {
+        *colWidthsOut = colWidths;
+    }
+
+    return std::make_pair(colsWidth, curry);
+}
+
+
+// After merge(), arranges again only the entries from fd[first] on, in the
+// row laid out by arrangeRow() (with the same rowHeight). Returns false if
+// the new entries are taller than the row: then the whole row must be
+// arranged again
+template <class Entry>
+bool updateRow(const std::vector<Entry *> &fd, size_t first, int rowHeight, int &width)
+{
+    // start right after the last visible entry before first
+    int currx = 0;
+
+    for (size_t i = first; i > 0; --i) {
+        if (!fd[i-1]->filtered) {
+            currx = fd[i-1]->getStartX() + fd[i-1]->getMinimalWidth();
+            break;
+        }
+    }
+
+    for (size_t ct = first; ct < fd.size(); ++ct) {
+        if (fd[ct]->filtered) {
+            fd[ct]->drawable = false;
+        } else if (fd[ct]->getMinimalHeight() > rowHeight) {
+            return false;
+        } else {
+            const int maxw = fd[ct]->getMinimalWidth();
+            fd[ct]->setPosition(currx, 0, maxw, rowHeight);
+            fd[ct]->drawable = true;
+            currx += maxw;
+        }
+    }
+
+    width = currx;
+    return true;
+}
+
+
+// After merge(), arranges again only the entries from fd[first] on, in the
+// grid laid out by arrangeGrid() (with the same rowHeight and colWidths):
+// the entries before first keep their cells. Returns false if some entry
+// does not fit in its cell, in which case the whole grid must be arranged
+// again. Otherwise, the result is the same as arrangeGrid() when all the
+// entries have the same width; with different widths, the grid can have
+// fewer or wider columns than a full layout would give, until the next one
+template <class Entry>
+bool updateGrid(const std::vector<Entry *> &fd, size_t first, int rowHeight, const std::vector<int> &colWidths, std::pair<int, int> &size)
+{
+    const int numOfCols = colWidths.size();
+
+    if (numOfCols == 0) {
+        return false;
+    }
+
+    // start from the cell after the one of the last visible entry before
+    // first
+    int col = 0;
+    int curry = 0;
+
+    for (size_t i = first; i > 0; --i) {
+        const Entry *prev = fd[i-1];
+
+        if (!prev->filtered) {
+            int x = 0;
+
+            for (col = 0; col < numOfCols && x < prev->getStartX(); ++col) {
+                x += colWidths[col];
+            }
+
+            if (col == numOfCols || x != prev->getStartX()) {
+                return false;
+            }
+
+            curry = prev->getStartY();
+
+            if (++col == numOfCols) {
+                col = 0;
+                curry += rowHeight;
+            }
+
+            break;
+        }
+    }
+
+    int currx = std::accumulate(colWidths.begin(), colWidths.begin() + col, 0);
+
+    for (size_t ct = first; ct < fd.size(); ++ct) {
+        Entry *entry = fd[ct];
+
+        if (entry->filtered) {
+            entry->drawable = false;
+            continue;
+        }
+
+        if (entry->getMinimalHeight() > rowHeight || entry->getMinimalWidth() > colWidths[col]) {
+            return false;
+        }
+
+        entry->setPosition(currx, curry, colWidths[col], rowHeight);
+        entry->drawable = true;
+        currx += colWidths[col];
+
+        if (++col == numOfCols) {
+            col = 0;
+            currx = 0;
+            curry += rowHeight;
+        }
+    }
+
+    size.first = std::accumulate(colWidths.begin(), colWidths.end(), 0);
+    size.second = col > 0 ? curry + rowHeight : curry;
+    return true;
+}
+
+} // namespace thumbbrowserlayout